@@ -0,0 +1,458 @@
+#include "app_config.hpp"
+
+#include <iostream>
+#include <string>
+#include <optional>
+#include <stdexcept>
+#include <cstdlib> // std::getenv | _dupenv_s | free
+#include <cctype> // isdigit
+#include <thread> // std::thread::hardware_concurrency
+
+
+// Reads an environment variable, if it is set.
+// getenv() is flagged as unsafe by MSVC (SDL checks), so on Windows we use _dupenv_s.
+static std::optional<std::string> get_env_var(const char* name) {
+
+#ifdef _MSC_VER
+    char* value = nullptr;
+    size_t length = 0;
+    if (_dupenv_s(&value, &length, name) != 0 || value == nullptr) {
+        return std::nullopt;
+    }
+    std::string result(value);
+    free(value);
+    return result;
+#else
+    const char* value = std::getenv(name);
+    if (value == nullptr) {
+        return std::nullopt;
+    }
+    return std::string(value);
+#endif
+}
+
+
+static uint64_t parse_unsigned(const std::string& option, const std::string& value) {
+
+    // std::stoull() skips leading whitespace and wraps negative numbers around
+    // (" -1" = 18446744073709551615): only digits are accepted.
+    try {
+        if (value.empty() || !isdigit(static_cast<unsigned char>(value[0]))) {
+            throw std::invalid_argument(value);
+        }
+        size_t parsed_chars = 0;
+        unsigned long long result = std::stoull(value, &parsed_chars);
+        if (parsed_chars != value.size()) {
+            throw std::invalid_argument(value);
+        }
+        return result;
+    }
+    catch (const std::exception&) {
+        throw std::runtime_error("Invalid value for " + option + ": '" + value + "'! \n");
+    }
+}
+
+
+// The range is checked on the 64 bit value, before narrowing it: 4294967297 must be
+// rejected, not wrap around to 1.
+static uint32_t parse_unsigned_max(const std::string& option, const std::string& value, uint32_t max_value, const char* unit = "") {
+
+    uint64_t result = parse_unsigned(option, value);
+    if (result > max_value) {
+        throw std::runtime_error(option + " must be at most " + std::to_string(max_value) + unit + "! \n");
+    }
+    return static_cast<uint32_t>(result);
+}
+
+
+static bool parse_bool(const std::string& option, const std::string& value) {
+
+    if (value == "1" || value == "true" || value == "on" || value == "yes") {
+        return true;
+    }
+    if (value == "0" || value == "false" || value == "off" || value == "no") {
+        return false;
+    }
+    throw std::runtime_error("Invalid value for " + option + ": '" + value + "'! \n");
+}
+
+
+static PresentProfile parse_present_profile(const std::string& option, const std::string& value) {
+
+    if (value == "low-latency") {
+        return PresentProfile::LowLatency;
+    }
+    if (value == "max-throughput") {
+        return PresentProfile::MaxThroughput;
+    }
+    if (value == "power-saving") {
+        return PresentProfile::PowerSaving;
+    }
+    throw std::runtime_error(
+        "Invalid value for " + option + ": '" + value + "' (low-latency, max-throughput or power-saving)! \n");
+}
+
+
+static LogMode parse_log_mode(const std::string& option, const std::string& value) {
+
+    if (value == "sync") {
+        return LogMode::Sync;
+    }
+    if (value == "async") {
+        return LogMode::Async;
+    }
+    throw std::runtime_error("Invalid value for " + option + ": '" + value + "' (sync or async)! \n");
+}
+
+
+static CullingMode parse_culling_mode(const std::string& option, const std::string& value) {
+
+    if (value == "none") {
+        return CullingMode::None;
+    }
+    if (value == "cpu") {
+        return CullingMode::Cpu;
+    }
+    if (value == "gpu") {
+        return CullingMode::Gpu;
+    }
+    throw std::runtime_error("Invalid value for " + option + ": '" + value + "' (none, cpu or gpu)! \n");
+}
+
+
+static RenderingPath parse_rendering_path(const std::string& option, const std::string& value) {
+
+    if (value == "auto") {
+        return RenderingPath::Auto;
+    }
+    if (value == "render-pass") {
+        return RenderingPath::RenderPass;
+    }
+    if (value == "dynamic") {
+        return RenderingPath::Dynamic;
+    }
+    throw std::runtime_error("Invalid value for " + option + ": '" + value + "' (auto, render-pass or dynamic)! \n");
+}
+
+
+static uint32_t parse_msaa_samples(const std::string& option, const std::string& value) {
+
+    if (value == "max") {
+        return MAX_MSAA_SAMPLES;
+    }
+
+    uint64_t samples = parse_unsigned(option, value);
+    if (samples < 1 || samples > MAX_MSAA_SAMPLES || (samples & (samples - 1)) != 0) {
+        throw std::runtime_error(option + " must be a power of two between 1 and " + std::to_string(MAX_MSAA_SAMPLES) + ", or max! \n");
+    }
+    return static_cast<uint32_t>(samples);
+}
+
+
+static uint32_t parse_job_threads(const std::string& option, const std::string& value) {
+
+    if (value == "auto") {
+        return JOB_THREADS_AUTO;
+    }
+
+    return parse_unsigned_max(option, value, MAX_JOB_THREADS);
+}
+
+
+static void set_frames_in_flight(AppConfig& config, const std::string& option, const std::string& value) {
+
+    uint64_t frames = parse_unsigned(option, value);
+    if (frames < 1 || frames > MAX_FRAMES_IN_FLIGHT_LIMIT) {
+        throw std::runtime_error(
+            option + " must be between 1 and " + std::to_string(MAX_FRAMES_IN_FLIGHT_LIMIT) + "! \n");
+    }
+    config.frames_in_flight = static_cast<uint32_t>(frames);
+}
+
+
+const char* present_profile_to_string(PresentProfile profile) {
+
+    switch (profile) {
+    case PresentProfile::LowLatency:    return "low-latency";
+    case PresentProfile::MaxThroughput: return "max-throughput";
+    case PresentProfile::PowerSaving:   return "power-saving";
+    }
+    return "unknown";
+}
+
+
+const char* culling_mode_to_string(CullingMode mode) {
+
+    switch (mode) {
+    case CullingMode::None: return "none";
+    case CullingMode::Cpu:  return "cpu";
+    case CullingMode::Gpu:  return "gpu";
+    }
+    return "unknown";
+}
+
+
+const char* rendering_path_to_string(RenderingPath path) {
+
+    switch (path) {
+    case RenderingPath::Auto:       return "auto";
+    case RenderingPath::RenderPass: return "render-pass";
+    case RenderingPath::Dynamic:    return "dynamic";
+    }
+    return "unknown";
+}
+
+
+AppConfig parse_app_config(int argc, char* argv[]) {
+
+    AppConfig config;
+
+    // Environment first, so that the command line can override it.
+    if (auto value = get_env_var("VKDEMO_FRAMES_IN_FLIGHT")) {
+        set_frames_in_flight(config, "VKDEMO_FRAMES_IN_FLIGHT", *value);
+    }
+    if (auto value = get_env_var("VKDEMO_MAX_FRAMES")) {
+        config.max_frames = parse_unsigned("VKDEMO_MAX_FRAMES", *value);
+    }
+    if (auto value = get_env_var("VKDEMO_HEADLESS")) {
+        config.headless = parse_bool("VKDEMO_HEADLESS", *value);
+    }
+    if (auto value = get_env_var("VKDEMO_OUTPUT")) {
+        config.output_image = *value;
+    }
+    if (auto value = get_env_var("VKDEMO_DEVICE")) {
+        config.device_selector = *value;
+    }
+    if (auto value = get_env_var("VKDEMO_PIPELINE_CACHE")) {
+        config.pipeline_cache_file = *value;
+    }
+    if (auto value = get_env_var("VKDEMO_PRESENT_PROFILE")) {
+        config.present_profile = parse_present_profile("VKDEMO_PRESENT_PROFILE", *value);
+    }
+    if (auto value = get_env_var("VKDEMO_PROFILE_OUTPUT")) {
+        config.profile_output = *value;
+    }
+    if (auto value = get_env_var("VKDEMO_TRACE")) {
+        config.trace_output = *value;
+    }
+    if (auto value = get_env_var("VKDEMO_LOG_MODE")) {
+        config.log_mode = parse_log_mode("VKDEMO_LOG_MODE", *value);
+    }
+    if (auto value = get_env_var("VKDEMO_MESH_GRID")) {
+        config.mesh_grid = parse_unsigned_max("VKDEMO_MESH_GRID", *value, MAX_MESH_GRID);
+    }
+    if (auto value = get_env_var("VKDEMO_UPLOAD_BUDGET")) {
+        config.upload_budget_kb = parse_unsigned_max("VKDEMO_UPLOAD_BUDGET", *value, MAX_UPLOAD_BUDGET_KB, " KB");
+    }
+    if (auto value = get_env_var("VKDEMO_INSTANCES")) {
+        config.instances = parse_unsigned_max("VKDEMO_INSTANCES", *value, MAX_INSTANCES);
+    }
+    if (auto value = get_env_var("VKDEMO_INSTANCE_DRAWS")) {
+        config.instance_draws = parse_bool("VKDEMO_INSTANCE_DRAWS", *value);
+    }
+    if (auto value = get_env_var("VKDEMO_RECORD_JOBS")) {
+        config.record_jobs = parse_unsigned_max("VKDEMO_RECORD_JOBS", *value, MAX_RECORD_JOBS);
+    }
+    if (auto value = get_env_var("VKDEMO_JOB_THREADS")) {
+        config.job_threads = parse_job_threads("VKDEMO_JOB_THREADS", *value);
+    }
+    if (auto value = get_env_var("VKDEMO_SYNC_PIPELINES")) {
+        config.sync_pipelines = parse_bool("VKDEMO_SYNC_PIPELINES", *value);
+    }
+    if (auto value = get_env_var("VKDEMO_CULLING")) {
+        config.culling = parse_culling_mode("VKDEMO_CULLING", *value);
+    }
+    if (auto value = get_env_var("VKDEMO_RENDERING")) {
+        config.rendering = parse_rendering_path("VKDEMO_RENDERING", *value);
+    }
+    if (auto value = get_env_var("VKDEMO_SORT_DRAWS")) {
+        config.sort_draws = parse_bool("VKDEMO_SORT_DRAWS", *value);
+    }
+    if (auto value = get_env_var("VKDEMO_MSAA")) {
+        config.msaa_samples = parse_msaa_samples("VKDEMO_MSAA", *value);
+    }
+    if (auto value = get_env_var("VKDEMO_SWAPCHAIN_IMAGES")) {
+        config.swapchain_images = parse_unsigned_max("VKDEMO_SWAPCHAIN_IMAGES", *value, UINT32_MAX);
+    }
+
+    for (int i = 1; i < argc; i++) {
+
+        std::string option = argv[i];
+
+        // Flags without a value
+        if (option == "--headless") {
+            config.headless = true;
+            continue;
+        }
+        if (option == "--sync-pipelines") {
+            config.sync_pipelines = true;
+            continue;
+        }
+        if (option == "--instance-draws") {
+            config.instance_draws = true;
+            continue;
+        }
+        if (option == "--sort-draws") {
+            config.sort_draws = true;
+            continue;
+        }
+
+        // Every other option takes exactly one value.
+        if (i + 1 >= argc) {
+            throw std::runtime_error("Missing value for command line option " + option + "! \n");
+        }
+        std::string value = argv[++i];
+
+        if (option == "--frames-in-flight") {
+            set_frames_in_flight(config, option, value);
+        }
+        else if (option == "--max-frames") {
+            config.max_frames = parse_unsigned(option, value);
+        }
+        else if (option == "--output") {
+            config.output_image = value;
+        }
+        else if (option == "--device") {
+            config.device_selector = value;
+        }
+        else if (option == "--pipeline-cache") {
+            config.pipeline_cache_file = value;
+        }
+        else if (option == "--present-profile") {
+            config.present_profile = parse_present_profile(option, value);
+        }
+        else if (option == "--swapchain-images") {
+            config.swapchain_images = parse_unsigned_max(option, value, UINT32_MAX);
+        }
+        else if (option == "--profile-output") {
+            config.profile_output = value;
+        }
+        else if (option == "--trace") {
+            config.trace_output = value;
+        }
+        else if (option == "--log-mode") {
+            config.log_mode = parse_log_mode(option, value);
+        }
+        else if (option == "--mesh-grid") {
+            config.mesh_grid = parse_unsigned_max(option, value, MAX_MESH_GRID);
+        }
+        else if (option == "--upload-budget") {
+            config.upload_budget_kb = parse_unsigned_max(option, value, MAX_UPLOAD_BUDGET_KB, " KB");
+        }
+        else if (option == "--instances") {
+            config.instances = parse_unsigned_max(option, value, MAX_INSTANCES);
+        }
+        else if (option == "--record-jobs") {
+            config.record_jobs = parse_unsigned_max(option, value, MAX_RECORD_JOBS);
+        }
+        else if (option == "--job-threads") {
+            config.job_threads = parse_job_threads(option, value);
+        }
+        else if (option == "--culling") {
+            config.culling = parse_culling_mode(option, value);
+        }
+        else if (option == "--rendering") {
+            config.rendering = parse_rendering_path(option, value);
+        }
+        else if (option == "--msaa") {
+            config.msaa_samples = parse_msaa_samples(option, value);
+        }
+        else if (option == "--bench") {
+            config.benchmark = value;
+        }
+        else if (option == "--self-test") {
+            config.self_test = value;
+        }
+        else {
+            throw std::runtime_error("Unknown command line option: " + option + " \n");
+        }
+    }
+
+    if (config.pipeline_cache_file == "none") {
+        config.pipeline_cache_file.clear();
+    }
+
+    // The culled draws come from the draw list of the mesh, they know nothing about instances.
+    if (config.instances > 0 && config.culling != CullingMode::None) {
+        throw std::runtime_error("--instances can't be combined with --culling! \n");
+    }
+
+    if (config.job_threads == JOB_THREADS_AUTO) {
+        uint32_t hardware_threads = std::thread::hardware_concurrency();
+        config.job_threads = hardware_threads > 1 ? hardware_threads - 1 : 0;
+    }
+
+    if (config.headless && config.max_frames == 0) {
+        config.max_frames = DEFAULT_HEADLESS_MAX_FRAMES;
+    }
+
+    if (!config.output_image.empty() && !config.headless) {
+        throw std::runtime_error("--output is only supported together with --headless! \n");
+    }
+
+    return config;
+}
+
+
+void print_app_config(const AppConfig& config) {
+
+    std::cout << "Demo configuration: \n";
+    std::cout << "\t Mode: " << (config.headless ? "headless (offscreen)" : "windowed") << ". \n";
+    std::cout << "\t Frames in flight: " << config.frames_in_flight << ". \n";
+    if (config.max_frames > 0) {
+        std::cout << "\t Max frames: " << config.max_frames << ". \n";
+    }
+    else {
+        std::cout << "\t Max frames: unlimited. \n";
+    }
+    if (!config.output_image.empty()) {
+        std::cout << "\t Output image: " << config.output_image << ". \n";
+    }
+    if (!config.device_selector.empty()) {
+        std::cout << "\t Device: " << config.device_selector << ". \n";
+    }
+    std::cout << "\t Pipeline cache: "
+        << (config.pipeline_cache_file.empty() ? "disabled" : config.pipeline_cache_file) << ". \n";
+    if (!config.headless) {
+        std::cout << "\t Present profile: " << present_profile_to_string(config.present_profile) << ". \n";
+        if (config.swapchain_images > 0) {
+            std::cout << "\t Swapchain images: " << config.swapchain_images << ". \n";
+        }
+    }
+    if (!config.profile_output.empty()) {
+        std::cout << "\t Profile output: " << config.profile_output << ". \n";
+    }
+    if (!config.trace_output.empty()) {
+        std::cout << "\t Trace output: " << config.trace_output << ". \n";
+    }
+    if (config.mesh_grid > 0) {
+        std::cout << "\t Mesh: " << config.mesh_grid << " x " << config.mesh_grid << " grid. \n";
+    }
+    if (config.upload_budget_kb > 0) {
+        std::cout << "\t Upload budget: " << config.upload_budget_kb << " KB per frame (streamed). \n";
+    }
+    if (config.instances > 0) {
+        std::cout << "\t Instances: " << config.instances
+            << (config.instance_draws ? " (one draw call each)" : " (instanced draw)") << ". \n";
+    }
+    std::cout << "\t Job threads: " << config.job_threads << " + main thread. \n";
+    if (config.record_jobs > 0) {
+        std::cout << "\t Record jobs: " << config.record_jobs << ". \n";
+    }
+    else {
+        std::cout << "\t Record jobs: none (inline). \n";
+    }
+    std::cout << "\t Culling: " << culling_mode_to_string(config.culling) << ". \n";
+    std::cout << "\t Rendering: " << rendering_path_to_string(config.rendering) << ". \n";
+    std::cout << "\t Draw order: " << (config.sort_draws ? "front to back" : "draw list") << ". \n";
+    std::cout << "\t MSAA: " << config.msaa_samples << "x (requested). \n";
+    std::cout << "\t Pipelines: " << (config.sync_pipelines ? "compiled before the first frame" : "compiled in the background") << ". \n";
+    std::cout << "\t Log mode: " << (config.log_mode == LogMode::Async ? "async" : "sync") << ". \n";
+    if (!config.benchmark.empty()) {
+        std::cout << "\t Benchmark: " << config.benchmark << ". \n";
+    }
+    if (!config.self_test.empty()) {
+        std::cout << "\t Self test: " << config.self_test << ". \n";
+    }
+    std::cout << "\n";
+}
@@ -0,0 +1,205 @@
+#pragma once
+
+#include <cstdint> // uint32_t | uint64_t
+#include <string>
+
+#include "vk_log.hpp" // LogMode
+
+
+// Upper bound for the number of frames the CPU is allowed to work ahead of the GPU.
+// Going past 3 only adds latency without improving the throughput.
+const uint32_t MAX_FRAMES_IN_FLIGHT_LIMIT = 3;
+
+// Without a window there is nothing that closes the main loop,
+// so headless runs stop after this many frames unless told otherwise.
+const uint64_t DEFAULT_HEADLESS_MAX_FRAMES = 1000;
+
+// Largest --record-jobs accepted.
+const uint32_t MAX_RECORD_JOBS = 64;
+
+// Largest --job-threads accepted, and the value of "auto" until it is resolved.
+const uint32_t MAX_JOB_THREADS = 256;
+const uint32_t JOB_THREADS_AUTO = UINT32_MAX;
+
+// Largest --mesh-grid accepted (the index count must fit in 32 bits, with a wide margin:
+// 4096 x 4096 cells is already ~16.8M vertices, 336 MB).
+const uint32_t MAX_MESH_GRID = 4096;
+
+// Largest --instances accepted (80 bytes of instance data per instance and per frame in flight).
+const uint32_t MAX_INSTANCES = 1000000;
+
+// Largest --msaa accepted (VK_SAMPLE_COUNT_64_BIT), and the value of "max".
+const uint32_t MAX_MSAA_SAMPLES = 64;
+
+// Largest --upload-budget accepted, in KB (the staging buffer is a few times this).
+const uint32_t MAX_UPLOAD_BUDGET_KB = 256 * 1024;
+
+
+// How the swapchain trades latency, frame rate and power (see vk_swapchain.cpp).
+enum class PresentProfile {
+
+    LowLatency,    // IMMEDIATE or MAILBOX, as few images as possible
+    MaxThroughput, // MAILBOX or IMMEDIATE, one extra image so the GPU never waits for the display
+    PowerSaving    // FIFO_RELAXED or FIFO, capped at the refresh rate
+};
+
+const char* present_profile_to_string(PresentProfile profile);
+
+
+// Which draws of the draw list are recorded (see vk_culling.hpp).
+enum class CullingMode {
+
+    None, // Every draw, one vkCmdDrawIndexed() each
+    Cpu,  // Frustum culled on the CPU (SIMD), visible draws written to an indirect buffer
+    Gpu   // Frustum culled by a compute shader, drawn with a single indirect draw
+};
+
+const char* culling_mode_to_string(CullingMode mode);
+
+
+// How the graphics passes are begun (see vk_render_graph.hpp).
+enum class RenderingPath {
+
+    Auto,       // Dynamic rendering if the device supports it, render passes otherwise
+    RenderPass, // VkRenderPass and VkFramebuffer objects
+    Dynamic     // vkCmdBeginRendering() (Vulkan 1.3), no render pass or framebuffer
+};
+
+const char* rendering_path_to_string(RenderingPath path);
+
+
+// Runtime options of the demo. Every option can be set from the command line
+// or from an environment variable (the command line wins if both are set).
+struct AppConfig {
+
+    // --frames-in-flight <N> | VKDEMO_FRAMES_IN_FLIGHT
+    // How many frames can be recorded/submitted while the GPU is still working
+    // on the previous ones. 1 means CPU and GPU are fully serialized.
+    uint32_t frames_in_flight = 2;
+
+    // --max-frames <N> | VKDEMO_MAX_FRAMES
+    // Stop the main loop after N frames (0 = run until the window is closed).
+    // Useful to get reproducible measurements.
+    uint64_t max_frames = 0;
+
+    // --headless | VKDEMO_HEADLESS=1
+    // Render into offscreen images without creating a window, a surface or a swapchain.
+    // Nothing is presented, so there is no compositor or vsync limiting the frame rate.
+    bool headless = false;
+
+    // --output <file.ppm> | VKDEMO_OUTPUT
+    // Headless only: write the last rendered frame to a PPM image at exit.
+    std::string output_image;
+
+    // --device <name|uuid> | VKDEMO_DEVICE
+    // Pin the physical device instead of picking the highest scoring one.
+    // Either the device UUID or a (case insensitive) part of the device name.
+    std::string device_selector;
+
+    // --pipeline-cache <file|none> | VKDEMO_PIPELINE_CACHE
+    // Where the pipeline cache is loaded from at startup and saved to at shutdown.
+    // "none" disables the on-disk cache (every run is a cold start).
+    std::string pipeline_cache_file = "pipeline_cache.bin";
+
+    // --present-profile <low-latency|max-throughput|power-saving> | VKDEMO_PRESENT_PROFILE
+    // Picks the present mode and the number of swapchain images.
+    PresentProfile present_profile = PresentProfile::MaxThroughput;
+
+    // --swapchain-images <N> | VKDEMO_SWAPCHAIN_IMAGES
+    // Overrides the number of swapchain images of the profile (0 = profile default).
+    // Clamped to what the surface supports.
+    uint32_t swapchain_images = 0;
+
+    // --profile-output <file.json|file.csv> | VKDEMO_PROFILE_OUTPUT
+    // Write the profiler timings (per frame and percentiles) to a file at exit.
+    std::string profile_output;
+
+    // --trace <file.json> | VKDEMO_TRACE
+    // Record the startup and every frame, and write them as a Chrome trace at exit
+    // (load it in about://tracing or https://ui.perfetto.dev).
+    std::string trace_output;
+
+    // --log-mode <sync|async> | VKDEMO_LOG_MODE
+    // How LOG_*() messages are written (see vk_log.hpp).
+    LogMode log_mode = LogMode::Async;
+
+    // --mesh-grid <N> | VKDEMO_MESH_GRID
+    // Draw a grid of N x N quads instead of a single quad (0 = a single quad).
+    // Gives a mesh of realistic size to measure the upload bandwidth with.
+    uint32_t mesh_grid = 0;
+
+    // --upload-budget <KB> | VKDEMO_UPLOAD_BUDGET
+    // Stream the mesh in through the upload scheduler, at most KB per frame on the transfer
+    // queue, while the frames are rendered (0 = upload it at startup and wait for it).
+    // Needs the timelineSemaphore feature (Vulkan 1.2). See vk_upload_scheduler.hpp.
+    uint32_t upload_budget_kb = 0;
+
+    // --instances <N> | VKDEMO_INSTANCES
+    // Draw the mesh N times with a single instanced draw, every instance with its own
+    // transform and color (0 = draw it once, without instancing). See vk_instancing.hpp.
+    uint32_t instances = 0;
+
+    // --instance-draws | VKDEMO_INSTANCE_DRAWS=1
+    // Draw the N instances with one draw call each instead of one instanced draw.
+    // Same GPU work, N times the draw calls: compare the record and GPU timings of
+    // both to see the draw call overhead (on a software rasterizer like lavapipe too).
+    bool instance_draws = false;
+
+    // --record-jobs <N> | VKDEMO_RECORD_JOBS
+    // Split the draws in N secondary command buffers, recorded in parallel by the
+    // job system (0 = record everything inline on the main thread). See vk_parallel_record.hpp.
+    uint32_t record_jobs = 0;
+
+    // --job-threads <N|auto> | VKDEMO_JOB_THREADS
+    // Worker threads of the job system (see job_system.hpp). The main thread runs jobs
+    // too while it waits for them, so 0 means everything runs on the main thread.
+    // auto = one less than the hardware threads.
+    uint32_t job_threads = JOB_THREADS_AUTO;
+
+    // --sync-pipelines | VKDEMO_SYNC_PIPELINES=1
+    // Compile the pipelines during init_vulkan(), before the first frame, instead of in
+    // the background (see vk_pipeline_compiler.hpp). Every frame then draws the mesh,
+    // which is what reproducible frame time measurements want.
+    bool sync_pipelines = false;
+
+    // --culling <none|cpu|gpu> | VKDEMO_CULLING
+    // Frustum culling of the draw list (see vk_culling.hpp). With gpu the CPU cost of
+    // the draws no longer depends on how many there are. Culled draws are not split
+    // across --record-jobs, they are a single indirect draw.
+    CullingMode culling = CullingMode::None;
+
+    // --rendering <auto|render-pass|dynamic> | VKDEMO_RENDERING
+    // Begin the passes with render pass and framebuffer objects or with dynamic rendering.
+    // Both draw the same frame: compare the record timings of the two to see what the
+    // objects cost (on a software rasterizer like lavapipe too). dynamic fails on devices
+    // without the dynamicRendering feature, auto falls back to render passes.
+    RenderingPath rendering = RenderingPath::Auto;
+
+    // --sort-draws | VKDEMO_SORT_DRAWS=1
+    // Record the draws front to back every frame, so that the depth test rejects the
+    // hidden fragments before they are shaded (see vk_draw_sort.hpp). Culled draws keep
+    // the order of the draw list.
+    bool sort_draws = false;
+
+    // --msaa <1|2|4|8|16|32|64|max> | VKDEMO_MSAA
+    // Samples per pixel of the main pass. The color and depth buffers are multisampled
+    // and the color is resolved into the swapchain image (see vk_render_graph.hpp).
+    // Lowered to the largest count the device supports for color and depth attachments.
+    // --bench msaa measures the GPU time of every supported count.
+    uint32_t msaa_samples = 1;
+
+    // --bench <name>
+    // Run a benchmark instead of the demo (see benchmarks.hpp for the list).
+    std::string benchmark;
+
+    // --self-test <name>
+    // Run a self test instead of the demo (see self_tests.hpp for the list).
+    // Throws (and exits with EXIT_FAILURE) on the first check that fails.
+    std::string self_test;
+};
+
+
+// Builds the configuration from the environment and the command line arguments.
+AppConfig parse_app_config(int argc, char* argv[]);
+
+void print_app_config(const AppConfig& config);
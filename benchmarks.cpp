@@ -0,0 +1,411 @@
+#include "benchmarks.hpp"
+#include "job_system.hpp"
+#include "vk_uniform_ring.hpp"
+#include "vk_culling.hpp"
+
+#include <algorithm> // std::sort
+#include <chrono>
+#include <cmath> // std::ceil
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <thread>
+
+#include <glm/glm.hpp>
+
+
+using bench_clock = std::chrono::steady_clock;
+
+// Default number of iterations when --max-frames is not given.
+const uint64_t DEFAULT_BENCHMARK_FRAMES = 10000;
+
+// CPU work of a simulated frame, so that the logging cost is compared to something.
+const double SIMULATED_FRAME_WORK_US = 50.0;
+
+// The job benchmark is much slower per iteration, it has its own default.
+const uint64_t DEFAULT_JOB_BENCHMARK_ITERATIONS = 200;
+
+// Overhead: empty jobs started and waited for per iteration.
+const uint32_t JOB_BENCHMARK_EMPTY_JOBS = 1000;
+
+// Scaling: jobs per iteration and the CPU work of each of them
+// (about 2.5 ms of work per iteration on a single thread).
+const uint32_t JOB_BENCHMARK_TASKS = 256;
+const double JOB_BENCHMARK_TASK_US = 10.0;
+
+// Uniform blocks written per frame, and the default number of frames.
+const uint32_t UNIFORM_BENCHMARK_BLOCKS = 100000;
+const uint64_t DEFAULT_UNIFORM_BENCHMARK_FRAMES = 200;
+
+// minUniformBufferOffsetAlignment of common GPUs (256 is the largest the spec allows).
+const VkDeviceSize UNIFORM_BENCHMARK_ALIGNMENTS[] = { 16, 64, 256 };
+
+// Object counts of the culling benchmark, and its default number of frames.
+const uint32_t CULLING_BENCHMARK_OBJECTS[] = { 1000, 10000, 100000, 1000000 };
+const uint64_t DEFAULT_CULLING_BENCHMARK_FRAMES = 100;
+
+
+static double percentile(const std::vector<double>& sorted_samples, double p) {
+
+    size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * sorted_samples.size()));
+    return sorted_samples[std::min(std::max<size_t>(rank, 1), sorted_samples.size()) - 1];
+}
+
+
+void print_benchmark_results(const std::string& title, const std::vector<BenchmarkResult>& results) {
+
+    std::cout << "\n" << "Benchmark results: " << title << " \n";
+
+    double baseline_mean = 0.0;
+
+    for (const auto& result : results) {
+
+        if (result.samples_ms.empty()) {
+            continue;
+        }
+
+        std::vector<double> sorted_samples = result.samples_ms;
+        std::sort(sorted_samples.begin(), sorted_samples.end());
+
+        double sum = 0.0;
+        for (double sample : sorted_samples) {
+            sum += sample;
+        }
+        double mean = sum / sorted_samples.size();
+        if (baseline_mean == 0.0) {
+            baseline_mean = mean;
+        }
+
+        std::cout << "\t " << result.name
+            << ": mean " << mean << " ms"
+            << " | p50 " << percentile(sorted_samples, 50.0) << " ms"
+            << " | p95 " << percentile(sorted_samples, 95.0) << " ms"
+            << " | p99 " << percentile(sorted_samples, 99.0) << " ms"
+            << " | x" << (baseline_mean / mean) << " vs " << results.front().name << ". \n";
+    }
+    std::cout << "\n";
+}
+
+
+static void simulate_cpu_work(double microseconds) {
+
+    bench_clock::time_point start = bench_clock::now();
+    while (std::chrono::duration<double, std::micro>(bench_clock::now() - start).count() < microseconds) {
+    }
+}
+
+
+static void simulate_frame_work() {
+
+    simulate_cpu_work(SIMULATED_FRAME_WORK_US);
+}
+
+
+// Every simulated frame logs the two lines record_command_buffer() used to print,
+// once with std::cout + std::endl (as before) and once with the async logger.
+static void benchmark_logging(uint64_t frames) {
+
+    std::vector<BenchmarkResult> results(2);
+    results[0].name = "iostream (sync)";
+    results[1].name = "ring buffer (async)";
+
+    for (auto& result : results) {
+        result.samples_ms.reserve(frames);
+    }
+
+    for (uint64_t frame = 0; frame < frames; frame++) {
+
+        bench_clock::time_point start = bench_clock::now();
+        simulate_frame_work();
+        std::cout << "Begin recording command buffer(s). " << frame << std::endl;
+        std::cout << "Finished recording command buffer(s). " << frame << std::endl;
+        results[0].samples_ms.push_back(std::chrono::duration<double, std::milli>(bench_clock::now() - start).count());
+    }
+
+    start_logger(LogMode::Async);
+
+    for (uint64_t frame = 0; frame < frames; frame++) {
+
+        bench_clock::time_point start = bench_clock::now();
+        simulate_frame_work();
+        LOG_INFO("Begin recording command buffer(s). %llu", static_cast<unsigned long long>(frame));
+        LOG_INFO("Finished recording command buffer(s). %llu", static_cast<unsigned long long>(frame));
+        results[1].samples_ms.push_back(std::chrono::duration<double, std::milli>(bench_clock::now() - start).count());
+    }
+
+    flush_log();
+
+    print_benchmark_results("logging, " + std::to_string(frames) + " frames", results);
+}
+
+
+// Runs iterations batches of jobs_count jobs and returns the time of every batch,
+// from the first job started to the wait returning.
+static BenchmarkResult time_job_batches(
+    const std::string& name,
+    uint32_t worker_threads, uint64_t iterations,
+    uint32_t jobs_count, double job_work_us) {
+
+    BenchmarkResult result;
+    result.name = name;
+    result.samples_ms.reserve(iterations);
+
+    JobSystem job_system;
+    create_job_system(job_system, worker_threads);
+
+    for (uint64_t iteration = 0; iteration < iterations; iteration++) {
+
+        bench_clock::time_point start = bench_clock::now();
+
+        JobCounter counter;
+        for (uint32_t i = 0; i < jobs_count; i++) {
+            run_job(job_system, [job_work_us]() {
+                if (job_work_us > 0.0) {
+                    simulate_cpu_work(job_work_us);
+                }
+            }, counter);
+        }
+        wait_for_counter(job_system, counter);
+
+        result.samples_ms.push_back(std::chrono::duration<double, std::milli>(bench_clock::now() - start).count());
+    }
+
+    std::cout << "\t " << name << ": " << job_system.executed_jobs.load() << " jobs, "
+        << job_system.stolen_jobs.load() << " stolen. \n";
+
+    destroy_job_system(job_system);
+
+    return result;
+}
+
+
+static void benchmark_jobs(uint64_t iterations) {
+
+    uint32_t hardware_threads = std::max(1u, std::thread::hardware_concurrency());
+
+    std::cout << "Job system benchmark (" << hardware_threads << " hardware threads): \n";
+
+    // Overhead: a plain loop calling the same std::function vs the job system.
+    // The difference divided by JOB_BENCHMARK_EMPTY_JOBS is the cost of a job.
+    std::vector<BenchmarkResult> overhead_results(1);
+    overhead_results[0].name = "plain loop";
+    for (uint64_t iteration = 0; iteration < iterations; iteration++) {
+
+        bench_clock::time_point start = bench_clock::now();
+
+        std::function<void()> function = []() {};
+        for (uint32_t i = 0; i < JOB_BENCHMARK_EMPTY_JOBS; i++) {
+            function();
+        }
+
+        overhead_results[0].samples_ms.push_back(std::chrono::duration<double, std::milli>(bench_clock::now() - start).count());
+    }
+    overhead_results.push_back(time_job_batches("1 thread", 0, iterations, JOB_BENCHMARK_EMPTY_JOBS, 0.0));
+    if (hardware_threads > 1) {
+        overhead_results.push_back(time_job_batches(
+            std::to_string(hardware_threads) + " threads", hardware_threads - 1, iterations, JOB_BENCHMARK_EMPTY_JOBS, 0.0));
+    }
+
+    print_benchmark_results(
+        "job overhead, " + std::to_string(JOB_BENCHMARK_EMPTY_JOBS) + " empty jobs per iteration", overhead_results);
+
+    for (size_t i = 1; i < overhead_results.size(); i++) {
+
+        double sum = 0.0;
+        for (double sample : overhead_results[i].samples_ms) {
+            sum += sample;
+        }
+        double job_ns = sum / overhead_results[i].samples_ms.size() / JOB_BENCHMARK_EMPTY_JOBS * 1e6;
+        std::cout << "\t " << overhead_results[i].name << ": " << job_ns << " ns per job (start + run + wait). \n";
+    }
+    std::cout << "\n";
+
+    // Scaling: the same work on 1, 2, 4, ... threads (the waiting thread runs jobs too).
+    std::vector<BenchmarkResult> scaling_results;
+    for (uint32_t threads = 1; ; threads *= 2) {
+
+        threads = std::min(threads, hardware_threads);
+        scaling_results.push_back(time_job_batches(
+            std::to_string(threads) + " thread(s)", threads - 1, iterations, JOB_BENCHMARK_TASKS, JOB_BENCHMARK_TASK_US));
+
+        if (threads == hardware_threads) {
+            break;
+        }
+    }
+
+    print_benchmark_results(
+        "job scaling, " + std::to_string(JOB_BENCHMARK_TASKS) + " jobs of "
+        + std::to_string(static_cast<int>(JOB_BENCHMARK_TASK_US)) + " us per iteration", scaling_results);
+}
+
+
+// Per-object constants of a typical draw (80 bytes).
+struct ObjectUniforms {
+
+    glm::mat4 model;
+    glm::vec4 color;
+};
+
+
+// Every frame writes UNIFORM_BENCHMARK_BLOCKS blocks: first into a packed array (the
+// memcpy baseline, no alignment and no offsets), then through the uniform ring with
+// the alignments of common GPUs. The ring is set up over host memory, the cost being
+// measured is the CPU side of writing the blocks, and the padding every block needs.
+static void benchmark_uniforms(uint64_t frames) {
+
+    const uint32_t frames_in_flight = 2;
+
+    std::vector<ObjectUniforms> objects(UNIFORM_BENCHMARK_BLOCKS);
+    for (uint32_t i = 0; i < UNIFORM_BENCHMARK_BLOCKS; i++) {
+        objects[i].model = glm::mat4(1.0f);
+        objects[i].color = glm::vec4(static_cast<float>(i), 0.0f, 0.0f, 1.0f);
+    }
+
+    std::vector<BenchmarkResult> results;
+    std::vector<VkDeviceSize> frame_bytes;
+
+    // Baseline
+    {
+        std::vector<ObjectUniforms> packed(UNIFORM_BENCHMARK_BLOCKS * frames_in_flight);
+
+        BenchmarkResult result;
+        result.name = "packed array";
+        result.samples_ms.reserve(frames);
+
+        for (uint64_t frame = 0; frame < frames; frame++) {
+
+            ObjectUniforms* region = packed.data() + (frame % frames_in_flight) * UNIFORM_BENCHMARK_BLOCKS;
+
+            bench_clock::time_point start = bench_clock::now();
+            for (uint32_t i = 0; i < UNIFORM_BENCHMARK_BLOCKS; i++) {
+                memcpy(region + i, &objects[i], sizeof(ObjectUniforms));
+            }
+            result.samples_ms.push_back(std::chrono::duration<double, std::milli>(bench_clock::now() - start).count());
+        }
+
+        results.push_back(std::move(result));
+        frame_bytes.push_back(sizeof(ObjectUniforms) * UNIFORM_BENCHMARK_BLOCKS);
+    }
+
+    for (VkDeviceSize alignment : UNIFORM_BENCHMARK_ALIGNMENTS) {
+
+        VkDeviceSize block_size = (sizeof(ObjectUniforms) + alignment - 1) & ~(alignment - 1);
+        VkDeviceSize frame_size = block_size * UNIFORM_BENCHMARK_BLOCKS;
+        std::vector<uint8_t> memory(frame_size * frames_in_flight);
+
+        UniformRing ring;
+        init_uniform_ring(ring, memory.data(), frame_size, alignment, frames_in_flight);
+
+        BenchmarkResult result;
+        result.name = "ring, " + std::to_string(alignment) + " B alignment";
+        result.samples_ms.reserve(frames);
+
+        // Keeps the offsets alive, as the draws would.
+        uint64_t offsets_sum = 0;
+
+        for (uint64_t frame = 0; frame < frames; frame++) {
+
+            bench_clock::time_point start = bench_clock::now();
+            begin_uniform_ring_frame(ring, static_cast<uint32_t>(frame));
+            for (uint32_t i = 0; i < UNIFORM_BENCHMARK_BLOCKS; i++) {
+                offsets_sum += push_uniform_block(ring, objects[i]);
+            }
+            result.samples_ms.push_back(std::chrono::duration<double, std::milli>(bench_clock::now() - start).count());
+        }
+
+        begin_uniform_ring_frame(ring, 0);
+        LOG_DEBUG("Uniform ring benchmark offsets sum: %llu.", static_cast<unsigned long long>(offsets_sum));
+
+        results.push_back(std::move(result));
+        frame_bytes.push_back(ring.peak_bytes);
+    }
+
+    print_benchmark_results(
+        "uniforms, " + std::to_string(UNIFORM_BENCHMARK_BLOCKS) + " blocks of "
+        + std::to_string(sizeof(ObjectUniforms)) + " bytes per frame, " + std::to_string(frames) + " frames", results);
+
+    VkDeviceSize payload_bytes = frame_bytes.front();
+    for (size_t i = 0; i < results.size(); i++) {
+        std::cout << "\t " << results[i].name << ": "
+            << static_cast<double>(frame_bytes[i]) / (1024.0 * 1024.0) << " MB per frame, "
+            << 100.0 * (frame_bytes[i] - payload_bytes) / frame_bytes[i] << "% padding. \n";
+    }
+    std::cout << "\n";
+}
+
+
+// The objects are spread over twice the width and height of the view, about a quarter
+// of them is visible. Both variants cull the same objects with the same frustum, what
+// CullingMode::Cpu does every frame before writing the commands.
+// CullingMode::Gpu has no row here: its CPU side is a descriptor set, the push constants
+// and a few commands, which need the device. The demo prints it with its culling
+// statistics (--culling gpu), next to the cost of --culling cpu on the same scene.
+static void benchmark_culling(uint64_t frames) {
+
+    std::mt19937 random(42);
+    std::uniform_real_distribution<float> position(-2.0f, 2.0f);
+    std::uniform_real_distribution<float> depth(0.0f, 1.0f);
+    std::uniform_real_distribution<float> radius(0.001f, 0.05f);
+
+    glm::mat4 transform(1.0f);
+
+    for (uint32_t objects_count : CULLING_BENCHMARK_OBJECTS) {
+
+        std::vector<glm::vec4> bounds(objects_count);
+        for (auto& sphere : bounds) {
+            sphere = glm::vec4(position(random), position(random), depth(random), radius(random));
+        }
+
+        CullingObjects objects;
+        build_culling_objects(objects, bounds);
+        std::vector<uint32_t> visible(objects_count);
+
+        std::vector<BenchmarkResult> results(2);
+        results[0].name = "scalar";
+        results[1].name = "SIMD";
+
+        uint32_t scalar_visible = 0;
+        uint32_t simd_visible = 0;
+
+        for (uint64_t frame = 0; frame < frames; frame++) {
+
+            bench_clock::time_point start = bench_clock::now();
+            scalar_visible = cull_objects_scalar(objects, extract_frustum_planes(transform), visible.data());
+            results[0].samples_ms.push_back(std::chrono::duration<double, std::milli>(bench_clock::now() - start).count());
+
+            start = bench_clock::now();
+            simd_visible = cull_objects_simd(objects, extract_frustum_planes(transform), visible.data());
+            results[1].samples_ms.push_back(std::chrono::duration<double, std::milli>(bench_clock::now() - start).count());
+        }
+
+        if (scalar_visible != simd_visible) {
+            throw std::runtime_error("Culling benchmark: scalar and SIMD culling disagree! \n");
+        }
+
+        print_benchmark_results(
+            "culling, " + std::to_string(objects_count) + " objects (" + std::to_string(simd_visible) + " visible), "
+            + std::to_string(frames) + " frames", results);
+    }
+}
+
+
+void run_benchmark(const AppConfig& config) {
+
+    uint64_t frames = config.max_frames > 0 ? config.max_frames : DEFAULT_BENCHMARK_FRAMES;
+
+    if (config.benchmark == "logging") {
+        benchmark_logging(frames);
+    }
+    else if (config.benchmark == "jobs") {
+        benchmark_jobs(config.max_frames > 0 ? config.max_frames : DEFAULT_JOB_BENCHMARK_ITERATIONS);
+    }
+    else if (config.benchmark == "uniforms") {
+        benchmark_uniforms(config.max_frames > 0 ? config.max_frames : DEFAULT_UNIFORM_BENCHMARK_FRAMES);
+    }
+    else if (config.benchmark == "culling") {
+        benchmark_culling(config.max_frames > 0 ? config.max_frames : DEFAULT_CULLING_BENCHMARK_FRAMES);
+    }
+    else {
+        throw std::runtime_error("Unknown benchmark: " + config.benchmark + " \n");
+    }
+}
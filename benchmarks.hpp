@@ -0,0 +1,28 @@
+#pragma once
+
+#include "app_config.hpp"
+
+#include <string>
+#include <vector>
+
+
+// Benchmarks, selected with --bench <name>:
+// - logging: per-frame cost of std::cout logging vs the async logger (vk_log.hpp).
+// - jobs: scheduling overhead of the job system and its scaling from 1 to N threads (job_system.hpp).
+// - uniforms: writing 100k per-object uniform blocks per frame into the uniform ring (vk_uniform_ring.hpp).
+// - culling: CPU cost of frustum culling 1k to 1M objects, scalar vs SIMD (vk_culling.hpp).
+// - msaa: GPU frame time at every supported sample count, running the demo headless (in main.cpp).
+// - rendering: CPU time recording the command buffer with render passes vs dynamic rendering,
+//   running the demo headless (in main.cpp).
+void run_benchmark(const AppConfig& config);
+
+
+// Timings of one variant of a benchmark, one sample per iteration.
+struct BenchmarkResult {
+
+    std::string name;
+    std::vector<double> samples_ms;
+};
+
+// Prints mean/p50/p95/p99 of every variant, plus how each compares to the first one.
+void print_benchmark_results(const std::string& title, const std::vector<BenchmarkResult>& results);
@@ -1,3 +1,4 @@
-C:\VulkanSDK\1.3.290.0\Bin\glslc.exe shader.vert -o vert.spv
-C:\VulkanSDK\1.3.290.0\Bin\glslc.exe shader.frag -o frag.spv
+rem Compiles the shaders with glslc from the Vulkan SDK (VULKAN_SDK).
+rem The build step itself is compile_shaders.py, which also runs on Linux and macOS.
+python "%~dp0compile_shaders.py" %*
 pause
\ No newline at end of file
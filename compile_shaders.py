@@ -0,0 +1,162 @@
+#!/usr/bin/env python3
+
+# Compiles the GLSL shaders of the demo to SPIR-V with glslc (Vulkan SDK), on Windows,
+# Linux and macOS. Run it from anywhere: the paths are relative to this file.
+#
+#   python compile_shaders.py           compiles the shaders whose .spv is missing or older
+#   python compile_shaders.py --force   compiles all of them
+#   python compile_shaders.py --embed   also writes embedded_shaders.hpp (see vk_shaders.hpp)
+#
+# glslc is looked up in $GLSLC, then in the bin directory of $VULKAN_SDK, then in the PATH.
+# The .spv files and the embedded header are build outputs, they are not committed.
+#
+# The embedded header holds the bytecode of every shader as constexpr uint32_t arrays. Built
+# with VKDEMO_EMBED_SHADERS the demo loads the shaders from there instead of from the .spv
+# files next to the working directory: no file I/O at startup, and a single binary to deploy.
+
+import argparse
+import os
+import shutil
+import subprocess
+import sys
+
+
+# Source -> SPIR-V. The .spv names are the ones the demo loads.
+SHADERS = [
+    ("shader.vert", "vert.spv"),
+    ("shader.frag", "frag.spv"),
+    ("instanced.vert", "instanced_vert.spv"),
+    ("cull.comp", "cull.spv"),
+]
+
+EMBEDDED_HEADER = "embedded_shaders.hpp"
+
+ROOT = os.path.dirname(os.path.abspath(__file__))
+
+
+def find_glslc():
+
+    if os.environ.get("GLSLC"):
+        return os.environ["GLSLC"]
+
+    executable = "glslc.exe" if os.name == "nt" else "glslc"
+
+    # The SDK installs into Bin on Windows and bin elsewhere.
+    vulkan_sdk = os.environ.get("VULKAN_SDK")
+    if vulkan_sdk:
+        for bin_dir in ("Bin", "bin"):
+            path = os.path.join(vulkan_sdk, bin_dir, executable)
+            if os.path.isfile(path):
+                return path
+
+    path = shutil.which(executable)
+    if path:
+        return path
+
+    sys.exit("glslc not found: install the Vulkan SDK and set VULKAN_SDK, or set GLSLC.")
+
+
+def is_up_to_date(source, output):
+
+    return os.path.isfile(output) and os.path.getmtime(output) >= os.path.getmtime(source)
+
+
+def compile_shaders(force):
+
+    glslc = None
+
+    for source_name, output_name in SHADERS:
+
+        source = os.path.join(ROOT, source_name)
+        output = os.path.join(ROOT, output_name)
+
+        if not force and is_up_to_date(source, output):
+            continue
+
+        if glslc is None:
+            glslc = find_glslc()
+
+        print("Compiling " + source_name + " -> " + output_name)
+        result = subprocess.run([glslc, source, "-o", output])
+        if result.returncode != 0:
+            sys.exit("Failed to compile " + source_name + ".")
+
+
+def embedded_array_name(output_name):
+
+    return "EMBEDDED_SHADER_" + output_name.replace(".", "_").upper()
+
+
+def write_embedded_header():
+
+    lines = [
+        "#pragma once",
+        "",
+        "// Generated by compile_shaders.py --embed from the .spv files, do not edit.",
+        "",
+        "#include <cstddef> // size_t",
+        "#include <cstdint> // uint32_t",
+        "",
+        "",
+    ]
+
+    for _, output_name in SHADERS:
+
+        with open(os.path.join(ROOT, output_name), "rb") as spv_file:
+            bytecode = spv_file.read()
+
+        if len(bytecode) % 4 != 0:
+            sys.exit(output_name + " is not SPIR-V (its size is not a multiple of 4 bytes).")
+
+        # SPIR-V is a stream of little endian words (glslc always writes little endian).
+        words = [int.from_bytes(bytecode[i:i + 4], "little") for i in range(0, len(bytecode), 4)]
+
+        lines.append("constexpr uint32_t " + embedded_array_name(output_name) + "[] = {")
+        for i in range(0, len(words), 8):
+            lines.append("    " + ", ".join("0x%08x" % word for word in words[i:i + 8]) + ",")
+        lines.append("};")
+        lines.append("")
+
+    lines.append("")
+    lines.append("struct EmbeddedShader {")
+    lines.append("")
+    lines.append("    const char* name; // The .spv file it was read from")
+    lines.append("    const uint32_t* code;")
+    lines.append("    size_t words_count;")
+    lines.append("};")
+    lines.append("")
+    lines.append("constexpr EmbeddedShader EMBEDDED_SHADERS[] = {")
+    for _, output_name in SHADERS:
+        array_name = embedded_array_name(output_name)
+        lines.append("    { \"" + output_name + "\", " + array_name + ", sizeof(" + array_name + ") / sizeof(uint32_t) },")
+    lines.append("};")
+    lines.append("")
+
+    content = "\n".join(lines)
+
+    # Rewriting the same header would rebuild everything that includes it.
+    header = os.path.join(ROOT, EMBEDDED_HEADER)
+    if os.path.isfile(header):
+        with open(header, "r") as header_file:
+            if header_file.read() == content:
+                return
+
+    with open(header, "w", newline="\n") as header_file:
+        header_file.write(content)
+    print("Wrote " + EMBEDDED_HEADER)
+
+
+def main():
+
+    parser = argparse.ArgumentParser(description="Compiles the shaders of the demo to SPIR-V.")
+    parser.add_argument("--force", action="store_true", help="compile every shader, even the up to date ones")
+    parser.add_argument("--embed", action="store_true", help="write " + EMBEDDED_HEADER + " too")
+    args = parser.parse_args()
+
+    compile_shaders(args.force)
+    if args.embed:
+        write_embedded_header()
+
+
+if __name__ == "__main__":
+    main()
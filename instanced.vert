@@ -0,0 +1,35 @@
+#version 450
+
+// Per-vertex attributes, read from the vertex buffer (binding 0, see vk_mesh.cpp).
+layout(location = 0) in vec2 in_position;
+layout(location = 1) in vec3 in_color;
+
+// Per-instance attributes, read once per instance from the instance streams
+// (bindings 1 and 2, see vk_instancing.hpp). The mat4 takes locations 2 to 5.
+layout(location = 2) in mat4 instance_transform;
+layout(location = 6) in vec4 instance_color;
+
+// Per-frame data, written by the CPU every frame into the uniform ring (FrameUniforms
+// in vk_frame.hpp).
+layout(set = 0, binding = 0) uniform FrameUniforms {
+	mat4 transform;
+} frame;
+
+layout(location = 0) out vec3 fragment_color;
+
+void main() {
+
+	gl_Position = frame.transform * instance_transform * vec4(in_position, 0.0, 1.0);
+	fragment_color = in_color * instance_color.rgb;
+}
+
+/*
+Same as shader.vert, drawn with instanceCount > 1.
+
+Inputs of a binding with VK_VERTEX_INPUT_RATE_INSTANCE advance once per instance:
+	every vertex of instance i reads element (firstInstance + i) of the stream.
+	gl_InstanceIndex would give the same index, to read the data from a buffer instead.
+
+A matrix input takes one location per column, the vertex input state describes
+	each column as a vec4 attribute.
+*/
@@ -0,0 +1,231 @@
+#include "job_system.hpp"
+#include "vk_trace.hpp"
+
+
+namespace {
+
+    // Queue of the calling thread in the system it belongs to (none: -1).
+    thread_local JobSystem* thread_job_system = nullptr;
+    thread_local int32_t thread_queue_index = -1;
+
+
+    uint32_t calling_thread_queue(const JobSystem& job_system) {
+
+        if (thread_job_system == &job_system && thread_queue_index >= 0) {
+            return static_cast<uint32_t>(thread_queue_index);
+        }
+        return 0;
+    }
+
+
+    void push_job(JobSystem& job_system, Job job) {
+
+        job.counter->pending.fetch_add(1);
+
+        // Counted before it is visible in the deque, so the count never goes below zero.
+        // Both atomics are sequentially consistent: either the sleeping worker sees the
+        // new job in its wait predicate, or we see the worker sleeping and wake it up.
+        job_system.queued_jobs.fetch_add(1);
+
+        JobQueue& queue = *job_system.queues[calling_thread_queue(job_system)];
+        {
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.jobs.push_back(std::move(job));
+        }
+
+        if (job_system.sleeping_workers.load() > 0) {
+            std::lock_guard<std::mutex> lock(job_system.sleep_mutex);
+            job_system.wake_up.notify_one();
+        }
+    }
+
+
+    bool pop_own_job(JobSystem& job_system, uint32_t queue_index, Job& job) {
+
+        JobQueue& queue = *job_system.queues[queue_index];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+
+        if (queue.jobs.empty()) {
+            return false;
+        }
+
+        job = std::move(queue.jobs.back());
+        queue.jobs.pop_back();
+        return true;
+    }
+
+
+    bool steal_job(JobSystem& job_system, uint32_t queue_index, Job& job) {
+
+        uint32_t queues_count = static_cast<uint32_t>(job_system.queues.size());
+
+        // Start from the next queue, so that the thieves don't all hit the same victim.
+        for (uint32_t i = 1; i < queues_count; i++) {
+
+            JobQueue& victim = *job_system.queues[(queue_index + i) % queues_count];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+
+            if (!victim.jobs.empty()) {
+                job = std::move(victim.jobs.front());
+                victim.jobs.pop_front();
+                job_system.stolen_jobs.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+
+    bool try_get_job(JobSystem& job_system, uint32_t queue_index, Job& job) {
+
+        if (pop_own_job(job_system, queue_index, job) || steal_job(job_system, queue_index, job)) {
+            job_system.queued_jobs.fetch_sub(1);
+            return true;
+        }
+        return false;
+    }
+
+
+    void execute_job(JobSystem& job_system, Job& job) {
+
+        try {
+            job.function();
+        }
+        catch (...) {
+            std::lock_guard<std::mutex> lock(job.counter->error_mutex);
+            if (!job.counter->error) {
+                job.counter->error = std::current_exception();
+            }
+        }
+
+        job_system.executed_jobs.fetch_add(1, std::memory_order_relaxed);
+
+        // Release: whatever the job wrote is visible to the thread that sees the counter at zero.
+        job.counter->pending.fetch_sub(1, std::memory_order_release);
+    }
+
+
+    void worker_loop(JobSystem& job_system, uint32_t queue_index) {
+
+        thread_job_system = &job_system;
+        thread_queue_index = static_cast<int32_t>(queue_index);
+        set_trace_thread_name("job_worker");
+
+        Job job;
+
+        while (!job_system.stopping.load()) {
+
+            if (try_get_job(job_system, queue_index, job)) {
+                execute_job(job_system, job);
+                job = Job{};
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(job_system.sleep_mutex);
+            job_system.sleeping_workers.fetch_add(1);
+            job_system.wake_up.wait(lock, [&]() {
+                return job_system.stopping.load() || job_system.queued_jobs.load() > 0;
+            });
+            job_system.sleeping_workers.fetch_sub(1);
+        }
+    }
+}
+
+
+void create_job_system(JobSystem& job_system, uint32_t worker_threads) {
+
+    job_system.stopping.store(false);
+
+    job_system.queues.clear();
+    for (uint32_t i = 0; i < worker_threads + 1; i++) {
+        job_system.queues.push_back(std::make_unique<JobQueue>());
+    }
+
+    thread_job_system = &job_system;
+    thread_queue_index = 0;
+
+    for (uint32_t i = 0; i < worker_threads; i++) {
+        job_system.workers.emplace_back(worker_loop, std::ref(job_system), i + 1);
+    }
+}
+
+
+void destroy_job_system(JobSystem& job_system) {
+
+    {
+        std::lock_guard<std::mutex> lock(job_system.sleep_mutex);
+        job_system.stopping.store(true);
+    }
+    job_system.wake_up.notify_all();
+
+    for (auto& worker : job_system.workers) {
+        worker.join();
+    }
+
+    job_system.workers.clear();
+    job_system.queues.clear();
+
+    if (thread_job_system == &job_system) {
+        thread_job_system = nullptr;
+        thread_queue_index = -1;
+    }
+}
+
+
+void run_job(JobSystem& job_system, std::function<void()> function, JobCounter& counter) {
+
+    Job job;
+    job.function = std::move(function);
+    job.counter = &counter;
+
+    push_job(job_system, std::move(job));
+}
+
+
+void run_parallel_for(
+    JobSystem& job_system,
+    uint32_t count, uint32_t batch_size,
+    std::function<void(uint32_t begin, uint32_t end)> function,
+    JobCounter& counter) {
+
+    if (batch_size == 0) {
+        batch_size = 1;
+    }
+
+    for (uint32_t begin = 0; begin < count; begin += batch_size) {
+
+        uint32_t end = begin + batch_size < count ? begin + batch_size : count;
+        run_job(job_system, [function, begin, end]() { function(begin, end); }, counter);
+    }
+}
+
+
+void wait_for_counter(JobSystem& job_system, JobCounter& counter) {
+
+    uint32_t queue_index = calling_thread_queue(job_system);
+    Job job;
+
+    // Help instead of blocking: run jobs until the ones we wait for are done.
+    // They may be running on other threads, in that case we just yield.
+    while (counter.pending.load(std::memory_order_acquire) > 0) {
+
+        if (try_get_job(job_system, queue_index, job)) {
+            execute_job(job_system, job);
+            job = Job{};
+        }
+        else {
+            std::this_thread::yield();
+        }
+    }
+
+    std::exception_ptr error;
+    {
+        std::lock_guard<std::mutex> lock(counter.error_mutex);
+        error = counter.error;
+        counter.error = nullptr;
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+// Work-stealing job system.
+//
+// Every thread (the workers and the thread that created the system) has its own deque
+// of jobs. A thread pushes and pops jobs at the back of its own deque (LIFO, the data
+// of the job it just pushed is still in its cache), and when its deque is empty it steals
+// from the front of the deque of another thread (FIFO, the oldest and usually largest
+// pieces of work). Every deque has its own lock, so threads only contend when stealing.
+//
+// Dependencies are expressed with counters: every job started with a counter increments
+// it, and decrements it when done. wait_for_counter() doesn't block the waiting thread:
+// it runs jobs (its own first, then stolen ones) until the counter reaches zero.
+// So a job can start jobs and wait for them, and the main thread helps while waiting.
+
+
+// Tracks a group of jobs. Must outlive them (wait for it before it goes out of scope).
+struct JobCounter {
+
+    std::atomic<uint32_t> pending{ 0 };
+
+    // First exception thrown by one of the jobs, rethrown by wait_for_counter().
+    std::mutex error_mutex;
+    std::exception_ptr error;
+};
+
+
+struct Job {
+
+    std::function<void()> function;
+    JobCounter* counter = nullptr;
+};
+
+
+struct JobQueue {
+
+    std::mutex mutex;
+    std::deque<Job> jobs;
+};
+
+
+struct JobSystem {
+
+    std::vector<std::thread> workers;
+
+    // Queue 0 belongs to the thread that created the system, queue i + 1 to worker i.
+    std::vector<std::unique_ptr<JobQueue>> queues;
+
+    // Idle workers sleep until a job is pushed (checking queued_jobs), instead of spinning.
+    std::mutex sleep_mutex;
+    std::condition_variable wake_up;
+    std::atomic<uint32_t> sleeping_workers{ 0 };
+    std::atomic<uint64_t> queued_jobs{ 0 };
+    std::atomic<bool> stopping{ false };
+
+    std::atomic<uint64_t> executed_jobs{ 0 };
+    std::atomic<uint64_t> stolen_jobs{ 0 };
+};
+
+
+// Starts worker_threads workers. With 0 workers every job runs on the thread
+// that waits for it, which is useful to compare against.
+void create_job_system(JobSystem& job_system, uint32_t worker_threads);
+
+// Stops the workers. Every job must be done.
+void destroy_job_system(JobSystem& job_system);
+
+// Pushes a job to the deque of the calling thread (threads that don't belong
+// to the system push to the deque of the thread that created it).
+void run_job(JobSystem& job_system, std::function<void()> function, JobCounter& counter);
+
+// Splits [0, count) in batches of batch_size and runs function(begin, end) for
+// every batch as a job.
+void run_parallel_for(
+    JobSystem& job_system,
+    uint32_t count, uint32_t batch_size,
+    std::function<void(uint32_t begin, uint32_t end)> function,
+    JobCounter& counter);
+
+// Runs jobs until the counter reaches zero, then rethrows the first exception
+// thrown by one of its jobs (if any).
+void wait_for_counter(JobSystem& job_system, JobCounter& counter);
+
+// Number of threads that can run jobs (the workers + the creating thread).
+inline uint32_t job_threads_count(const JobSystem& job_system) {
+    return static_cast<uint32_t>(job_system.queues.size());
+}
@@ -4,17 +4,39 @@
 #include "vk_queue_family.hpp"
 #include "vk_swapchain.hpp"
 #include "vk_graphics_pipeline.hpp"
+#include "vk_shaders.hpp"
+#include "vk_render_graph.hpp"
+#include "vk_frame.hpp"
+#include "vk_mesh.hpp"
+#include "vk_upload_scheduler.hpp"
+#include "vk_memory.hpp"
+#include "vk_descriptors.hpp"
+#include "vk_uniform_ring.hpp"
+#include "vk_culling.hpp"
+#include "vk_draw_sort.hpp"
+#include "vk_instancing.hpp"
+#include "vk_parallel_record.hpp"
+#include "job_system.hpp"
+#include "vk_offscreen.hpp"
+#include "vk_pipeline_cache.hpp"
+#include "vk_pipeline_compiler.hpp"
+#include "vk_profiler.hpp"
+#include "app_config.hpp"
+#include "benchmarks.hpp"
+#include "self_tests.hpp"
 
 
 #include <stdexcept>
 #include <cstdlib> // EXIT_FAILURE | EXIT_SUCCESS
-#include <cstring> // strcmp
+#include <cstring> // strcmp | memcpy
 #include <cstdint> // uint32_t
 #include <optional>
 #include <algorithm> // std::clamp
 #include <limits> // std::numeric_limits
 #include <vector>
 #include <set>
+#include <deque>
+#include <chrono>
 
 
 /* ----------------------------------------------------------------- */
@@ -27,120 +49,1013 @@ class VulkanDemo {
 
 public:
 
+    explicit VulkanDemo(const AppConfig& app_config) : config(app_config) {}
+
     void run() {
-        init_window();
-        init_vulkan();
+
+        startup_time = std::chrono::steady_clock::now();
+
+        if (!config.trace_output.empty()) {
+            start_tracing();
+            set_trace_thread_name("main");
+        }
+
+        {
+            TRACE_SCOPE("init");
+            init_window();
+            init_vulkan();
+        }
         main_loop();
-        cleanup();
+        {
+            TRACE_SCOPE("cleanup");
+            cleanup();
+        }
+
+        if (!config.trace_output.empty()) {
+            save_trace(config.trace_output);
+        }
+    }
+
+    // After run(), for --bench msaa: the sample count actually used and
+    // the GPU time of the last frames.
+    VkSampleCountFlagBits get_msaa_samples() const {
+        return msaa_samples;
+    }
+
+    std::vector<double> get_gpu_frame_times() const {
+        return profiler.get_samples(ProfileScope::Gpu);
+    }
+
+    // After run(), for --bench rendering: the path actually used and the CPU time
+    // spent recording the command buffer of the last frames.
+    bool uses_dynamic_rendering() const {
+        return frame_graph.dynamic_rendering;
+    }
+
+    std::vector<double> get_record_times() const {
+        return profiler.get_samples(ProfileScope::Record);
     }
 
 private:
 
     /* ----------------------------------------------------------------- */
     VkInstance vulkan_instance;
-    VkSurfaceKHR vulkan_surface;
+    VkSurfaceKHR vulkan_surface = VK_NULL_HANDLE; // Stays VK_NULL_HANDLE when running headless
 
     VkPhysicalDevice vulkan_physical_device = VK_NULL_HANDLE; // Implicitly destroyed when vulkan_instance is destroyed
     VkDevice vulkan_logical_device;
+    DeviceFeatures device_features; // The optional features that are enabled
 
     // Implicitly destroyed when vulkan_logical_device is destroyed.
     VkQueue vulkan_graphics_queue;
     VkQueue vulkan_present_queue;
+    VkQueue vulkan_transfer_queue; // Same as vulkan_graphics_queue if there is no separate transfer family
+    VkQueue vulkan_compute_queue;  // Same as vulkan_graphics_queue if there is no async compute family
+
+    // Every buffer and image we create gets its memory from here.
+    MemoryAllocator memory_allocator;
+
+    VkSwapchainKHR vulkan_swapchain = VK_NULL_HANDLE;
 
-    VkSwapchainKHR vulkan_swapchain;
+    // Swapchains replaced by a recreation, waiting for the frames that use them to finish.
+    std::deque<RetiredSwapchain> retired_swapchains;
 
-    // Implicitly destroyed when vulkan_swapchain is destroyed
+    // Implicitly destroyed when vulkan_swapchain is destroyed.
+    // When running headless these are the offscreen images instead (see vk_offscreen.hpp),
+    // owned by us together with their memory.
     std::vector<VkImage> vulkan_swapchain_images;
+    std::vector<MemoryAllocation> vulkan_offscreen_allocations;
     std::vector<VkImageView> vulkan_swapchain_image_views;
+    std::vector<VkSemaphore> render_finished_semaphores; // One per swapchain image, none headless
     VkFormat vulkan_swapchain_image_format;
     VkExtent2D vulkan_swapchain_extent;
+    VkPresentModeKHR vulkan_present_mode = VK_PRESENT_MODE_FIFO_KHR;
+
+    VkPipelineCache vulkan_pipeline_cache;
+
+    // Descriptor set layouts, shared by every pipeline that uses the same bindings,
+    // and the pools the per-frame descriptor allocators take their pools from.
+    DescriptorLayoutCache descriptor_layout_cache;
+    DescriptorPools descriptor_pools;
+    VkDescriptorSetLayout frame_set_layout = VK_NULL_HANDLE; // Set 0: FrameUniforms
+    DescriptorBinding frame_uniforms_binding{};               // Its binding, as the shaders declare it
+
+    // Transient uniform data of every frame, written with a pointer bump.
+    UniformRing uniform_ring;
+
+    // Owns the pipelines (and their layouts), compiled in the background.
+    // The mesh is drawn with the pipeline of this description, looked up every frame
+    // the way a material would (the hash is computed once).
+    PipelineCompiler pipeline_compiler;
+    GraphicsPipelineDesc graphics_pipeline_desc;
+    uint64_t graphics_pipeline_hash = 0;
+    bool graphics_pipeline_ready = false;
+
+    // The passes of a frame and the resources they use (see vk_render_graph.hpp):
+    // the culling dispatch (--culling gpu) and the main pass, drawing into the swapchain image.
+    // Owns the render pass, the framebuffers and the transient images.
+    RenderGraph frame_graph;
+    RenderGraphResource backbuffer_resource = 0;
+    RenderGraphResource depth_resource = 0;
+    RenderGraphResource msaa_color_resource = UINT32_MAX; // --msaa only, resolved into the backbuffer
+    VkSampleCountFlagBits msaa_samples = VK_SAMPLE_COUNT_1_BIT;
+    RenderGraphResource culling_commands_resource = UINT32_MAX; // --culling gpu only
+    RenderGraphResource culling_count_resource = UINT32_MAX;
+    RenderGraphPassIndex main_pass = 0;
+
+    // What the passes of the frame graph record, set by draw_frame() right before
+    // recording (the pass callbacks only hold a pointer to the demo).
+    struct FramePassData {
+
+        VkPipeline graphics_pipeline = VK_NULL_HANDLE;
+        VkPipelineLayout pipeline_layout = VK_NULL_HANDLE;
+        VkDescriptorSet frame_descriptor_set = VK_NULL_HANDLE;
+        uint32_t frame_uniforms_offset = 0;
+        const FrameInstances* instances = nullptr;
+        const FrameCulling* frame_culling = nullptr; // nullptr: no culled draws this frame
+        const uint32_t* draw_order = nullptr;        // nullptr: the order of the draw list
+    };
+    FramePassData frame_pass_data;
 
-    VkPipeline vulkan_graphics_pipeline;
-    VkPipelineLayout vulkan_pipeline_layout;
-    VkRenderPass vulkan_render_pass;
-    std::vector<VkFramebuffer> vulkan_swapchain_framebuffers;
     VkCommandPool vulkan_command_pool;
-    VkCommandBuffer vulkan_command_buffer; // Implicitly destroyed when vulkan_command_buffer is destroyed
+    VkCommandPool vulkan_transfer_command_pool;
+
+    // Only used with --upload-budget.
+    UploadScheduler upload_scheduler;
+
+    Mesh mesh;
+    bool mesh_ready = false; // Streamed meshes are drawn once their upload is ready
+
+    // Only used with --culling cpu|gpu.
+    CullingSystem culling;
+
+    // Only used with --instances.
+    InstanceBuffers instance_buffers;
+
+    // Only used with --sort-draws.
+    DrawSorter draw_sorter;
+
+    // Runs the work that can be split across cores (see job_system.hpp).
+    JobSystem job_system;
+
+    // Only used with --record-jobs.
+    ParallelRecorder parallel_recorder;
+    std::vector<VkCommandBuffer> secondary_command_buffers;
+
+    // One entry per frame in flight (command buffer + sync objects).
+    std::vector<FrameData> frames;
+    uint32_t current_frame = 0;
+    uint64_t submitted_frames = 0;
+    uint32_t last_rendered_image = 0;
+    FrameStats frame_stats;
+    Profiler profiler;
+
+    // Set when the acquire found the swapchain out of date and the frame was skipped.
+    // Its fence wait and acquire time carry over to the next frame, the one that
+    // actually gets rendered, instead of being lost from the timings.
+    bool frame_skipped = false;
+    double skipped_wait_ms = 0.0;
 
     VkDebugUtilsMessengerEXT vulkan_debugger_messenger;
 
-    GLFWwindow* window;
+    GLFWwindow* window = nullptr; // No window when running headless
+
+    // Set by the GLFW callback. Not every driver reports VK_ERROR_OUT_OF_DATE_KHR
+    // after a resize, so we also recreate the swapchain when this is set.
+    bool framebuffer_resized = false;
+
+    AppConfig config;
+
+    // When run() started, to measure the startup-to-first-frame latency.
+    std::chrono::steady_clock::time_point startup_time;
     /* ----------------------------------------------------------------- */
 
 
     /* ----------------------------------------------------------------- */
     void init_window() {
 
+        TRACE_SCOPE("init_window");
+
+        // Headless machines usually have no display at all, so GLFW is never initialized.
+        if (config.headless) {
+            return;
+        }
+
         glfwInit(); // Initializes the GLFW lib
 
         glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API); // Specify to use VULKAN (by explicitly not using OpenGL)
 
-        glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE); // Disable resizing window (temporary)
-
         window = glfwCreateWindow(WIDTH, HEIGHT, "Vulkan demo", nullptr, nullptr);
+
+        // GLFW callbacks are plain functions, so we store a pointer to
+        // the demo in the window to get back to it from the callback.
+        glfwSetWindowUserPointer(window, this);
+        glfwSetFramebufferSizeCallback(window, CALLBACK_FUNC_framebuffer_resize);
+    }
+
+    static void CALLBACK_FUNC_framebuffer_resize(GLFWwindow* window, int /*width*/, int /*height*/) {
+
+        auto demo = reinterpret_cast<VulkanDemo*>(glfwGetWindowUserPointer(window));
+        demo->framebuffer_resized = true;
+    }
+
+    // A minimized window has a framebuffer of size 0, and a swapchain can't be 0x0.
+    bool is_window_minimized() {
+
+        int width = 0, height = 0;
+        glfwGetFramebufferSize(window, &width, &height);
+        return width == 0 || height == 0;
     }
 
     void init_vulkan() {
 
-        create_vulkan_instance(vulkan_instance);
+        std::cout << "Creating Job system... \n\n";
+        create_job_system(job_system, config.job_threads);
+        std::cout << "\t Threads: " << job_threads_count(job_system) << " (" << config.job_threads << " workers + main thread). \n\n";
+
+        create_vulkan_instance(vulkan_instance, config.headless);
 
         create_debug_messenger(vulkan_debugger_messenger, vulkan_instance);
         
-        create_vulkan_surface(vulkan_surface, vulkan_instance, window);
+        if (!config.headless) {
+            create_vulkan_surface(vulkan_surface, vulkan_instance, window);
+        }
         
-        select_physical_device(vulkan_physical_device, vulkan_instance, vulkan_surface);
+        select_physical_device(vulkan_physical_device, vulkan_instance, vulkan_surface, config.device_selector);
         
         create_vulkan_logical_device(
             vulkan_logical_device,
             vulkan_surface,
             vulkan_physical_device,
-            vulkan_graphics_queue, vulkan_present_queue);
+            vulkan_graphics_queue, vulkan_present_queue, vulkan_transfer_queue, vulkan_compute_queue,
+            device_features);
+
+        create_memory_allocator(memory_allocator, vulkan_physical_device, vulkan_logical_device);
+
+        if (config.self_test == "memory") {
+            test_memory_allocator(memory_allocator);
+        }
         
-        create_vulkan_swapchain(
-            vulkan_swapchain,
-            window, vulkan_surface,
-            vulkan_physical_device, vulkan_logical_device,
-            vulkan_swapchain_images, vulkan_swapchain_image_format, vulkan_swapchain_extent);
+        if (config.headless) {
+            // One offscreen image per frame in flight: frame i always renders into image i,
+            // so the frame fence also protects the image from being overwritten too early.
+            create_offscreen_images(
+                vulkan_swapchain_images, vulkan_offscreen_allocations,
+                memory_allocator, vulkan_logical_device,
+                config.frames_in_flight, { WIDTH, HEIGHT },
+                vulkan_swapchain_image_format, vulkan_swapchain_extent);
+        }
+        else {
+            create_vulkan_swapchain(
+                vulkan_swapchain,
+                window, vulkan_surface,
+                vulkan_physical_device, vulkan_logical_device,
+                config.present_profile, config.swapchain_images,
+                vulkan_swapchain_images, vulkan_swapchain_image_format, vulkan_swapchain_extent,
+                vulkan_present_mode);
+
+            create_render_finished_semaphores(render_finished_semaphores, vulkan_swapchain_images.size(), vulkan_logical_device);
+        }
         
         create_swapchain_image_views(vulkan_swapchain_image_views, vulkan_logical_device, vulkan_swapchain_images, vulkan_swapchain_image_format);
 
-        create_render_pass(vulkan_render_pass, vulkan_logical_device, vulkan_swapchain_image_format);
+        create_frame_graph();
 
-        create_graphics_pipeline(
-            vulkan_graphics_pipeline, vulkan_pipeline_layout,
-            vulkan_logical_device,
-            vulkan_render_pass,
-            vulkan_swapchain_extent);
+        using clock = std::chrono::steady_clock;
 
-        create_framebuffers(vulkan_swapchain_framebuffers,
-            vulkan_logical_device,
-            vulkan_render_pass,
-            vulkan_swapchain_image_views, vulkan_swapchain_extent);
+        clock::time_point cache_start = clock::now();
+        bool warm_cache = create_pipeline_cache(
+            vulkan_pipeline_cache,
+            vulkan_physical_device, vulkan_logical_device,
+            config.pipeline_cache_file);
+        clock::time_point pipeline_start = clock::now();
+
+        // The pipeline compiles on the job system while we go on with the rest of the
+        // initialization, and the first frames are presented without it if needed.
+        create_pipeline_compiler(pipeline_compiler, vulkan_logical_device, vulkan_pipeline_cache, job_system);
+
+        create_descriptor_layout_cache(descriptor_layout_cache, vulkan_logical_device);
+        create_descriptor_pools(descriptor_pools, vulkan_logical_device);
+
+        // The plain vertex shader reads the Vertex struct as it is, so its layout is derived
+        // from the shader (see vk_shaders.hpp). The instanced one also reads the instance
+        // buffer, which the shader alone can't describe.
+        if (config.instances > 0) {
+            graphics_pipeline_desc.vertex_layout = get_instanced_vertex_layout();
+            graphics_pipeline_desc.vert_shader_file = "instanced_vert.spv";
+        }
+
+        // The frame set is the set 0 the shaders declare (see vk_shaders.hpp), its uniform
+        // buffer is dynamic: it is bound at the offset of its block in the uniform ring.
+        ShaderReflection vert_shader_reflection = reflect_shader(
+            load_shader(graphics_pipeline_desc.vert_shader_file), graphics_pipeline_desc.vert_shader_file);
+        ShaderReflection frag_shader_reflection = reflect_shader(
+            load_shader(graphics_pipeline_desc.frag_shader_file), graphics_pipeline_desc.frag_shader_file);
+        DescriptorSetLayoutDesc frame_set_desc = get_reflected_set_layout(
+            { &vert_shader_reflection, &frag_shader_reflection }, 0, true);
+        frame_set_layout = get_descriptor_set_layout(descriptor_layout_cache, frame_set_desc);
+
+        // The only descriptor the demo writes into the frame set is the FrameUniforms block,
+        // and the block the shaders read must be the struct the CPU writes.
+        if (frame_set_desc.bindings.size() != 1 ||
+            frame_set_desc.bindings[0].type != VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC ||
+            frame_set_desc.bindings[0].count != 1) {
+            throw std::runtime_error("The set 0 of the shaders must hold the FrameUniforms uniform block only! \n");
+        }
+        for (const ShaderReflection* reflection : { &vert_shader_reflection, &frag_shader_reflection }) {
+            for (const auto& descriptor : reflection->descriptor_bindings) {
+                if (descriptor.set == 0 && descriptor.block_size != sizeof(FrameUniforms)) {
+                    throw std::runtime_error("The frame uniform block of the shaders is " + std::to_string(descriptor.block_size)
+                        + " bytes, FrameUniforms is " + std::to_string(sizeof(FrameUniforms)) + "! \n");
+                }
+            }
+        }
+        frame_uniforms_binding = frame_set_desc.bindings[0];
+
+        graphics_pipeline_desc.set_layouts = { frame_set_layout };
+        graphics_pipeline_desc.render_pass = get_pass_render_pass(frame_graph, main_pass);
+        if (frame_graph.dynamic_rendering) {
+            graphics_pipeline_desc.color_formats = get_pass_color_formats(frame_graph, main_pass);
+        }
+        graphics_pipeline_desc.depth_format = get_pass_depth_format(frame_graph, main_pass);
+        graphics_pipeline_desc.rasterization_samples = get_pass_samples(frame_graph, main_pass);
+        graphics_pipeline_hash = hash_pipeline_desc(graphics_pipeline_desc);
+        PipelineHandle graphics_pipeline_handle = request_graphics_pipeline(
+            pipeline_compiler, graphics_pipeline_desc, graphics_pipeline_hash);
+
+        if (config.sync_pipelines) {
+            wait_for_pipelines(pipeline_compiler);
+        }
+
+        clock::time_point pipeline_end = clock::now();
+        std::cout << "Pipeline startup timings (" << (warm_cache ? "warm" : "cold") << " cache): \n";
+        std::cout << "\t Cache load: "
+            << std::chrono::duration<double, std::milli>(pipeline_start - cache_start).count() << " ms. \n";
+        if (get_pipeline_status(pipeline_compiler, graphics_pipeline_handle) == PipelineStatus::Pending) {
+            std::cout << "\t Pipeline submission: "
+                << std::chrono::duration<double, std::milli>(pipeline_end - pipeline_start).count() << " ms (compiling in the background). \n\n";
+        }
+        else {
+            std::cout << "\t Pipeline creation: "
+                << std::chrono::duration<double, std::milli>(pipeline_end - pipeline_start).count() << " ms. \n\n";
+        }
+
+        create_render_graph_resources(frame_graph, memory_allocator, vulkan_logical_device, vulkan_swapchain_extent);
+        print_render_graph(frame_graph);
 
         create_command_pool(
             vulkan_command_pool,
             vulkan_surface,
             vulkan_physical_device, vulkan_logical_device);
 
-        create_command_buffer(
-            vulkan_command_buffer,
+        create_transfer_command_pool(
+            vulkan_transfer_command_pool,
+            vulkan_surface,
+            vulkan_physical_device, vulkan_logical_device);
+
+        QueueFamilyIndices queue_family_indices = find_queue_families(vulkan_surface, vulkan_physical_device);
+
+        if (config.upload_budget_kb > 0) {
+            if (!device_features.timeline_semaphore) {
+                throw std::runtime_error("--upload-budget needs a device with the timelineSemaphore feature (Vulkan 1.2)! \n");
+            }
+            create_upload_scheduler(
+                upload_scheduler,
+                memory_allocator, vulkan_logical_device,
+                queue_family_indices.transfer_family.value(), vulkan_transfer_queue,
+                static_cast<VkDeviceSize>(config.upload_budget_kb) * 1024);
+        }
+
+        create_mesh(
+            mesh,
+            config.mesh_grid > 0 ? generate_grid_mesh(config.mesh_grid, job_system) : generate_quad_mesh(),
+            memory_allocator, vulkan_logical_device,
+            queue_family_indices.graphics_family.value(), queue_family_indices.transfer_family.value(),
+            vulkan_transfer_command_pool, vulkan_transfer_queue,
+            job_system,
+            config.upload_budget_kb > 0 ? &upload_scheduler : nullptr);
+
+        create_culling_system(
+            culling,
+            config.culling, device_features,
+            mesh,
+            memory_allocator,
+            vulkan_physical_device, vulkan_logical_device,
+            descriptor_layout_cache, vulkan_pipeline_cache,
+            config.frames_in_flight,
+            queue_family_indices.graphics_family.value(), queue_family_indices.transfer_family.value(),
+            vulkan_transfer_command_pool, vulkan_transfer_queue,
+            job_system);
+
+        print_memory_stats(memory_allocator);
+
+        frames.resize(config.frames_in_flight);
+
+        create_command_buffers(
+            frames,
             vulkan_command_pool,
             vulkan_logical_device);
+
+        create_sync_objects(frames, vulkan_logical_device);
+
+        create_uniform_ring(
+            uniform_ring,
+            memory_allocator,
+            vulkan_physical_device, vulkan_logical_device,
+            UNIFORM_RING_FRAME_SIZE, config.frames_in_flight);
+
+        create_frame_resources(frames, descriptor_pools);
+
+        if (config.instances > 0) {
+            create_instance_buffers(
+                instance_buffers,
+                memory_allocator, vulkan_logical_device,
+                config.instances, config.frames_in_flight);
+        }
+
+        if (config.record_jobs > 0) {
+            create_parallel_recorder(
+                parallel_recorder,
+                config.record_jobs,
+                vulkan_surface,
+                vulkan_physical_device, vulkan_logical_device,
+                config.frames_in_flight);
+        }
+
+        create_profiler(
+            profiler,
+            vulkan_surface,
+            vulkan_physical_device, vulkan_logical_device,
+            config.frames_in_flight);
+    }
+
+    // Declares the passes of a frame and compiles the graph, which creates the render pass
+    // of the main pass (the pipeline is created for it), unless the passes use dynamic
+    // rendering (--rendering). The transient images and the framebuffers follow the extent,
+    // they are created afterwards (and on every recreation).
+    void create_frame_graph() {
+
+        TRACE_SCOPE("create_frame_graph");
+
+        if (config.rendering == RenderingPath::Dynamic && !device_features.dynamic_rendering) {
+            throw std::runtime_error("--rendering dynamic needs a device with the dynamicRendering feature (Vulkan 1.3)! \n");
+        }
+        frame_graph.dynamic_rendering = config.rendering != RenderingPath::RenderPass && device_features.dynamic_rendering;
+
+        // The swapchain image is discarded and cleared every frame. The first barrier waits
+        // for COLOR_ATTACHMENT_OUTPUT, the stage the submit waits for the acquire on.
+        // Headless, the offscreen image ends up ready to be copied back to the host.
+        backbuffer_resource = add_imported_image(
+            frame_graph, "backbuffer",
+            vulkan_swapchain_image_format,
+            config.headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+            VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+
+        // The culling dispatch writes the indirect commands and the count of the frame,
+        // the main pass draws them: the graph puts the barrier between the two.
+        if (config.culling == CullingMode::Gpu) {
+
+            culling_commands_resource = add_imported_buffer(frame_graph, "culling_commands");
+            culling_count_resource = add_imported_buffer(frame_graph, "culling_count");
+
+            RenderGraphPassIndex culling_pass = add_render_graph_pass(
+                frame_graph, "culling", RenderGraphPassType::Compute,
+                [this](VkCommandBuffer vk_command_buffer) {
+                    if (frame_pass_data.frame_culling != nullptr) {
+                        record_culling_dispatch(vk_command_buffer, *frame_pass_data.frame_culling);
+                    }
+                });
+            add_pass_access(frame_graph, culling_pass, culling_commands_resource, RenderGraphAccess::ComputeShaderWrite);
+            add_pass_access(frame_graph, culling_pass, culling_count_resource, RenderGraphAccess::ComputeShaderWrite);
+        }
+
+        main_pass = add_render_graph_pass(
+            frame_graph, "main", RenderGraphPassType::Graphics,
+            [this](VkCommandBuffer vk_command_buffer) {
+                record_main_pass(
+                    vk_command_buffer,
+                    frame_pass_data.graphics_pipeline, frame_pass_data.pipeline_layout,
+                    frame_pass_data.frame_descriptor_set, frame_pass_data.frame_uniforms_offset,
+                    vulkan_swapchain_extent,
+                    mesh, frame_pass_data.instances,
+                    frame_pass_data.frame_culling,
+                    frame_pass_data.draw_order,
+                    secondary_command_buffers);
+            });
+
+        // With MSAA the pass draws into a multisampled color buffer, resolved into the
+        // swapchain image at the end of the pass. Like the depth buffer, it is cleared when
+        // the pass begins and never stored: both only live in the pass (lazily allocated).
+        msaa_samples = choose_msaa_samples(vulkan_physical_device, config.msaa_samples);
+        if (static_cast<uint32_t>(msaa_samples) != config.msaa_samples) {
+            std::cout << "\t MSAA: " << config.msaa_samples << "x requested, the device supports up to "
+                << msaa_samples << "x for color and depth attachments. \n\n";
+        }
+
+        if (msaa_samples != VK_SAMPLE_COUNT_1_BIT) {
+            msaa_color_resource = add_transient_image(frame_graph, "msaa_color", vulkan_swapchain_image_format, msaa_samples);
+            add_pass_color_attachment(frame_graph, main_pass, msaa_color_resource, VK_ATTACHMENT_LOAD_OP_CLEAR, { {1.0f, 1.0f, 1.0f, 1.0f} });
+            add_pass_resolve_attachment(frame_graph, main_pass, msaa_color_resource, backbuffer_resource);
+        }
+        else {
+            add_pass_color_attachment(frame_graph, main_pass, backbuffer_resource, VK_ATTACHMENT_LOAD_OP_CLEAR, { {1.0f, 1.0f, 1.0f, 1.0f} });
+        }
+
+        // The depth buffer only lives during the main pass: cleared when it begins, never
+        // stored (the graph sees that nothing reads it afterwards).
+        depth_resource = add_transient_image(frame_graph, "depth", choose_depth_format(vulkan_physical_device), msaa_samples);
+        add_pass_depth_attachment(frame_graph, main_pass, depth_resource, VK_ATTACHMENT_LOAD_OP_CLEAR);
+        if (config.culling == CullingMode::Gpu) {
+            add_pass_access(frame_graph, main_pass, culling_commands_resource, RenderGraphAccess::IndirectRead);
+            add_pass_access(frame_graph, main_pass, culling_count_resource, RenderGraphAccess::IndirectRead);
+        }
+
+        compile_render_graph(frame_graph, vulkan_logical_device);
+    }
+
+    // Recreates the swapchain and the objects that depend on its images and extent:
+    // the image views and the resources of the frame graph (framebuffers and transient
+    // images). The render passes only depend on the image format (which doesn't change
+    // for the same surface) and the pipeline uses dynamic viewport and scissor, so
+    // neither of them has to be recreated.
+    //
+    // The old objects may still be in use by the frames in flight. Instead of waiting
+    // for the whole device to be idle (which stalls for tens of milliseconds), they are
+    // retired and destroyed later by release_retired_swapchains().
+    void recreate_swapchain() {
+
+        TRACE_SCOPE("recreate_swapchain");
+
+        // Nothing to render into while minimized, try again once the window is restored.
+        if (is_window_minimized()) {
+            framebuffer_resized = true;
+            return;
+        }
+
+        using clock = std::chrono::steady_clock;
+        clock::time_point recreate_start = clock::now();
+
+        RetiredSwapchain retired;
+        retired.swapchain = vulkan_swapchain;
+        retired.image_views = std::move(vulkan_swapchain_image_views);
+        retired.graph_resources = retire_render_graph_resources(frame_graph);
+        retired.render_finished_semaphores = std::move(render_finished_semaphores);
+        retired.retired_at_frame = submitted_frames;
+
+        vulkan_swapchain_image_views.clear();
+
+        create_vulkan_swapchain(
+            vulkan_swapchain,
+            window, vulkan_surface,
+            vulkan_physical_device, vulkan_logical_device,
+            config.present_profile, config.swapchain_images,
+            vulkan_swapchain_images, vulkan_swapchain_image_format, vulkan_swapchain_extent,
+            vulkan_present_mode,
+            retired.swapchain);
+
+        frame_stats.present_mode = present_mode_to_string(vulkan_present_mode);
+        frame_stats.reset_present_interval();
+
+        retired_swapchains.push_back(std::move(retired));
+
+        render_finished_semaphores.clear();
+        create_render_finished_semaphores(render_finished_semaphores, vulkan_swapchain_images.size(), vulkan_logical_device);
+
+        create_swapchain_image_views(vulkan_swapchain_image_views, vulkan_logical_device, vulkan_swapchain_images, vulkan_swapchain_image_format);
+
+        create_render_graph_resources(frame_graph, memory_allocator, vulkan_logical_device, vulkan_swapchain_extent);
+
+        framebuffer_resized = false;
+
+        LOG_INFO("Vulkan Swapchain recreated in %.3f ms.",
+            std::chrono::duration<double, std::milli>(clock::now() - recreate_start).count());
+    }
+
+    // Destroys the retired swapchains that no frame in flight can be using anymore.
+    // Must be called right after waiting for the fence of the current frame.
+    void release_retired_swapchains() {
+
+        // The fence we just waited for belongs to frame (submitted_frames - frames_in_flight),
+        // and the queue executes frames in order, so every frame before it is done too.
+        // A retired swapchain was last used by frame (retired_at_frame - 1), so its command
+        // buffers are done once submitted_frames >= retired_at_frame - 1 + frames_in_flight.
+        // We wait one frame longer than that: the present of the last frame is not covered
+        // by any fence, and the extra frame gives the presentation engine time to let go
+        // of the old images.
+        while (!retired_swapchains.empty() &&
+            submitted_frames >= retired_swapchains.front().retired_at_frame + config.frames_in_flight) {
+
+            destroy_retired_swapchain(retired_swapchains.front(), memory_allocator, vulkan_logical_device);
+            retired_swapchains.pop_front();
+        }
+    }
+
+    // Writes the per-frame data into the uniform ring and the descriptor set that points
+    // to it. The fence of the frame has been waited for, so the GPU is done with its
+    // region of the ring and with its sets.
+    VkDescriptorSet prepare_frame_descriptors(
+        FrameData& frame,
+        const FrameUniforms& uniforms, uint32_t& frame_uniforms_offset) {
+
+        ProfileTimer timer(profiler, ProfileScope::Descriptors);
+
+        // Frees every set the frame allocated last time, at once.
+        reset_descriptor_allocator(frame.descriptor_allocator);
+
+        begin_uniform_ring_frame(uniform_ring, current_frame);
+
+        frame_uniforms_offset = push_uniform_block(uniform_ring, uniforms);
+
+        VkDescriptorSet frame_descriptor_set = allocate_descriptor_set(frame.descriptor_allocator, frame_set_layout);
+
+        // A dynamic descriptor covers one block (range) of the whole ring buffer,
+        // the block itself is picked by the dynamic offset at bind time.
+        // The size of the block the shaders read was checked against FrameUniforms.
+        VkDescriptorBufferInfo buffer_info{};
+        buffer_info.buffer = uniform_ring.buffer;
+        buffer_info.offset = 0;
+        buffer_info.range = sizeof(FrameUniforms);
+
+        VkWriteDescriptorSet descriptor_write{};
+        descriptor_write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptor_write.dstSet = frame_descriptor_set;
+        descriptor_write.dstBinding = frame_uniforms_binding.binding;
+        descriptor_write.dstArrayElement = 0;
+        descriptor_write.descriptorType = frame_uniforms_binding.type;
+        descriptor_write.descriptorCount = 1;
+        descriptor_write.pBufferInfo = &buffer_info;
+
+        vkUpdateDescriptorSets(vulkan_logical_device, 1, &descriptor_write, 0, nullptr);
+
+        return frame_descriptor_set;
     }
 
     void draw_frame() {
-        
 
+        using clock = std::chrono::steady_clock;
+
+        TRACE_SCOPE("frame");
+
+        FrameData& frame = frames[current_frame];
+
+        // A skipped frame is still open: its scopes add up with the ones of this frame.
+        if (!frame_skipped) {
+            profiler.begin_frame(submitted_frames);
+        }
+        frame_skipped = false;
+
+        // Wait until the GPU has finished the last frame that used this FrameData
+        // (the one submitted frames_in_flight frames ago), so that its command buffer
+        // can be recorded again. With more than one frame in flight this usually returns
+        // immediately, because the GPU is working on a different frame in the meantime.
+        clock::time_point wait_start = clock::now();
+        {
+            ProfileTimer timer(profiler, ProfileScope::FenceWait);
+            vkWaitForFences(vulkan_logical_device, 1, &frame.in_flight_fence, VK_TRUE, UINT64_MAX);
+        }
+
+        // The GPU is done with the previous frame of this slot, its timestamps can be read.
+        collect_gpu_timings(profiler, vulkan_logical_device, current_frame);
+
+        release_retired_swapchains();
+
+        // Acquire an image from the swapchain. The semaphore is signaled when
+        // the presentation engine is finished using the image.
+        // Headless, every frame in flight has its own offscreen image.
+        uint32_t image_index = current_frame;
+        if (!config.headless) {
+            VkResult acquire_result;
+            {
+                ProfileTimer timer(profiler, ProfileScope::Acquire);
+                acquire_result = vkAcquireNextImageKHR(
+                    vulkan_logical_device,
+                    vulkan_swapchain,
+                    UINT64_MAX,
+                    frame.image_available_semaphore,
+                    VK_NULL_HANDLE,
+                    &image_index);
+            }
+
+            // The swapchain doesn't match the surface anymore and can't be used to present.
+            // Nothing was submitted (the fence is still signaled and the semaphore
+            // unsignaled), so we can recreate it and skip this frame.
+            // A suboptimal swapchain can still present, it is recreated after the present.
+            if (acquire_result == VK_ERROR_OUT_OF_DATE_KHR) {
+                frame_skipped = true;
+                skipped_wait_ms += std::chrono::duration<double, std::milli>(clock::now() - wait_start).count();
+                recreate_swapchain();
+                return;
+            }
+            else if (acquire_result != VK_SUCCESS && acquire_result != VK_SUBOPTIMAL_KHR) {
+                throw std::runtime_error("Failed to acquire Vulkan Swapchain image! \n");
+            }
+        }
+        double cpu_wait_ms = skipped_wait_ms + std::chrono::duration<double, std::milli>(clock::now() - wait_start).count();
+        skipped_wait_ms = 0.0;
+
+        // Only reset the fence once we are sure that we are going to submit work with it.
+        vkResetFences(vulkan_logical_device, 1, &frame.in_flight_fence);
+
+        // The streamed uploads of this frame go to the transfer queue before the
+        // graphics submit, which waits for them on the GPU (never on the CPU).
+        if (config.upload_budget_kb > 0) {
+            ProfileTimer timer(profiler, ProfileScope::Uploads);
+            process_uploads(upload_scheduler, vulkan_logical_device);
+        }
+
+        // VK_NULL_HANDLE while the pipeline is still compiling: the frame is only cleared.
+        PipelineHandle graphics_pipeline_handle = request_graphics_pipeline(
+            pipeline_compiler, graphics_pipeline_desc, graphics_pipeline_hash);
+        VkPipeline graphics_pipeline = get_ready_pipeline(pipeline_compiler, graphics_pipeline_handle);
+        VkPipelineLayout pipeline_layout = graphics_pipeline != VK_NULL_HANDLE ?
+            get_compiled_pipeline(pipeline_compiler, graphics_pipeline_handle).layout : VK_NULL_HANDLE;
+        if (graphics_pipeline != VK_NULL_HANDLE && !graphics_pipeline_ready) {
+            graphics_pipeline_ready = true;
+            LOG_INFO("Graphics pipeline ready at frame %llu, %.3f ms after startup (%.3f ms to compile).",
+                static_cast<unsigned long long>(submitted_frames),
+                std::chrono::duration<double, std::milli>(clock::now() - startup_time).count(),
+                get_compiled_pipeline(pipeline_compiler, graphics_pipeline_handle).compile_ms);
+        }
+
+        // Until the mesh has been streamed in the frame is only cleared, like while the
+        // pipeline is compiling.
+        if (!mesh_ready && is_upload_ready(upload_scheduler, mesh.upload_ticket)) {
+            mesh_ready = true;
+            if (mesh.upload_ticket != 0) {
+                LOG_INFO("Mesh streamed in at frame %llu, %.3f ms after startup.",
+                    static_cast<unsigned long long>(submitted_frames),
+                    std::chrono::duration<double, std::milli>(clock::now() - startup_time).count());
+            }
+        }
+        if (!mesh_ready) {
+            graphics_pipeline = VK_NULL_HANDLE;
+            pipeline_layout = VK_NULL_HANDLE;
+        }
+
+        FrameUniforms uniforms{};
+        uniforms.transform = glm::mat4(1.0f);
+
+        uint32_t frame_uniforms_offset = 0;
+        VkDescriptorSet frame_descriptor_set = prepare_frame_descriptors(frame, uniforms, frame_uniforms_offset);
+
+        // The instance streams of the frame are written every frame, like the uniforms.
+        FrameInstances frame_instances;
+        if (config.instances > 0) {
+            float time_s = std::chrono::duration<float>(clock::now() - startup_time).count();
+            animate_instance_grid(
+                get_instance_streams(instance_buffers, current_frame, config.instances),
+                time_s, job_system);
+            frame_instances = get_frame_instances(instance_buffers, current_frame, config.instances, config.instance_draws);
+        }
+        const FrameInstances* instances = config.instances > 0 ? &frame_instances : nullptr;
+
+        // The culled draws are the same frustum as the vertex shader sees.
+        FrameCulling frame_culling;
+        bool culled_draws = config.culling != CullingMode::None && graphics_pipeline != VK_NULL_HANDLE;
+        if (culled_draws) {
+            ProfileTimer timer(profiler, ProfileScope::Culling);
+            prepare_frame_culling(
+                frame_culling, culling,
+                current_frame, uniforms.transform,
+                frame.descriptor_allocator, vulkan_logical_device);
+        }
+
+        // The imported resources of the graph for this frame: the swapchain image and
+        // the culling regions of the frame in flight.
+        bind_render_graph_image(
+            frame_graph, backbuffer_resource,
+            vulkan_swapchain_images[image_index], vulkan_swapchain_image_views[image_index]);
+        if (config.culling == CullingMode::Gpu) {
+            bind_render_graph_buffer(
+                frame_graph, culling_commands_resource,
+                culling.indirect_buffer, current_frame * culling.indirect_region_size, culling.indirect_region_size);
+            bind_render_graph_buffer(
+                frame_graph, culling_count_resource,
+                culling.count_buffer, current_frame * culling.count_region_size, culling.count_region_size);
+        }
+
+        frame_pass_data.graphics_pipeline = graphics_pipeline;
+        frame_pass_data.pipeline_layout = pipeline_layout;
+        frame_pass_data.frame_descriptor_set = frame_descriptor_set;
+        frame_pass_data.frame_uniforms_offset = frame_uniforms_offset;
+        frame_pass_data.instances = instances;
+        frame_pass_data.frame_culling = culled_draws ? &frame_culling : nullptr;
+
+        // Front to back through the same transform as the vertex shader.
+        frame_pass_data.draw_order = nullptr;
+        if (config.sort_draws && !culled_draws && graphics_pipeline != VK_NULL_HANDLE) {
+            sort_draws_front_to_back(draw_sorter, mesh, uniforms.transform, 0, 0);
+            frame_pass_data.draw_order = draw_sorter.order.data();
+        }
+
+        {
+            ProfileTimer timer(profiler, ProfileScope::Record);
+            vkResetCommandBuffer(frame.command_buffer, 0);
+
+            secondary_command_buffers.clear();
+            // The culled draws are a single indirect draw, there is nothing to split.
+            if (config.record_jobs > 0 && graphics_pipeline != VK_NULL_HANDLE && !culled_draws) {
+                SecondaryRecordJob job{};
+                job.graphics_pipeline = graphics_pipeline;
+                job.pipeline_layout = pipeline_layout;
+                job.frame_descriptor_set = frame_descriptor_set;
+                job.frame_uniforms_offset = frame_uniforms_offset;
+                job.render_pass = get_pass_render_pass(frame_graph, main_pass);
+                job.framebuffer = get_pass_framebuffer(frame_graph, main_pass, vulkan_logical_device);
+                job.color_formats = graphics_pipeline_desc.color_formats;
+                job.depth_format = graphics_pipeline_desc.depth_format;
+                job.samples = graphics_pipeline_desc.rasterization_samples;
+                job.extent = vulkan_swapchain_extent;
+                job.mesh = &mesh;
+                job.instances = instances;
+                job.draw_order = frame_pass_data.draw_order;
+                job.frame_index = current_frame;
+
+                record_secondary_command_buffers(parallel_recorder, job_system, job, secondary_command_buffers);
+            }
+
+            frame_graph.passes[main_pass].contents = secondary_command_buffers.empty() ?
+                VK_SUBPASS_CONTENTS_INLINE : VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS;
+
+            record_command_buffer(
+                frame.command_buffer,
+                frame_graph, vulkan_logical_device,
+                profiler.timestamp_query_pool, first_timestamp_query(current_frame));
+        }
+
+        // Wait with writing colors to the image until it is available. The other
+        // stages of the pipeline (e.g. the vertex shader) can already start.
+        // Headless there is no acquire to wait for and no present to signal,
+        // the fence alone tracks the frame.
+        VkSemaphore wait_semaphores[2];
+        VkPipelineStageFlags wait_stages[2];
+        uint64_t wait_values[2] = { 0, 0 }; // Ignored for binary semaphores
+        uint32_t wait_count = 0;
+        if (!config.headless) {
+            wait_semaphores[wait_count] = frame.image_available_semaphore;
+            wait_stages[wait_count] = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+            wait_count++;
+        }
+
+        // The streamed data is read from the vertex input on (and by the indirect draws),
+        // the transfers can overlap the start of the frame.
+        uint64_t upload_wait_value = get_upload_wait_value(upload_scheduler);
+        if (upload_wait_value > 0) {
+            wait_semaphores[wait_count] = upload_scheduler.timeline_semaphore;
+            wait_stages[wait_count] =
+                VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT;
+            wait_values[wait_count] = upload_wait_value;
+            wait_count++;
+        }
+
+        // The semaphore of the image, not of the frame (see create_render_finished_semaphores()).
+        VkSemaphore signal_semaphores[] = { config.headless ? VK_NULL_HANDLE : render_finished_semaphores[image_index] };
+        uint32_t signal_count = config.headless ? 0 : 1;
+
+        VkSubmitInfo submit_info{};
+        submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submit_info.waitSemaphoreCount = wait_count;
+        submit_info.pWaitSemaphores = wait_semaphores;
+        submit_info.pWaitDstStageMask = wait_stages;
+        submit_info.commandBufferCount = 1;
+        submit_info.pCommandBuffers = &frame.command_buffer;
+        submit_info.signalSemaphoreCount = signal_count;
+        submit_info.pSignalSemaphores = signal_semaphores;
+
+        // With a timeline semaphore among the waits, every wait needs a value.
+        VkTimelineSemaphoreSubmitInfo timeline_submit_info{};
+        if (upload_wait_value > 0) {
+            timeline_submit_info.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+            timeline_submit_info.waitSemaphoreValueCount = wait_count;
+            timeline_submit_info.pWaitSemaphoreValues = wait_values;
+            submit_info.pNext = &timeline_submit_info;
+        }
+
+        // The fence is signaled once the command buffer has finished executing.
+        {
+            ProfileTimer timer(profiler, ProfileScope::Submit);
+            if (vkQueueSubmit(vulkan_graphics_queue, 1, &submit_info, frame.in_flight_fence) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to submit draw command buffer! \n");
+            }
+        }
+
+        mark_gpu_timings_pending(profiler, current_frame, submitted_frames);
+        submitted_frames++;
+
+        if (submitted_frames == 1) {
+            LOG_INFO("First frame submitted %.3f ms after startup (pipeline %s).",
+                std::chrono::duration<double, std::milli>(clock::now() - startup_time).count(),
+                graphics_pipeline != VK_NULL_HANDLE ? "ready" : "still compiling");
+        }
+        last_rendered_image = image_index;
+
+        // Give the image back to the swapchain once rendering has finished.
+        VkPresentInfoKHR present_info{};
+        present_info.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+        present_info.waitSemaphoreCount = 1;
+        present_info.pWaitSemaphores = signal_semaphores;
+        present_info.swapchainCount = 1;
+        present_info.pSwapchains = &vulkan_swapchain;
+        present_info.pImageIndices = &image_index;
+
+        if (!config.headless) {
+            VkResult present_result;
+            {
+                ProfileTimer timer(profiler, ProfileScope::Present);
+                present_result = vkQueuePresentKHR(vulkan_present_queue, &present_info);
+            }
+
+            if (present_result == VK_SUCCESS || present_result == VK_SUBOPTIMAL_KHR) {
+                frame_stats.present_done();
+            }
+
+            if (present_result == VK_ERROR_OUT_OF_DATE_KHR || present_result == VK_SUBOPTIMAL_KHR || framebuffer_resized) {
+                recreate_swapchain();
+            }
+            else if (present_result != VK_SUCCESS) {
+                throw std::runtime_error("Failed to present Vulkan Swapchain image! \n");
+            }
+        }
+
+        current_frame = (current_frame + 1) % config.frames_in_flight;
+
+        frame_stats.end_frame(cpu_wait_ms);
+        profiler.end_frame();
     }
 
     void main_loop() {
 
+        frame_stats.begin(config.frames_in_flight);
+        if (!config.headless) {
+            frame_stats.present_mode = present_mode_to_string(vulkan_present_mode);
+        }
+
         // Checks for events until the window is closed
-        while (!glfwWindowShouldClose(window)) {
+        // (headless, only max_frames ends the loop).
+        while (config.headless || !glfwWindowShouldClose(window)) {
+
+            if (!config.headless) {
+                glfwPollEvents(); // Check for events
+
+                // Don't render while minimized, sleep until something happens instead.
+                if (is_window_minimized()) {
+                    glfwWaitEvents();
+                    continue;
+                }
 
-            glfwPollEvents(); // Check for events
+                if (framebuffer_resized) {
+                    recreate_swapchain();
+                }
+            }
 
             draw_frame();
+
+            if (config.max_frames > 0 && frame_stats.total_frames >= config.max_frames) {
+                break;
+            }
+        }
+
+        // All of the operations in draw_frame() are asynchronous, so when we exit
+        // the loop drawing and presentation may still be going on.
+        // Wait for the logical device to finish before cleaning up.
+        vkDeviceWaitIdle(vulkan_logical_device);
+
+        // The summaries below go straight to std::cout, the frame log must come first.
+        flush_log();
+
+        // The device is idle, the timestamps of the last frames are available too.
+        for (uint32_t i = 0; i < config.frames_in_flight; i++) {
+            collect_gpu_timings(profiler, vulkan_logical_device, i);
+        }
+
+        frame_stats.print_summary();
+        profiler.print_summary();
+        print_pipeline_stats(pipeline_compiler);
+
+        std::vector<const DescriptorAllocator*> descriptor_allocators;
+        for (const auto& frame : frames) {
+            descriptor_allocators.push_back(&frame.descriptor_allocator);
+        }
+        print_descriptor_stats(descriptor_layout_cache, descriptor_pools, descriptor_allocators);
+
+        print_culling_stats(culling);
+        print_draw_sort_stats(draw_sorter);
+        print_upload_stats(upload_scheduler);
+
+        begin_uniform_ring_frame(uniform_ring, 0); // Counts the last frame in the peak
+        std::cout << "Uniform ring: peak " << uniform_ring.peak_bytes << " of " << uniform_ring.frame_size
+            << " bytes per frame (" << uniform_ring.alignment << " bytes alignment). \n\n";
+
+        if (!config.profile_output.empty()) {
+            save_profiler_report(profiler, config.profile_output);
+        }
+
+        if (config.headless && !config.output_image.empty() && frame_stats.total_frames > 0) {
+            save_offscreen_image(
+                config.output_image,
+                vulkan_swapchain_images[last_rendered_image], vulkan_swapchain_extent,
+                memory_allocator, vulkan_logical_device,
+                vulkan_command_pool, vulkan_graphics_queue);
         }
     }
 
@@ -148,32 +1063,92 @@ private:
 
         // Destroy objects in opposite order of creation.
 
+        std::cout << "Destroying Profiler... \n\n";
+        destroy_profiler(profiler, vulkan_logical_device);
+
+        if (config.record_jobs > 0) {
+            std::cout << "Destroying Parallel command recorder... \n\n";
+            destroy_parallel_recorder(parallel_recorder);
+        }
+
+        std::cout << "Destroying Vulkan Sync objects... \n\n";
+        destroy_sync_objects(frames, vulkan_logical_device);
+
+        std::cout << "Destroying Frame descriptor allocators... \n\n";
+        destroy_frame_resources(frames);
+
+        if (config.instances > 0) {
+            std::cout << "Destroying Instance buffers... \n\n";
+            destroy_instance_buffers(instance_buffers, memory_allocator, vulkan_logical_device);
+        }
+
+        std::cout << "Destroying Uniform ring buffer... \n\n";
+        destroy_uniform_ring(uniform_ring, memory_allocator, vulkan_logical_device);
+
+        std::cout << "Destroying Vulkan Descriptor pools... \n\n";
+        destroy_descriptor_pools(descriptor_pools);
+
+        if (config.culling != CullingMode::None) {
+            std::cout << "Destroying Culling system... \n\n";
+            destroy_culling_system(culling, memory_allocator, vulkan_logical_device);
+        }
+
+        std::cout << "Destroying Mesh... \n\n";
+        destroy_mesh(mesh, memory_allocator, vulkan_logical_device);
+
+        if (config.upload_budget_kb > 0) {
+            std::cout << "Destroying Upload scheduler... \n\n";
+            destroy_upload_scheduler(upload_scheduler, memory_allocator, vulkan_logical_device);
+        }
+
+        std::cout << "Destroying Vulkan Transfer command pool... \n\n";
+        vkDestroyCommandPool(vulkan_logical_device, vulkan_transfer_command_pool, nullptr);
+
         std::cout << "Destroying Vulkan Command pool... \n\n";
         vkDestroyCommandPool(vulkan_logical_device, vulkan_command_pool, nullptr);
 
-        // Delete the framebuffers  before the image views and render pass they 
-        // are based on, but only after the rendering is finished.
-        std::cout << "Destroying Vulkan Swapchain framebuffers... \n\n";
-        for (auto framebuffer : vulkan_swapchain_framebuffers) {
-            vkDestroyFramebuffer(vulkan_logical_device, framebuffer, nullptr);
-        }
+        // Waits for the pipelines that are still compiling (a very short run may end first).
+        std::cout << "Destroying Vulkan Graphics Pipelines and Layouts... \n\n";
+        destroy_pipeline_compiler(pipeline_compiler);
 
-        std::cout << "Destroying Vulkan Graphics Pipeline... \n\n";
-        vkDestroyPipeline(vulkan_logical_device, vulkan_graphics_pipeline, nullptr);
+        std::cout << "Destroying Vulkan Descriptor set layouts... \n\n";
+        destroy_descriptor_layout_cache(descriptor_layout_cache);
 
-        std::cout << "Destroying Vulkan Pipeline Layout... \n\n";
-        vkDestroyPipelineLayout(vulkan_logical_device, vulkan_pipeline_layout, nullptr);
+        // Save the cache before destroying it, the next run will start warm.
+        save_pipeline_cache(vulkan_pipeline_cache, vulkan_logical_device, config.pipeline_cache_file);
 
-        std::cout << "Destroying Vulkan Render pass... \n\n";
-        vkDestroyRenderPass(vulkan_logical_device, vulkan_render_pass, nullptr);
+        std::cout << "Destroying Vulkan Pipeline cache... \n\n";
+        vkDestroyPipelineCache(vulkan_logical_device, vulkan_pipeline_cache, nullptr);
+
+        // The frame graph owns the render pass and the framebuffers (and the transient
+        // images), the framebuffers go before the image views they are based on.
+        std::cout << "Destroying Render graph... \n\n";
+        destroy_render_graph(frame_graph, memory_allocator, vulkan_logical_device);
 
         std::cout << "Destroying Vulkan Image views... \n\n";
         for (auto img_view : vulkan_swapchain_image_views) {
             vkDestroyImageView(vulkan_logical_device, img_view, nullptr);
         }
 
-        std::cout << "Destroying Vulkan Swapchain... \n\n";
-        vkDestroySwapchainKHR(vulkan_logical_device, vulkan_swapchain, nullptr);
+        if (config.headless) {
+            std::cout << "Destroying Vulkan Offscreen images... \n\n";
+            destroy_offscreen_images(vulkan_swapchain_images, vulkan_offscreen_allocations, memory_allocator, vulkan_logical_device);
+        }
+        else {
+            // The device is idle here, so the retired swapchains can go as well.
+            std::cout << "Destroying Vulkan Retired swapchains... \n\n";
+            for (auto& retired : retired_swapchains) {
+                destroy_retired_swapchain(retired, memory_allocator, vulkan_logical_device);
+            }
+            retired_swapchains.clear();
+
+            std::cout << "Destroying Vulkan Swapchain... \n\n";
+            vkDestroySwapchainKHR(vulkan_logical_device, vulkan_swapchain, nullptr);
+            destroy_render_finished_semaphores(render_finished_semaphores, vulkan_logical_device);
+        }
+
+        std::cout << "Destroying Device memory allocator... \n\n";
+        destroy_memory_allocator(memory_allocator);
 
         std::cout << "Destroying Vulkan Logical device... \n\n";
         vkDestroyDevice(vulkan_logical_device, nullptr);
@@ -183,29 +1158,167 @@ private:
             destroy_debug_messenger(vulkan_debugger_messenger, vulkan_instance, nullptr);
         }
 
-        std::cout << "Destroying Vulkan Surface (Win32)... \n\n";
-        vkDestroySurfaceKHR(vulkan_instance, vulkan_surface, nullptr);
+        if (!config.headless) {
+            std::cout << "Destroying Vulkan Surface (Win32)... \n\n";
+            vkDestroySurfaceKHR(vulkan_instance, vulkan_surface, nullptr);
+        }
 
         std::cout << "Destroying Vulkan Instance... \n\n";
         std::cout << "Unloading validation layers: \n";
         vkDestroyInstance(vulkan_instance, nullptr);
 
-        glfwDestroyWindow(window);
+        if (!config.headless) {
+            glfwDestroyWindow(window);
 
-        glfwTerminate(); // Shutdowns the GLFW lib
+            glfwTerminate(); // Shutdowns the GLFW lib
+        }
+
+        std::cout << "Destroying Job system... \n\n";
+        destroy_job_system(job_system);
     }
     /* ----------------------------------------------------------------- */
 };
 
 
-int main() {
+// Frames rendered at every sample count by --bench msaa (--max-frames overrides it).
+const uint64_t DEFAULT_MSAA_BENCHMARK_FRAMES = 500;
 
-    VulkanDemo demo;
+// --bench msaa: GPU time of the demo frame at every sample count the device supports, from
+// 1x up to --msaa (all of them with the default --msaa 1). Unlike the benchmarks of
+// benchmarks.cpp it needs the device: every count runs the whole demo headless, with
+// the pipelines compiled before the first frame so that every frame draws the mesh.
+// The rest of the configuration (--mesh-grid, --instances, ...) is the scene measured.
+static void benchmark_msaa(const AppConfig& config) {
 
-    try {
+    AppConfig run_config = config;
+    run_config.benchmark.clear();
+    run_config.headless = true;
+    run_config.output_image.clear();
+    run_config.sync_pipelines = true;
+    run_config.max_frames = config.max_frames > 0 ? config.max_frames : DEFAULT_MSAA_BENCHMARK_FRAMES;
+
+    uint32_t max_samples = config.msaa_samples > 1 ? config.msaa_samples : MAX_MSAA_SAMPLES;
+
+    std::vector<BenchmarkResult> results;
+    for (uint32_t samples = 1; samples <= max_samples; samples *= 2) {
+
+        run_config.msaa_samples = samples;
+        VulkanDemo demo(run_config);
         demo.run();
+
+        // Lowered to a count already measured: the device supports nothing higher.
+        if (static_cast<uint32_t>(demo.get_msaa_samples()) != samples) {
+            break;
+        }
+
+        BenchmarkResult result;
+        result.name = std::to_string(samples) + "x";
+        result.samples_ms = demo.get_gpu_frame_times();
+        if (result.samples_ms.empty()) {
+            throw std::runtime_error("--bench msaa needs GPU timestamps, which the graphics queue doesn't support! \n");
+        }
+        results.push_back(result);
+    }
+
+    print_benchmark_results(
+        "MSAA, GPU time per frame at " + std::to_string(WIDTH) + " x " + std::to_string(HEIGHT)
+            + ", last " + std::to_string(std::min<uint64_t>(run_config.max_frames, PROFILER_HISTORY_SIZE)) + " of "
+            + std::to_string(run_config.max_frames) + " frames",
+        results);
+}
+
+
+// Frames rendered on every path by --bench rendering (--max-frames overrides it).
+const uint64_t DEFAULT_RENDERING_BENCHMARK_FRAMES = 500;
+
+// --bench rendering: CPU time recording the command buffer with render pass objects and
+// with dynamic rendering, running the demo headless like --bench msaa. The dynamic path
+// runs as --rendering auto so that a device without dynamic rendering only measures
+// the render pass path.
+static void benchmark_rendering(const AppConfig& config) {
+
+    AppConfig run_config = config;
+    run_config.benchmark.clear();
+    run_config.headless = true;
+    run_config.output_image.clear();
+    run_config.sync_pipelines = true;
+    run_config.max_frames = config.max_frames > 0 ? config.max_frames : DEFAULT_RENDERING_BENCHMARK_FRAMES;
+
+    std::vector<BenchmarkResult> results;
+    for (RenderingPath path : { RenderingPath::RenderPass, RenderingPath::Auto }) {
+
+        run_config.rendering = path;
+        VulkanDemo demo(run_config);
+        demo.run();
+
+        if (path == RenderingPath::Auto && !demo.uses_dynamic_rendering()) {
+            std::cout << "The device doesn't support dynamic rendering, only the render pass path is measured. \n\n";
+            break;
+        }
+
+        BenchmarkResult result;
+        result.name = rendering_path_to_string(path == RenderingPath::Auto ? RenderingPath::Dynamic : path);
+        result.samples_ms = demo.get_record_times();
+        results.push_back(result);
+    }
+
+    print_benchmark_results(
+        "Rendering path, CPU time recording the command buffer, last "
+            + std::to_string(std::min<uint64_t>(run_config.max_frames, PROFILER_HISTORY_SIZE)) + " of "
+            + std::to_string(run_config.max_frames) + " frames",
+        results);
+}
+
+
+// --self-test memory: the buddy allocator checks, then the demo runs headless for a
+// frame and tests its memory allocator right after creating it (see self_tests.hpp).
+static void self_test_memory(const AppConfig& config) {
+
+    test_buddy_allocator();
+
+    AppConfig run_config = config;
+    run_config.benchmark.clear();
+    run_config.headless = true;
+    run_config.output_image.clear();
+    run_config.max_frames = 1;
+
+    VulkanDemo demo(run_config);
+    demo.run();
+}
+
+
+int main(int argc, char* argv[]) {
+
+    try {
+        AppConfig config = parse_app_config(argc, argv);
+        print_app_config(config);
+
+        start_logger(config.log_mode);
+
+        if (config.self_test == "memory") {
+            self_test_memory(config);
+        }
+        else if (!config.self_test.empty()) {
+            throw std::runtime_error("Unknown self test: " + config.self_test + " \n");
+        }
+        else if (config.benchmark == "msaa") {
+            benchmark_msaa(config);
+        }
+        else if (config.benchmark == "rendering") {
+            benchmark_rendering(config);
+        }
+        else if (!config.benchmark.empty()) {
+            run_benchmark(config);
+        }
+        else {
+            VulkanDemo demo(config);
+            demo.run();
+        }
+
+        stop_logger();
     }
     catch (const std::exception& ex) {
+        stop_logger();
         std::cerr << ex.what() << std::endl;
         return EXIT_FAILURE;
     }
@@ -65,9 +65,9 @@ bool check_validation_layers_support() {
 }
 
 
-// Checks if the extensions specified
-// in DEVICE_EXTENSIONS are available for our device.
-bool check_extensions_support(VkPhysicalDevice phys_device) {
+// Checks if the extensions returned by get_required_device_extensions()
+// are available for our device.
+bool check_extensions_support(VkSurfaceKHR vk_surface, VkPhysicalDevice phys_device) {
 
     // Technically, the availability of a presentation queue
     // implies that the swapchain extension VK_KHR_SWAPCHAIN_EXTENSION_NAME
@@ -80,7 +80,8 @@ bool check_extensions_support(VkPhysicalDevice phys_device) {
     vkEnumerateDeviceExtensionProperties(phys_device, nullptr, &extensions_count, available_extensions.data());
 
     // Unconfirmed required extensions
-    std::set<std::string> required_extensions(DEVICE_EXTENSIONS.begin(), DEVICE_EXTENSIONS.end());
+    std::vector<const char*> device_extensions = get_required_device_extensions(vk_surface);
+    std::set<std::string> required_extensions(device_extensions.begin(), device_extensions.end());
 
     // We could also use a nested loop like in check_validation_layers_support.
     for (const auto& ext : available_extensions) {
@@ -92,16 +93,55 @@ bool check_extensions_support(VkPhysicalDevice phys_device) {
 
 
 // Gets the required GLFW extensions.
-std::vector<const char*> get_required_extensions() {
+std::vector<const char*> get_required_extensions(bool headless) {
 
-    uint32_t glfw_extensions_count = 0;
-    const char** glfw_extensions = glfwGetRequiredInstanceExtensions(&glfw_extensions_count);
+    std::vector<const char*> extensions;
 
-    std::vector<const char*> extensions(glfw_extensions, glfw_extensions + glfw_extensions_count);
+    // Without a window we don't need any of the surface extensions
+    // (and GLFW is not even initialized).
+    if (!headless) {
+        uint32_t glfw_extensions_count = 0;
+        const char** glfw_extensions = glfwGetRequiredInstanceExtensions(&glfw_extensions_count);
+
+        extensions.assign(glfw_extensions, glfw_extensions + glfw_extensions_count);
+    }
 
     if (ENABLE_VALIDATION_LAYERS) {
         extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME); // Debug messenger extension
     }
 
     return extensions;
-}
\ No newline at end of file
+}
+
+
+// Gets the device extensions we need. Without a surface we never present,
+// so VK_KHR_swapchain is not required.
+std::vector<const char*> get_required_device_extensions(VkSurfaceKHR vk_surface) {
+
+    if (is_headless(vk_surface)) {
+        return {};
+    }
+
+    return DEVICE_EXTENSIONS;
+}
+
+
+// Finds a memory type that is allowed by type_filter (memoryTypeBits of
+// VkMemoryRequirements) and has all of the requested properties.
+uint32_t find_memory_type(VkPhysicalDevice phys_device, uint32_t type_filter, VkMemoryPropertyFlags properties) {
+
+    VkPhysicalDeviceMemoryProperties memory_properties;
+    vkGetPhysicalDeviceMemoryProperties(phys_device, &memory_properties);
+
+    // type_filter is a bit field where bit i is set if memoryTypes[i] can be used.
+    for (uint32_t i = 0; i < memory_properties.memoryTypeCount; i++) {
+
+        if ((type_filter & (1 << i)) &&
+            (memory_properties.memoryTypes[i].propertyFlags & properties) == properties) {
+
+            return i;
+        }
+    }
+
+    throw std::runtime_error("Failed to find a suitable memory type! \n");
+}
@@ -3,6 +3,9 @@
 #define GLFW_INCLUDE_VULKAN // implicitly #include <vulkan/vulkan.h>
 #include <GLFW/glfw3.h>
 
+#include "vk_trace.hpp" // TRACE_SCOPE
+#include "vk_log.hpp" // LOG_*
+
 #include <iostream>
 #include <vector>
 #include <string>
@@ -20,6 +23,12 @@ const std::vector<const char*> VALIDATION_LAYERS = { "VK_LAYER_KHRONOS_validatio
 // Stores all required extensions (for now only VK_KHR_swapchain).
 const std::vector<const char*> DEVICE_EXTENSIONS = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
 
+// Throughout the demo a VK_NULL_HANDLE surface means we are running headless:
+// there is no window to present to, we render into offscreen images instead.
+inline bool is_headless(VkSurfaceKHR vk_surface) {
+    return vk_surface == VK_NULL_HANDLE;
+}
+
 
 // Reads all of the bytes from the specified file and
 // return them in a byte array managed by std::vector.
@@ -29,9 +38,17 @@ std::vector<char> read_file(const std::string& file_name);
 // in VALIDION_LAYERS array are available.
 bool check_validation_layers_support();
 
-// Checks if the extensions specified
-// in DEVICE_EXTENSIONS are available for our device.
-bool check_extensions_support(VkPhysicalDevice phys_device);
+// Checks if the extensions returned by get_required_device_extensions()
+// are available for our device.
+bool check_extensions_support(VkSurfaceKHR vk_surface, VkPhysicalDevice phys_device);
+
+// Gets required GLFW extensions (none when running headless).
+std::vector<const char*> get_required_extensions(bool headless);
+
+// Gets the device extensions we need. Without a surface we never present,
+// so VK_KHR_swapchain is not required.
+std::vector<const char*> get_required_device_extensions(VkSurfaceKHR vk_surface);
 
-// Gets required GLFW extensions.
-std::vector<const char*> get_required_extensions();
\ No newline at end of file
+// Finds a memory type that is allowed by type_filter (memoryTypeBits of
+// VkMemoryRequirements) and has all of the requested properties.
+uint32_t find_memory_type(VkPhysicalDevice phys_device, uint32_t type_filter, VkMemoryPropertyFlags properties);
\ No newline at end of file
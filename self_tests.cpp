@@ -0,0 +1,169 @@
+#include "self_tests.hpp"
+
+#include <algorithm> // std::sort | std::unique
+#include <cstring> // memset
+#include <iostream>
+#include <stdexcept>
+
+
+// Block of the buddy allocator tests: 256 pieces of MEMORY_MIN_ALLOCATION_SIZE.
+const VkDeviceSize TEST_BLOCK_SIZE = 64 * 1024;
+
+
+static void check(bool condition, const std::string& what) {
+
+    if (!condition) {
+        throw std::runtime_error("Self test failed: " + what + "! \n");
+    }
+}
+
+
+// The free lists of a block with nothing allocated: the whole block is a single piece.
+static bool is_single_free_piece(const BuddyAllocator& buddy) {
+
+    for (uint32_t order = 0; order + 1 < buddy.orders_count; order++) {
+        if (!buddy.free_lists[order].empty()) {
+            return false;
+        }
+    }
+    const auto& top = buddy.free_lists[buddy.orders_count - 1];
+    return top.size() == 1 && *top.begin() == 0;
+}
+
+
+void test_buddy_allocator() {
+
+    std::cout << "Testing the buddy allocator... \n";
+
+    BuddyAllocator buddy;
+    buddy.init(TEST_BLOCK_SIZE);
+    check(buddy.orders_count == 9, "a 64 KB block has 9 orders");
+    check(buddy.is_empty() && is_single_free_piece(buddy), "a new block is a single free piece");
+    check(buddy.largest_free_piece() == TEST_BLOCK_SIZE, "the largest free piece of a new block is the block");
+
+    // Split: the first allocation halves the block down to the smallest piece, the
+    // second one takes the next half up.
+    VkDeviceSize small_offset = 0;
+    VkDeviceSize medium_offset = 0;
+    check(buddy.allocate(100, 1, small_offset), "allocating 100 bytes");
+    check(small_offset == 0, "the first piece is at the start of the block");
+    check(buddy.allocated_bytes == MEMORY_MIN_ALLOCATION_SIZE, "100 bytes take a piece of the minimum size");
+    check(buddy.largest_free_piece() == TEST_BLOCK_SIZE / 2, "splitting leaves the upper half free");
+
+    check(buddy.allocate(300, 1, medium_offset), "allocating 300 bytes");
+    check(medium_offset == 512, "300 bytes go to the free 512 byte piece");
+    check(buddy.allocated_bytes == 256 + 512, "the stats count the rounded sizes");
+
+    // Alignment: a piece at least as large as the alignment, so aligned to it.
+    VkDeviceSize aligned_offset = 0;
+    check(buddy.allocate(256, 4096, aligned_offset), "allocating with a 4096 byte alignment");
+    check(aligned_offset % 4096 == 0, "the offset respects the alignment");
+    check(aligned_offset != 0, "an aligned piece doesn't overlap the first one");
+
+    check(!buddy.allocate(TEST_BLOCK_SIZE * 2, 1, aligned_offset), "a request larger than the block fails");
+    check(!buddy.allocate(TEST_BLOCK_SIZE, 1, aligned_offset), "a request for the whole block fails once it is split");
+
+    // Merge: freed in a different order than allocated, the pieces still merge back.
+    buddy.free(small_offset);
+    buddy.free(aligned_offset);
+    buddy.free(medium_offset);
+    check(buddy.is_empty() && buddy.allocated_bytes == 0, "everything is freed");
+    check(is_single_free_piece(buddy), "the freed pieces merge back into a single piece");
+
+    bool double_free_throws = false;
+    try {
+        buddy.free(small_offset);
+    }
+    catch (const std::runtime_error&) {
+        double_free_throws = true;
+    }
+    check(double_free_throws, "freeing a piece twice throws");
+
+    // Exhaustion: the block holds exactly 256 of the smallest pieces, all distinct.
+    std::vector<VkDeviceSize> offsets(TEST_BLOCK_SIZE / MEMORY_MIN_ALLOCATION_SIZE);
+    for (auto& offset : offsets) {
+        check(buddy.allocate(1, 1, offset), "filling the block with the smallest pieces");
+    }
+    VkDeviceSize extra_offset = 0;
+    check(!buddy.allocate(1, 1, extra_offset), "a full block fails");
+    check(buddy.largest_free_piece() == 0, "a full block has no free piece");
+
+    std::vector<VkDeviceSize> sorted_offsets = offsets;
+    std::sort(sorted_offsets.begin(), sorted_offsets.end());
+    check(std::unique(sorted_offsets.begin(), sorted_offsets.end()) == sorted_offsets.end(), "the pieces don't overlap");
+
+    // Every other piece first: nothing can merge until the second pass.
+    for (size_t i = 0; i < offsets.size(); i += 2) {
+        buddy.free(offsets[i]);
+    }
+    check(buddy.largest_free_piece() == MEMORY_MIN_ALLOCATION_SIZE, "pieces whose buddies are allocated don't merge");
+    for (size_t i = 1; i < offsets.size(); i += 2) {
+        buddy.free(offsets[i]);
+    }
+    check(is_single_free_piece(buddy), "a full block freed merges back into a single piece");
+
+    // The threshold of the memory allocator: up to half a block is sub-allocated.
+    check(!needs_dedicated_allocation(MEMORY_BLOCK_SIZE / 2, MEMORY_BLOCK_SIZE), "half a block is sub-allocated");
+    check(needs_dedicated_allocation(MEMORY_BLOCK_SIZE / 2 + 1, MEMORY_BLOCK_SIZE), "over half a block is dedicated");
+
+    std::cout << "Buddy allocator tests passed. \n\n";
+}
+
+
+void test_memory_allocator(MemoryAllocator& allocator) {
+
+    std::cout << "Testing the memory allocator on the device... \n";
+
+    MemoryStats before = get_memory_stats(allocator);
+    check(before.blocks_count == 0 && before.allocations_count == 0, "the allocator is new");
+
+    // Any memory type the host can write, like a staging buffer.
+    VkMemoryRequirements requirements{};
+    requirements.memoryTypeBits = ~0u;
+    VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+    const VkDeviceSize sizes[] = { 100, 1024, 4096 };
+    const VkDeviceSize alignments[] = { 4, 256, 4096 };
+
+    MemoryAllocation small_allocations[3];
+    for (size_t i = 0; i < 3; i++) {
+
+        requirements.size = sizes[i];
+        requirements.alignment = alignments[i];
+        allocate_memory(small_allocations[i], allocator, requirements, properties, AllocationKind::Linear);
+
+        check(small_allocations[i].pool != nullptr, "small allocations come from a block");
+        check(small_allocations[i].offset % alignments[i] == 0, "sub-allocations respect the alignment");
+        check(small_allocations[i].mapped != nullptr, "host visible sub-allocations are mapped");
+        memset(small_allocations[i].mapped, 0xAB, static_cast<size_t>(sizes[i]));
+    }
+    check(small_allocations[0].memory == small_allocations[1].memory &&
+        small_allocations[1].memory == small_allocations[2].memory, "the small allocations share one block");
+
+    // Just over the threshold: a VkDeviceMemory of its own.
+    MemoryAllocation dedicated_allocation;
+    requirements.size = small_allocations[0].pool->block_size / 2 + 1;
+    requirements.alignment = 256;
+    allocate_memory(dedicated_allocation, allocator, requirements, properties, AllocationKind::Linear);
+    check(dedicated_allocation.pool == nullptr && dedicated_allocation.offset == 0, "over half a block is dedicated");
+
+    MemoryStats stats = get_memory_stats(allocator);
+    check(stats.blocks_count == before.blocks_count + 1, "the small allocations took one block");
+    check(stats.dedicated_count == 1, "the stats count the dedicated allocation");
+    check(stats.allocations_count == 4, "the stats count every live allocation");
+    check(stats.device_allocations == before.device_allocations + 2, "one block and one dedicated vkAllocateMemory()");
+    check(stats.used_bytes == 100 + 1024 + 4096 + requirements.size, "the stats count the requested sizes");
+    check(stats.allocated_bytes >= stats.used_bytes, "the rounded sizes are at least the requested ones");
+
+    for (auto& allocation : small_allocations) {
+        free_memory(allocation, allocator);
+    }
+    free_memory(dedicated_allocation, allocator);
+
+    MemoryStats after = get_memory_stats(allocator);
+    check(after.allocations_count == 0 && after.used_bytes == 0 && after.dedicated_count == 0, "everything is freed");
+    check(after.blocks_count == before.blocks_count + 1, "the last block of a pool is kept for the next allocations");
+    check(after.external_fragmentation == 0.0, "the kept block is a single free piece again");
+
+    std::cout << "Memory allocator tests passed. \n\n";
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "app_config.hpp"
+#include "vk_memory.hpp"
+
+
+// Self tests, selected with --self-test <name>. Every check that fails throws, so a
+// self test that returns has passed (and the demo exits with EXIT_SUCCESS):
+// - memory: the buddy allocator without a device (split and merge, alignment, exhaustion,
+//   stats, the dedicated allocation threshold), then one pass of the memory allocator on
+//   the device, running the demo headless for a frame (in main.cpp).
+
+
+// The checks that need no device.
+void test_buddy_allocator();
+
+// Sub-allocations, a dedicated allocation and the stats of a memory allocator just
+// created (no block yet), on the device it was created for.
+void test_memory_allocator(MemoryAllocator& allocator);
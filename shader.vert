@@ -1,43 +1,44 @@
 #version 450
 
-vec2 positions[3] = vec2[](
-	
-	vec2(0.0, -0.5),
-	vec2(0.5, 0.5),
-	vec2(-0.5, 0.5)
-);
-
-vec3 colors[3] = vec3[](
-	
-	vec3(1.0, 0.0, 0.0),
-    vec3(0.0, 1.0, 0.0),
-    vec3(0.0, 0.0, 1.0)
-);
+// Per-vertex attributes, read from the vertex buffer.
+// The locations match the vertex layout of the Vertex struct (see vk_mesh.cpp).
+layout(location = 0) in vec2 in_position;
+layout(location = 1) in vec3 in_color;
+
+// Per-frame data, written by the CPU every frame into the uniform ring (FrameUniforms
+// in vk_frame.hpp). Bound as a dynamic uniform buffer: the block read is picked by the
+// dynamic offset given to vkCmdBindDescriptorSets(), the GLSL is the same.
+layout(set = 0, binding = 0) uniform FrameUniforms {
+	mat4 transform;
+} frame;
 
 layout(location = 0) out vec3 fragment_color;
 
 void main() {
 
-	gl_Position = vec4(positions[gl_VertexIndex], 0.0, 1.0);
-	fragment_color = colors[gl_VertexIndex];
+	gl_Position = frame.transform * vec4(in_position, 0.0, 1.0);
+	fragment_color = in_color;
 }
 
-/*	
-We are doing something unorthodox: include the coordinates directly inside the vertex shader.
+/*
+The vertex data now comes from a vertex buffer instead of being hardcoded
+in the shader.
 
-gl_VertexIndex variable: contains the index of the current vertex
-	usually it is an index into the vertex buffer, but in our case
-	it will be an index into a hardcoded array of vertex data
-  
-	the position of each vertex is accessed from the constant array
-	in the shader and combined with dummy z and w components to produce
-	a position in clip coordinates
+in variables: the vertex attributes, one value per vertex. The layout(location = x)
+	annotations assign indices to the inputs that we can later use to reference them:
+	the pipeline's vertex input state tells Vulkan where in the vertex buffer
+	every location is read from, and in which format.
+	Some types, like dvec3 64 bit vectors, use multiple slots.
+
+	The position is combined with dummy z and w components to produce
+	a position in clip coordinates, then transformed by the per-frame matrix.
+
+uniform blocks: data shared by all of the vertices of a draw, read through a
+	descriptor set. layout(set = s, binding = b) must match the descriptor set
+	layout of the pipeline layout.
 
 gl_Position variable: functions as the output
 
-Now the triangle is a gradient of colors. To do this we just need
-to add a new vector of colors, with every component being a vector of RGB colors
-for every vertex of the triangle.
-Now we need to pass the colors vector to the fragment shader, and we do this
-by adding an output for the colors vector and add a matching input in the fragment shader.
-*/
\ No newline at end of file
+The color of every vertex is passed to the fragment shader through
+the fragment_color output, with a matching input in the fragment shader.
+*/
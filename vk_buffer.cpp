@@ -0,0 +1,172 @@
+#include "vk_buffer.hpp"
+
+#include <algorithm> // std::sort | std::unique
+#include <chrono>
+#include <cstring> // memcpy
+
+
+void create_buffer(
+    VkBuffer& vk_buffer, MemoryAllocation& buffer_allocation,
+    MemoryAllocator& allocator, VkDevice vk_logic_device,
+    VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties,
+    const std::vector<uint32_t>& sharing_queue_families) {
+
+    std::vector<uint32_t> queue_families = sharing_queue_families;
+    std::sort(queue_families.begin(), queue_families.end());
+    queue_families.erase(std::unique(queue_families.begin(), queue_families.end()), queue_families.end());
+
+    VkBufferCreateInfo buffer_create_info{};
+    buffer_create_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    buffer_create_info.size = size;
+    buffer_create_info.usage = usage;
+
+    // CONCURRENT is a bit slower to access on some GPUs, but it avoids releasing and
+    // acquiring the buffer every time it moves from a queue family to another.
+    if (queue_families.size() > 1) {
+        buffer_create_info.sharingMode = VK_SHARING_MODE_CONCURRENT;
+        buffer_create_info.queueFamilyIndexCount = static_cast<uint32_t>(queue_families.size());
+        buffer_create_info.pQueueFamilyIndices = queue_families.data();
+    }
+    else {
+        buffer_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    }
+
+    if (vkCreateBuffer(vk_logic_device, &buffer_create_info, nullptr, &vk_buffer) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create Vulkan Buffer! \n");
+    }
+
+    VkMemoryRequirements memory_requirements;
+    vkGetBufferMemoryRequirements(vk_logic_device, vk_buffer, &memory_requirements);
+
+    allocate_memory(buffer_allocation, allocator, memory_requirements, properties, AllocationKind::Linear);
+
+    vkBindBufferMemory(vk_logic_device, vk_buffer, buffer_allocation.memory, buffer_allocation.offset);
+}
+
+
+void destroy_buffer(
+    VkBuffer& vk_buffer, MemoryAllocation& buffer_allocation,
+    MemoryAllocator& allocator, VkDevice vk_logic_device) {
+
+    vkDestroyBuffer(vk_logic_device, vk_buffer, nullptr);
+    free_memory(buffer_allocation, allocator);
+
+    vk_buffer = VK_NULL_HANDLE;
+}
+
+
+double upload_buffers_with_staging(
+    const std::vector<BufferUpload>& uploads,
+    MemoryAllocator& allocator, VkDevice vk_logic_device,
+    VkCommandPool vk_transfer_command_pool, VkQueue vk_transfer_queue,
+    JobSystem& job_system) {
+
+    TRACE_SCOPE("upload_buffers_with_staging");
+
+    using clock = std::chrono::steady_clock;
+
+    VkDeviceSize staging_size = 0;
+    for (const auto& upload : uploads) {
+        staging_size += upload.size;
+    }
+    if (staging_size == 0) {
+        return 0.0;
+    }
+
+    // The staging buffer lives in memory the CPU can write to. Device-local memory
+    // usually isn't host visible, so the GPU copies the data over from here.
+    VkBuffer staging_buffer;
+    MemoryAllocation staging_allocation;
+    create_buffer(
+        staging_buffer, staging_allocation,
+        allocator, vk_logic_device,
+        staging_size,
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+    clock::time_point upload_start = clock::now();
+
+    // The allocator keeps host visible memory mapped.
+    // HOST_COHERENT: the writes are visible to the device without flushing.
+    void* staging_data = staging_allocation.mapped;
+
+    // Large regions are copied in chunks by several jobs: a single thread usually
+    // can't saturate the memory bandwidth, and this is often write-combined memory.
+    const VkDeviceSize copy_chunk_size = 1024 * 1024;
+    JobCounter copy_counter;
+
+    std::vector<VkBufferCopy> copy_regions(uploads.size());
+    VkDeviceSize staging_offset = 0;
+    for (size_t i = 0; i < uploads.size(); i++) {
+
+        char* destination = static_cast<char*>(staging_data) + staging_offset;
+        const char* source = static_cast<const char*>(uploads[i].data);
+        VkDeviceSize region_size = uploads[i].size;
+
+        uint32_t chunks_count = static_cast<uint32_t>((region_size + copy_chunk_size - 1) / copy_chunk_size);
+        run_parallel_for(job_system, chunks_count, 1, [=](uint32_t first_chunk, uint32_t end_chunk) {
+
+            VkDeviceSize begin = first_chunk * copy_chunk_size;
+            VkDeviceSize end = std::min(end_chunk * copy_chunk_size, region_size);
+            memcpy(destination + begin, source + begin, static_cast<size_t>(end - begin));
+        }, copy_counter);
+
+        copy_regions[i].srcOffset = staging_offset;
+        copy_regions[i].dstOffset = uploads[i].dst_offset;
+        copy_regions[i].size = uploads[i].size;
+
+        staging_offset += uploads[i].size;
+    }
+
+    wait_for_counter(job_system, copy_counter);
+
+    VkCommandBufferAllocateInfo command_buffer_allocate_info{};
+    command_buffer_allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    command_buffer_allocate_info.commandPool = vk_transfer_command_pool;
+    command_buffer_allocate_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    command_buffer_allocate_info.commandBufferCount = 1;
+
+    VkCommandBuffer command_buffer;
+    if (vkAllocateCommandBuffers(vk_logic_device, &command_buffer_allocate_info, &command_buffer) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate the upload command buffer! \n");
+    }
+
+    VkCommandBufferBeginInfo begin_info{};
+    begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkBeginCommandBuffer(command_buffer, &begin_info);
+
+    for (size_t i = 0; i < uploads.size(); i++) {
+        vkCmdCopyBuffer(command_buffer, staging_buffer, uploads[i].dst_buffer, 1, &copy_regions[i]);
+    }
+
+    vkEndCommandBuffer(command_buffer);
+
+    // Wait on a fence rather than vkQueueWaitIdle(), so that other work
+    // submitted to the transfer queue doesn't delay us.
+    VkFenceCreateInfo fence_create_info{};
+    fence_create_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+    VkFence upload_fence;
+    if (vkCreateFence(vk_logic_device, &fence_create_info, nullptr, &upload_fence) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create the upload fence! \n");
+    }
+
+    VkSubmitInfo submit_info{};
+    submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submit_info.commandBufferCount = 1;
+    submit_info.pCommandBuffers = &command_buffer;
+
+    if (vkQueueSubmit(vk_transfer_queue, 1, &submit_info, upload_fence) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to submit the upload command buffer! \n");
+    }
+    vkWaitForFences(vk_logic_device, 1, &upload_fence, VK_TRUE, UINT64_MAX);
+
+    double upload_ms = std::chrono::duration<double, std::milli>(clock::now() - upload_start).count();
+
+    vkDestroyFence(vk_logic_device, upload_fence, nullptr);
+    vkFreeCommandBuffers(vk_logic_device, vk_transfer_command_pool, 1, &command_buffer);
+    destroy_buffer(staging_buffer, staging_allocation, allocator, vk_logic_device);
+
+    return upload_ms;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "my_utils.hpp"
+#include "vk_memory.hpp"
+#include "job_system.hpp"
+
+
+// Creates a buffer and binds it to memory sub-allocated from the allocator.
+// If sharing_queue_families contains more than one distinct family, the buffer is
+// created with VK_SHARING_MODE_CONCURRENT so that those families can use it without
+// ownership transfers.
+void create_buffer(
+    VkBuffer& vk_buffer, MemoryAllocation& buffer_allocation,
+    MemoryAllocator& allocator, VkDevice vk_logic_device,
+    VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties,
+    const std::vector<uint32_t>& sharing_queue_families = {});
+
+void destroy_buffer(
+    VkBuffer& vk_buffer, MemoryAllocation& buffer_allocation,
+    MemoryAllocator& allocator, VkDevice vk_logic_device);
+
+
+// One region of a staged upload: data is copied into dst_buffer at dst_offset.
+struct BufferUpload {
+
+    const void* data;
+    VkDeviceSize size;
+    VkBuffer dst_buffer;
+    VkDeviceSize dst_offset;
+};
+
+// Copies the data into device-local buffers through a single host-visible staging
+// buffer: the memcpy into the staging buffer is split in jobs, then one command buffer
+// and one submit on the transfer queue copy all of the regions. Waits for the copy to complete.
+// Returns the time from the first memcpy to the end of the copy, in milliseconds.
+double upload_buffers_with_staging(
+    const std::vector<BufferUpload>& uploads,
+    MemoryAllocator& allocator, VkDevice vk_logic_device,
+    VkCommandPool vk_transfer_command_pool, VkQueue vk_transfer_queue,
+    JobSystem& job_system);
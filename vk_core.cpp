@@ -4,10 +4,14 @@
 #include "vk_swapchain.hpp"
 
 #include <set>
+#include <string>
+#include <algorithm> // std::min | std::transform
+#include <cctype> // std::tolower
 
 
-void create_vulkan_instance(VkInstance& vk_instance) {
+void create_vulkan_instance(VkInstance& vk_instance, bool headless) {
 
+    TRACE_SCOPE("create_vulkan_instance");
     std::cout << "Creating Vulkan Instance... \n\n";
 
     /* [START] Get the extensions and validation layers - Not optional! */
@@ -34,7 +38,7 @@ void create_vulkan_instance(VkInstance& vk_instance) {
     instance_create_info.pApplicationInfo = &app_info;
 
     // Get required GLFW extensions
-    std::vector<const char*> glfw_extensions = get_required_extensions();
+    std::vector<const char*> glfw_extensions = get_required_extensions(headless);
     instance_create_info.enabledExtensionCount = static_cast<uint32_t>(glfw_extensions.size());
     instance_create_info.ppEnabledExtensionNames = glfw_extensions.data();
 
@@ -89,6 +93,7 @@ void create_vulkan_instance(VkInstance& vk_instance) {
 
 void create_vulkan_surface(VkSurfaceKHR& vk_surface, VkInstance vk_instance, GLFWwindow* window) {
 
+    TRACE_SCOPE("create_vulkan_surface");
     std::cout << "Creating Vulkan Surface (Win32)... \n";
 
     // Another way to do it (native Vulkan platform)
@@ -123,8 +128,13 @@ void create_vulkan_surface(VkSurfaceKHR& vk_surface, VkInstance vk_instance, GLF
 }
 
 
-void select_physical_device(VkPhysicalDevice& vk_phys_device, VkInstance& vk_instance, VkSurfaceKHR& vk_surface) {
+void select_physical_device(
+    VkPhysicalDevice& vk_phys_device,
+    VkInstance& vk_instance,
+    VkSurfaceKHR& vk_surface,
+    const std::string& device_selector) {
 
+    TRACE_SCOPE("select_physical_device");
     std::cout << "Selecting Vulkan Physical devices (GPUs)... \n\n";
 
     // Enumerating all physical devices
@@ -139,16 +149,50 @@ void select_physical_device(VkPhysicalDevice& vk_phys_device, VkInstance& vk_ins
     std::vector<VkPhysicalDevice> devices(devices_count);
     vkEnumeratePhysicalDevices(vk_instance, &devices_count, devices.data());
 
-    print_all_devices(devices, devices_count);
+    // Rate every device. A score of 0 means the device can't run the demo at all.
+    std::vector<uint64_t> scores(devices_count);
+    for (uint32_t i = 0; i < devices_count; i++) {
+        scores[i] = rate_device_suitability(vk_surface, devices[i]);
+    }
+
+    print_all_devices(devices, scores, devices_count);
+
+    if (!device_selector.empty()) {
+
+        // The device was pinned by the user (by name or by UUID).
+        // We still refuse it if it can't run the demo.
+        std::cout << "\t Device pinned by the user: " << device_selector << ". \n\n";
 
-    // Check if they are suitable for the operations we want to perform
-    for (const auto& dev : devices) {
-        
-        if (is_device_suitable(vk_surface, dev)) {
-            vk_phys_device = dev;
+        for (uint32_t i = 0; i < devices_count; i++) {
+
+            if (!device_matches_selector(devices[i], device_selector)) {
+                continue;
+            }
+
+            if (scores[i] == 0) {
+                throw std::runtime_error("The pinned Physical device (GPU) is not suitable: " + device_selector + " \n");
+            }
+
+            vk_phys_device = devices[i];
             break;
         }
-        
+
+        if (vk_phys_device == VK_NULL_HANDLE) {
+            throw std::runtime_error("Failed to find the pinned Physical device (GPU): " + device_selector + " \n");
+        }
+    }
+    else {
+
+        // Otherwise pick the device with the highest score. On ties the first
+        // enumerated device wins, which is usually the one the loader prefers.
+        uint64_t best_score = 0;
+        for (uint32_t i = 0; i < devices_count; i++) {
+
+            if (scores[i] > best_score) {
+                best_score = scores[i];
+                vk_phys_device = devices[i];
+            }
+        }
     }
 
     if (vk_phys_device == VK_NULL_HANDLE) {
@@ -166,8 +210,12 @@ void create_vulkan_logical_device(
     VkSurfaceKHR vk_surface,
     VkPhysicalDevice vk_phys_device,
     VkQueue& vk_graphics_queue,
-    VkQueue& vk_present_queue) {
+    VkQueue& vk_present_queue,
+    VkQueue& vk_transfer_queue,
+    VkQueue& vk_compute_queue,
+    DeviceFeatures& enabled_features) {
 
+    TRACE_SCOPE("create_vulkan_logical_device");
     std::cout << "Creating Vulkan Logical device... \n\n";
 
     // Specify the queues to be created. To be more specific,
@@ -177,7 +225,12 @@ void create_vulkan_logical_device(
     // Now i can create a set of all unique queue families that are necessary
     // for the required queues.
     std::vector<VkDeviceQueueCreateInfo> queue_families_create_info;
-    std::set<uint32_t> unique_queue_families = { indices.graphics_family.value(), indices.present_family.value() };
+    std::set<uint32_t> unique_queue_families = {
+        indices.graphics_family.value(),
+        indices.present_family.value(),
+        indices.transfer_family.value(),
+        indices.compute_family.value()
+    };
 
     // We don't really need more than one per family, because you can create all
     // of the command buffers on multiple threads and then submit them all at once
@@ -197,8 +250,49 @@ void create_vulkan_logical_device(
     }
 
     // Specify the device features needed, that we actually already queried up for
-    // with vkGetPhysicalDeviceFeatures
-    VkPhysicalDeviceFeatures device_features{}; // Right now we don't need anything special
+    // with vkGetPhysicalDeviceFeatures. Nothing is required, the optional features
+    // (see DeviceFeatures) are enabled only if the device has them.
+    VkPhysicalDeviceFeatures supported_features;
+    vkGetPhysicalDeviceFeatures(vk_phys_device, &supported_features);
+
+    VkPhysicalDeviceFeatures device_features{};
+    device_features.multiDrawIndirect = supported_features.multiDrawIndirect;
+
+    // The features added by Vulkan 1.2 are queried and enabled through VkPhysicalDeviceVulkan12Features,
+    // which only exists on 1.2+ devices.
+    VkPhysicalDeviceProperties device_properties;
+    vkGetPhysicalDeviceProperties(vk_phys_device, &device_properties);
+
+    // Same for the Vulkan 1.3 features and VkPhysicalDeviceVulkan13Features, chained after them.
+    bool vulkan_13 = device_properties.apiVersion >= VK_API_VERSION_1_3;
+
+    VkPhysicalDeviceVulkan13Features supported_features_13{};
+    supported_features_13.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+
+    VkPhysicalDeviceVulkan12Features supported_features_12{};
+    supported_features_12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    supported_features_12.pNext = vulkan_13 ? &supported_features_13 : nullptr;
+    if (device_properties.apiVersion >= VK_API_VERSION_1_2) {
+        VkPhysicalDeviceFeatures2 supported_features_2{};
+        supported_features_2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        supported_features_2.pNext = &supported_features_12;
+        vkGetPhysicalDeviceFeatures2(vk_phys_device, &supported_features_2);
+    }
+
+    VkPhysicalDeviceVulkan13Features device_features_13{};
+    device_features_13.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+    device_features_13.dynamicRendering = supported_features_13.dynamicRendering;
+
+    VkPhysicalDeviceVulkan12Features device_features_12{};
+    device_features_12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    device_features_12.pNext = vulkan_13 ? &device_features_13 : nullptr;
+    device_features_12.drawIndirectCount = supported_features_12.drawIndirectCount;
+    device_features_12.timelineSemaphore = supported_features_12.timelineSemaphore;
+
+    enabled_features.multi_draw_indirect = device_features.multiDrawIndirect == VK_TRUE;
+    enabled_features.draw_indirect_count = device_features_12.drawIndirectCount == VK_TRUE;
+    enabled_features.timeline_semaphore = device_features_12.timelineSemaphore == VK_TRUE;
+    enabled_features.dynamic_rendering = device_features_13.dynamicRendering == VK_TRUE;
 
     // Filling the logical device infos
     VkDeviceCreateInfo logical_device_create_info{};
@@ -206,12 +300,16 @@ void create_vulkan_logical_device(
     logical_device_create_info.queueCreateInfoCount = static_cast<uint32_t>(queue_families_create_info.size());
     logical_device_create_info.pQueueCreateInfos = queue_families_create_info.data();
     logical_device_create_info.pEnabledFeatures = &device_features;
+    if (device_properties.apiVersion >= VK_API_VERSION_1_2) {
+        logical_device_create_info.pNext = &device_features_12;
+    }
 
     // We enable validation layers specific to the device for retrocompatibility purposes.
     // Note that now we have explicitly set the VK_KHR_swapchain extension in the function
-    // check_extensions_support().
-    logical_device_create_info.enabledExtensionCount = static_cast<uint32_t>(DEVICE_EXTENSIONS.size());
-    logical_device_create_info.ppEnabledExtensionNames = DEVICE_EXTENSIONS.data();
+    // check_extensions_support() (unless we are running headless).
+    std::vector<const char*> device_extensions = get_required_device_extensions(vk_surface);
+    logical_device_create_info.enabledExtensionCount = static_cast<uint32_t>(device_extensions.size());
+    logical_device_create_info.ppEnabledExtensionNames = device_extensions.data();
     if (ENABLE_VALIDATION_LAYERS) {
         logical_device_create_info.enabledLayerCount = static_cast<uint32_t>(VALIDATION_LAYERS.size());
         logical_device_create_info.ppEnabledLayerNames = VALIDATION_LAYERS.data();
@@ -228,6 +326,20 @@ void create_vulkan_logical_device(
     // If the queue families are the same, then we only need to pass its index once.
     vkGetDeviceQueue(vk_logic_device, indices.graphics_family.value(), 0, &vk_graphics_queue);
     vkGetDeviceQueue(vk_logic_device, indices.present_family.value(), 0, &vk_present_queue);
+    vkGetDeviceQueue(vk_logic_device, indices.transfer_family.value(), 0, &vk_transfer_queue);
+    vkGetDeviceQueue(vk_logic_device, indices.compute_family.value(), 0, &vk_compute_queue);
+
+    std::cout << "\t Queue families: graphics " << indices.graphics_family.value()
+        << ", present " << indices.present_family.value()
+        << ", transfer " << indices.transfer_family.value()
+        << (indices.transfer_family == indices.graphics_family ? " (same as graphics)" : " (separate family)")
+        << ", compute " << indices.compute_family.value()
+        << (indices.compute_family == indices.graphics_family ? " (same as graphics)" : " (async)")
+        << ". \n";
+    std::cout << "\t Optional features: multiDrawIndirect " << (enabled_features.multi_draw_indirect ? "yes" : "no")
+        << ", drawIndirectCount " << (enabled_features.draw_indirect_count ? "yes" : "no")
+        << ", timelineSemaphore " << (enabled_features.timeline_semaphore ? "yes" : "no")
+        << ", dynamicRendering " << (enabled_features.dynamic_rendering ? "yes" : "no") << ". \n\n";
 
     std::cout << "Vulkan Logical device created. \n\n";
 }
@@ -235,27 +347,16 @@ void create_vulkan_logical_device(
 
 bool is_device_suitable(VkSurfaceKHR vk_surface, VkPhysicalDevice phys_device) {
 
-    VkPhysicalDeviceProperties device_properties;
-    VkPhysicalDeviceFeatures device_features;
-    vkGetPhysicalDeviceProperties(phys_device, &device_properties);
-    vkGetPhysicalDeviceFeatures(phys_device, &device_features);
-
-    // Only dedicated graphic cards  that support geometry shaders are defined as suitable
-    return device_properties.deviceType ==
-        VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU
-        && device_features.geometryShader;
-
-
     // Select all suitable devices as devices that support VK_QUEUE_GRAPHICS_BIT
     // and support Presentation (Present Queue Family)
     QueueFamilyIndices indices = find_queue_families(vk_surface, phys_device);
 
     // Get the extensions supported by the device (for now only Swapchain is required)
-    bool extensions_supported = check_extensions_support(phys_device);
+    bool extensions_supported = check_extensions_support(vk_surface, phys_device);
 
-    // Get the swapchain details
-    bool swapchain_adequate = false;
-    if (extensions_supported) {
+    // Get the swapchain details. Running headless there is no swapchain at all.
+    bool swapchain_adequate = is_headless(vk_surface);
+    if (extensions_supported && !is_headless(vk_surface)) {
 
         // We query for swapchain support only after veryifing that
         // the extension VK_KHR_swapchain is available for our device.
@@ -269,16 +370,236 @@ bool is_device_suitable(VkSurfaceKHR vk_surface, VkPhysicalDevice phys_device) {
 }
 
 
+uint64_t rate_device_suitability(VkSurfaceKHR vk_surface, VkPhysicalDevice phys_device) {
+
+    // Devices that can't run the demo at all are never selected, no matter how fast they are.
+    // Note that we don't require anything about the device type or optional features
+    // (like geometry shaders): integrated GPUs and CPU implementations (lavapipe, SwiftShader)
+    // are perfectly fine, they just rank lower.
+    if (!is_device_suitable(vk_surface, phys_device)) {
+        return 0;
+    }
+
+    VkPhysicalDeviceProperties device_properties;
+    vkGetPhysicalDeviceProperties(phys_device, &device_properties);
+
+    uint64_t score = 1;
+
+    // The device type is by far the most important factor: a dedicated GPU
+    // always beats an integrated one, which always beats a CPU implementation.
+    switch (device_properties.deviceType) {
+
+    case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+        score += 1000000;
+        break;
+
+    case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+        score += 500000;
+        break;
+
+    case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+        score += 250000;
+        break;
+
+    case VK_PHYSICAL_DEVICE_TYPE_CPU:
+        score += 100000;
+        break;
+
+    default:
+        break;
+    }
+
+    // Among devices of the same type, the amount of local memory is a good indicator
+    // of the device class (1 point per MiB, capped at 64 GiB so it can't override the type).
+    score += std::min<uint64_t>(get_device_local_memory(phys_device) / (1024 * 1024), 65536);
+
+    // Limits that roughly scale with the size of the hardware.
+    score += device_properties.limits.maxImageDimension2D / 16;
+    score += device_properties.limits.maxComputeWorkGroupInvocations / 16;
+
+    // Queue family capabilities: a graphics queue that can also present saves us
+    // from sharing the swapchain images between families, and dedicated transfer
+    // and compute families allow async uploads/compute.
+    QueueFamilyIndices indices = find_queue_families(vk_surface, phys_device);
+    if (indices.graphics_family == indices.present_family) {
+        score += 1000;
+    }
+
+    uint32_t queue_families_count = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(phys_device, &queue_families_count, nullptr);
+    std::vector<VkQueueFamilyProperties> queue_families(queue_families_count);
+    vkGetPhysicalDeviceQueueFamilyProperties(phys_device, &queue_families_count, queue_families.data());
+
+    for (const auto& queue_family : queue_families) {
+
+        bool graphics = (queue_family.queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0;
+        bool compute = (queue_family.queueFlags & VK_QUEUE_COMPUTE_BIT) != 0;
+        bool transfer = (queue_family.queueFlags & VK_QUEUE_TRANSFER_BIT) != 0;
+
+        if (transfer && !graphics && !compute) {
+            score += 500; // dedicated transfer (DMA) family
+        }
+        else if (compute && !graphics) {
+            score += 500; // async compute family
+        }
+    }
+
+    return score;
+}
+
+
+VkDeviceSize get_device_local_memory(VkPhysicalDevice phys_device) {
+
+    VkPhysicalDeviceMemoryProperties device_memory;
+    vkGetPhysicalDeviceMemoryProperties(phys_device, &device_memory);
+
+    VkDeviceSize local_memory = 0;
+    for (uint32_t j = 0; j < device_memory.memoryHeapCount; j++) {
+
+        if (device_memory.memoryHeaps[j].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) {
+            local_memory += device_memory.memoryHeaps[j].size;
+        }
+    }
+
+    return local_memory;
+}
+
+
+VkFormat choose_depth_format(VkPhysicalDevice phys_device) {
+
+    // Best precision first. The spec guarantees D16_UNORM, and one of X8_D24_UNORM_PACK32
+    // and D32_SFLOAT. We don't use the stencil, so the formats without one come first;
+    // the stencil formats are only there for precision on a device that would otherwise
+    // fall back to D16_UNORM.
+    const VkFormat candidates[] = {
+        VK_FORMAT_D32_SFLOAT,
+        VK_FORMAT_X8_D24_UNORM_PACK32,
+        VK_FORMAT_D32_SFLOAT_S8_UINT,
+        VK_FORMAT_D24_UNORM_S8_UINT,
+        VK_FORMAT_D16_UNORM
+    };
+
+    for (VkFormat format : candidates) {
+
+        VkFormatProperties properties;
+        vkGetPhysicalDeviceFormatProperties(phys_device, format, &properties);
+        if (properties.optimalTilingFeatures & VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT) {
+            return format;
+        }
+    }
+
+    // Not reached on a conformant device: D16_UNORM is always supported.
+    throw std::runtime_error("Failed to find a supported depth format! \n");
+}
+
+
+bool has_stencil_component(VkFormat format) {
+
+    return format == VK_FORMAT_D16_UNORM_S8_UINT ||
+        format == VK_FORMAT_D24_UNORM_S8_UINT ||
+        format == VK_FORMAT_D32_SFLOAT_S8_UINT ||
+        format == VK_FORMAT_S8_UINT;
+}
+
+
+VkSampleCountFlagBits choose_msaa_samples(VkPhysicalDevice phys_device, uint32_t requested_samples) {
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(phys_device, &properties);
+
+    // The main pass has both a color and a depth attachment with the same sample count.
+    VkSampleCountFlags counts =
+        properties.limits.framebufferColorSampleCounts &
+        properties.limits.framebufferDepthSampleCounts;
+
+    // The VkSampleCountFlagBits values are the sample counts themselves.
+    for (uint32_t samples = VK_SAMPLE_COUNT_64_BIT; samples > VK_SAMPLE_COUNT_1_BIT; samples >>= 1) {
+        if (samples <= requested_samples && (counts & samples)) {
+            return static_cast<VkSampleCountFlagBits>(samples);
+        }
+    }
+    return VK_SAMPLE_COUNT_1_BIT;
+}
+
+
+std::string get_device_uuid(VkPhysicalDevice phys_device) {
+
+    // The device UUID is only exposed through vkGetPhysicalDeviceProperties2 (Vulkan 1.1).
+    VkPhysicalDeviceIDProperties id_properties{};
+    id_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES;
+
+    VkPhysicalDeviceProperties2 device_properties{};
+    device_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    device_properties.pNext = &id_properties;
+
+    vkGetPhysicalDeviceProperties2(phys_device, &device_properties);
+
+    // Formatted as 8-4-4-4-12 hex digits, like every other UUID.
+    static const char* hex_digits = "0123456789abcdef";
+    std::string uuid;
+    for (uint32_t i = 0; i < VK_UUID_SIZE; i++) {
+
+        if (i == 4 || i == 6 || i == 8 || i == 10) {
+            uuid += '-';
+        }
+        uuid += hex_digits[id_properties.deviceUUID[i] >> 4];
+        uuid += hex_digits[id_properties.deviceUUID[i] & 0xF];
+    }
+
+    return uuid;
+}
+
+
+bool device_matches_selector(VkPhysicalDevice phys_device, const std::string& device_selector) {
+
+    auto to_lower = [](std::string str) {
+        std::transform(str.begin(), str.end(), str.begin(),
+            [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        return str;
+    };
+
+    // UUIDs are compared ignoring case and dashes.
+    auto normalize_uuid = [&](const std::string& str) {
+        std::string result;
+        for (char c : to_lower(str)) {
+            if (c != '-') {
+                result += c;
+            }
+        }
+        return result;
+    };
+
+    if (normalize_uuid(device_selector) == normalize_uuid(get_device_uuid(phys_device))) {
+        return true;
+    }
+
+    // Otherwise the selector is a (case insensitive) part of the device name,
+    // e.g. "llvmpipe" or "RTX 4090".
+    VkPhysicalDeviceProperties device_properties;
+    vkGetPhysicalDeviceProperties(phys_device, &device_properties);
+
+    return to_lower(device_properties.deviceName).find(to_lower(device_selector)) != std::string::npos;
+}
+
+
 void print_all_devices(
     const std::vector<VkPhysicalDevice> physical_devices,
+    const std::vector<uint64_t>& scores,
     uint32_t devices_count) {
 
     VkPhysicalDeviceProperties device_properties;
     std::cout << "\t Available physical devices (GPUs): " << devices_count << ".\n";
     std::cout << "\t Listing all physical devices: \n";
-    for (const auto& device : physical_devices) {
-        vkGetPhysicalDeviceProperties(device, &device_properties);
-        std::cout << "\t\t " << device_properties.deviceName << " \n";
+    for (uint32_t i = 0; i < devices_count; i++) {
+        vkGetPhysicalDeviceProperties(physical_devices[i], &device_properties);
+        std::cout << "\t\t " << device_properties.deviceName
+            << " | UUID: " << get_device_uuid(physical_devices[i]);
+        if (scores[i] > 0) {
+            std::cout << " | Score: " << scores[i] << " \n";
+        }
+        else {
+            std::cout << " | Not suitable \n";
+        }
     }
     std::cout << "\n";
 
@@ -3,23 +3,68 @@
 #include "my_utils.hpp"
 
 
-void create_vulkan_instance(VkInstance& vk_instance);
+// Optional features of the device, enabled by create_vulkan_logical_device() when the
+// device supports them. Whatever uses them checks here first and falls back otherwise.
+struct DeviceFeatures {
+
+    bool multi_draw_indirect = false; // drawCount > 1 in vkCmdDraw*Indirect()
+    bool draw_indirect_count = false; // vkCmdDrawIndexedIndirectCount() (Vulkan 1.2)
+    bool timeline_semaphore = false;  // Semaphores with a 64 bit counter (Vulkan 1.2)
+    bool dynamic_rendering = false;   // vkCmdBeginRendering(), no render pass objects (Vulkan 1.3)
+};
+
+
+void create_vulkan_instance(VkInstance& vk_instance, bool headless);
 
 void create_vulkan_surface(VkSurfaceKHR& vk_surface, VkInstance vk_instance, GLFWwindow* window);
 
-void select_physical_device(VkPhysicalDevice& vk_phys_device, VkInstance& vk_instance, VkSurfaceKHR& vk_surface);
+// Picks the device with the highest rate_device_suitability() score, unless
+// device_selector (a device name or UUID) pins a specific one.
+void select_physical_device(
+    VkPhysicalDevice& vk_phys_device,
+    VkInstance& vk_instance,
+    VkSurfaceKHR& vk_surface,
+    const std::string& device_selector);
 
 void create_vulkan_logical_device(
     VkDevice& vk_logic_device,
     VkSurfaceKHR vk_surface,
     VkPhysicalDevice vk_phys_device,
     VkQueue& vk_graphics_queue,
-    VkQueue& vk_present_queue);
+    VkQueue& vk_present_queue,
+    VkQueue& vk_transfer_queue,
+    VkQueue& vk_compute_queue,
+    DeviceFeatures& enabled_features);
 
+// Checks the hard requirements (queue families, extensions, swapchain support).
 bool is_device_suitable(VkSurfaceKHR vk_surface, VkPhysicalDevice phys_device);
 
+// Returns 0 if the device is not suitable, otherwise a score where higher is
+// (very likely) faster, based on device type, memory, limits and queue families.
+uint64_t rate_device_suitability(VkSurfaceKHR vk_surface, VkPhysicalDevice phys_device);
+
+// Sum of the sizes of all DEVICE_LOCAL memory heaps.
+VkDeviceSize get_device_local_memory(VkPhysicalDevice phys_device);
+
+// The first depth format the device can use as an optimal tiling depth attachment:
+// D32_SFLOAT, then the packed depth/stencil formats, then D16_UNORM (always supported).
+VkFormat choose_depth_format(VkPhysicalDevice phys_device);
+
+bool has_stencil_component(VkFormat format);
+
+// The largest sample count up to requested_samples (a power of two) that the device supports
+// for both color and depth framebuffer attachments (framebufferColorSampleCounts &
+// framebufferDepthSampleCounts). 1 is always supported.
+VkSampleCountFlagBits choose_msaa_samples(VkPhysicalDevice phys_device, uint32_t requested_samples);
+
+std::string get_device_uuid(VkPhysicalDevice phys_device);
+
+// device_selector is either a device UUID or a (case insensitive) part of the device name.
+bool device_matches_selector(VkPhysicalDevice phys_device, const std::string& device_selector);
+
 void print_all_devices(
     const std::vector<VkPhysicalDevice> physical_devices,
+    const std::vector<uint64_t>& scores,
     uint32_t devices_count);
 
 void print_device_properties(VkPhysicalDevice phys_device);
\ No newline at end of file
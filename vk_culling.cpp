@@ -0,0 +1,510 @@
+#include "vk_culling.hpp"
+#include "vk_buffer.hpp"
+#include "vk_graphics_pipeline.hpp" // create_shader_module
+#include "vk_shaders.hpp"
+
+#include <algorithm> // std::min
+#include <chrono>
+#include <cmath> // std::sqrt
+
+// SSE2 is part of x86-64, MSVC doesn't define __SSE2__ for it.
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CULLING_SSE2 1
+#include <emmintrin.h>
+#endif
+
+
+static VkDeviceSize align_up(VkDeviceSize size, VkDeviceSize alignment) {
+
+    return (size + alignment - 1) / alignment * alignment;
+}
+
+
+static bool is_sphere_visible(const FrustumPlanes& frustum, float x, float y, float z, float radius) {
+
+    for (const auto& plane : frustum.planes) {
+        if (plane.x * x + plane.y * y + plane.z * z + plane.w < -radius) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+FrustumPlanes extract_frustum_planes(const glm::mat4& transform) {
+
+    // Row i of the matrix (glm is column major: transform[column][row]).
+    auto row = [&transform](int i) {
+        return glm::vec4(transform[0][i], transform[1][i], transform[2][i], transform[3][i]);
+    };
+
+    glm::vec4 r0 = row(0), r1 = row(1), r2 = row(2), r3 = row(3);
+
+    // A clip space point is inside if -w <= x <= w, -w <= y <= w and 0 <= z <= w.
+    FrustumPlanes frustum;
+    frustum.planes[0] = glm::vec4(r3.x + r0.x, r3.y + r0.y, r3.z + r0.z, r3.w + r0.w); // Left
+    frustum.planes[1] = glm::vec4(r3.x - r0.x, r3.y - r0.y, r3.z - r0.z, r3.w - r0.w); // Right
+    frustum.planes[2] = glm::vec4(r3.x + r1.x, r3.y + r1.y, r3.z + r1.z, r3.w + r1.w); // Bottom
+    frustum.planes[3] = glm::vec4(r3.x - r1.x, r3.y - r1.y, r3.z - r1.z, r3.w - r1.w); // Top
+    frustum.planes[4] = r2;                                                            // Near
+    frustum.planes[5] = glm::vec4(r3.x - r2.x, r3.y - r2.y, r3.z - r2.z, r3.w - r2.w); // Far
+
+    // Normalized, so that the distance to the plane can be compared to the radius.
+    for (auto& plane : frustum.planes) {
+        float length = std::sqrt(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+        if (length > 0.0f) {
+            plane = glm::vec4(plane.x / length, plane.y / length, plane.z / length, plane.w / length);
+        }
+    }
+
+    return frustum;
+}
+
+
+void build_culling_objects(CullingObjects& objects, const std::vector<glm::vec4>& bounds) {
+
+    objects.count = static_cast<uint32_t>(bounds.size());
+    objects.center_x.resize(bounds.size());
+    objects.center_y.resize(bounds.size());
+    objects.center_z.resize(bounds.size());
+    objects.radius.resize(bounds.size());
+
+    for (size_t i = 0; i < bounds.size(); i++) {
+        objects.center_x[i] = bounds[i].x;
+        objects.center_y[i] = bounds[i].y;
+        objects.center_z[i] = bounds[i].z;
+        objects.radius[i] = bounds[i].w;
+    }
+}
+
+
+uint32_t cull_objects_scalar(const CullingObjects& objects, const FrustumPlanes& frustum, uint32_t* visible) {
+
+    uint32_t visible_count = 0;
+
+    for (uint32_t i = 0; i < objects.count; i++) {
+        if (is_sphere_visible(frustum, objects.center_x[i], objects.center_y[i], objects.center_z[i], objects.radius[i])) {
+            visible[visible_count++] = i;
+        }
+    }
+
+    return visible_count;
+}
+
+
+uint32_t cull_objects_simd(const CullingObjects& objects, const FrustumPlanes& frustum, uint32_t* visible) {
+
+#ifdef CULLING_SSE2
+    uint32_t visible_count = 0;
+    uint32_t simd_count = objects.count & ~3u;
+
+    // Every plane component in all 4 lanes.
+    __m128 plane_x[6], plane_y[6], plane_z[6], plane_w[6];
+    for (int p = 0; p < 6; p++) {
+        plane_x[p] = _mm_set1_ps(frustum.planes[p].x);
+        plane_y[p] = _mm_set1_ps(frustum.planes[p].y);
+        plane_z[p] = _mm_set1_ps(frustum.planes[p].z);
+        plane_w[p] = _mm_set1_ps(frustum.planes[p].w);
+    }
+
+    for (uint32_t i = 0; i < simd_count; i += 4) {
+
+        __m128 x = _mm_loadu_ps(&objects.center_x[i]);
+        __m128 y = _mm_loadu_ps(&objects.center_y[i]);
+        __m128 z = _mm_loadu_ps(&objects.center_z[i]);
+        __m128 negative_radius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&objects.radius[i]));
+
+        // Lanes stay all ones while the sphere is inside (or crossing) every plane.
+        __m128 inside = _mm_cmpeq_ps(x, x);
+        for (int p = 0; p < 6; p++) {
+            __m128 distance = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(plane_x[p], x), _mm_mul_ps(plane_y[p], y)),
+                _mm_add_ps(_mm_mul_ps(plane_z[p], z), plane_w[p]));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negative_radius));
+        }
+
+        // One bit per lane. Every index is written, only the visible ones move
+        // the end of the list forward: no branch to mispredict.
+        int mask = _mm_movemask_ps(inside);
+        for (uint32_t lane = 0; lane < 4; lane++) {
+            visible[visible_count] = i + lane;
+            visible_count += (mask >> lane) & 1;
+        }
+    }
+
+    // The last objects that don't fill a register.
+    for (uint32_t i = simd_count; i < objects.count; i++) {
+        if (is_sphere_visible(frustum, objects.center_x[i], objects.center_y[i], objects.center_z[i], objects.radius[i])) {
+            visible[visible_count++] = i;
+        }
+    }
+
+    return visible_count;
+#else
+    return cull_objects_scalar(objects, frustum, visible);
+#endif
+}
+
+
+static void create_culling_pipeline(
+    CullingSystem& culling,
+    VkDevice vk_logic_device,
+    DescriptorLayoutCache& layout_cache, VkPipelineCache vk_pipeline_cache) {
+
+    TRACE_SCOPE("create_culling_pipeline");
+
+    ShaderBytecode comp_shader_bytecode = load_shader("cull.spv");
+    ShaderReflection comp_shader_reflection = reflect_shader(comp_shader_bytecode, "cull.spv");
+
+    // Objects (read), indirect commands (written), draw count (atomic): the set layout is
+    // the one the shader declares, and the push constants must match the CPU struct.
+    DescriptorSetLayoutDesc set_desc = get_reflected_set_layout({ &comp_shader_reflection }, 0, false);
+    culling.set_layout = get_descriptor_set_layout(layout_cache, set_desc);
+
+    if (comp_shader_reflection.push_constants_size != sizeof(CullingPushConstants)) {
+        throw std::runtime_error("The push constants of cull.spv are " + std::to_string(comp_shader_reflection.push_constants_size)
+            + " bytes, CullingPushConstants is " + std::to_string(sizeof(CullingPushConstants)) + "! \n");
+    }
+
+    VkPushConstantRange push_constant_range{};
+    push_constant_range.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    push_constant_range.offset = 0;
+    push_constant_range.size = sizeof(CullingPushConstants);
+
+    VkPipelineLayoutCreateInfo pipeline_layout_create_info{};
+    pipeline_layout_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipeline_layout_create_info.setLayoutCount = 1;
+    pipeline_layout_create_info.pSetLayouts = &culling.set_layout;
+    pipeline_layout_create_info.pushConstantRangeCount = 1;
+    pipeline_layout_create_info.pPushConstantRanges = &push_constant_range;
+
+    if (vkCreatePipelineLayout(vk_logic_device, &pipeline_layout_create_info, nullptr, &culling.pipeline_layout) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create Vulkan Culling pipeline layout! \n");
+    }
+
+    VkShaderModule comp_shader_module = create_shader_module(comp_shader_bytecode, vk_logic_device);
+
+    // A compute pipeline is a single stage, there is no fixed function state.
+    VkPipelineShaderStageCreateInfo comp_shader_stage_info{};
+    comp_shader_stage_info.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    comp_shader_stage_info.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    comp_shader_stage_info.module = comp_shader_module;
+    comp_shader_stage_info.pName = "main";
+
+    VkComputePipelineCreateInfo pipeline_create_info{};
+    pipeline_create_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipeline_create_info.stage = comp_shader_stage_info;
+    pipeline_create_info.layout = culling.pipeline_layout;
+
+    VkResult result = vkCreateComputePipelines(vk_logic_device, vk_pipeline_cache, 1, &pipeline_create_info, nullptr, &culling.pipeline);
+
+    vkDestroyShaderModule(vk_logic_device, comp_shader_module, nullptr);
+
+    if (result != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create Vulkan Culling pipeline! \n");
+    }
+}
+
+
+void create_culling_system(
+    CullingSystem& culling,
+    CullingMode mode, const DeviceFeatures& features,
+    const Mesh& mesh,
+    MemoryAllocator& allocator,
+    VkPhysicalDevice vk_phys_device, VkDevice vk_logic_device,
+    DescriptorLayoutCache& layout_cache, VkPipelineCache vk_pipeline_cache,
+    uint32_t frames_in_flight,
+    uint32_t graphics_family, uint32_t transfer_family,
+    VkCommandPool vk_transfer_command_pool, VkQueue vk_transfer_queue,
+    JobSystem& job_system) {
+
+    culling.mode = mode;
+    if (mode == CullingMode::None) {
+        return;
+    }
+
+    TRACE_SCOPE("create_culling_system");
+    std::cout << "Creating Culling system (" << culling_mode_to_string(mode) << ")... \n\n";
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(vk_phys_device, &properties);
+
+    culling.features = features;
+    culling.max_draw_indirect_count = features.multi_draw_indirect ? properties.limits.maxDrawIndirectCount : 1;
+    culling.mesh = &mesh;
+    culling.objects_count = static_cast<uint32_t>(mesh.draws.size());
+
+    VkDeviceSize commands_size = sizeof(VkDrawIndexedIndirectCommand) * culling.objects_count;
+
+    if (mode == CullingMode::Cpu) {
+
+        build_culling_objects(culling.objects, mesh.draw_bounds);
+        culling.visible.resize(culling.objects_count);
+
+        // Written by the CPU every frame, read once by the GPU: no need to copy it to device local memory.
+        culling.indirect_region_size = align_up(commands_size, 16);
+        create_buffer(
+            culling.indirect_buffer, culling.indirect_allocation,
+            allocator, vk_logic_device,
+            culling.indirect_region_size * frames_in_flight,
+            VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    }
+    else {
+
+        uint64_t max_objects = static_cast<uint64_t>(properties.limits.maxComputeWorkGroupCount[0]) * CULLING_WORKGROUP_SIZE;
+        if (culling.objects_count > max_objects) {
+            throw std::runtime_error("Too many objects for GPU culling, the limit is " + std::to_string(max_objects) + "! \n");
+        }
+
+        // The count can only limit a single draw: with more objects than a draw takes,
+        // every command is written and drawn instead.
+        culling.compact = features.draw_indirect_count && culling.objects_count <= culling.max_draw_indirect_count;
+
+        // The regions are bound as storage buffers, their offsets must be aligned.
+        VkDeviceSize alignment = std::max<VkDeviceSize>(properties.limits.minStorageBufferOffsetAlignment, 4);
+        culling.indirect_region_size = align_up(commands_size, alignment);
+        culling.count_region_size = alignment;
+
+        create_buffer(
+            culling.indirect_buffer, culling.indirect_allocation,
+            allocator, vk_logic_device,
+            culling.indirect_region_size * frames_in_flight,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+        create_buffer(
+            culling.count_buffer, culling.count_allocation,
+            allocator, vk_logic_device,
+            culling.count_region_size * frames_in_flight,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+        std::vector<GpuCullingObject> gpu_objects(culling.objects_count);
+        for (uint32_t i = 0; i < culling.objects_count; i++) {
+            gpu_objects[i].bounds = mesh.draw_bounds[i];
+            gpu_objects[i].index_count = mesh.draws[i].index_count;
+            gpu_objects[i].first_index = mesh.draws[i].first_index;
+            gpu_objects[i].padding[0] = 0;
+            gpu_objects[i].padding[1] = 0;
+        }
+
+        VkDeviceSize objects_size = sizeof(GpuCullingObject) * gpu_objects.size();
+
+        // Uploaded once, like the mesh (see create_mesh()).
+        create_buffer(
+            culling.object_buffer, culling.object_allocation,
+            allocator, vk_logic_device,
+            objects_size,
+            VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            { graphics_family, transfer_family });
+
+        upload_buffers_with_staging(
+            { { gpu_objects.data(), objects_size, culling.object_buffer, 0 } },
+            allocator, vk_logic_device,
+            vk_transfer_command_pool, vk_transfer_queue,
+            job_system);
+
+        create_culling_pipeline(culling, vk_logic_device, layout_cache, vk_pipeline_cache);
+    }
+
+    std::cout << "\t Objects: " << culling.objects_count << ". \n";
+    if (mode == CullingMode::Gpu && culling.compact) {
+        std::cout << "\t Draw: vkCmdDrawIndexedIndirectCount(). \n\n";
+    }
+    else {
+        std::cout << "\t Draw: vkCmdDrawIndexedIndirect(), up to " << culling.max_draw_indirect_count << " draws per call. \n\n";
+    }
+}
+
+
+void destroy_culling_system(CullingSystem& culling, MemoryAllocator& allocator, VkDevice vk_logic_device) {
+
+    if (culling.pipeline != VK_NULL_HANDLE) {
+        vkDestroyPipeline(vk_logic_device, culling.pipeline, nullptr);
+        culling.pipeline = VK_NULL_HANDLE;
+    }
+    if (culling.pipeline_layout != VK_NULL_HANDLE) {
+        vkDestroyPipelineLayout(vk_logic_device, culling.pipeline_layout, nullptr);
+        culling.pipeline_layout = VK_NULL_HANDLE;
+    }
+
+    if (culling.object_buffer != VK_NULL_HANDLE) {
+        destroy_buffer(culling.object_buffer, culling.object_allocation, allocator, vk_logic_device);
+    }
+    if (culling.count_buffer != VK_NULL_HANDLE) {
+        destroy_buffer(culling.count_buffer, culling.count_allocation, allocator, vk_logic_device);
+    }
+    if (culling.indirect_buffer != VK_NULL_HANDLE) {
+        destroy_buffer(culling.indirect_buffer, culling.indirect_allocation, allocator, vk_logic_device);
+    }
+
+    culling.objects = CullingObjects{};
+    culling.visible.clear();
+    culling.mesh = nullptr;
+}
+
+
+void prepare_frame_culling(
+    FrameCulling& frame_culling,
+    CullingSystem& culling,
+    uint32_t frame_index,
+    const glm::mat4& transform,
+    DescriptorAllocator& descriptor_allocator,
+    VkDevice vk_logic_device) {
+
+    using clock = std::chrono::steady_clock;
+    clock::time_point cull_start = clock::now();
+
+    frame_culling = FrameCulling{};
+    frame_culling.culling = &culling;
+    frame_culling.frame_index = frame_index;
+
+    FrustumPlanes frustum = extract_frustum_planes(transform);
+
+    if (culling.mode == CullingMode::Cpu) {
+
+        uint32_t visible_count = cull_objects_simd(culling.objects, frustum, culling.visible.data());
+
+        auto commands = reinterpret_cast<VkDrawIndexedIndirectCommand*>(
+            static_cast<uint8_t*>(culling.indirect_allocation.mapped) + frame_index * culling.indirect_region_size);
+
+        for (uint32_t i = 0; i < visible_count; i++) {
+            const DrawCommand& draw = culling.mesh->draws[culling.visible[i]];
+            commands[i] = { draw.index_count, 1, draw.first_index, 0, 0 };
+        }
+
+        frame_culling.visible_count = visible_count;
+        culling.total_visible += visible_count;
+    }
+    else {
+
+        frame_culling.descriptor_set = allocate_descriptor_set(descriptor_allocator, culling.set_layout);
+
+        VkDescriptorBufferInfo buffer_infos[3]{};
+        buffer_infos[0].buffer = culling.object_buffer;
+        buffer_infos[0].offset = 0;
+        buffer_infos[0].range = VK_WHOLE_SIZE;
+        buffer_infos[1].buffer = culling.indirect_buffer;
+        buffer_infos[1].offset = frame_index * culling.indirect_region_size;
+        buffer_infos[1].range = culling.indirect_region_size;
+        buffer_infos[2].buffer = culling.count_buffer;
+        buffer_infos[2].offset = frame_index * culling.count_region_size;
+        buffer_infos[2].range = sizeof(uint32_t);
+
+        VkWriteDescriptorSet descriptor_writes[3]{};
+        for (uint32_t i = 0; i < 3; i++) {
+            descriptor_writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            descriptor_writes[i].dstSet = frame_culling.descriptor_set;
+            descriptor_writes[i].dstBinding = i;
+            descriptor_writes[i].dstArrayElement = 0;
+            descriptor_writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            descriptor_writes[i].descriptorCount = 1;
+            descriptor_writes[i].pBufferInfo = &buffer_infos[i];
+        }
+        vkUpdateDescriptorSets(vk_logic_device, 3, descriptor_writes, 0, nullptr);
+
+        for (int p = 0; p < 6; p++) {
+            frame_culling.push_constants.planes[p] = frustum.planes[p];
+        }
+        frame_culling.push_constants.object_count = culling.objects_count;
+        frame_culling.push_constants.compact = culling.compact ? 1 : 0;
+    }
+
+    culling.total_frames++;
+    culling.total_cull_ms += std::chrono::duration<double, std::milli>(clock::now() - cull_start).count();
+}
+
+
+void record_culling_dispatch(VkCommandBuffer vk_command_buffer, const FrameCulling& frame_culling) {
+
+    const CullingSystem& culling = *frame_culling.culling;
+    if (culling.mode != CullingMode::Gpu) {
+        return;
+    }
+
+    // The shader appends to the list with atomicAdd() on the count, which starts at 0.
+    VkDeviceSize count_offset = frame_culling.frame_index * culling.count_region_size;
+    vkCmdFillBuffer(vk_command_buffer, culling.count_buffer, count_offset, sizeof(uint32_t), 0);
+
+    VkMemoryBarrier clear_barrier{};
+    clear_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    clear_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    clear_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(
+        vk_command_buffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0, 1, &clear_barrier, 0, nullptr, 0, nullptr);
+
+    vkCmdBindPipeline(vk_command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, culling.pipeline);
+    vkCmdBindDescriptorSets(
+        vk_command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+        culling.pipeline_layout,
+        0, 1, &frame_culling.descriptor_set,
+        0, nullptr);
+    vkCmdPushConstants(
+        vk_command_buffer, culling.pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT,
+        0, sizeof(CullingPushConstants), &frame_culling.push_constants);
+
+    vkCmdDispatch(vk_command_buffer, (culling.objects_count + CULLING_WORKGROUP_SIZE - 1) / CULLING_WORKGROUP_SIZE, 1, 1);
+
+    // No barrier before the indirect draw here: the culling pass of the frame graph
+    // declares the writes and the main pass the indirect reads (see vk_render_graph.hpp).
+}
+
+
+// draws_count commands from offset, at most max_draws per vkCmdDrawIndexedIndirect().
+static void record_indirect_draws(
+    VkCommandBuffer vk_command_buffer,
+    VkBuffer vk_indirect_buffer, VkDeviceSize offset,
+    uint32_t draws_count, uint32_t max_draws) {
+
+    const uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+
+    for (uint32_t first = 0; first < draws_count; first += max_draws) {
+        uint32_t count = std::min(max_draws, draws_count - first);
+        vkCmdDrawIndexedIndirect(vk_command_buffer, vk_indirect_buffer, offset + static_cast<VkDeviceSize>(first) * stride, count, stride);
+    }
+}
+
+
+void record_culled_draws(VkCommandBuffer vk_command_buffer, const FrameCulling& frame_culling) {
+
+    const CullingSystem& culling = *frame_culling.culling;
+    VkDeviceSize indirect_offset = frame_culling.frame_index * culling.indirect_region_size;
+
+    if (culling.mode == CullingMode::Cpu) {
+        record_indirect_draws(
+            vk_command_buffer, culling.indirect_buffer, indirect_offset,
+            frame_culling.visible_count, culling.max_draw_indirect_count);
+    }
+    else if (culling.compact) {
+        // The GPU reads how many commands to draw from the count buffer.
+        vkCmdDrawIndexedIndirectCount(
+            vk_command_buffer,
+            culling.indirect_buffer, indirect_offset,
+            culling.count_buffer, frame_culling.frame_index * culling.count_region_size,
+            culling.objects_count, sizeof(VkDrawIndexedIndirectCommand));
+    }
+    else {
+        record_indirect_draws(
+            vk_command_buffer, culling.indirect_buffer, indirect_offset,
+            culling.objects_count, culling.max_draw_indirect_count);
+    }
+}
+
+
+void print_culling_stats(const CullingSystem& culling) {
+
+    if (culling.mode == CullingMode::None || culling.total_frames == 0) {
+        return;
+    }
+
+    std::cout << "Culling statistics (" << culling_mode_to_string(culling.mode) << "): \n";
+    std::cout << "\t Objects: " << culling.objects_count << ". \n";
+    if (culling.mode == CullingMode::Cpu) {
+        std::cout << "\t Visible: " << static_cast<double>(culling.total_visible) / culling.total_frames << " per frame. \n";
+    }
+    std::cout << "\t CPU cost: " << culling.total_cull_ms * 1000.0 / culling.total_frames << " us per frame. \n\n";
+}
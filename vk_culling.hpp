@@ -0,0 +1,181 @@
+#pragma once
+
+#include "my_utils.hpp"
+#include "app_config.hpp" // CullingMode
+#include "vk_core.hpp" // DeviceFeatures
+#include "vk_memory.hpp"
+#include "vk_mesh.hpp"
+#include "vk_descriptors.hpp"
+#include "job_system.hpp"
+
+#include <glm/glm.hpp>
+
+
+// Frustum culling of the draw list of the mesh.
+//
+// Every draw of the mesh is an object with a bounding sphere (Mesh::draw_bounds), and
+// the objects outside the view frustum of the frame are not drawn. There are two ways
+// to find them:
+//
+// - CPU (CullingMode::Cpu): the spheres are tested 4 at a time with SSE, from a SoA copy
+//   of the bounds (centers x, y, z and radii in separate arrays, so that one load fills
+//   a register with 4 objects). The visible draws are written as VkDrawIndexedIndirectCommand
+//   into a host visible buffer and drawn with vkCmdDrawIndexedIndirect().
+//   The CPU cost grows with the number of objects.
+//
+// - GPU (CullingMode::Gpu): the bounds and the draw ranges are uploaded once. Every
+//   frame a compute shader (cull.comp) tests one object per invocation and appends the
+//   visible draws to the indirect buffer, counting them with an atomic. The render pass
+//   then draws them with a single vkCmdDrawIndexedIndirectCount(): the CPU records one
+//   dispatch and one draw, whatever the number of objects.
+//
+// Without drawIndirectCount the compute shader writes the command of every object
+// (instanceCount = 0 when culled) and all of them are drawn with vkCmdDrawIndexedIndirect().
+// Without multiDrawIndirect every command is an indirect draw of its own.
+//
+// The indirect buffer has one region per frame in flight: the region of a frame is
+// only written again after waiting for the fence of that frame.
+
+
+// local_size_x of cull.comp.
+const uint32_t CULLING_WORKGROUP_SIZE = 64;
+
+
+// The planes of the view frustum: xyz is the normal (pointing inside), w the distance.
+// A point p is inside a plane if dot(plane.xyz, p) + plane.w >= 0.
+struct FrustumPlanes {
+
+    glm::vec4 planes[6];
+};
+
+// Extracts the planes from the clip space transform (left, right, bottom, top, near, far).
+// Clip space depth goes from 0 to 1, like in Vulkan.
+FrustumPlanes extract_frustum_planes(const glm::mat4& transform);
+
+
+// Bounding spheres of the objects, one array per component (SoA).
+struct CullingObjects {
+
+    std::vector<float> center_x;
+    std::vector<float> center_y;
+    std::vector<float> center_z;
+    std::vector<float> radius;
+    uint32_t count = 0;
+};
+
+// bounds: center in xyz, radius in w (see Mesh::draw_bounds).
+void build_culling_objects(CullingObjects& objects, const std::vector<glm::vec4>& bounds);
+
+// Write the indices of the visible objects to visible (room for objects.count indices)
+// and return how many there are. The SIMD version falls back to the scalar one on CPUs
+// without SSE2.
+uint32_t cull_objects_scalar(const CullingObjects& objects, const FrustumPlanes& frustum, uint32_t* visible);
+uint32_t cull_objects_simd(const CullingObjects& objects, const FrustumPlanes& frustum, uint32_t* visible);
+
+
+// An object of cull.comp (std430 layout).
+struct GpuCullingObject {
+
+    glm::vec4 bounds;
+    uint32_t index_count;
+    uint32_t first_index;
+    uint32_t padding[2];
+};
+
+// Push constants of cull.comp.
+struct CullingPushConstants {
+
+    glm::vec4 planes[6];
+    uint32_t object_count;
+    uint32_t compact; // 1: append the visible draws and count them, 0: write the command of every object
+};
+
+
+struct CullingSystem {
+
+    CullingMode mode = CullingMode::None;
+    DeviceFeatures features;
+    uint32_t max_draw_indirect_count = 1; // Draws per vkCmdDrawIndexedIndirect()
+    bool compact = false;                 // Draw with vkCmdDrawIndexedIndirectCount()
+
+    const Mesh* mesh = nullptr;
+    uint32_t objects_count = 0;
+
+    // CPU culling
+    CullingObjects objects;
+    std::vector<uint32_t> visible;
+
+    // Indirect commands, one region per frame in flight.
+    // Host visible for CPU culling, device local (written by the compute shader) for GPU culling.
+    VkBuffer indirect_buffer = VK_NULL_HANDLE;
+    MemoryAllocation indirect_allocation;
+    VkDeviceSize indirect_region_size = 0;
+
+    // GPU culling
+    VkBuffer object_buffer = VK_NULL_HANDLE; // GpuCullingObject of every draw
+    MemoryAllocation object_allocation;
+    VkBuffer count_buffer = VK_NULL_HANDLE;  // Draw count, one region per frame in flight
+    MemoryAllocation count_allocation;
+    VkDeviceSize count_region_size = 0;
+
+    VkDescriptorSetLayout set_layout = VK_NULL_HANDLE; // Owned by the layout cache
+    VkPipelineLayout pipeline_layout = VK_NULL_HANDLE;
+    VkPipeline pipeline = VK_NULL_HANDLE;
+
+    // Whole run
+    uint64_t total_frames = 0;
+    uint64_t total_visible = 0; // CPU culling only, the GPU count is never read back
+    double total_cull_ms = 0.0;
+};
+
+
+// What the command buffer of a frame needs to record the culled draws.
+struct FrameCulling {
+
+    const CullingSystem* culling = nullptr;
+    uint32_t frame_index = 0;
+
+    uint32_t visible_count = 0;                    // CPU culling
+    VkDescriptorSet descriptor_set = VK_NULL_HANDLE; // GPU culling
+    CullingPushConstants push_constants{};           // GPU culling
+};
+
+
+// Creates the buffers of the mode (and, for GPU culling, the compute pipeline and the
+// object buffer, uploaded through the transfer queue). Nothing to create with CullingMode::None.
+// The mesh must outlive the culling system.
+void create_culling_system(
+    CullingSystem& culling,
+    CullingMode mode, const DeviceFeatures& features,
+    const Mesh& mesh,
+    MemoryAllocator& allocator,
+    VkPhysicalDevice vk_phys_device, VkDevice vk_logic_device,
+    DescriptorLayoutCache& layout_cache, VkPipelineCache vk_pipeline_cache,
+    uint32_t frames_in_flight,
+    uint32_t graphics_family, uint32_t transfer_family,
+    VkCommandPool vk_transfer_command_pool, VkQueue vk_transfer_queue,
+    JobSystem& job_system);
+
+void destroy_culling_system(CullingSystem& culling, MemoryAllocator& allocator, VkDevice vk_logic_device);
+
+// CPU culling: culls and writes the visible draws into the region of the frame.
+// GPU culling: allocates and writes the descriptor set of the dispatch.
+// The fence of the frame must have been waited for.
+void prepare_frame_culling(
+    FrameCulling& frame_culling,
+    CullingSystem& culling,
+    uint32_t frame_index,
+    const glm::mat4& transform,
+    DescriptorAllocator& descriptor_allocator,
+    VkDevice vk_logic_device);
+
+// GPU culling: clears the count and dispatches cull.comp. Outside of the render pass,
+// in a compute pass of the frame graph that writes the indirect and count regions of the
+// frame: the graph makes them visible to the indirect draw. Records nothing for CPU culling.
+void record_culling_dispatch(VkCommandBuffer vk_command_buffer, const FrameCulling& frame_culling);
+
+// The indirect draws of the visible objects. Inside the render pass, after binding
+// the pipeline and the mesh (see record_draw_state()).
+void record_culled_draws(VkCommandBuffer vk_command_buffer, const FrameCulling& frame_culling);
+
+void print_culling_stats(const CullingSystem& culling);
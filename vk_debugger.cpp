@@ -4,6 +4,7 @@
 
 void create_debug_messenger(VkDebugUtilsMessengerEXT& debug_messenger, VkInstance vk_instance) {
 
+    TRACE_SCOPE("create_debug_messenger");
     std::cout << "Creating Vulkan Debugger... \n";
 
     if (!ENABLE_VALIDATION_LAYERS)
@@ -70,7 +71,16 @@ static VKAPI_ATTR VkBool32 VKAPI_CALL CALLBACK_FUNC_debug_messenger(
     const VkDebugUtilsMessengerCallbackDataEXT* ptr_callback_data,
     void* ptr_user_data) {
 
-    std::cerr << "\t Validation layer: " << ptr_callback_data->pMessage << std::endl;
+    // Validation messages can come every frame, so they go through the async logger.
+    if (message_severity >= VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT) {
+        LOG_ERROR("\t Validation layer: %s", ptr_callback_data->pMessage);
+    }
+    else if (message_severity >= VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT) {
+        LOG_WARN("\t Validation layer: %s", ptr_callback_data->pMessage);
+    }
+    else {
+        LOG_DEBUG("\t Validation layer: %s", ptr_callback_data->pMessage);
+    }
 
     return VK_FALSE;
 }
\ No newline at end of file
@@ -0,0 +1,302 @@
+#include "vk_descriptors.hpp"
+
+#include <algorithm> // std::sort
+#include <chrono>
+
+
+bool operator==(const DescriptorSetLayoutDesc& a, const DescriptorSetLayoutDesc& b) {
+
+    if (a.bindings.size() != b.bindings.size()) {
+        return false;
+    }
+
+    for (size_t i = 0; i < a.bindings.size(); i++) {
+        const DescriptorBinding& x = a.bindings[i];
+        const DescriptorBinding& y = b.bindings[i];
+        if (x.binding != y.binding || x.type != y.type || x.count != y.count || x.stages != y.stages) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+size_t DescriptorSetLayoutDescHash::operator()(const DescriptorSetLayoutDesc& desc) const {
+
+    size_t hash = desc.bindings.size();
+
+    auto combine = [&hash](size_t value) {
+        hash ^= value + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
+    };
+
+    for (const auto& binding : desc.bindings) {
+        combine(binding.binding);
+        combine(static_cast<size_t>(binding.type));
+        combine(binding.count);
+        combine(binding.stages);
+    }
+
+    return hash;
+}
+
+
+static VkDescriptorPool create_descriptor_pool(VkDevice vk_logic_device, uint32_t sets_count) {
+
+    TRACE_SCOPE("create_descriptor_pool");
+
+    std::vector<VkDescriptorPoolSize> pool_sizes;
+    for (const auto& ratio : DESCRIPTOR_POOL_RATIOS) {
+        pool_sizes.push_back({ ratio.type, static_cast<uint32_t>(ratio.descriptors_per_set * sets_count) });
+    }
+
+    // No FREE_DESCRIPTOR_SET_BIT: sets are only ever freed all together, by resetting the pool.
+    VkDescriptorPoolCreateInfo pool_create_info{};
+    pool_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    pool_create_info.flags = 0;
+    pool_create_info.maxSets = sets_count;
+    pool_create_info.poolSizeCount = static_cast<uint32_t>(pool_sizes.size());
+    pool_create_info.pPoolSizes = pool_sizes.data();
+
+    VkDescriptorPool pool;
+    if (vkCreateDescriptorPool(vk_logic_device, &pool_create_info, nullptr, &pool) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create Vulkan Descriptor pool! \n");
+    }
+
+    return pool;
+}
+
+
+// Takes an empty pool from the list, or creates a new one.
+static VkDescriptorPool take_descriptor_pool(DescriptorPools& pools) {
+
+    std::lock_guard<std::mutex> lock(pools.mutex);
+
+    if (!pools.free_pools.empty()) {
+        VkDescriptorPool pool = pools.free_pools.back();
+        pools.free_pools.pop_back();
+        return pool;
+    }
+
+    VkDescriptorPool pool = create_descriptor_pool(pools.device, pools.next_pool_sets);
+    pools.all_pools.push_back(pool);
+
+    LOG_DEBUG("Created descriptor pool %zu (%u sets).", pools.all_pools.size(), pools.next_pool_sets);
+
+    // The more pools we need, the larger they get, so their number stays small.
+    pools.next_pool_sets = std::min(pools.next_pool_sets * 2, DESCRIPTOR_POOL_MAX_SETS);
+
+    return pool;
+}
+
+
+// Frees the sets of the pools used since the last reset: the ones up to current_pool.
+static void reset_owned_pools(DescriptorAllocator& allocator) {
+
+    for (size_t i = 0; i < allocator.owned_pools.size() && i <= allocator.current_pool; i++) {
+        vkResetDescriptorPool(allocator.pools->device, allocator.owned_pools[i], 0);
+    }
+
+    allocator.current_pool = 0;
+    allocator.current_pool_sets = 0;
+    allocator.frame_sets = 0;
+}
+
+
+void create_descriptor_layout_cache(DescriptorLayoutCache& cache, VkDevice vk_logic_device) {
+
+    cache.device = vk_logic_device;
+    cache.layouts.clear();
+    cache.hits = 0;
+    cache.misses = 0;
+}
+
+
+void destroy_descriptor_layout_cache(DescriptorLayoutCache& cache) {
+
+    for (auto& entry : cache.layouts) {
+        vkDestroyDescriptorSetLayout(cache.device, entry.second, nullptr);
+    }
+    cache.layouts.clear();
+}
+
+
+VkDescriptorSetLayout get_descriptor_set_layout(DescriptorLayoutCache& cache, DescriptorSetLayoutDesc desc) {
+
+    std::sort(desc.bindings.begin(), desc.bindings.end(),
+        [](const DescriptorBinding& a, const DescriptorBinding& b) { return a.binding < b.binding; });
+
+    std::lock_guard<std::mutex> lock(cache.mutex);
+
+    auto found = cache.layouts.find(desc);
+    if (found != cache.layouts.end()) {
+        cache.hits++;
+        return found->second;
+    }
+
+    cache.misses++;
+
+    std::vector<VkDescriptorSetLayoutBinding> layout_bindings;
+    for (const auto& binding : desc.bindings) {
+
+        VkDescriptorSetLayoutBinding layout_binding{};
+        layout_binding.binding = binding.binding;
+        layout_binding.descriptorType = binding.type;
+        layout_binding.descriptorCount = binding.count;
+        layout_binding.stageFlags = binding.stages;
+        layout_binding.pImmutableSamplers = nullptr;
+        layout_bindings.push_back(layout_binding);
+    }
+
+    VkDescriptorSetLayoutCreateInfo layout_create_info{};
+    layout_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layout_create_info.bindingCount = static_cast<uint32_t>(layout_bindings.size());
+    layout_create_info.pBindings = layout_bindings.data();
+
+    VkDescriptorSetLayout layout;
+    if (vkCreateDescriptorSetLayout(cache.device, &layout_create_info, nullptr, &layout) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create Vulkan Descriptor set layout! \n");
+    }
+
+    cache.layouts.emplace(std::move(desc), layout);
+    return layout;
+}
+
+
+void create_descriptor_pools(DescriptorPools& pools, VkDevice vk_logic_device) {
+
+    pools.device = vk_logic_device;
+    pools.all_pools.clear();
+    pools.free_pools.clear();
+    pools.next_pool_sets = DESCRIPTOR_POOL_INITIAL_SETS;
+}
+
+
+void destroy_descriptor_pools(DescriptorPools& pools) {
+
+    for (auto pool : pools.all_pools) {
+        vkDestroyDescriptorPool(pools.device, pool, nullptr);
+    }
+    pools.all_pools.clear();
+    pools.free_pools.clear();
+}
+
+
+void create_descriptor_allocator(DescriptorAllocator& allocator, DescriptorPools& pools) {
+
+    allocator = DescriptorAllocator{};
+    allocator.pools = &pools;
+}
+
+
+void destroy_descriptor_allocator(DescriptorAllocator& allocator) {
+
+    // The next allocator that takes them expects empty pools.
+    reset_owned_pools(allocator);
+
+    std::lock_guard<std::mutex> lock(allocator.pools->mutex);
+    for (auto pool : allocator.owned_pools) {
+        allocator.pools->free_pools.push_back(pool);
+    }
+    allocator.owned_pools.clear();
+}
+
+
+void reset_descriptor_allocator(DescriptorAllocator& allocator) {
+
+    using clock = std::chrono::steady_clock;
+    clock::time_point reset_start = clock::now();
+
+    reset_owned_pools(allocator);
+
+    allocator.total_frames++;
+    allocator.total_allocate_ms += std::chrono::duration<double, std::milli>(clock::now() - reset_start).count();
+}
+
+
+VkDescriptorSet allocate_descriptor_set(DescriptorAllocator& allocator, VkDescriptorSetLayout vk_layout) {
+
+    using clock = std::chrono::steady_clock;
+    clock::time_point allocate_start = clock::now();
+
+    VkDescriptorSetAllocateInfo allocate_info{};
+    allocate_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocate_info.descriptorSetCount = 1;
+    allocate_info.pSetLayouts = &vk_layout;
+
+    VkDescriptorSet set = VK_NULL_HANDLE;
+
+    for (;;) {
+
+        if (allocator.current_pool == allocator.owned_pools.size()) {
+            allocator.owned_pools.push_back(take_descriptor_pool(*allocator.pools));
+            allocator.pools_taken++;
+        }
+
+        allocate_info.descriptorPool = allocator.owned_pools[allocator.current_pool];
+        VkResult result = vkAllocateDescriptorSets(allocator.pools->device, &allocate_info, &set);
+
+        if (result == VK_SUCCESS) {
+            break;
+        }
+
+        // The pool is full (out of sets or of descriptors of one type), go on with the next one.
+        if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL) {
+
+            // A set that doesn't fit in an empty pool never will.
+            if (allocator.current_pool_sets == 0) {
+                throw std::runtime_error("Descriptor set larger than a descriptor pool! \n");
+            }
+
+            allocator.current_pool++;
+            allocator.current_pool_sets = 0;
+            continue;
+        }
+
+        throw std::runtime_error("Failed to allocate Vulkan Descriptor set! \n");
+    }
+
+    allocator.current_pool_sets++;
+    allocator.frame_sets++;
+    allocator.total_sets++;
+    allocator.total_allocate_ms += std::chrono::duration<double, std::milli>(clock::now() - allocate_start).count();
+
+    return set;
+}
+
+
+void print_descriptor_stats(
+    const DescriptorLayoutCache& cache,
+    const DescriptorPools& pools,
+    const std::vector<const DescriptorAllocator*>& allocators) {
+
+    uint64_t total_sets = 0;
+    uint64_t total_frames = 0;
+    uint64_t pools_taken = 0;
+    double total_allocate_ms = 0.0;
+
+    for (const DescriptorAllocator* allocator : allocators) {
+        total_sets += allocator->total_sets;
+        total_frames += allocator->total_frames;
+        pools_taken += allocator->pools_taken;
+        total_allocate_ms += allocator->total_allocate_ms;
+    }
+
+    std::cout << "Descriptor statistics: \n";
+    std::cout << "\t Set layouts: " << cache.layouts.size()
+        << " (cache: " << cache.hits << " hits, " << cache.misses << " misses). \n";
+    std::cout << "\t Pools: " << pools.all_pools.size() << " created, " << pools_taken << " taken by the frame allocators. \n";
+    std::cout << "\t Sets allocated: " << total_sets;
+    if (total_frames > 0) {
+        std::cout << " (" << static_cast<double>(total_sets) / total_frames << " per frame)";
+    }
+    std::cout << ". \n";
+    if (total_frames > 0) {
+        std::cout << "\t Allocation cost: " << total_allocate_ms * 1000.0 / total_frames << " us per frame";
+        if (total_sets > 0) {
+            std::cout << ", " << total_allocate_ms * 1000000.0 / total_sets << " ns per set";
+        }
+        std::cout << " (resets included). \n";
+    }
+    std::cout << "\n";
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include "my_utils.hpp"
+
+#include <mutex>
+#include <unordered_map>
+
+
+// Descriptor sets.
+//
+// Shaders read their resources (uniform buffers, images...) through descriptor sets,
+// whose layout is part of the pipeline layout.
+//
+// - Layouts are created once per binding description and shared: the layout cache
+//   returns the layout it already has for an equal description. Pipelines whose set
+//   layouts are the same objects are compatible, so their sets can stay bound.
+//
+// - Sets come from descriptor pools. Allocating from a pool is cheap, but freeing sets
+//   one by one needs FREE_DESCRIPTOR_SET_BIT, which makes the pool fragment and every
+//   allocation slower. The sets used by a frame all die together, so every frame in
+//   flight has a linear allocator instead: it takes sets from its pools in order and
+//   resets the pools all at once (vkResetDescriptorPool()) when the frame starts again.
+//
+// - When the pools of an allocator are full it takes another one from the shared pool
+//   list, which grows (with larger pools) as needed. After a few frames every allocator
+//   owns enough pools and no pool is created anymore.
+
+
+// Descriptors of every type a pool holds, per set of the pool. A set may use more of
+// one type and less of another, the pool runs out of whichever is exhausted first.
+struct DescriptorPoolRatio {
+
+    VkDescriptorType type;
+    float descriptors_per_set;
+};
+
+const std::vector<DescriptorPoolRatio> DESCRIPTOR_POOL_RATIOS = {
+    { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2.0f },
+    { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1.0f },
+    { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2.0f },
+    { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2.0f },
+};
+
+// Sets of the first pool; every new pool is twice as large, up to the maximum.
+const uint32_t DESCRIPTOR_POOL_INITIAL_SETS = 64;
+const uint32_t DESCRIPTOR_POOL_MAX_SETS = 4096;
+
+
+struct DescriptorBinding {
+
+    uint32_t binding;
+    VkDescriptorType type;
+    uint32_t count;
+    VkShaderStageFlags stages;
+};
+
+// The key of the layout cache. The bindings are sorted by binding number
+// before lookup, so the order they are listed in doesn't matter.
+struct DescriptorSetLayoutDesc {
+
+    std::vector<DescriptorBinding> bindings;
+};
+
+bool operator==(const DescriptorSetLayoutDesc& a, const DescriptorSetLayoutDesc& b);
+
+struct DescriptorSetLayoutDescHash {
+    size_t operator()(const DescriptorSetLayoutDesc& desc) const;
+};
+
+
+struct DescriptorLayoutCache {
+
+    VkDevice device = VK_NULL_HANDLE;
+
+    // Layouts are requested while creating pipelines, which may happen on the job system.
+    std::mutex mutex;
+    std::unordered_map<DescriptorSetLayoutDesc, VkDescriptorSetLayout, DescriptorSetLayoutDescHash> layouts;
+
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+};
+
+
+// Pools shared by the allocators. Only touched when an allocator runs out of pools.
+struct DescriptorPools {
+
+    VkDevice device = VK_NULL_HANDLE;
+
+    std::mutex mutex;
+    std::vector<VkDescriptorPool> all_pools;  // Destroyed with the list
+    std::vector<VkDescriptorPool> free_pools; // Empty, not owned by any allocator
+    uint32_t next_pool_sets = DESCRIPTOR_POOL_INITIAL_SETS;
+};
+
+
+// Linear allocator of a frame in flight (one thread at a time).
+struct DescriptorAllocator {
+
+    DescriptorPools* pools = nullptr;
+
+    // Pools taken from the list, in use order. Sets are allocated from
+    // pools[current_pool], the pools before it are full.
+    std::vector<VkDescriptorPool> owned_pools;
+    size_t current_pool = 0;
+    uint32_t current_pool_sets = 0; // Allocated from pools[current_pool]
+
+    // This frame
+    uint32_t frame_sets = 0;
+
+    // Whole run
+    uint64_t total_sets = 0;
+    uint64_t total_frames = 0;
+    uint64_t pools_taken = 0;       // Pools taken from the list (ideally only in the first frames)
+    double total_allocate_ms = 0.0; // Resets + allocations
+};
+
+
+void create_descriptor_layout_cache(DescriptorLayoutCache& cache, VkDevice vk_logic_device);
+
+void destroy_descriptor_layout_cache(DescriptorLayoutCache& cache);
+
+// Returns the layout of this description, creating it the first time it is requested.
+// Owned by the cache.
+VkDescriptorSetLayout get_descriptor_set_layout(DescriptorLayoutCache& cache, DescriptorSetLayoutDesc desc);
+
+
+void create_descriptor_pools(DescriptorPools& pools, VkDevice vk_logic_device);
+
+// Every allocator must have been destroyed already.
+void destroy_descriptor_pools(DescriptorPools& pools);
+
+
+void create_descriptor_allocator(DescriptorAllocator& allocator, DescriptorPools& pools);
+
+// Gives the pools back to the list. The GPU must be done with the sets.
+void destroy_descriptor_allocator(DescriptorAllocator& allocator);
+
+// Frees every set of the allocator at once. Called when the frame starts,
+// after waiting for its fence (the GPU is done with the sets of the last use).
+void reset_descriptor_allocator(DescriptorAllocator& allocator);
+
+VkDescriptorSet allocate_descriptor_set(DescriptorAllocator& allocator, VkDescriptorSetLayout vk_layout);
+
+// Layout cache hits/misses, pools, and the cost of the per-frame allocations.
+void print_descriptor_stats(
+    const DescriptorLayoutCache& cache,
+    const DescriptorPools& pools,
+    const std::vector<const DescriptorAllocator*>& allocators);
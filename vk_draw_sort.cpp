@@ -0,0 +1,116 @@
+#include "vk_draw_sort.hpp"
+
+#include <algorithm> // std::clamp
+#include <chrono>
+#include <cstring> // memcpy
+
+
+uint64_t make_draw_sort_key(uint32_t pipeline_id, uint32_t material_id, float depth) {
+
+    // Also turns -0.0 (sign bit set) into 0.0.
+    depth = std::clamp(depth, 0.0f, 1.0f) + 0.0f;
+
+    uint32_t depth_bits;
+    memcpy(&depth_bits, &depth, sizeof(depth_bits));
+
+    return (static_cast<uint64_t>(pipeline_id & 0xFFFF) << DRAW_SORT_PIPELINE_SHIFT) |
+        (static_cast<uint64_t>(material_id & 0xFFFF) << DRAW_SORT_MATERIAL_SHIFT) |
+        depth_bits;
+}
+
+
+void radix_sort_draws(std::vector<DrawSortEntry>& entries, std::vector<DrawSortEntry>& scratch) {
+
+    const size_t count = entries.size();
+    if (count < 2) {
+        return;
+    }
+    scratch.resize(count);
+
+    // One histogram per byte of the key, all of them in a single pass over the keys.
+    uint32_t histograms[8][256] = {};
+    for (const auto& entry : entries) {
+        for (uint32_t byte = 0; byte < 8; byte++) {
+            histograms[byte][(entry.key >> (byte * 8)) & 0xFF]++;
+        }
+    }
+
+    DrawSortEntry* src = entries.data();
+    DrawSortEntry* dst = scratch.data();
+
+    for (uint32_t byte = 0; byte < 8; byte++) {
+
+        uint32_t* histogram = histograms[byte];
+
+        // Every key has the same byte here: the pass wouldn't move anything.
+        if (histogram[(src[0].key >> (byte * 8)) & 0xFF] == count) {
+            continue;
+        }
+
+        // Prefix sum: where the first entry of every bucket goes.
+        uint32_t offset = 0;
+        for (uint32_t bucket = 0; bucket < 256; bucket++) {
+            uint32_t bucket_count = histogram[bucket];
+            histogram[bucket] = offset;
+            offset += bucket_count;
+        }
+
+        // In order, so entries with the same byte keep the order of the previous pass.
+        for (size_t i = 0; i < count; i++) {
+            dst[histogram[(src[i].key >> (byte * 8)) & 0xFF]++] = src[i];
+        }
+
+        std::swap(src, dst);
+    }
+
+    // After an odd number of passes the sorted entries are in the scratch buffer.
+    if (src != entries.data()) {
+        entries.swap(scratch);
+    }
+}
+
+
+void sort_draws_front_to_back(
+    DrawSorter& sorter,
+    const Mesh& mesh,
+    const glm::mat4& transform,
+    uint32_t pipeline_id, uint32_t material_id) {
+
+    TRACE_SCOPE("sort_draws");
+
+    using clock = std::chrono::steady_clock;
+    clock::time_point sort_start = clock::now();
+
+    const uint32_t draws_count = static_cast<uint32_t>(mesh.draws.size());
+
+    sorter.entries.resize(draws_count);
+    for (uint32_t i = 0; i < draws_count; i++) {
+
+        const glm::vec4& bounds = mesh.draw_bounds[i]; // Center in xyz
+        glm::vec4 clip = transform * glm::vec4(bounds.x, bounds.y, bounds.z, 1.0f);
+        float depth = clip.w > 0.0f ? clip.z / clip.w : 0.0f;
+
+        sorter.entries[i] = { make_draw_sort_key(pipeline_id, material_id, depth), i };
+    }
+
+    radix_sort_draws(sorter.entries, sorter.scratch);
+
+    sorter.order.resize(draws_count);
+    for (uint32_t i = 0; i < draws_count; i++) {
+        sorter.order[i] = sorter.entries[i].draw;
+    }
+
+    sorter.total_frames++;
+    sorter.total_sort_ms += std::chrono::duration<double, std::milli>(clock::now() - sort_start).count();
+}
+
+
+void print_draw_sort_stats(const DrawSorter& sorter) {
+
+    if (sorter.total_frames == 0) {
+        return;
+    }
+
+    std::cout << "Draw sorting: " << sorter.order.size() << " draw(s) sorted front to back, "
+        << sorter.total_sort_ms * 1000.0 / sorter.total_frames << " us per frame. \n\n";
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "my_utils.hpp"
+#include "vk_mesh.hpp"
+
+#include <glm/glm.hpp>
+
+
+// Draw list sorting.
+//
+// Every draw gets a 64 bit sort key, and the draws are recorded in the order of their keys:
+//
+//   bits 63-48: pipeline | bits 47-32: material | bits 31-0: depth
+//
+// The pipeline comes first so that the draws sharing one are recorded together (one bind
+// for all of them), then the material, then the depth, front to back: the nearest draws
+// are drawn first, and the depth test rejects the fragments of the draws behind them before
+// they are shaded (early-Z, see the depth state in create_graphics_pipeline()). On a CPU
+// rasterizer like lavapipe the fragment shading is most of the frame, so every fragment
+// rejected early is time saved.
+//
+// The depth is the clip space depth of the center of the draw, in [0, 1]. A float >= 0
+// compares like its bits read as an unsigned integer, so the key stores the bits as they are.
+//
+// The keys are sorted with an LSD radix sort: 8 passes of 8 bits, every pass a counting
+// sort (histogram, prefix sum, scatter) from one buffer into the other. O(n) with no
+// comparisons to mispredict, where std::sort is O(n log n). The histograms of the 8 passes
+// are built in a single read of the keys, and a pass whose byte is the same in every key
+// (e.g. the pipeline bits while there is a single pipeline) is skipped.
+
+
+const uint32_t DRAW_SORT_PIPELINE_SHIFT = 48;
+const uint32_t DRAW_SORT_MATERIAL_SHIFT = 32;
+
+
+struct DrawSortEntry {
+
+    uint64_t key;
+    uint32_t draw; // Index in the draw list
+};
+
+
+// pipeline_id and material_id are truncated to 16 bits, depth is clamped to [0, 1].
+uint64_t make_draw_sort_key(uint32_t pipeline_id, uint32_t material_id, float depth);
+
+// Stable sort of entries by key. scratch is resized to the size of entries.
+void radix_sort_draws(std::vector<DrawSortEntry>& entries, std::vector<DrawSortEntry>& scratch);
+
+
+struct DrawSorter {
+
+    std::vector<DrawSortEntry> entries;
+    std::vector<DrawSortEntry> scratch;
+
+    std::vector<uint32_t> order; // Indices in the draw list, in recording order
+
+    // Whole run
+    uint64_t total_frames = 0;
+    double total_sort_ms = 0.0;
+};
+
+
+// Sorts the draws of the mesh front to back as seen through transform (clip space, depth
+// from 0 to 1 like in Vulkan), into sorter.order. Every draw of the mesh uses the same
+// pipeline and material for now, the keys leave room for more.
+void sort_draws_front_to_back(
+    DrawSorter& sorter,
+    const Mesh& mesh,
+    const glm::mat4& transform,
+    uint32_t pipeline_id, uint32_t material_id);
+
+void print_draw_sort_stats(const DrawSorter& sorter);
@@ -0,0 +1,153 @@
+#include "vk_frame.hpp"
+
+#include <algorithm> // std::max
+#include <cstdio> // snprintf
+
+
+// How often the frame statistics are printed.
+const double STATS_REPORT_INTERVAL_MS = 1000.0;
+
+
+void FrameStats::begin(uint32_t frames_in_flight_count) {
+
+    frames_in_flight = frames_in_flight_count;
+    run_start = clock::now();
+    window_start = run_start;
+}
+
+
+void FrameStats::end_frame(double cpu_wait_ms) {
+
+    window_frames++;
+    window_wait_ms += cpu_wait_ms;
+    total_frames++;
+    total_wait_ms += cpu_wait_ms;
+
+    clock::time_point now = clock::now();
+    double window_ms = std::chrono::duration<double, std::milli>(now - window_start).count();
+
+    if (window_ms >= STATS_REPORT_INTERVAL_MS) {
+
+        // Printed from inside the frame loop, so through the async logger.
+        char present_text[128] = "";
+        if (window_presents > 0) {
+            snprintf(present_text, sizeof(present_text), " | Present interval (%s): %.3f ms avg, %.3f ms max",
+                present_mode.c_str(), window_present_ms / window_presents, window_present_max_ms);
+        }
+
+        LOG_INFO("\t FPS: %.1f | Frame time: %.3f ms | CPU wait: %.3f ms/frame%s | Frames in flight: %u",
+            window_frames * 1000.0 / window_ms,
+            window_ms / window_frames,
+            window_wait_ms / window_frames,
+            present_text,
+            frames_in_flight);
+
+        window_start = now;
+        window_frames = 0;
+        window_wait_ms = 0.0;
+        window_presents = 0;
+        window_present_ms = 0.0;
+        window_present_max_ms = 0.0;
+    }
+}
+
+
+void FrameStats::present_done() {
+
+    clock::time_point now = clock::now();
+
+    if (has_last_present) {
+
+        double interval_ms = std::chrono::duration<double, std::milli>(now - last_present).count();
+
+        window_presents++;
+        window_present_ms += interval_ms;
+        window_present_max_ms = std::max(window_present_max_ms, interval_ms);
+        total_presents++;
+        total_present_ms += interval_ms;
+    }
+
+    last_present = now;
+    has_last_present = true;
+}
+
+
+void FrameStats::reset_present_interval() {
+
+    has_last_present = false;
+}
+
+
+void FrameStats::print_summary() const {
+
+    if (total_frames == 0) {
+        return;
+    }
+
+    double run_ms = std::chrono::duration<double, std::milli>(clock::now() - run_start).count();
+
+    std::cout << "\n" << "Frame statistics: \n";
+    std::cout << "\t Frames in flight: " << frames_in_flight << ". \n";
+    std::cout << "\t Frames rendered: " << total_frames << ". \n";
+    std::cout << "\t Average FPS: " << (total_frames * 1000.0 / run_ms) << ". \n";
+    std::cout << "\t Average frame time: " << (run_ms / total_frames) << " ms. \n";
+    std::cout << "\t Average CPU wait: " << (total_wait_ms / total_frames) << " ms/frame. \n";
+    if (total_presents > 0) {
+        std::cout << "\t Present mode: " << present_mode << ". \n";
+        std::cout << "\t Average present interval: " << (total_present_ms / total_presents) << " ms. \n";
+    }
+    std::cout << "\n";
+}
+
+
+void create_sync_objects(std::vector<FrameData>& frames, VkDevice vk_logic_device) {
+
+    TRACE_SCOPE("create_sync_objects");
+    std::cout << "Creating Vulkan Sync objects for " << frames.size() << " frame(s) in flight... \n\n";
+
+    VkSemaphoreCreateInfo semaphore_create_info{};
+    semaphore_create_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+    // The fence is created already signaled, otherwise the very first
+    // vkWaitForFences() in draw_frame() would wait forever on a fence
+    // that no submission will ever signal.
+    VkFenceCreateInfo fence_create_info{};
+    fence_create_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    fence_create_info.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+
+    for (auto& frame : frames) {
+
+        if (vkCreateSemaphore(vk_logic_device, &semaphore_create_info, nullptr, &frame.image_available_semaphore) != VK_SUCCESS ||
+            vkCreateFence(vk_logic_device, &fence_create_info, nullptr, &frame.in_flight_fence) != VK_SUCCESS) {
+
+            throw std::runtime_error("Failed to create Vulkan Sync objects! \n");
+        }
+    }
+
+    std::cout << "Vulkan Sync objects created. \n\n";
+}
+
+
+void destroy_sync_objects(std::vector<FrameData>& frames, VkDevice vk_logic_device) {
+
+    for (auto& frame : frames) {
+        vkDestroySemaphore(vk_logic_device, frame.image_available_semaphore, nullptr);
+        vkDestroyFence(vk_logic_device, frame.in_flight_fence, nullptr);
+    }
+}
+
+
+void create_frame_resources(std::vector<FrameData>& frames, DescriptorPools& descriptor_pools) {
+
+    for (auto& frame : frames) {
+        create_descriptor_allocator(frame.descriptor_allocator, descriptor_pools);
+    }
+}
+
+
+void destroy_frame_resources(std::vector<FrameData>& frames) {
+
+    for (auto& frame : frames) {
+        destroy_descriptor_allocator(frame.descriptor_allocator);
+    }
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "my_utils.hpp"
+#include "vk_descriptors.hpp"
+
+#include <glm/glm.hpp>
+
+#include <chrono>
+#include <string>
+
+
+// Per-frame shader data, set 0 binding 0 (see shader.vert), written into the
+// uniform ring buffer every frame (see vk_uniform_ring.hpp).
+// std140 layout: a mat4 is 4 vec4 columns, no padding.
+struct FrameUniforms {
+
+    glm::mat4 transform; // Applied to every vertex. The meshes are already in clip space.
+};
+
+
+// Everything a single frame in flight owns. While the GPU is still
+// working on frame N, the CPU can already record frame N+1 in a different
+// FrameData, so none of these objects can be shared between frames.
+struct FrameData {
+
+    VkCommandBuffer command_buffer; // Implicitly destroyed when the command pool is destroyed
+
+    // Signaled when the swapchain image has been acquired and is ready for rendering.
+    VkSemaphore image_available_semaphore;
+
+    // The semaphore signaled when rendering has finished belongs to the swapchain image
+    // instead (see create_render_finished_semaphores()).
+
+    // Signaled when the GPU has finished executing the command buffer of this frame,
+    // so the CPU knows when it can record into it again.
+    VkFence in_flight_fence;
+
+    // The descriptor sets of the frame, all freed at once when the frame starts again.
+    DescriptorAllocator descriptor_allocator;
+};
+
+
+// Measures the achieved frame rate and how long the CPU is blocked waiting for
+// the GPU (fences) and for the presentation engine (image acquisition).
+// With a window it also measures the present-to-present interval, i.e. the time
+// between two successive vkQueuePresentKHR() calls as seen by the CPU. That is
+// what the present mode throttles (FIFO blocks to the refresh rate).
+// A summary is printed periodically and once more at the end of the run.
+struct FrameStats {
+
+    using clock = std::chrono::steady_clock;
+
+    uint32_t frames_in_flight = 0;
+    std::string present_mode = "none"; // Just for the reports
+
+    // Present-to-present interval
+    clock::time_point last_present;
+    bool has_last_present = false;
+    uint64_t window_presents = 0;
+    double window_present_ms = 0.0;
+    double window_present_max_ms = 0.0;
+    uint64_t total_presents = 0;
+    double total_present_ms = 0.0;
+
+    // Current reporting window
+    clock::time_point window_start;
+    uint64_t window_frames = 0;
+    double window_wait_ms = 0.0;
+
+    // Whole run
+    clock::time_point run_start;
+    uint64_t total_frames = 0;
+    double total_wait_ms = 0.0;
+
+    void begin(uint32_t frames_in_flight_count);
+
+    // Called once per frame with the time the CPU spent blocked in that frame.
+    void end_frame(double cpu_wait_ms);
+
+    // Called right after every successful present.
+    void present_done();
+
+    // The previous present belongs to a different swapchain (possibly with a
+    // different present mode), the interval across a recreation is meaningless.
+    void reset_present_interval();
+
+    void print_summary() const;
+};
+
+
+void create_sync_objects(std::vector<FrameData>& frames, VkDevice vk_logic_device);
+
+void destroy_sync_objects(std::vector<FrameData>& frames, VkDevice vk_logic_device);
+
+
+// Creates the descriptor allocator of every frame in flight.
+void create_frame_resources(std::vector<FrameData>& frames, DescriptorPools& descriptor_pools);
+
+void destroy_frame_resources(std::vector<FrameData>& frames);
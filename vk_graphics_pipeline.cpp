@@ -1,57 +1,180 @@
 #include "vk_graphics_pipeline.hpp"
+#include "vk_core.hpp"
 #include "vk_queue_family.hpp"
+#include "vk_culling.hpp"
+#include "vk_instancing.hpp"
+#include "vk_render_graph.hpp"
 
 
-void create_graphics_pipeline(
-    VkPipeline& vk_graphics_pipeline, VkPipelineLayout& vk_pipeline_layout,
-    VkDevice vk_logic_device,
-    VkRenderPass vk_render_pass,
-    VkExtent2D vk_swapchain_extent) {
+namespace {
+
+    const uint64_t FNV_OFFSET_BASIS = 14695981039346656037ull;
+    const uint64_t FNV_PRIME = 1099511628211ull;
+
+    void hash_bytes(uint64_t& hash, const void* data, size_t size) {
+
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < size; i++) {
+            hash ^= bytes[i];
+            hash *= FNV_PRIME;
+        }
+    }
+
+    // Fields are hashed one by one (never whole structs), the padding between them
+    // is not initialized.
+    template <typename T>
+    void hash_value(uint64_t& hash, const T& value) {
+        hash_bytes(hash, &value, sizeof(value));
+    }
+
+    void hash_string(uint64_t& hash, const std::string& value) {
+        hash_value(hash, value.size()); // "ab" + "c" must not hash like "a" + "bc"
+        hash_bytes(hash, value.data(), value.size());
+    }
+
+    // Destroys the shader module it holds when it goes out of scope.
+    struct ShaderModuleGuard {
 
-    std::cout << "Creating the Vulkan Graphics Pipeline ... \n\n";
+        VkDevice device;
+        VkShaderModule module = VK_NULL_HANDLE;
 
-    std::cout << "\t Creating the Vulkan Pipeline Layout... \n\n";
+        explicit ShaderModuleGuard(VkDevice device) : device(device) {}
+        ShaderModuleGuard(const ShaderModuleGuard&) = delete;
+        ShaderModuleGuard& operator=(const ShaderModuleGuard&) = delete;
 
-    auto vert_shader_bytecode = read_file("vert.spv");
-    auto frag_shader_bytecode = read_file("frag.spv");
+        ~ShaderModuleGuard() {
+            if (module != VK_NULL_HANDLE) {
+                vkDestroyShaderModule(device, module, nullptr);
+            }
+        }
+    };
+}
 
-    std::cout << "\t\t Vert shader file size: " << vert_shader_bytecode.size() << " bytes. \n";
-    std::cout << "\t\t Frag shader file size: " << frag_shader_bytecode.size() << " bytes. \n\n";
 
-    std::cout << "\t\t Creating the shader modules... \n";
-    VkShaderModule vert_shader_module = create_shader_module(vert_shader_bytecode, vk_logic_device);
-    VkShaderModule frag_shader_module = create_shader_module(frag_shader_bytecode, vk_logic_device);
+bool operator==(const GraphicsPipelineDesc& a, const GraphicsPipelineDesc& b) {
+
+    return a.vert_shader_file == b.vert_shader_file &&
+        a.frag_shader_file == b.frag_shader_file &&
+        a.vertex_layout == b.vertex_layout &&
+        a.topology == b.topology &&
+        a.polygon_mode == b.polygon_mode &&
+        a.cull_mode == b.cull_mode &&
+        a.front_face == b.front_face &&
+        a.rasterization_samples == b.rasterization_samples &&
+        a.blend_enable == b.blend_enable &&
+        a.depth_format == b.depth_format &&
+        a.depth_write == b.depth_write &&
+        a.depth_compare_op == b.depth_compare_op &&
+        a.set_layouts == b.set_layouts &&
+        a.render_pass == b.render_pass &&
+        a.color_formats == b.color_formats;
+}
 
-    if (vert_shader_module == VK_NULL_HANDLE) {
+
+uint64_t hash_pipeline_desc(const GraphicsPipelineDesc& desc) {
+
+    uint64_t hash = FNV_OFFSET_BASIS;
+
+    hash_string(hash, desc.vert_shader_file);
+    hash_string(hash, desc.frag_shader_file);
+
+    hash_value(hash, desc.vertex_layout.bindings.size());
+    for (const auto& binding : desc.vertex_layout.bindings) {
+        hash_value(hash, binding.stride);
+        hash_value(hash, binding.input_rate);
+        hash_value(hash, binding.attributes.size());
+        for (const auto& attribute : binding.attributes) {
+            hash_value(hash, attribute.location);
+            hash_value(hash, attribute.format);
+            hash_value(hash, attribute.offset);
+        }
+    }
+
+    hash_value(hash, desc.topology);
+    hash_value(hash, desc.polygon_mode);
+    hash_value(hash, desc.cull_mode);
+    hash_value(hash, desc.front_face);
+    hash_value(hash, desc.rasterization_samples);
+    hash_value(hash, desc.blend_enable);
+    hash_value(hash, desc.depth_format);
+    hash_value(hash, desc.depth_write);
+    hash_value(hash, desc.depth_compare_op);
+
+    hash_value(hash, desc.set_layouts.size());
+    for (VkDescriptorSetLayout set_layout : desc.set_layouts) {
+        hash_value(hash, set_layout);
+    }
+
+    hash_value(hash, desc.render_pass);
+
+    hash_value(hash, desc.color_formats.size());
+    for (VkFormat format : desc.color_formats) {
+        hash_value(hash, format);
+    }
+
+    return hash;
+}
+
+
+void create_graphics_pipeline(
+    VkPipeline& vk_graphics_pipeline, VkPipelineLayout& vk_pipeline_layout,
+    VkDevice vk_logic_device,
+    VkPipelineCache vk_pipeline_cache,
+    const GraphicsPipelineDesc& desc,
+    JobSystem& job_system) {
+
+    TRACE_SCOPE("create_graphics_pipeline");
+    // Pipelines are compiled on the job workers (see vk_pipeline_compiler.hpp): no
+    // std::cout here, see vk_log.hpp.
+    LOG_DEBUG("Creating the Vulkan Graphics Pipeline (%s, %s)...", desc.vert_shader_file.c_str(), desc.frag_shader_file.c_str());
+
+    // Loading the shaders and creating the shader modules doesn't depend on the other
+    // stage, so every stage is a job of its own.
+    // The guards destroy the shader modules however this function exits: one job failing
+    // after the other created its module, a failed reflection or Vulkan call...
+    ShaderBytecode vert_shader_bytecode;
+    ShaderBytecode frag_shader_bytecode;
+    ShaderModuleGuard vert_shader_module(vk_logic_device);
+    ShaderModuleGuard frag_shader_module(vk_logic_device);
+
+    JobCounter shader_counter;
+    run_job(job_system, [&]() {
+        vert_shader_bytecode = load_shader(desc.vert_shader_file);
+        vert_shader_module.module = create_shader_module(vert_shader_bytecode, vk_logic_device);
+    }, shader_counter);
+    run_job(job_system, [&]() {
+        frag_shader_bytecode = load_shader(desc.frag_shader_file);
+        frag_shader_module.module = create_shader_module(frag_shader_bytecode, vk_logic_device);
+    }, shader_counter);
+    wait_for_counter(job_system, shader_counter);
+
+    if (vert_shader_module.module == VK_NULL_HANDLE) {
         throw std::runtime_error("Vert shader not created! \n");
     }
-    else if (frag_shader_module == VK_NULL_HANDLE) {
+    else if (frag_shader_module.module == VK_NULL_HANDLE) {
         throw std::runtime_error("Frag shader not created! \n");
     }
-    else {
-        std::cout << "\t\t Shader modules created. \n\n";
-    }
 
+    LOG_DEBUG("\t Shader modules created (vert %zu bytes, frag %zu bytes).",
+        vert_shader_bytecode.size() * sizeof(uint32_t), frag_shader_bytecode.size() * sizeof(uint32_t));
 
-    std::cout << "\t\t Creating the shader stages... \n";
     // To actually use the shaders we will need to assign them to a specific
     // pipeline stage.
     VkPipelineShaderStageCreateInfo vert_shader_stage_info{};
     vert_shader_stage_info.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
     vert_shader_stage_info.stage = VK_SHADER_STAGE_VERTEX_BIT;
-    vert_shader_stage_info.module = vert_shader_module;
+    vert_shader_stage_info.module = vert_shader_module.module;
     vert_shader_stage_info.pName = "main";
 
     VkPipelineShaderStageCreateInfo frag_shader_stage_info{};
     frag_shader_stage_info.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
     frag_shader_stage_info.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-    frag_shader_stage_info.module = frag_shader_module;
+    frag_shader_stage_info.module = frag_shader_module.module;
     frag_shader_stage_info.pName = "main";
 
     VkPipelineShaderStageCreateInfo shader_stages[] = {
         vert_shader_stage_info,
         frag_shader_stage_info };
-    std::cout << "\t\t Shader stages created.  \n\n";
 
     // While most of the pipeline state needs to be baked into the pipeline static state, a
     // limited amount of the state can actually be dynamic, changing it without recreating the
@@ -65,17 +188,31 @@ void create_graphics_pipeline(
 
     // The VkPipelineVertexInputStateCreateInfo structure describes the format
     // of the vertex data that will be passed to the vertex shader.
-    // Because were hard coding the vertex data directly in the vertex shader, well
-    // fill in this structure to specify that there is no vertex data to load for now.
     // The pVertexBindingDescriptions and pVertexAttributeDescriptions
     // members point to an array of structs that describe the aforementioned details
-    // for loading vertex data.
+    // for loading vertex data. They are built from the vertex layout (see vk_mesh.hpp).
+    // The inputs of the vertex shader are read back from its bytecode (see vk_shaders.hpp):
+    // a layout missing one of them is an error here rather than garbage on screen, and
+    // a description without a layout gets the one the shader asks for.
+    ShaderReflection vert_shader_reflection = reflect_shader(vert_shader_bytecode, desc.vert_shader_file);
+    VertexLayout vertex_layout = desc.vertex_layout;
+    if (vertex_layout.bindings.empty()) {
+        vertex_layout = derive_vertex_layout(vert_shader_reflection);
+    }
+    else {
+        check_vertex_layout(vert_shader_reflection, vertex_layout, desc.vert_shader_file);
+    }
+
+    std::vector<VkVertexInputBindingDescription> binding_descriptions;
+    std::vector<VkVertexInputAttributeDescription> attribute_descriptions;
+    build_vertex_input_descriptions(vertex_layout, binding_descriptions, attribute_descriptions);
+
     VkPipelineVertexInputStateCreateInfo vertex_input_create_info{};
     vertex_input_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-    vertex_input_create_info.vertexBindingDescriptionCount = 0;
-    vertex_input_create_info.pVertexBindingDescriptions = nullptr;
-    vertex_input_create_info.vertexAttributeDescriptionCount = 0;
-    vertex_input_create_info.pVertexAttributeDescriptions = nullptr;
+    vertex_input_create_info.vertexBindingDescriptionCount = static_cast<uint32_t>(binding_descriptions.size());
+    vertex_input_create_info.pVertexBindingDescriptions = binding_descriptions.data();
+    vertex_input_create_info.vertexAttributeDescriptionCount = static_cast<uint32_t>(attribute_descriptions.size());
+    vertex_input_create_info.pVertexAttributeDescriptions = attribute_descriptions.data();
 
     // The VkPipelineInputAssemblyStateCreateInfo struct describes two things:
     // what kind of geometry will be drawn from the vertices and if primitive restart
@@ -87,39 +224,12 @@ void create_graphics_pipeline(
     // following data for the structure :
     VkPipelineInputAssemblyStateCreateInfo input_assembly_create_info{};
     input_assembly_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-    input_assembly_create_info.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    input_assembly_create_info.topology = desc.topology;
     input_assembly_create_info.primitiveRestartEnable = VK_FALSE;
 
-    // A viewport describes the region of the framebuffer that the output
-    // will be rendered to. This will almost always be (0, 0) to (width, height)
-    // and in this tutorial will also be the case.
-    // Remember that the size of the swapchain and its images may differ from the WIDTH
-    // and HEIGHT of the window. The swapchain images will be used as framebuffers later on,
-    // so we should stick to their size.
-    // The minDepth and maxDepth values specify the range of depth values to use
-    // the framebuffer.These values must be within the[0.0f, 1.0f] range, but
-    // minDepth may be higher than maxDepth.If you arent doing anything special,
-    // then you should stick to the standard values of 0.0f and 1.0f.
-    VkViewport viewport{};
-    viewport.x = 0.0f;
-    viewport.y = 0.0f;
-    viewport.width = (float)vk_swapchain_extent.width;
-    viewport.height = (float)vk_swapchain_extent.height;
-    viewport.minDepth = 0.0f;
-    viewport.maxDepth = 1.0f;
-
-    // While viewports define the transformation from the image to the framebuffer,
-    // scissor rectangles define in which regions pixels will actually be stored.
-    // Any pixels outside the scissor rectangles will be discarded by the rasterizer.
-    // They function like a filter rather than a transformation.
-    // If we want to draw to the entire framebuffer we should specify a scissor
-    // rectangle that covers it entirely.
-    VkRect2D scissor{};
-    scissor.offset = { 0, 0 };
-    scissor.extent = vk_swapchain_extent;
-
     // Most of the times viewport and scissor are set as dynamic state in the command buffer
-    // rather than as a static part of the pipeline.
+    // rather than as a static part of the pipeline (see record_draws()). This also keeps
+    // the pipeline independent of the swapchain extent, so it survives a resize.
     dynamic_state = {
        VK_DYNAMIC_STATE_VIEWPORT,
        VK_DYNAMIC_STATE_SCISSOR
@@ -142,7 +252,6 @@ void create_graphics_pipeline(
     viewport_state_create_info.scissorCount = 1;
     // viewport_state_create_info.pScissors = &scissor;
 
-    std::cout << "\t\t Creating Vulkan Rasterizer... \n";
     // The rasterizer takes the geometry that is shaped by the vertices from the
     // vertex shader and turns it into fragments to be colored by the fragment shader.
     VkPipelineRasterizationStateCreateInfo rasterizer_create_info{};
@@ -155,26 +264,40 @@ void create_graphics_pipeline(
 
     // Determines how fragments are generated from geometry.
     // Fill the area of the polygon with fragments.
-    rasterizer_create_info.polygonMode = VK_POLYGON_MODE_FILL;
+    rasterizer_create_info.polygonMode = desc.polygon_mode;
     rasterizer_create_info.lineWidth = 1.0f; // thickness of line in terms of number of fragments
-    rasterizer_create_info.cullMode = VK_CULL_MODE_BACK_BIT; // enables back-face culling
+    rasterizer_create_info.cullMode = desc.cull_mode; // VK_CULL_MODE_BACK_BIT enables back-face culling
 
     // Specifies the vertex order for faces to be considered front-facing
     // and can be clockwise/counterclockwise.
-    rasterizer_create_info.frontFace = VK_FRONT_FACE_CLOCKWISE;
+    rasterizer_create_info.frontFace = desc.front_face;
     rasterizer_create_info.depthBiasEnable = VK_FALSE;
-    std::cout << "\t\t Vulkan Rasterizer created. \n\n";
 
 
     // Multisampling is one of the ways to perform anti-aliasing. It works by combining
     // the fragment shader results of multiple polygons that rasterize to the same pixel.
     // This mainly occurs around edges, which is also where the most noticeable aliasing
     // artifacts occur.
-    // For now we will keep it disabled, and revisit it later.
+    // The sample count must match the attachments of the pass (see get_pass_samples()),
+    // the fragment shader still runs once per pixel (no sample shading), only the coverage
+    // and the depth test are per sample.
     VkPipelineMultisampleStateCreateInfo multisampling_create_info{};
     multisampling_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
     multisampling_create_info.sampleShadingEnable = VK_FALSE;
-    multisampling_create_info.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+    multisampling_create_info.rasterizationSamples = desc.rasterization_samples;
+
+    // The depth test keeps the fragment closest to the camera. It runs before the fragment
+    // shader (early fragment tests) as long as the shader doesn't discard or write depth,
+    // so a fragment hidden by something already drawn costs no shading: drawing the opaque
+    // geometry front to back (see vk_draw_sort.hpp) makes most hidden fragments fail early.
+    // LESS_OR_EQUAL: draws at the same depth still overwrite each other in draw order.
+    VkPipelineDepthStencilStateCreateInfo depth_stencil_create_info{};
+    depth_stencil_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depth_stencil_create_info.depthTestEnable = VK_TRUE;
+    depth_stencil_create_info.depthWriteEnable = desc.depth_write ? VK_TRUE : VK_FALSE;
+    depth_stencil_create_info.depthCompareOp = desc.depth_compare_op;
+    depth_stencil_create_info.depthBoundsTestEnable = VK_FALSE;
+    depth_stencil_create_info.stencilTestEnable = VK_FALSE;
 
     // After a fragment shader has returned a color, it needs to be combined with the color
     // already present in the framebuffer.
@@ -188,7 +311,15 @@ void create_graphics_pipeline(
         VK_COLOR_COMPONENT_G_BIT |
         VK_COLOR_COMPONENT_B_BIT |
         VK_COLOR_COMPONENT_A_BIT;
-    color_blend_attachment.blendEnable = VK_FALSE;
+    color_blend_attachment.blendEnable = desc.blend_enable ? VK_TRUE : VK_FALSE;
+
+    // finalColor.rgb = newAlpha * newColor + (1 - newAlpha) * oldColor
+    color_blend_attachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+    color_blend_attachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+    color_blend_attachment.colorBlendOp = VK_BLEND_OP_ADD;
+    color_blend_attachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+    color_blend_attachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+    color_blend_attachment.alphaBlendOp = VK_BLEND_OP_ADD;
 
     // The second structure references the array of structures for all of the framebuffers
     VkPipelineColorBlendStateCreateInfo color_blending_create_info{};
@@ -203,8 +334,11 @@ void create_graphics_pipeline(
     // These uniform values need to be specified during pipeline creation by creating a
     // VkPipelineLayout object.Even though we wont be using them until a future
     // chapter, we are still required to create an empty pipeline layout.
+    // The set layouts describe the descriptor sets the shaders read (see vk_descriptors.hpp).
     VkPipelineLayoutCreateInfo pipeline_layout_create_info{};
     pipeline_layout_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipeline_layout_create_info.setLayoutCount = static_cast<uint32_t>(desc.set_layouts.size());
+    pipeline_layout_create_info.pSetLayouts = desc.set_layouts.data();
 
     if (vkCreatePipelineLayout(
         vk_logic_device,
@@ -215,7 +349,7 @@ void create_graphics_pipeline(
         throw std::runtime_error("Failed to create Vulkan Pipeline Layout! \n");
     }
 
-    std::cout << "\t Vulkan Pipeline Layout created. \n\n";
+    LOG_DEBUG("\t Vulkan Pipeline Layout created.");
 
     // We create the Graphics pipeline using all the previously built
     // structs describing the fixed-function stage.
@@ -228,48 +362,62 @@ void create_graphics_pipeline(
     graphics_pipeline_create_info.pViewportState = &viewport_state_create_info;
     graphics_pipeline_create_info.pRasterizationState = &rasterizer_create_info;
     graphics_pipeline_create_info.pMultisampleState = &multisampling_create_info;
-    graphics_pipeline_create_info.pDepthStencilState = nullptr;
+    graphics_pipeline_create_info.pDepthStencilState =
+        desc.depth_format != VK_FORMAT_UNDEFINED ? &depth_stencil_create_info : nullptr;
     graphics_pipeline_create_info.pColorBlendState = &color_blending_create_info;
     graphics_pipeline_create_info.pDynamicState = &dynamic_state_create_info;
 
     graphics_pipeline_create_info.layout = vk_pipeline_layout;
-    graphics_pipeline_create_info.renderPass = vk_render_pass;
+    graphics_pipeline_create_info.renderPass = desc.render_pass;
     // index of the subpass where the graphics pipeline will be used
     graphics_pipeline_create_info.subpass = 0;
 
-    if (vkCreateGraphicsPipelines(
+    // Without a render pass (dynamic rendering) the pipeline is told the formats of the
+    // attachments it will draw into instead.
+    VkPipelineRenderingCreateInfo rendering_create_info{};
+    if (desc.render_pass == VK_NULL_HANDLE) {
+        rendering_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+        rendering_create_info.colorAttachmentCount = static_cast<uint32_t>(desc.color_formats.size());
+        rendering_create_info.pColorAttachmentFormats = desc.color_formats.data();
+        rendering_create_info.depthAttachmentFormat = desc.depth_format;
+        rendering_create_info.stencilAttachmentFormat = has_stencil_component(desc.depth_format) ? desc.depth_format : VK_FORMAT_UNDEFINED;
+        graphics_pipeline_create_info.pNext = &rendering_create_info;
+    }
+
+    // The pipeline cache lets the driver skip the compilation of pipelines
+    // it has already seen, in this run or (since it is saved to disk) in a previous one.
+    trace_begin("vkCreateGraphicsPipelines");
+    VkResult pipeline_result = vkCreateGraphicsPipelines(
         vk_logic_device,
-        VK_NULL_HANDLE,
+        vk_pipeline_cache,
         1,
         &graphics_pipeline_create_info,
         nullptr,
-        &vk_graphics_pipeline) != VK_SUCCESS) {
+        &vk_graphics_pipeline);
+    trace_end("vkCreateGraphicsPipelines");
 
+    if (pipeline_result != VK_SUCCESS) {
         throw std::runtime_error("Failed to create Vulkan Graphics Pipeline! \n");
     }
 
-    std::cout << "Vulkan Graphics Pipeline created. \n\n";
-
     // We can destroy the shader modules as soon as the pipeline
-    // is finished.
-    std::cout << "Destroying shader modules... \n\n";
-    vkDestroyShaderModule(vk_logic_device, vert_shader_module, nullptr);
-    vkDestroyShaderModule(vk_logic_device, frag_shader_module, nullptr);
+    // is finished: the guards do it on return.
+    LOG_DEBUG("Vulkan Graphics Pipeline created (%s, %s).", desc.vert_shader_file.c_str(), desc.frag_shader_file.c_str());
 }
 
 
 // Before we can pass the code to the pipeline,
 // we have to wrap it in a VkShaderModule object.
-VkShaderModule create_shader_module(const std::vector<char>& shader_code, VkDevice vk_logic_device) {
+VkShaderModule create_shader_module(const ShaderBytecode& shader_code, VkDevice vk_logic_device) {
+
+    TRACE_SCOPE("create_shader_module");
 
     VkShaderModuleCreateInfo shader_module_create_info{};
     shader_module_create_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    shader_module_create_info.codeSize = shader_code.size();
-    // The size of the shader bytecode (a char specified in bytes) is different from the bytecode pointer
-    // (a uint32_t) so we need to cast it with reinterpret_cast.
-    // Technically with a cast like this we should also need to ensure data satisfies the 
-    // alignment requirement of uint32_t, but the std::vector default allocator already ensures it.
-    shader_module_create_info.pCode = reinterpret_cast<const uint32_t*>(shader_code.data());
+    // codeSize is in bytes, while the bytecode is already a stream of uint32_t words:
+    // no cast, and no alignment to worry about.
+    shader_module_create_info.codeSize = shader_code.size() * sizeof(uint32_t);
+    shader_module_create_info.pCode = shader_code.data();
 
     VkShaderModule shader_module;
 
@@ -286,126 +434,12 @@ VkShaderModule create_shader_module(const std::vector<char>& shader_code, VkDevi
 }
 
 
-void create_render_pass(VkRenderPass& vk_render_pass, VkDevice vk_logic_device, VkFormat& vk_swapchain_image_format) {
-
-    std::cout << "Creating Vulkan Render pass... \n";
-
-    // We need to specify the framebuffer attachments that will be used while
-    // rendering. We need to specify how many color and depth buffers there will be.
-    // How many samples to use for each of them and how their contents should be handled 
-    // throughout the rendering operations. This informations are wrapped in a render pass object.
-    // In our case we will have just a single color buffer attachment represented by one of the
-    // images from the swapchain.
-    VkAttachmentDescription color_attachment{};
-    color_attachment.format = vk_swapchain_image_format;
-    color_attachment.samples = VK_SAMPLE_COUNT_1_BIT; // we are not doing anything with multisampling
-
-    // This are for color and depth data.
-    // What to do before rendering, in our case clear the framebuffer 
-    // (sets the window to black)
-    color_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    // What to do after rendering, in our case render the triangle to screen (store it in the framebuffer)
-    color_attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-
-    // This are for stencil data. We are not doing anything with stencils
-    // so we set it in the following way:
-    color_attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-    color_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-
-    // Which layout the image will have before render pass begins.
-    // We do not care what the previous layout the image was.
-    color_attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-
-    // Which layout the image will have after render pass finishes.
-    // We want the image to be ready for presentation using the swapchain
-    // after rendering.
-    color_attachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-
-    // A single render pass can consist of multiple subpasses. Subpasses are subsequent
-    // rendering operations that depend on the contents of framebuffers in previous
-    // passes, for example a sequence of post - processing effects that are applied one
-    // after another. In our case we will stick to a single subpass.
-    // Every subpass references one or more of the attachments that weve described.
-    VkAttachmentReference color_attachment_reference{};
-
-    // Specifies which attachment to reference by its
-    // index in the attachment descriptions array.Our array consists of a single
-    // VkAttachmentDescription, so its index is 0.
-    color_attachment_reference.attachment = 0;
-
-    // Specifies which layout we would like the attachment to have during a subpass that uses this
-    // reference. We intend to use the attachment to function as a color buffer and
-    // the VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL layout will give us the best performance,
-    color_attachment_reference.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-    VkSubpassDescription subpass{};
-    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-    subpass.colorAttachmentCount = 1;
-    subpass.pColorAttachments = &color_attachment_reference;
-
-    VkRenderPassCreateInfo render_pass_create_info{};
-    render_pass_create_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-    render_pass_create_info.attachmentCount = 1;
-    render_pass_create_info.pAttachments = &color_attachment;
-    render_pass_create_info.subpassCount = 1;
-    render_pass_create_info.pSubpasses = &subpass;
-
-    if (vkCreateRenderPass(
-        vk_logic_device,
-        &render_pass_create_info,
-        nullptr,
-        &vk_render_pass) != VK_SUCCESS) {
-
-        throw std::runtime_error("Failed to create Vulkan Render pass! \n");
-    }
-
-    std::cout << "Vulkan Render pass created. \n\n";
-}
-
-void create_framebuffers(
-    std::vector<VkFramebuffer> vk_swapchain_framebuffers,
-    VkDevice vk_logic_device,
-    VkRenderPass vk_render_pass,
-    std::vector<VkImageView> vk_swapchain_image_views, VkExtent2D vk_swapchain_extent) {
-
-    std::cout << "Creating Vulkan Swapchain framebuffers... \n\n";
-
-    vk_swapchain_framebuffers.resize(vk_swapchain_image_views.size());
-
-    for (size_t i = 0; i < vk_swapchain_image_views.size(); i++) {
-
-        VkImageView attachments[] = { vk_swapchain_image_views[i] };
-
-        // You can only use a framebuffer with the render passes that it is compatible
-        // with, so they roughly use the same number and type of attachments.
-        VkFramebufferCreateInfo framebuffer_create_info{};
-        framebuffer_create_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-        framebuffer_create_info.renderPass = vk_render_pass;
-        framebuffer_create_info.attachmentCount = 1;
-        framebuffer_create_info.pAttachments = attachments;
-        framebuffer_create_info.width = vk_swapchain_extent.width;
-        framebuffer_create_info.height = vk_swapchain_extent.height;
-        framebuffer_create_info.layers = 1; // number of layers in image arrays
-
-        if (vkCreateFramebuffer(
-            vk_logic_device,
-            &framebuffer_create_info,
-            nullptr,
-            &vk_swapchain_framebuffers[i]) != VK_SUCCESS) {
-
-            throw std::runtime_error("Failed to create Vulkan Swapchain framebuffers! \n");
-        }
-    }
-
-    std::cout << "Vulkan Swapchain framebuffers created. \n\n";
-}
-
-
 void create_command_pool(
     VkCommandPool& vk_command_pool,
     VkSurfaceKHR vk_surface,
     VkPhysicalDevice vk_phys_device, VkDevice vk_logic_device) {
     
+    TRACE_SCOPE("create_command_pool");
     std::cout << "Creating Vulkan Command pool... \n\n";
 
     QueueFamilyIndices queue_family_indices = find_queue_families(vk_surface, vk_phys_device);
@@ -435,65 +469,90 @@ void create_command_pool(
 }
 
 
-void create_command_buffer(
-    VkCommandBuffer& vk_command_buffer,
+void create_transfer_command_pool(
+    VkCommandPool& vk_transfer_command_pool,
+    VkSurfaceKHR vk_surface,
+    VkPhysicalDevice vk_phys_device, VkDevice vk_logic_device) {
+
+    TRACE_SCOPE("create_transfer_command_pool");
+    std::cout << "Creating Vulkan Transfer command pool... \n\n";
+
+    QueueFamilyIndices queue_family_indices = find_queue_families(vk_surface, vk_phys_device);
+
+    // The upload command buffers are recorded once, submitted once and freed:
+    // VK_COMMAND_POOL_CREATE_TRANSIENT_BIT tells the driver they are short lived.
+    VkCommandPoolCreateInfo command_pool_create_info{};
+    command_pool_create_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    command_pool_create_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    command_pool_create_info.queueFamilyIndex = queue_family_indices.transfer_family.value();
+
+    if (vkCreateCommandPool(
+        vk_logic_device,
+        &command_pool_create_info,
+        nullptr,
+        &vk_transfer_command_pool) != VK_SUCCESS) {
+
+        throw std::runtime_error("Failed to create Vulkan Transfer command pool! \n");
+    }
+
+    std::cout << "Vulkan Transfer command pool created. \n\n";
+}
+
+
+void create_command_buffers(
+    std::vector<FrameData>& frames,
     VkCommandPool vk_command_pool,
     VkDevice vk_logic_device) {
     
+    TRACE_SCOPE("create_command_buffers");
     std::cout << "Creating Vulkan Command buffer(s)... \n\n";
 
+    // Every frame in flight gets its own command buffer: while the GPU is still
+    // executing the command buffer of the previous frame, we can already record
+    // the next one without waiting.
+    std::vector<VkCommandBuffer> command_buffers(frames.size());
+
     VkCommandBufferAllocateInfo command_buffer_allocate_info{};
     command_buffer_allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
     command_buffer_allocate_info.commandPool = vk_command_pool;
     command_buffer_allocate_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    command_buffer_allocate_info.commandBufferCount = 1; // we only use 1 command buffer
+    command_buffer_allocate_info.commandBufferCount = static_cast<uint32_t>(command_buffers.size());
 
     if (vkAllocateCommandBuffers(
             vk_logic_device,
             &command_buffer_allocate_info,
-            &vk_command_buffer) != VK_SUCCESS) {
+            command_buffers.data()) != VK_SUCCESS) {
     
         throw std::runtime_error("Failed to allocate Vulkan Command buffer(s)! \n");
     }
 
+    for (size_t i = 0; i < frames.size(); i++) {
+        frames[i].command_buffer = command_buffers[i];
+    }
+
     std::cout << "Vulkan Command buffer(s) created. \n\n";
 }
 
 
 
-void record_command_buffer(
+void record_draw_state(
     VkCommandBuffer vk_command_buffer,
     VkPipeline vk_graphics_pipeline,
+    VkPipelineLayout vk_pipeline_layout,
+    VkDescriptorSet vk_frame_descriptor_set, uint32_t frame_uniforms_offset,
     VkExtent2D vk_swapchain_extent,
-    VkRenderPass vk_render_pass,
-    std::vector<VkFramebuffer> vk_swapchain_framebuffers,
-    uint32_t swapchain_image_index) {
-
-    std::cout << "Begin recording command buffer(s). \n\n";
-
-    VkCommandBufferBeginInfo command_buffer_begin_info{};
-    command_buffer_begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-
-    if (vkBeginCommandBuffer(vk_command_buffer, &command_buffer_begin_info) != VK_SUCCESS) {
-       
-        throw std::runtime_error("Failed to begin recording command buffer(s)! \n");
-    }
-
-    VkRenderPassBeginInfo render_pass_begin_info{};
-    render_pass_begin_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-    render_pass_begin_info.renderPass = vk_render_pass;
-    render_pass_begin_info.framebuffer = vk_swapchain_framebuffers[swapchain_image_index];
-    render_pass_begin_info.renderArea.offset = {0, 0};
-    render_pass_begin_info.renderArea.extent = vk_swapchain_extent;
-
-    VkClearValue clear_color = { { {1.0f, 1.0f, 1.0f, 1.0f} } };
-    render_pass_begin_info.clearValueCount = 1;
-    render_pass_begin_info.pClearValues = &clear_color;
-
-    vkCmdBeginRenderPass(vk_command_buffer, &render_pass_begin_info, VK_SUBPASS_CONTENTS_INLINE);
+    const Mesh& mesh) {
 
     vkCmdBindPipeline(vk_command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vk_graphics_pipeline);
 
+    // The per-frame data (set 0) stays bound for every draw. The descriptor points to the
+    // uniform ring buffer, the dynamic offset selects the block of this frame.
+    vkCmdBindDescriptorSets(
+        vk_command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+        vk_pipeline_layout,
+        0, 1, &vk_frame_descriptor_set,
+        1, &frame_uniforms_offset);
+
     // A viewport describes the region of the framebuffer that the output
    // will be rendered to. This will almost always be (0, 0) to (width, height)
    // and in this tutorial will also be the case.
@@ -524,15 +583,150 @@ void record_command_buffer(
     scissor.extent = vk_swapchain_extent;
     vkCmdSetScissor(vk_command_buffer, 0, 1, &scissor);
 
-    // Draw command for the triangle!
-    vkCmdDraw(vk_command_buffer, 3, 1, 0, 0);
+    // The vertex buffer is bound to binding 0 of the vertex layout, the index
+    // buffer selects which of its vertices make up each triangle.
+    VkBuffer vertex_buffers[] = { mesh.vertex_buffer };
+    VkDeviceSize vertex_offsets[] = { 0 };
+    vkCmdBindVertexBuffers(vk_command_buffer, 0, 1, vertex_buffers, vertex_offsets);
+    vkCmdBindIndexBuffer(vk_command_buffer, mesh.index_buffer, 0, mesh.index_type);
+}
+
+
+void record_draws(
+    VkCommandBuffer vk_command_buffer,
+    VkPipeline vk_graphics_pipeline,
+    VkPipelineLayout vk_pipeline_layout,
+    VkDescriptorSet vk_frame_descriptor_set, uint32_t frame_uniforms_offset,
+    VkExtent2D vk_swapchain_extent,
+    const Mesh& mesh,
+    const FrameInstances* instances,
+    const uint32_t* draw_order,
+    uint32_t first_draw, uint32_t draws_count) {
+
+    record_draw_state(
+        vk_command_buffer,
+        vk_graphics_pipeline, vk_pipeline_layout,
+        vk_frame_descriptor_set, frame_uniforms_offset,
+        vk_swapchain_extent,
+        mesh);
+
+    if (instances == nullptr) {
+        // Draw commands for the mesh!
+        for (uint32_t i = first_draw; i < first_draw + draws_count; i++) {
+            const DrawCommand& draw = mesh.draws[draw_order != nullptr ? draw_order[i] : i];
+            vkCmdDrawIndexed(vk_command_buffer, draw.index_count, 1, draw.first_index, 0, 0);
+        }
+        return;
+    }
+
+    bind_instance_streams(vk_command_buffer, *instances);
+
+    for (uint32_t i = first_draw; i < first_draw + draws_count; i++) {
+
+        const DrawCommand& draw = mesh.draws[draw_order != nullptr ? draw_order[i] : i];
+
+        if (instances->draw_per_instance) {
+            // firstInstance selects the element of the instance streams.
+            for (uint32_t instance = 0; instance < instances->count; instance++) {
+                vkCmdDrawIndexed(vk_command_buffer, draw.index_count, 1, draw.first_index, 0, instance);
+            }
+        }
+        else {
+            vkCmdDrawIndexed(vk_command_buffer, draw.index_count, instances->count, draw.first_index, 0, 0);
+        }
+    }
+}
+
+
 
-    vkCmdEndRenderPass(vk_command_buffer);
+void record_main_pass(
+    VkCommandBuffer vk_command_buffer,
+    VkPipeline vk_graphics_pipeline,
+    VkPipelineLayout vk_pipeline_layout,
+    VkDescriptorSet vk_frame_descriptor_set, uint32_t frame_uniforms_offset,
+    VkExtent2D vk_swapchain_extent,
+    const Mesh& mesh,
+    const FrameInstances* instances,
+    const FrameCulling* frame_culling,
+    const uint32_t* draw_order,
+    const std::vector<VkCommandBuffer>& vk_secondary_command_buffers) {
+
+    // With secondary command buffers the draws were recorded by the worker threads
+    // (see vk_parallel_record.hpp), the render pass only executes them.
+    if (!vk_secondary_command_buffers.empty()) {
+
+        vkCmdExecuteCommands(
+            vk_command_buffer,
+            static_cast<uint32_t>(vk_secondary_command_buffers.size()),
+            vk_secondary_command_buffers.data());
+        return;
+    }
+
+    // Until the pipeline is compiled there is nothing to draw with,
+    // but the frame can still be presented (see vk_pipeline_compiler.hpp).
+    if (vk_graphics_pipeline == VK_NULL_HANDLE) {
+        return;
+    }
+
+    if (frame_culling != nullptr) {
+        record_draw_state(
+            vk_command_buffer,
+            vk_graphics_pipeline, vk_pipeline_layout,
+            vk_frame_descriptor_set, frame_uniforms_offset,
+            vk_swapchain_extent,
+            mesh);
+        record_culled_draws(vk_command_buffer, *frame_culling);
+    }
+    else {
+        record_draws(
+            vk_command_buffer,
+            vk_graphics_pipeline, vk_pipeline_layout,
+            vk_frame_descriptor_set, frame_uniforms_offset,
+            vk_swapchain_extent,
+            mesh, instances, draw_order,
+            0, static_cast<uint32_t>(mesh.draws.size()));
+    }
+}
+
+
+void record_command_buffer(
+    VkCommandBuffer vk_command_buffer,
+    RenderGraph& frame_graph,
+    VkDevice vk_logic_device,
+    VkQueryPool vk_timestamp_query_pool, uint32_t first_timestamp_query) {
+
+    // This runs every frame: no std::cout here, see vk_log.hpp.
+    LOG_TRACE("Begin recording command buffer.");
+
+    VkCommandBufferBeginInfo command_buffer_begin_info{};
+    command_buffer_begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+
+    if (vkBeginCommandBuffer(vk_command_buffer, &command_buffer_begin_info) != VK_SUCCESS) {
+       
+        throw std::runtime_error("Failed to begin recording command buffer(s)! \n");
+    }
+
+    // Timestamps around the passes of the frame (if the profiler has a query pool).
+    // Queries must be reset before being written again, and the reset can't
+    // happen inside a render pass. TOP_OF_PIPE is written as soon as the GPU
+    // starts the command buffer, BOTTOM_OF_PIPE once all the previous work is done.
+    if (vk_timestamp_query_pool != VK_NULL_HANDLE) {
+        vkCmdResetQueryPool(vk_command_buffer, vk_timestamp_query_pool, first_timestamp_query, 2);
+        vkCmdWriteTimestamp(vk_command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, vk_timestamp_query_pool, first_timestamp_query);
+    }
+
+    // The culling dispatch, the render pass and every barrier between them
+    // (and around them, for the swapchain image) come from the graph.
+    execute_render_graph(frame_graph, vk_command_buffer, vk_logic_device);
+
+    if (vk_timestamp_query_pool != VK_NULL_HANDLE) {
+        vkCmdWriteTimestamp(vk_command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, vk_timestamp_query_pool, first_timestamp_query + 1);
+    }
 
     if (vkEndCommandBuffer(vk_command_buffer) != VK_SUCCESS) {
         
         throw std::runtime_error("Failed to record command buffer(s)! \n");
     }
 
-    std::cout << "Finished recording command buffer(s). \n\n";
+    LOG_TRACE("Finished recording command buffer.");
 }
\ No newline at end of file
@@ -1,28 +1,70 @@
 #pragma once
 
 #include "my_utils.hpp"
+#include "vk_frame.hpp"
+#include "vk_mesh.hpp"
+#include "vk_shaders.hpp"
+#include "job_system.hpp"
 
+struct FrameCulling; // vk_culling.hpp
+struct FrameInstances; // vk_instancing.hpp
+struct RenderGraph; // vk_render_graph.hpp
 
-void create_graphics_pipeline(
-    VkPipeline& vk_graphics_pipeline, VkPipelineLayout& vk_pipeline_layout,
-    VkDevice vk_logic_device,
-    VkRenderPass vk_render_pass,
-    VkExtent2D vk_swapchain_extent);
 
+// Everything a graphics pipeline is built from, instead of Vulkan create infos full
+// of pointers: two descriptions that compare equal give the same pipeline, so the
+// pipeline compiler can hand out the pipeline it already has (see vk_pipeline_compiler.hpp).
+// The defaults are the state of the demo pipeline.
+// Viewport and scissor are dynamic state, they are not part of the description.
+struct GraphicsPipelineDesc {
 
-// Before we can pass the code to the pipeline,
-// we have to wrap it in a VkShaderModule object.
-VkShaderModule create_shader_module(const std::vector<char>& shader_code, VkDevice vk_logic_device);
+    std::string vert_shader_file = "vert.spv";
+    std::string frag_shader_file = "frag.spv";
+    VertexLayout vertex_layout;
+
+    VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    VkPolygonMode polygon_mode = VK_POLYGON_MODE_FILL;
+    VkCullModeFlags cull_mode = VK_CULL_MODE_BACK_BIT;
+    VkFrontFace front_face = VK_FRONT_FACE_CLOCKWISE;
+    VkSampleCountFlagBits rasterization_samples = VK_SAMPLE_COUNT_1_BIT;
+    bool blend_enable = false; // Alpha blending (src * alpha + dst * (1 - alpha))
+
+    // Depth test and write against the depth attachment of the pass.
+    // VK_FORMAT_UNDEFINED = the pass has no depth attachment, the pipeline no depth state.
+    VkFormat depth_format = VK_FORMAT_UNDEFINED;
+    bool depth_write = true;
+    VkCompareOp depth_compare_op = VK_COMPARE_OP_LESS_OR_EQUAL;
 
+    // Set layouts of the pipeline layout, by set number. They come from the layout
+    // cache (see vk_descriptors.hpp), so equal layouts are the same handle.
+    std::vector<VkDescriptorSetLayout> set_layouts;
 
-void create_render_pass(VkRenderPass& vk_render_pass, VkDevice vk_logic_device, VkFormat& vk_swapchain_image_format);
+    // The pipeline is drawn in subpass 0 of render_pass, or with dynamic rendering
+    // (render_pass VK_NULL_HANDLE) into attachments of color_formats.
+    VkRenderPass render_pass = VK_NULL_HANDLE;
+    std::vector<VkFormat> color_formats;
+};
 
+bool operator==(const GraphicsPipelineDesc& a, const GraphicsPipelineDesc& b);
 
-void create_framebuffers(
-    std::vector<VkFramebuffer> vk_swapchain_framebuffers,
+// 64 bit FNV-1a hash of every field of the description. Hashing walks the strings and
+// the vertex layout, so hash a description once and keep the hash with it.
+uint64_t hash_pipeline_desc(const GraphicsPipelineDesc& desc);
+
+
+// Compiles the pipeline right away, on the calling thread. To compile pipelines in the
+// background instead, submit them to the pipeline compiler (see vk_pipeline_compiler.hpp).
+void create_graphics_pipeline(
+    VkPipeline& vk_graphics_pipeline, VkPipelineLayout& vk_pipeline_layout,
     VkDevice vk_logic_device,
-    VkRenderPass vk_render_pass,
-    std::vector<VkImageView> vk_swapchain_image_views, VkExtent2D vk_swapchain_extent);
+    VkPipelineCache vk_pipeline_cache,
+    const GraphicsPipelineDesc& desc,
+    JobSystem& job_system);
+
+
+// Before we can pass the code to the pipeline,
+// we have to wrap it in a VkShaderModule object.
+VkShaderModule create_shader_module(const ShaderBytecode& shader_code, VkDevice vk_logic_device);
 
 
 void create_command_pool(
@@ -31,10 +73,74 @@ void create_command_pool(
     VkPhysicalDevice vk_phys_device, VkDevice vk_logic_device);
 
 
-void create_command_buffer(
-    VkCommandBuffer& vk_command_buffer,
+// Command pool of the transfer queue family, for the short lived upload command buffers.
+void create_transfer_command_pool(
+    VkCommandPool& vk_transfer_command_pool,
+    VkSurfaceKHR vk_surface,
+    VkPhysicalDevice vk_phys_device, VkDevice vk_logic_device);
+
+
+// Allocates one command buffer for every frame in flight.
+void create_command_buffers(
+    std::vector<FrameData>& frames,
     VkCommandPool vk_command_pool,
     VkDevice vk_logic_device);
 
 
-void record_command_buffer();
\ No newline at end of file
+// Binds the pipeline, the frame descriptor set (set 0, with the offset of the frame
+// uniforms in the uniform ring), the dynamic state and the mesh buffers.
+void record_draw_state(
+    VkCommandBuffer vk_command_buffer,
+    VkPipeline vk_graphics_pipeline,
+    VkPipelineLayout vk_pipeline_layout,
+    VkDescriptorSet vk_frame_descriptor_set, uint32_t frame_uniforms_offset,
+    VkExtent2D vk_swapchain_extent,
+    const Mesh& mesh);
+
+
+// record_draw_state(), then draws_count draws of the draw list of the mesh starting at first_draw.
+// With draw_order (not nullptr) the i-th draw recorded is mesh.draws[draw_order[i]]
+// instead of mesh.draws[i] (see vk_draw_sort.hpp).
+// With instances (not nullptr) the instance streams are bound too and every draw is
+// drawn once per instance (see vk_instancing.hpp).
+// Used for the inline draws and for every secondary command buffer (they don't
+// inherit any state from the primary command buffer).
+void record_draws(
+    VkCommandBuffer vk_command_buffer,
+    VkPipeline vk_graphics_pipeline,
+    VkPipelineLayout vk_pipeline_layout,
+    VkDescriptorSet vk_frame_descriptor_set, uint32_t frame_uniforms_offset,
+    VkExtent2D vk_swapchain_extent,
+    const Mesh& mesh,
+    const FrameInstances* instances,
+    const uint32_t* draw_order,
+    uint32_t first_draw, uint32_t draws_count);
+
+
+// The contents of the main render pass (recorded by the render graph, between
+// vkCmdBeginRenderPass() and vkCmdEndRenderPass()).
+// If vk_secondary_command_buffers is empty the draws are recorded inline, otherwise they
+// are executed: the pass must then have been begun with SECONDARY_COMMAND_BUFFERS.
+// With frame_culling (not nullptr) the draws are the indirect draws of the culled draw list,
+// otherwise they are recorded in draw_order (nullptr = the order of the draw list).
+// A VK_NULL_HANDLE pipeline (still compiling) records no draws, the frame is only cleared.
+void record_main_pass(
+    VkCommandBuffer vk_command_buffer,
+    VkPipeline vk_graphics_pipeline,
+    VkPipelineLayout vk_pipeline_layout,
+    VkDescriptorSet vk_frame_descriptor_set, uint32_t frame_uniforms_offset,
+    VkExtent2D vk_swapchain_extent,
+    const Mesh& mesh,
+    const FrameInstances* instances,
+    const FrameCulling* frame_culling,
+    const uint32_t* draw_order,
+    const std::vector<VkCommandBuffer>& vk_secondary_command_buffers);
+
+
+// Records the whole frame: the passes of the frame graph (see vk_render_graph.hpp), whose
+// imported resources must be bound for this frame, between the profiler timestamps.
+void record_command_buffer(
+    VkCommandBuffer vk_command_buffer,
+    RenderGraph& frame_graph,
+    VkDevice vk_logic_device,
+    VkQueryPool vk_timestamp_query_pool, uint32_t first_timestamp_query);
\ No newline at end of file
@@ -0,0 +1,148 @@
+#include "vk_instancing.hpp"
+#include "vk_buffer.hpp"
+
+#include <cmath> // std::ceil | std::sqrt | std::sin | std::cos
+
+
+VertexLayout get_instanced_vertex_layout() {
+
+    VertexLayout layout = Vertex::get_layout();
+
+    // The columns of the transform, one vec4 attribute each.
+    VertexBindingLayout transform_binding;
+    transform_binding.stride = sizeof(glm::mat4);
+    transform_binding.input_rate = VK_VERTEX_INPUT_RATE_INSTANCE;
+    for (uint32_t column = 0; column < 4; column++) {
+        transform_binding.attributes.push_back({
+            INSTANCE_TRANSFORM_LOCATION + column,
+            VK_FORMAT_R32G32B32A32_SFLOAT,
+            static_cast<uint32_t>(column * sizeof(glm::vec4)) });
+    }
+
+    VertexBindingLayout color_binding;
+    color_binding.stride = sizeof(glm::vec4);
+    color_binding.input_rate = VK_VERTEX_INPUT_RATE_INSTANCE;
+    color_binding.attributes.push_back({ INSTANCE_COLOR_LOCATION, VK_FORMAT_R32G32B32A32_SFLOAT, 0 });
+
+    // The index of a binding in the vector is its binding number: Vertex is binding 0.
+    layout.bindings.push_back(transform_binding);
+    layout.bindings.push_back(color_binding);
+
+    return layout;
+}
+
+
+void create_instance_buffers(
+    InstanceBuffers& instances,
+    MemoryAllocator& allocator, VkDevice vk_logic_device,
+    uint32_t max_instances, uint32_t frames_in_flight) {
+
+    TRACE_SCOPE("create_instance_buffers");
+    std::cout << "Creating Instance buffers... \n\n";
+
+    instances.max_instances = max_instances;
+    instances.colors_offset = sizeof(glm::mat4) * static_cast<VkDeviceSize>(max_instances);
+
+    // Regions start on a 256 bytes boundary, which suits any attribute format.
+    VkDeviceSize streams_size = instances.colors_offset + sizeof(glm::vec4) * static_cast<VkDeviceSize>(max_instances);
+    instances.region_size = (streams_size + 255) & ~static_cast<VkDeviceSize>(255);
+
+    // Coherent: the writes through the mapped pointer need no flush.
+    create_buffer(
+        instances.buffer, instances.allocation,
+        allocator, vk_logic_device,
+        instances.region_size * frames_in_flight,
+        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+    std::cout << "\t Instances: " << max_instances << " ("
+        << instances.region_size / 1024 << " KB x " << frames_in_flight << " frame(s) in flight). \n\n";
+}
+
+
+void destroy_instance_buffers(InstanceBuffers& instances, MemoryAllocator& allocator, VkDevice vk_logic_device) {
+
+    destroy_buffer(instances.buffer, instances.allocation, allocator, vk_logic_device);
+    instances.max_instances = 0;
+}
+
+
+InstanceStreams get_instance_streams(const InstanceBuffers& instances, uint32_t frame_index, uint32_t count) {
+
+    uint8_t* region = static_cast<uint8_t*>(instances.allocation.mapped) + frame_index * instances.region_size;
+
+    InstanceStreams streams;
+    streams.transforms = reinterpret_cast<glm::mat4*>(region);
+    streams.colors = reinterpret_cast<glm::vec4*>(region + instances.colors_offset);
+    streams.count = count;
+    return streams;
+}
+
+
+FrameInstances get_frame_instances(
+    const InstanceBuffers& instances,
+    uint32_t frame_index, uint32_t count,
+    bool draw_per_instance) {
+
+    FrameInstances frame_instances;
+    frame_instances.buffer = instances.buffer;
+    frame_instances.transforms_offset = frame_index * instances.region_size;
+    frame_instances.colors_offset = frame_instances.transforms_offset + instances.colors_offset;
+    frame_instances.count = count;
+    frame_instances.draw_per_instance = draw_per_instance;
+    return frame_instances;
+}
+
+
+void animate_instance_grid(const InstanceStreams& streams, float time_s, JobSystem& job_system) {
+
+    TRACE_SCOPE("animate_instance_grid");
+
+    uint32_t cells_per_side = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(streams.count))));
+    float cell_size = 2.0f / cells_per_side;
+
+    // The quad spans 1 x 1, a little smaller than the cell so that the instances don't touch.
+    float scale = cell_size * 0.8f;
+
+    JobCounter counter;
+    run_parallel_for(job_system, streams.count, 4096, [&](uint32_t begin, uint32_t end) {
+
+        // Each stream is written in its own loop, sequentially.
+        for (uint32_t i = begin; i < end; i++) {
+
+            uint32_t column = i % cells_per_side;
+            uint32_t row = i / cells_per_side;
+
+            float angle = time_s + i * 0.1f;
+            float cos_scaled = std::cos(angle) * scale;
+            float sin_scaled = std::sin(angle) * scale;
+
+            // Rotation and scale around z, then the translation to the center of the cell.
+            glm::mat4& transform = streams.transforms[i];
+            transform = glm::mat4(1.0f);
+            transform[0][0] = cos_scaled;
+            transform[0][1] = sin_scaled;
+            transform[1][0] = -sin_scaled;
+            transform[1][1] = cos_scaled;
+            transform[3][0] = -1.0f + cell_size * (column + 0.5f);
+            transform[3][1] = -1.0f + cell_size * (row + 0.5f);
+        }
+
+        for (uint32_t i = begin; i < end; i++) {
+
+            float u = static_cast<float>(i % cells_per_side) / cells_per_side;
+            float v = static_cast<float>(i / cells_per_side) / cells_per_side;
+            streams.colors[i] = glm::vec4(0.5f + 0.5f * u, 0.5f + 0.5f * v, 1.0f - 0.5f * u, 1.0f);
+        }
+    }, counter);
+
+    wait_for_counter(job_system, counter);
+}
+
+
+void bind_instance_streams(VkCommandBuffer vk_command_buffer, const FrameInstances& instances) {
+
+    VkBuffer instance_buffers[] = { instances.buffer, instances.buffer };
+    VkDeviceSize instance_offsets[] = { instances.transforms_offset, instances.colors_offset };
+    vkCmdBindVertexBuffers(vk_command_buffer, INSTANCE_TRANSFORM_BINDING, 2, instance_buffers, instance_offsets);
+}
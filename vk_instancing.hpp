@@ -0,0 +1,93 @@
+#pragma once
+
+#include "my_utils.hpp"
+#include "vk_memory.hpp"
+#include "vk_mesh.hpp"
+#include "job_system.hpp"
+
+#include <glm/glm.hpp>
+
+
+// Instanced drawing.
+//
+// Every draw of the mesh is drawn instances_count times by a single vkCmdDrawIndexed()
+// (instanceCount = N). What changes from one instance to the next comes from vertex
+// bindings with VK_VERTEX_INPUT_RATE_INSTANCE: the vertex input fetches the next element
+// of those bindings once per instance, instead of once per vertex.
+//
+// The per-instance data is a structure of arrays: one stream (vertex binding) per
+// attribute, the transforms in binding 1 and the colors in binding 2. The CPU writes
+// every stream sequentially, straight into the mapped buffer, and a stream that isn't
+// touched in a frame costs nothing to the others (an array of structs would interleave
+// them in every cache line).
+//
+// The buffer is host visible with one region per frame in flight, like the uniform ring
+// (see vk_uniform_ring.hpp): the region of a frame is written after waiting for its fence.
+//
+// For comparison the same instances can also be drawn with one draw call per instance
+// (instanceCount = 1, firstInstance = i reads the data of instance i): same GPU work,
+// N times the draw calls.
+
+
+// Bindings and locations of the instance streams (locations 0 and 1 are the vertex).
+// A mat4 attribute takes 4 locations, one per column.
+const uint32_t INSTANCE_TRANSFORM_BINDING = 1;
+const uint32_t INSTANCE_COLOR_BINDING = 2;
+const uint32_t INSTANCE_TRANSFORM_LOCATION = 2; // Locations 2 to 5
+const uint32_t INSTANCE_COLOR_LOCATION = 6;
+
+
+// The vertex layout of Vertex, plus the instance streams.
+VertexLayout get_instanced_vertex_layout();
+
+
+struct InstanceBuffers {
+
+    VkBuffer buffer = VK_NULL_HANDLE;
+    MemoryAllocation allocation;
+
+    uint32_t max_instances = 0;
+    VkDeviceSize region_size = 0;   // Per frame in flight
+    VkDeviceSize colors_offset = 0; // Of the color stream, inside a region (the transforms come first)
+};
+
+// The streams of a frame, pointing into the mapped buffer.
+struct InstanceStreams {
+
+    glm::mat4* transforms;
+    glm::vec4* colors;
+    uint32_t count;
+};
+
+// What the command buffer needs to draw the instances of a frame.
+struct FrameInstances {
+
+    VkBuffer buffer = VK_NULL_HANDLE;
+    VkDeviceSize transforms_offset = 0;
+    VkDeviceSize colors_offset = 0;
+    uint32_t count = 0;
+    bool draw_per_instance = false; // One draw call per instance instead of one instanced draw
+};
+
+
+void create_instance_buffers(
+    InstanceBuffers& instances,
+    MemoryAllocator& allocator, VkDevice vk_logic_device,
+    uint32_t max_instances, uint32_t frames_in_flight);
+
+void destroy_instance_buffers(InstanceBuffers& instances, MemoryAllocator& allocator, VkDevice vk_logic_device);
+
+// The fence of frame_index must have been waited for.
+InstanceStreams get_instance_streams(const InstanceBuffers& instances, uint32_t frame_index, uint32_t count);
+
+FrameInstances get_frame_instances(
+    const InstanceBuffers& instances,
+    uint32_t frame_index, uint32_t count,
+    bool draw_per_instance);
+
+// The instances scene: the instances on a grid covering the view, every one scaled to its
+// cell, spinning with time and tinted by its position. Written with the job system.
+void animate_instance_grid(const InstanceStreams& streams, float time_s, JobSystem& job_system);
+
+// Binds the streams to their vertex bindings.
+void bind_instance_streams(VkCommandBuffer vk_command_buffer, const FrameInstances& instances);
@@ -0,0 +1,260 @@
+#include "vk_log.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdarg> // va_list
+#include <cstdio> // vsnprintf | fwrite
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+
+
+static_assert((LOG_RING_BUFFER_SIZE & (LOG_RING_BUFFER_SIZE - 1)) == 0, "LOG_RING_BUFFER_SIZE must be a power of two");
+
+
+namespace {
+
+    // Bounded MPSC queue (Dmitry Vyukov's design). Every slot has a sequence number:
+    // - sequence == position:     the slot is free for the producer claiming that position
+    // - sequence == position + 1: the slot holds a message for the consumer
+    // Producers claim a position with a CAS on enqueue_position and publish the
+    // message by storing the sequence (release). The single consumer reads it
+    // (acquire) and frees the slot for the next lap of the ring.
+    struct LogSlot {
+
+        std::atomic<size_t> sequence;
+        LogLevel level;
+        char text[LOG_MESSAGE_SIZE];
+    };
+
+    struct LogRingBuffer {
+
+        std::unique_ptr<LogSlot[]> slots;
+
+        // Separate cache lines, producers and consumer don't fight over them.
+        alignas(64) std::atomic<size_t> enqueue_position{ 0 };
+        alignas(64) size_t dequeue_position = 0;
+        alignas(64) std::atomic<size_t> written_count{ 0 };
+        std::atomic<uint64_t> dropped_count{ 0 };
+    };
+
+    LogRingBuffer ring;
+    std::atomic<LogMode> log_mode{ LogMode::Sync };
+    std::atomic<bool> consumer_running{ false };
+    std::thread consumer_thread;
+
+
+    const char* level_prefix(LogLevel level) {
+
+        switch (level) {
+        case LogLevel::Trace: return "[trace] ";
+        case LogLevel::Debug: return "[debug] ";
+        case LogLevel::Warn:  return "[warn] ";
+        case LogLevel::Error: return "[error] ";
+        default:              return "";
+        }
+    }
+
+
+    bool goes_to_stderr(LogLevel level) {
+
+        return level == LogLevel::Warn || level == LogLevel::Error;
+    }
+
+
+    void format_message(char* text, const char* format, va_list args) {
+
+        int length = vsnprintf(text, LOG_MESSAGE_SIZE, format, args);
+        if (length >= static_cast<int>(LOG_MESSAGE_SIZE)) {
+            text[LOG_MESSAGE_SIZE - 4] = '.';
+            text[LOG_MESSAGE_SIZE - 3] = '.';
+            text[LOG_MESSAGE_SIZE - 2] = '.';
+        }
+    }
+
+
+    bool try_push(LogLevel level, const char* format, va_list args) {
+
+        size_t position = ring.enqueue_position.load(std::memory_order_relaxed);
+        LogSlot* slot;
+
+        for (;;) {
+
+            slot = &ring.slots[position & (LOG_RING_BUFFER_SIZE - 1)];
+            size_t sequence = slot->sequence.load(std::memory_order_acquire);
+            intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+
+            if (difference == 0) {
+                // The slot is free, try to claim it.
+                if (ring.enqueue_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            }
+            else if (difference < 0) {
+                // The consumer hasn't freed this slot yet: the ring buffer is full.
+                return false;
+            }
+            else {
+                // Another producer claimed it first.
+                position = ring.enqueue_position.load(std::memory_order_relaxed);
+            }
+        }
+
+        slot->level = level;
+        format_message(slot->text, format, args);
+        slot->sequence.store(position + 1, std::memory_order_release);
+
+        return true;
+    }
+
+
+    // Moves the ready messages into the batches. Returns how many were taken.
+    size_t drain_ring(std::string& out_batch, std::string& err_batch) {
+
+        size_t taken = 0;
+
+        for (;;) {
+
+            LogSlot& slot = ring.slots[ring.dequeue_position & (LOG_RING_BUFFER_SIZE - 1)];
+            size_t sequence = slot.sequence.load(std::memory_order_acquire);
+
+            if (sequence != ring.dequeue_position + 1) {
+                break; // Empty (or the producer of this slot hasn't finished writing yet)
+            }
+
+            std::string& batch = goes_to_stderr(slot.level) ? err_batch : out_batch;
+            batch += level_prefix(slot.level);
+            batch += slot.text;
+            batch += '\n';
+
+            slot.sequence.store(ring.dequeue_position + LOG_RING_BUFFER_SIZE, std::memory_order_release);
+            ring.dequeue_position++;
+            taken++;
+        }
+
+        return taken;
+    }
+
+
+    void write_batches(std::string& out_batch, std::string& err_batch, size_t taken) {
+
+        if (!out_batch.empty()) {
+            fwrite(out_batch.data(), 1, out_batch.size(), stdout);
+            fflush(stdout);
+            out_batch.clear();
+        }
+        if (!err_batch.empty()) {
+            fwrite(err_batch.data(), 1, err_batch.size(), stderr);
+            fflush(stderr);
+            err_batch.clear();
+        }
+
+        ring.written_count.fetch_add(taken, std::memory_order_release);
+    }
+
+
+    void consumer_loop() {
+
+        std::string out_batch;
+        std::string err_batch;
+        out_batch.reserve(64 * 1024);
+
+        while (consumer_running.load(std::memory_order_acquire)) {
+
+            size_t taken = drain_ring(out_batch, err_batch);
+            if (taken == 0) {
+                // Nothing to do. Sleeping instead of waiting on a condition variable
+                // keeps the producers free of any lock.
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                continue;
+            }
+            write_batches(out_batch, err_batch, taken);
+        }
+
+        // Last messages, logged before stop_logger().
+        size_t taken = drain_ring(out_batch, err_batch);
+        write_batches(out_batch, err_batch, taken);
+    }
+}
+
+
+void start_logger(LogMode mode) {
+
+    if (mode == LogMode::Async && !consumer_running.load()) {
+
+        ring.slots = std::make_unique<LogSlot[]>(LOG_RING_BUFFER_SIZE);
+        for (size_t i = 0; i < LOG_RING_BUFFER_SIZE; i++) {
+            ring.slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+
+        // Whatever was written with std::cout so far must come before the log.
+        std::cout.flush();
+
+        consumer_running.store(true, std::memory_order_release);
+        consumer_thread = std::thread(consumer_loop);
+    }
+
+    log_mode.store(mode, std::memory_order_release);
+}
+
+
+void stop_logger() {
+
+    if (!consumer_running.load()) {
+        return;
+    }
+
+    log_mode.store(LogMode::Sync, std::memory_order_release);
+    consumer_running.store(false, std::memory_order_release);
+    consumer_thread.join();
+
+    uint64_t dropped = ring.dropped_count.load();
+    if (dropped > 0) {
+        std::cerr << "\t Logger: " << dropped << " message(s) dropped (ring buffer full). \n";
+    }
+}
+
+
+void flush_log() {
+
+    if (!consumer_running.load(std::memory_order_acquire)) {
+        return;
+    }
+
+    // Every claimed position is either written or dropped, wait for the written ones.
+    size_t target = ring.enqueue_position.load(std::memory_order_acquire);
+    while (ring.written_count.load(std::memory_order_acquire) < target) {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+}
+
+
+LogMode get_log_mode() {
+
+    return log_mode.load(std::memory_order_relaxed);
+}
+
+
+void log_message(LogLevel level, const char* format, ...) {
+
+    va_list args;
+    va_start(args, format);
+
+    if (log_mode.load(std::memory_order_acquire) == LogMode::Async) {
+
+        if (!try_push(level, format, args)) {
+            ring.dropped_count.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    else {
+
+        char text[LOG_MESSAGE_SIZE];
+        format_message(text, format, args);
+
+        std::ostream& stream = goes_to_stderr(level) ? std::cerr : std::cout;
+        stream << level_prefix(level) << text << std::endl;
+    }
+
+    va_end(args);
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+
+// Leveled logger for the paths that run every frame.
+//
+// In async mode (the default) LOG_*() formats the message into a slot of a
+// lock-free multi-producer single-consumer ring buffer and returns: no lock,
+// no allocation, no syscall. A background thread prefixes the messages and
+// writes them out in batches. In sync mode every message goes straight to
+// std::cout/std::cerr and is flushed, which is what the demo used to do.
+//
+// Levels below VKDEMO_LOG_LEVEL are removed by the preprocessor, so they cost
+// nothing at all (the arguments are not even evaluated).
+
+
+#define VKDEMO_LOG_LEVEL_TRACE 0
+#define VKDEMO_LOG_LEVEL_DEBUG 1
+#define VKDEMO_LOG_LEVEL_INFO  2
+#define VKDEMO_LOG_LEVEL_WARN  3
+#define VKDEMO_LOG_LEVEL_ERROR 4
+#define VKDEMO_LOG_LEVEL_OFF   5
+
+// Can be overridden from the build (e.g. /DVKDEMO_LOG_LEVEL=0 to get everything).
+#ifndef VKDEMO_LOG_LEVEL
+#ifdef _DEBUG
+#define VKDEMO_LOG_LEVEL VKDEMO_LOG_LEVEL_DEBUG
+#else
+#define VKDEMO_LOG_LEVEL VKDEMO_LOG_LEVEL_INFO
+#endif
+#endif
+
+
+enum class LogLevel {
+
+    Trace = VKDEMO_LOG_LEVEL_TRACE,
+    Debug = VKDEMO_LOG_LEVEL_DEBUG,
+    Info = VKDEMO_LOG_LEVEL_INFO,
+    Warn = VKDEMO_LOG_LEVEL_WARN,
+    Error = VKDEMO_LOG_LEVEL_ERROR
+};
+
+enum class LogMode {
+
+    Sync,
+    Async
+};
+
+
+// Number of slots in the ring buffer (power of two) and the maximum length of a message
+// (longer ones are truncated and end with "...").
+// When the ring buffer is full, messages are dropped (and counted) instead of blocking.
+const size_t LOG_RING_BUFFER_SIZE = 4096;
+const size_t LOG_MESSAGE_SIZE = 512;
+
+
+// Until start_logger() is called the logger is in sync mode.
+void start_logger(LogMode mode);
+
+// Writes everything still in the ring buffer and stops the background thread.
+void stop_logger();
+
+// Blocks until every message logged so far has been written.
+// Call it before writing to std::cout directly, to keep the output in order.
+void flush_log();
+
+LogMode get_log_mode();
+
+#if defined(__GNUC__) || defined(__clang__)
+__attribute__((format(printf, 2, 3)))
+#endif
+void log_message(LogLevel level, const char* format, ...);
+
+
+#if VKDEMO_LOG_LEVEL <= VKDEMO_LOG_LEVEL_TRACE
+#define LOG_TRACE(...) log_message(LogLevel::Trace, __VA_ARGS__)
+#else
+#define LOG_TRACE(...) ((void)0)
+#endif
+
+#if VKDEMO_LOG_LEVEL <= VKDEMO_LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...) log_message(LogLevel::Debug, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) ((void)0)
+#endif
+
+#if VKDEMO_LOG_LEVEL <= VKDEMO_LOG_LEVEL_INFO
+#define LOG_INFO(...) log_message(LogLevel::Info, __VA_ARGS__)
+#else
+#define LOG_INFO(...) ((void)0)
+#endif
+
+#if VKDEMO_LOG_LEVEL <= VKDEMO_LOG_LEVEL_WARN
+#define LOG_WARN(...) log_message(LogLevel::Warn, __VA_ARGS__)
+#else
+#define LOG_WARN(...) ((void)0)
+#endif
+
+#if VKDEMO_LOG_LEVEL <= VKDEMO_LOG_LEVEL_ERROR
+#define LOG_ERROR(...) log_message(LogLevel::Error, __VA_ARGS__)
+#else
+#define LOG_ERROR(...) ((void)0)
+#endif
@@ -0,0 +1,450 @@
+#include "vk_memory.hpp"
+
+#include <algorithm> // std::max | std::min
+
+
+static VkDeviceSize round_up_to_power_of_two(VkDeviceSize size) {
+
+    VkDeviceSize result = 1;
+    while (result < size) {
+        result <<= 1;
+    }
+    return result;
+}
+
+
+static uint32_t log2_of_power_of_two(VkDeviceSize value) {
+
+    uint32_t result = 0;
+    while ((VkDeviceSize(1) << result) < value) {
+        result++;
+    }
+    return result;
+}
+
+
+void BuddyAllocator::init(VkDeviceSize size) {
+
+    block_size = size;
+    orders_count = log2_of_power_of_two(size / MEMORY_MIN_ALLOCATION_SIZE) + 1;
+
+    free_lists.assign(orders_count, {});
+    allocated_orders.clear();
+    allocated_bytes = 0;
+
+    // At the start the whole block is a single free piece of the highest order.
+    free_lists[orders_count - 1].insert(0);
+}
+
+
+bool BuddyAllocator::allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset) {
+
+    // Pieces are aligned to their own size, so a piece at least as large as the
+    // alignment (always a power of two in Vulkan) is also aligned well enough.
+    VkDeviceSize piece_size = round_up_to_power_of_two(std::max({ size, alignment, MEMORY_MIN_ALLOCATION_SIZE }));
+    if (piece_size > block_size) {
+        return false;
+    }
+
+    uint32_t order = log2_of_power_of_two(piece_size / MEMORY_MIN_ALLOCATION_SIZE);
+
+    // The smallest free piece that is large enough.
+    uint32_t free_order = order;
+    while (free_order < orders_count && free_lists[free_order].empty()) {
+        free_order++;
+    }
+    if (free_order == orders_count) {
+        return false;
+    }
+
+    offset = *free_lists[free_order].begin();
+    free_lists[free_order].erase(free_lists[free_order].begin());
+
+    // Split it in halves until it has the right size. We keep the first half,
+    // the second half becomes a free piece of the order below.
+    while (free_order > order) {
+        free_order--;
+        free_lists[free_order].insert(offset + (MEMORY_MIN_ALLOCATION_SIZE << free_order));
+    }
+
+    allocated_orders[offset] = order;
+    allocated_bytes += piece_size;
+
+    return true;
+}
+
+
+void BuddyAllocator::free(VkDeviceSize offset) {
+
+    auto allocated = allocated_orders.find(offset);
+    if (allocated == allocated_orders.end()) {
+        throw std::runtime_error("Freeing memory that was not allocated from this block! \n");
+    }
+
+    uint32_t order = allocated->second;
+    allocated_orders.erase(allocated);
+    allocated_bytes -= MEMORY_MIN_ALLOCATION_SIZE << order;
+
+    // The buddy of a piece is the other half of the piece of the order above:
+    // their offsets only differ in the bit of the piece size.
+    while (order + 1 < orders_count) {
+
+        VkDeviceSize buddy = offset ^ (MEMORY_MIN_ALLOCATION_SIZE << order);
+
+        auto free_buddy = free_lists[order].find(buddy);
+        if (free_buddy == free_lists[order].end()) {
+            break;
+        }
+
+        free_lists[order].erase(free_buddy);
+        offset = std::min(offset, buddy);
+        order++;
+    }
+
+    free_lists[order].insert(offset);
+}
+
+
+VkDeviceSize BuddyAllocator::largest_free_piece() const {
+
+    for (uint32_t order = orders_count; order > 0; order--) {
+        if (!free_lists[order - 1].empty()) {
+            return MEMORY_MIN_ALLOCATION_SIZE << (order - 1);
+        }
+    }
+    return 0;
+}
+
+
+static uint32_t find_allocator_memory_type(
+    const MemoryAllocator& allocator,
+    uint32_t type_filter, VkMemoryPropertyFlags properties) {
+
+    for (uint32_t i = 0; i < allocator.memory_properties.memoryTypeCount; i++) {
+
+        if ((type_filter & (1 << i)) &&
+            (allocator.memory_properties.memoryTypes[i].propertyFlags & properties) == properties) {
+
+            return i;
+        }
+    }
+
+    throw std::runtime_error("Failed to find a suitable memory type! \n");
+}
+
+
+static bool is_host_visible(const MemoryAllocator& allocator, uint32_t memory_type) {
+
+    return (allocator.memory_properties.memoryTypes[memory_type].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0;
+}
+
+
+// The single place where the allocator calls vkAllocateMemory().
+static void allocate_device_memory(
+    MemoryAllocator& allocator,
+    uint32_t memory_type, VkDeviceSize size,
+    VkDeviceMemory& memory, void*& mapped) {
+
+    if (allocator.max_allocations_count > 0 &&
+        allocator.live_device_allocations >= allocator.max_allocations_count) {
+
+        LOG_WARN("Device memory allocations over maxMemoryAllocationCount (%u), vkAllocateMemory() may fail.",
+            allocator.max_allocations_count);
+    }
+
+    VkMemoryAllocateInfo memory_allocate_info{};
+    memory_allocate_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    memory_allocate_info.allocationSize = size;
+    memory_allocate_info.memoryTypeIndex = memory_type;
+
+    if (vkAllocateMemory(allocator.device, &memory_allocate_info, nullptr, &memory) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate Vulkan Device memory! \n");
+    }
+
+    mapped = nullptr;
+    if (is_host_visible(allocator, memory_type)) {
+        if (vkMapMemory(allocator.device, memory, 0, VK_WHOLE_SIZE, 0, &mapped) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to map Vulkan Device memory! \n");
+        }
+    }
+
+    allocator.live_device_allocations++;
+    allocator.device_allocations++;
+}
+
+
+static void free_device_memory(MemoryAllocator& allocator, VkDeviceMemory memory) {
+
+    // Freeing the memory also unmaps it.
+    vkFreeMemory(allocator.device, memory, nullptr);
+    allocator.live_device_allocations--;
+}
+
+
+static MemoryPool& get_memory_pool(MemoryAllocator& allocator, uint32_t memory_type, AllocationKind kind) {
+
+    if (!allocator.separate_kinds) {
+        kind = AllocationKind::Linear;
+    }
+
+    size_t pool_index = static_cast<size_t>(memory_type) * 2 + (kind == AllocationKind::Optimal ? 1 : 0);
+    std::unique_ptr<MemoryPool>& pool = allocator.pools[pool_index];
+
+    if (!pool) {
+
+        pool = std::make_unique<MemoryPool>();
+        pool->memory_type = memory_type;
+        pool->kind = kind;
+
+        // A block shouldn't take more than 1/8 of its heap, small heaps (like the
+        // 256 MB of device local, host visible memory without resizable BAR) get
+        // smaller blocks.
+        uint32_t heap = allocator.memory_properties.memoryTypes[memory_type].heapIndex;
+        VkDeviceSize heap_size = allocator.memory_properties.memoryHeaps[heap].size;
+
+        VkDeviceSize block_size = MEMORY_BLOCK_SIZE;
+        while (block_size > MEMORY_MIN_ALLOCATION_SIZE * 1024 && block_size > heap_size / 8) {
+            block_size >>= 1;
+        }
+        pool->block_size = block_size;
+    }
+
+    return *pool;
+}
+
+
+void create_memory_allocator(
+    MemoryAllocator& allocator,
+    VkPhysicalDevice vk_phys_device, VkDevice vk_logic_device) {
+
+    TRACE_SCOPE("create_memory_allocator");
+    std::cout << "Creating Device memory allocator... \n\n";
+
+    VkPhysicalDeviceProperties device_properties;
+    vkGetPhysicalDeviceProperties(vk_phys_device, &device_properties);
+
+    allocator.device = vk_logic_device;
+    vkGetPhysicalDeviceMemoryProperties(vk_phys_device, &allocator.memory_properties);
+    allocator.buffer_image_granularity = device_properties.limits.bufferImageGranularity;
+    allocator.max_allocations_count = device_properties.limits.maxMemoryAllocationCount;
+
+    // Sub-allocations are at least MEMORY_MIN_ALLOCATION_SIZE bytes and aligned to their
+    // size, so if the granularity is not larger than that, two resources never share
+    // a granularity page. Otherwise linear and optimal resources get separate blocks.
+    allocator.separate_kinds = allocator.buffer_image_granularity > MEMORY_MIN_ALLOCATION_SIZE;
+
+    allocator.pools.clear();
+    allocator.pools.resize(static_cast<size_t>(allocator.memory_properties.memoryTypeCount) * 2);
+
+    std::cout << "\t Memory types: " << allocator.memory_properties.memoryTypeCount
+        << ", heaps: " << allocator.memory_properties.memoryHeapCount << ". \n";
+    std::cout << "\t Buffer/image granularity: " << allocator.buffer_image_granularity << " bytes"
+        << (allocator.separate_kinds ? " (separate blocks for buffers and images)" : "") << ". \n";
+    std::cout << "\t Max allocations: " << allocator.max_allocations_count << ". \n\n";
+
+    std::cout << "Device memory allocator created. \n\n";
+}
+
+
+void destroy_memory_allocator(MemoryAllocator& allocator) {
+
+    MemoryStats stats = get_memory_stats(allocator);
+    if (stats.allocations_count > 0) {
+        LOG_WARN("Destroying the memory allocator with %u live allocation(s).", stats.allocations_count);
+    }
+
+    for (auto& pool : allocator.pools) {
+        if (!pool) {
+            continue;
+        }
+        for (auto& block : pool->blocks) {
+            free_device_memory(allocator, block->memory);
+        }
+    }
+
+    allocator.pools.clear();
+}
+
+
+void allocate_memory(
+    MemoryAllocation& allocation,
+    MemoryAllocator& allocator,
+    const VkMemoryRequirements& requirements,
+    VkMemoryPropertyFlags properties,
+    AllocationKind kind) {
+
+    std::lock_guard<std::mutex> lock(allocator.mutex);
+
+    uint32_t memory_type = find_allocator_memory_type(allocator, requirements.memoryTypeBits, properties);
+    MemoryPool& pool = get_memory_pool(allocator, memory_type, kind);
+
+    allocation = MemoryAllocation{};
+    allocation.size = requirements.size;
+
+    if (needs_dedicated_allocation(requirements.size, pool.block_size)) {
+
+        allocate_device_memory(allocator, memory_type, requirements.size, allocation.memory, allocation.mapped);
+
+        allocator.dedicated_bytes += requirements.size;
+        allocator.dedicated_count++;
+        allocator.used_bytes += requirements.size;
+        return;
+    }
+
+    VkDeviceSize offset = 0;
+    MemoryBlock* block = nullptr;
+
+    for (auto& pool_block : pool.blocks) {
+        if (pool_block->buddy.allocate(requirements.size, requirements.alignment, offset)) {
+            block = pool_block.get();
+            break;
+        }
+    }
+
+    // Every block is full (or there is none yet): add a new one.
+    if (block == nullptr) {
+
+        auto new_block = std::make_unique<MemoryBlock>();
+        allocate_device_memory(allocator, memory_type, pool.block_size, new_block->memory, new_block->mapped);
+        new_block->buddy.init(pool.block_size);
+
+        LOG_DEBUG("New %llu KB memory block for memory type %u.",
+            static_cast<unsigned long long>(pool.block_size / 1024), memory_type);
+
+        if (!new_block->buddy.allocate(requirements.size, requirements.alignment, offset)) {
+            throw std::runtime_error("Failed to sub-allocate from a new memory block! \n");
+        }
+
+        block = new_block.get();
+        pool.blocks.push_back(std::move(new_block));
+    }
+
+    allocation.memory = block->memory;
+    allocation.offset = offset;
+    allocation.pool = &pool;
+    allocation.block = block;
+    if (block->mapped != nullptr) {
+        allocation.mapped = static_cast<char*>(block->mapped) + offset;
+    }
+
+    allocator.used_bytes += requirements.size;
+}
+
+
+void free_memory(MemoryAllocation& allocation, MemoryAllocator& allocator) {
+
+    if (allocation.memory == VK_NULL_HANDLE) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(allocator.mutex);
+
+    allocator.used_bytes -= allocation.size;
+
+    if (allocation.pool == nullptr) {
+
+        free_device_memory(allocator, allocation.memory);
+        allocator.dedicated_bytes -= allocation.size;
+        allocator.dedicated_count--;
+    }
+    else {
+
+        MemoryPool& pool = *allocation.pool;
+        allocation.block->buddy.free(allocation.offset);
+
+        // Empty blocks are given back to the driver, except the last one of the pool:
+        // a resource freed and created again every frame would otherwise allocate
+        // and free a whole block every frame.
+        if (allocation.block->buddy.is_empty() && pool.blocks.size() > 1) {
+
+            auto empty_block = std::find_if(pool.blocks.begin(), pool.blocks.end(),
+                [&](const std::unique_ptr<MemoryBlock>& block) { return block.get() == allocation.block; });
+
+            free_device_memory(allocator, (*empty_block)->memory);
+            pool.blocks.erase(empty_block);
+        }
+    }
+
+    allocation = MemoryAllocation{};
+}
+
+
+bool needs_dedicated_allocation(VkDeviceSize size, VkDeviceSize block_size) {
+
+    // Large resources would waste most of a block (and up to half of their own size
+    // in rounding), they get their own allocation instead.
+    return size > block_size / 2;
+}
+
+
+bool has_memory_type(const MemoryAllocator& allocator, uint32_t type_filter, VkMemoryPropertyFlags properties) {
+
+    for (uint32_t i = 0; i < allocator.memory_properties.memoryTypeCount; i++) {
+
+        if ((type_filter & (1 << i)) &&
+            (allocator.memory_properties.memoryTypes[i].propertyFlags & properties) == properties) {
+
+            return true;
+        }
+    }
+    return false;
+}
+
+
+MemoryStats get_memory_stats(MemoryAllocator& allocator) {
+
+    std::lock_guard<std::mutex> lock(allocator.mutex);
+
+    MemoryStats stats;
+    stats.reserved_bytes = allocator.dedicated_bytes;
+    stats.allocated_bytes = allocator.dedicated_bytes;
+    stats.used_bytes = allocator.used_bytes;
+    stats.dedicated_count = allocator.dedicated_count;
+    stats.allocations_count = allocator.dedicated_count;
+    stats.device_allocations = allocator.device_allocations;
+
+    VkDeviceSize free_bytes = 0;
+    VkDeviceSize largest_free_piece = 0;
+
+    for (const auto& pool : allocator.pools) {
+        if (!pool) {
+            continue;
+        }
+        for (const auto& block : pool->blocks) {
+
+            stats.blocks_count++;
+            stats.reserved_bytes += block->buddy.block_size;
+            stats.allocated_bytes += block->buddy.allocated_bytes;
+            stats.allocations_count += static_cast<uint32_t>(block->buddy.allocated_orders.size());
+
+            free_bytes += block->buddy.block_size - block->buddy.allocated_bytes;
+            largest_free_piece = std::max(largest_free_piece, block->buddy.largest_free_piece());
+        }
+    }
+
+    if (stats.allocated_bytes > 0) {
+        stats.internal_fragmentation = 1.0 - static_cast<double>(stats.used_bytes) / stats.allocated_bytes;
+    }
+    if (free_bytes > 0) {
+        stats.external_fragmentation = 1.0 - static_cast<double>(largest_free_piece) / free_bytes;
+    }
+
+    return stats;
+}
+
+
+void print_memory_stats(MemoryAllocator& allocator) {
+
+    MemoryStats stats = get_memory_stats(allocator);
+
+    auto to_mb = [](VkDeviceSize bytes) { return static_cast<double>(bytes) / (1024.0 * 1024.0); };
+
+    std::cout << "Device memory: \n";
+    std::cout << "\t Reserved: " << to_mb(stats.reserved_bytes) << " MB ("
+        << stats.blocks_count << " block(s), " << stats.dedicated_count << " dedicated). \n";
+    std::cout << "\t Used: " << to_mb(stats.used_bytes) << " MB in "
+        << stats.allocations_count << " allocation(s) (" << to_mb(stats.allocated_bytes) << " MB after rounding). \n";
+    std::cout << "\t Fragmentation: internal " << stats.internal_fragmentation * 100.0
+        << "%, external " << stats.external_fragmentation * 100.0 << "%. \n";
+    std::cout << "\t vkAllocateMemory() calls: " << stats.device_allocations << ". \n\n";
+}
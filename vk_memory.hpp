@@ -0,0 +1,179 @@
+#pragma once
+
+#include "my_utils.hpp"
+
+#include <memory>
+#include <mutex>
+#include <set>
+#include <unordered_map>
+
+
+// Device memory allocator.
+//
+// Every vkAllocateMemory() is a driver call (often a kernel call too), and the number
+// of live allocations is limited by maxMemoryAllocationCount (4096 on many drivers).
+// So instead of one allocation per resource, we allocate large blocks per memory type
+// and sub-allocate the resources out of them with a buddy allocator.
+// Resources larger than half a block get a dedicated allocation of their own.
+//
+// Host visible blocks are mapped once, when they are allocated, and stay mapped:
+// a VkDeviceMemory can only be mapped once at a time, and many resources share it.
+
+
+// Default size of a block. Smaller heaps get smaller blocks (see create_memory_allocator()).
+const VkDeviceSize MEMORY_BLOCK_SIZE = 64ull * 1024 * 1024;
+
+// Smallest sub-allocation. Every sub-allocation is a power of two >= this size,
+// aligned to its own size.
+const VkDeviceSize MEMORY_MIN_ALLOCATION_SIZE = 256;
+
+
+// Buddy allocator over a range of block_size bytes (a power of two).
+// The range is split in halves until a piece fits the request; when a piece is freed
+// and its buddy (the other half) is free too, the two are merged back.
+// Allocation and free only walk the orders (log2(block_size / MEMORY_MIN_ALLOCATION_SIZE)),
+// the cost doesn't grow with the number of allocations.
+// It only deals with offsets, it knows nothing about Vulkan objects.
+struct BuddyAllocator {
+
+    VkDeviceSize block_size = 0;
+    uint32_t orders_count = 0; // Order k = pieces of MEMORY_MIN_ALLOCATION_SIZE << k bytes
+
+    // Offsets of the free pieces of every order. Sorted, so that the lowest piece
+    // is used first and the allocations stay packed at the start of the block.
+    std::vector<std::set<VkDeviceSize>> free_lists;
+
+    // Order of every allocated piece, by offset.
+    std::unordered_map<VkDeviceSize, uint32_t> allocated_orders;
+
+    VkDeviceSize allocated_bytes = 0; // Sum of the pieces handed out (after rounding)
+
+    void init(VkDeviceSize size);
+
+    // Returns false if no free piece is large enough.
+    bool allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset);
+
+    void free(VkDeviceSize offset);
+
+    VkDeviceSize largest_free_piece() const;
+
+    bool is_empty() const {
+        return allocated_orders.empty();
+    }
+};
+
+
+// What is going to be bound to an allocation. Linear resources (buffers and linear
+// images) and optimal images must be bufferImageGranularity bytes apart, or they
+// may alias on some GPUs.
+enum class AllocationKind {
+
+    Linear,
+    Optimal
+};
+
+
+struct MemoryBlock {
+
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    void* mapped = nullptr; // Host visible memory only
+    BuddyAllocator buddy;
+};
+
+
+// The blocks of one memory type (and one kind, when the kinds can't share blocks).
+struct MemoryPool {
+
+    uint32_t memory_type = 0;
+    AllocationKind kind = AllocationKind::Linear;
+    VkDeviceSize block_size = 0;
+    std::vector<std::unique_ptr<MemoryBlock>> blocks;
+};
+
+
+struct MemoryAllocation {
+
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+    VkDeviceSize size = 0;      // Requested size
+    void* mapped = nullptr;     // Host pointer to the allocation, if host visible
+
+    MemoryPool* pool = nullptr; // nullptr for dedicated allocations
+    MemoryBlock* block = nullptr;
+};
+
+
+struct MemoryStats {
+
+    VkDeviceSize reserved_bytes = 0;  // Total size of the VkDeviceMemory objects
+    VkDeviceSize allocated_bytes = 0; // Handed out to resources, including the buddy rounding
+    VkDeviceSize used_bytes = 0;      // Actually requested by the resources
+
+    uint32_t blocks_count = 0;
+    uint32_t dedicated_count = 0;
+    uint32_t allocations_count = 0;   // Live sub-allocations + dedicated allocations
+    uint64_t device_allocations = 0;  // vkAllocateMemory() calls so far
+
+    // Wasted by rounding up to powers of two: 1 - used / allocated.
+    double internal_fragmentation = 0.0;
+
+    // How scattered the free space is: 1 - largest free piece / total free space.
+    // 0 means all of the free space of the blocks is a single piece.
+    double external_fragmentation = 0.0;
+};
+
+
+struct MemoryAllocator {
+
+    VkDevice device = VK_NULL_HANDLE;
+    VkPhysicalDeviceMemoryProperties memory_properties{};
+    VkDeviceSize buffer_image_granularity = 1;
+    uint32_t max_allocations_count = 0;
+
+    // When the granularity fits inside the smallest sub-allocation, linear and optimal
+    // resources can never share a granularity page, so they share the pools too.
+    bool separate_kinds = false;
+
+    // Pools by memory type * 2 + kind, created the first time they are used.
+    std::vector<std::unique_ptr<MemoryPool>> pools;
+
+    VkDeviceSize dedicated_bytes = 0;
+    VkDeviceSize used_bytes = 0;
+    uint32_t dedicated_count = 0;
+    uint32_t live_device_allocations = 0;
+    uint64_t device_allocations = 0;
+
+    // Resources may be created from more than one thread.
+    std::mutex mutex;
+};
+
+
+void create_memory_allocator(
+    MemoryAllocator& allocator,
+    VkPhysicalDevice vk_phys_device, VkDevice vk_logic_device);
+
+// Every allocation must have been freed already.
+void destroy_memory_allocator(MemoryAllocator& allocator);
+
+// Allocates memory with all of the requested properties for a resource with
+// these requirements. Bind the resource at allocation.memory + allocation.offset.
+void allocate_memory(
+    MemoryAllocation& allocation,
+    MemoryAllocator& allocator,
+    const VkMemoryRequirements& requirements,
+    VkMemoryPropertyFlags properties,
+    AllocationKind kind);
+
+void free_memory(MemoryAllocation& allocation, MemoryAllocator& allocator);
+
+// Whether allocate_memory() gives a resource of that size its own VkDeviceMemory
+// instead of a piece of a block of block_size bytes.
+bool needs_dedicated_allocation(VkDeviceSize size, VkDeviceSize block_size);
+
+// Whether one of the memory types in type_filter has all of the properties (e.g. to
+// fall back to other properties instead of failing in allocate_memory()).
+bool has_memory_type(const MemoryAllocator& allocator, uint32_t type_filter, VkMemoryPropertyFlags properties);
+
+MemoryStats get_memory_stats(MemoryAllocator& allocator);
+
+void print_memory_stats(MemoryAllocator& allocator);
@@ -0,0 +1,301 @@
+#include "vk_mesh.hpp"
+#include "vk_buffer.hpp"
+
+#include <algorithm> // std::min | std::max
+#include <cmath> // std::sqrt
+#include <cstddef> // offsetof
+#include <limits>
+
+
+void build_vertex_input_descriptions(
+    const VertexLayout& layout,
+    std::vector<VkVertexInputBindingDescription>& binding_descriptions,
+    std::vector<VkVertexInputAttributeDescription>& attribute_descriptions) {
+
+    binding_descriptions.clear();
+    attribute_descriptions.clear();
+
+    for (uint32_t binding = 0; binding < layout.bindings.size(); binding++) {
+
+        const VertexBindingLayout& binding_layout = layout.bindings[binding];
+
+        // A binding describes at which rate to load data from memory throughout the vertices:
+        // the number of bytes between data entries and whether to move to the next
+        // data entry after each vertex or after each instance.
+        VkVertexInputBindingDescription binding_description{};
+        binding_description.binding = binding;
+        binding_description.stride = binding_layout.stride;
+        binding_description.inputRate = binding_layout.input_rate;
+        binding_descriptions.push_back(binding_description);
+
+        // An attribute describes how to extract a vertex attribute from
+        // the chunk of vertex data originating from a binding.
+        for (const auto& attribute : binding_layout.attributes) {
+
+            VkVertexInputAttributeDescription attribute_description{};
+            attribute_description.binding = binding;
+            attribute_description.location = attribute.location;
+            attribute_description.format = attribute.format;
+            attribute_description.offset = attribute.offset;
+            attribute_descriptions.push_back(attribute_description);
+        }
+    }
+}
+
+
+// The plain pipeline derives its vertex layout from shader.vert: the attributes packed
+// in location order, which the Vertex struct must be.
+static_assert(offsetof(Vertex, color) == sizeof(glm::vec2) && sizeof(Vertex) == sizeof(glm::vec2) + sizeof(glm::vec3),
+    "Vertex must be packed in the order of the shader inputs");
+
+VertexLayout Vertex::get_layout() {
+
+    // The formats use the same names as the color formats:
+    // float = VK_FORMAT_R32_SFLOAT, vec2 = VK_FORMAT_R32G32_SFLOAT, vec3 = VK_FORMAT_R32G32B32_SFLOAT.
+    VertexBindingLayout binding;
+    binding.stride = sizeof(Vertex);
+    binding.input_rate = VK_VERTEX_INPUT_RATE_VERTEX;
+    binding.attributes = {
+        { 0, VK_FORMAT_R32G32_SFLOAT, static_cast<uint32_t>(offsetof(Vertex, position)) },
+        { 1, VK_FORMAT_R32G32B32_SFLOAT, static_cast<uint32_t>(offsetof(Vertex, color)) }
+    };
+
+    VertexLayout layout;
+    layout.bindings.push_back(binding);
+    return layout;
+}
+
+
+MeshData generate_quad_mesh() {
+
+    MeshData mesh_data;
+
+    mesh_data.vertices = {
+        { {-0.5f, -0.5f}, {1.0f, 0.0f, 0.0f} },
+        { { 0.5f, -0.5f}, {0.0f, 1.0f, 0.0f} },
+        { { 0.5f,  0.5f}, {0.0f, 0.0f, 1.0f} },
+        { {-0.5f,  0.5f}, {1.0f, 1.0f, 1.0f} }
+    };
+
+    // Two triangles sharing the diagonal: the shared vertices are stored once.
+    // Clockwise, like the triangle of the rasterizer state.
+    mesh_data.indices = { 0, 1, 2, 2, 3, 0 };
+
+    return mesh_data;
+}
+
+
+MeshData generate_grid_mesh(uint32_t cells_per_side, JobSystem& job_system) {
+
+    TRACE_SCOPE("generate_grid_mesh");
+
+    MeshData mesh_data;
+
+    uint32_t vertices_per_side = cells_per_side + 1;
+    mesh_data.vertices.resize(static_cast<size_t>(vertices_per_side) * vertices_per_side);
+    mesh_data.indices.resize(static_cast<size_t>(cells_per_side) * cells_per_side * 6);
+    mesh_data.draws.resize(static_cast<size_t>(cells_per_side) * cells_per_side);
+
+    // Every row is written to its own part of the arrays, so the rows are generated
+    // in parallel (a few rows per job, so that a job is not too small to be worth it).
+    const uint32_t rows_per_job = 16;
+    JobCounter counter;
+
+    // Same area and corner colors as the quad, the colors are blended across the grid.
+    run_parallel_for(job_system, vertices_per_side, rows_per_job, [&](uint32_t first_row, uint32_t end_row) {
+
+        for (uint32_t y = first_row; y < end_row; y++) {
+            for (uint32_t x = 0; x < vertices_per_side; x++) {
+
+                float u = static_cast<float>(x) / cells_per_side;
+                float v = static_cast<float>(y) / cells_per_side;
+
+                Vertex& vertex = mesh_data.vertices[static_cast<size_t>(y) * vertices_per_side + x];
+                vertex.position = { u - 0.5f, v - 0.5f };
+                // Bilinear blend of the corners: red, green, blue and white.
+                vertex.color = {
+                    1.0f - u,
+                    u * (1.0f - v) + (1.0f - u) * v,
+                    v
+                };
+            }
+        }
+    }, counter);
+
+    run_parallel_for(job_system, cells_per_side, rows_per_job, [&](uint32_t first_row, uint32_t end_row) {
+
+        for (uint32_t y = first_row; y < end_row; y++) {
+            for (uint32_t x = 0; x < cells_per_side; x++) {
+
+                uint32_t top_left = y * vertices_per_side + x;
+                uint32_t top_right = top_left + 1;
+                uint32_t bottom_left = top_left + vertices_per_side;
+                uint32_t bottom_right = bottom_left + 1;
+
+                size_t cell = static_cast<size_t>(y) * cells_per_side + x;
+                uint32_t* indices = &mesh_data.indices[cell * 6];
+
+                indices[0] = top_left;
+                indices[1] = top_right;
+                indices[2] = bottom_right;
+                indices[3] = bottom_right;
+                indices[4] = bottom_left;
+                indices[5] = top_left;
+
+                mesh_data.draws[cell] = { 6, static_cast<uint32_t>(cell * 6) };
+            }
+        }
+    }, counter);
+
+    wait_for_counter(job_system, counter);
+
+    return mesh_data;
+}
+
+
+// Sphere around the bounding box of the vertices referenced by every draw.
+// Not the tightest sphere, but cheap and good enough to cull with.
+static void compute_draw_bounds(Mesh& mesh, const MeshData& mesh_data, JobSystem& job_system) {
+
+    TRACE_SCOPE("compute_draw_bounds");
+
+    mesh.draw_bounds.resize(mesh.draws.size());
+
+    JobCounter counter;
+    run_parallel_for(job_system, static_cast<uint32_t>(mesh.draws.size()), 4096, [&](uint32_t begin, uint32_t end) {
+
+        for (uint32_t i = begin; i < end; i++) {
+
+            const DrawCommand& draw = mesh.draws[i];
+            glm::vec2 min_corner(std::numeric_limits<float>::max());
+            glm::vec2 max_corner(-std::numeric_limits<float>::max());
+
+            for (uint32_t index = draw.first_index; index < draw.first_index + draw.index_count; index++) {
+                const glm::vec2& position = mesh_data.vertices[mesh_data.indices[index]].position;
+                min_corner = { std::min(min_corner.x, position.x), std::min(min_corner.y, position.y) };
+                max_corner = { std::max(max_corner.x, position.x), std::max(max_corner.y, position.y) };
+            }
+
+            float half_x = (max_corner.x - min_corner.x) * 0.5f;
+            float half_y = (max_corner.y - min_corner.y) * 0.5f;
+            mesh.draw_bounds[i] = glm::vec4(
+                min_corner.x + half_x, min_corner.y + half_y, 0.0f,
+                std::sqrt(half_x * half_x + half_y * half_y));
+        }
+    }, counter);
+
+    wait_for_counter(job_system, counter);
+}
+
+
+void create_mesh(
+    Mesh& mesh,
+    const MeshData& mesh_data,
+    MemoryAllocator& allocator, VkDevice vk_logic_device,
+    uint32_t graphics_family, uint32_t transfer_family,
+    VkCommandPool vk_transfer_command_pool, VkQueue vk_transfer_queue,
+    JobSystem& job_system,
+    UploadScheduler* upload_scheduler) {
+
+    TRACE_SCOPE("create_mesh");
+    std::cout << "Creating Mesh... \n\n";
+
+    if (mesh_data.vertices.empty() || mesh_data.indices.empty()) {
+        throw std::runtime_error("Failed to create Mesh: no geometry! \n");
+    }
+
+    mesh.vertex_count = static_cast<uint32_t>(mesh_data.vertices.size());
+    mesh.index_count = static_cast<uint32_t>(mesh_data.indices.size());
+
+    mesh.draws = mesh_data.draws;
+    if (mesh.draws.empty()) {
+        mesh.draws.push_back({ mesh.index_count, 0 });
+    }
+
+    compute_draw_bounds(mesh, mesh_data, job_system);
+
+    std::vector<uint16_t> indices_16;
+    const void* index_data = mesh_data.indices.data();
+    VkDeviceSize index_size = sizeof(uint32_t) * mesh_data.indices.size();
+
+    if (mesh.vertex_count <= std::numeric_limits<uint16_t>::max()) {
+
+        indices_16.assign(mesh_data.indices.begin(), mesh_data.indices.end());
+        index_data = indices_16.data();
+        index_size = sizeof(uint16_t) * indices_16.size();
+        mesh.index_type = VK_INDEX_TYPE_UINT16;
+    }
+    else {
+        mesh.index_type = VK_INDEX_TYPE_UINT32;
+    }
+
+    VkDeviceSize vertex_size = sizeof(Vertex) * mesh_data.vertices.size();
+
+    // The buffers are written by the transfer queue and read by the graphics queue.
+    // When they are different families the buffers are shared CONCURRENT between them
+    // (see create_buffer()), so no queue family ownership transfer is needed.
+    std::vector<uint32_t> sharing_families = { graphics_family, transfer_family };
+
+    // DEVICE_LOCAL is the fastest memory for the GPU to read, but usually the CPU
+    // can't map it: the data goes through the staging buffer and TRANSFER_DST.
+    create_buffer(
+        mesh.vertex_buffer, mesh.vertex_allocation,
+        allocator, vk_logic_device,
+        vertex_size,
+        VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        sharing_families);
+
+    create_buffer(
+        mesh.index_buffer, mesh.index_allocation,
+        allocator, vk_logic_device,
+        index_size,
+        VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        sharing_families);
+
+    double upload_kb = static_cast<double>(vertex_size + index_size) / 1024.0;
+
+    std::cout << "\t Vertices: " << mesh.vertex_count << ", indices: " << mesh.index_count
+        << " (" << (mesh.index_type == VK_INDEX_TYPE_UINT16 ? "16" : "32") << " bit), draws: " << mesh.draws.size() << ". \n";
+
+    // The index buffer is queued last: once it is ready, the vertices are too.
+    if (upload_scheduler != nullptr) {
+
+        schedule_buffer_upload(*upload_scheduler, mesh_data.vertices.data(), vertex_size, mesh.vertex_buffer, 0);
+        mesh.upload_ticket = schedule_buffer_upload(*upload_scheduler, index_data, index_size, mesh.index_buffer, 0);
+
+        std::cout << "\t Streaming " << upload_kb << " KB through the Upload scheduler. \n\n";
+        std::cout << "Mesh created. \n\n";
+        return;
+    }
+
+    double upload_ms = upload_buffers_with_staging(
+        {
+            { mesh_data.vertices.data(), vertex_size, mesh.vertex_buffer, 0 },
+            { index_data, index_size, mesh.index_buffer, 0 }
+        },
+        allocator, vk_logic_device,
+        vk_transfer_command_pool, vk_transfer_queue,
+        job_system);
+
+    double upload_mb_per_s = upload_ms > 0.0 ? (upload_kb / 1024.0) / (upload_ms / 1000.0) : 0.0;
+
+    std::cout << "\t Uploaded " << upload_kb << " KB in " << upload_ms << " ms ("
+        << upload_mb_per_s << " MB/s). \n\n";
+
+    std::cout << "Mesh created. \n\n";
+}
+
+
+void destroy_mesh(Mesh& mesh, MemoryAllocator& allocator, VkDevice vk_logic_device) {
+
+    destroy_buffer(mesh.index_buffer, mesh.index_allocation, allocator, vk_logic_device);
+    destroy_buffer(mesh.vertex_buffer, mesh.vertex_allocation, allocator, vk_logic_device);
+
+    mesh.vertex_count = 0;
+    mesh.index_count = 0;
+    mesh.draws.clear();
+    mesh.draw_bounds.clear();
+    mesh.upload_ticket = 0;
+}
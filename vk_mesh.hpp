@@ -0,0 +1,133 @@
+#pragma once
+
+#include "my_utils.hpp"
+#include "vk_memory.hpp"
+#include "vk_upload_scheduler.hpp"
+#include "job_system.hpp"
+
+#include <glm/glm.hpp>
+
+
+// Describes how the vertex data is laid out in the vertex buffer(s), independently
+// of the Vulkan structs. The pipeline builds its vertex input state from it, so the
+// vertex format is written down in one place only (next to the vertex struct).
+struct VertexAttributeLayout {
+
+    uint32_t location; // layout(location = N) in the vertex shader
+    VkFormat format;
+    uint32_t offset;   // Offset of the attribute inside the vertex
+};
+
+struct VertexBindingLayout {
+
+    uint32_t stride;
+    VkVertexInputRate input_rate;
+    std::vector<VertexAttributeLayout> attributes;
+};
+
+struct VertexLayout {
+
+    // The index of the binding in this vector is its binding number.
+    std::vector<VertexBindingLayout> bindings;
+};
+
+
+// The vertex layout is part of the pipeline description (see GraphicsPipelineDesc),
+// which is compared when looking pipelines up.
+inline bool operator==(const VertexAttributeLayout& a, const VertexAttributeLayout& b) {
+    return a.location == b.location && a.format == b.format && a.offset == b.offset;
+}
+
+inline bool operator==(const VertexBindingLayout& a, const VertexBindingLayout& b) {
+    return a.stride == b.stride && a.input_rate == b.input_rate && a.attributes == b.attributes;
+}
+
+inline bool operator==(const VertexLayout& a, const VertexLayout& b) {
+    return a.bindings == b.bindings;
+}
+
+
+// Fills the Vulkan descriptions used by VkPipelineVertexInputStateCreateInfo.
+void build_vertex_input_descriptions(
+    const VertexLayout& layout,
+    std::vector<VkVertexInputBindingDescription>& binding_descriptions,
+    std::vector<VkVertexInputAttributeDescription>& attribute_descriptions);
+
+
+// Vertex of the demo meshes: interleaved position and color (20 bytes).
+struct Vertex {
+
+    glm::vec2 position;
+    glm::vec3 color;
+
+    static VertexLayout get_layout();
+};
+
+
+// One vkCmdDrawIndexed() of a range of the index buffer.
+struct DrawCommand {
+
+    uint32_t index_count;
+    uint32_t first_index;
+};
+
+
+// Device-local vertex and index buffers of a mesh.
+struct Mesh {
+
+    VkBuffer vertex_buffer = VK_NULL_HANDLE;
+    MemoryAllocation vertex_allocation;
+    VkBuffer index_buffer = VK_NULL_HANDLE;
+    MemoryAllocation index_allocation;
+
+    uint32_t vertex_count = 0;
+    uint32_t index_count = 0;
+
+    // 16 bit indices when the vertices fit, half the index data to upload and read.
+    VkIndexType index_type = VK_INDEX_TYPE_UINT32;
+
+    // The draw list: the ranges of the index buffer drawn every frame.
+    std::vector<DrawCommand> draws;
+
+    // Bounding sphere of every draw (center in xyz, radius in w), for culling.
+    std::vector<glm::vec4> draw_bounds;
+
+    // Streamed meshes can only be drawn once this upload is ready (see is_upload_ready()).
+    UploadTicket upload_ticket = 0;
+};
+
+
+// CPU side geometry, before the upload.
+struct MeshData {
+
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+
+    // Empty = a single draw of all the indices.
+    std::vector<DrawCommand> draws;
+};
+
+// The colored quad drawn by the demo (4 vertices, 6 indices).
+MeshData generate_quad_mesh();
+
+// A grid of cells_per_side x cells_per_side quads covering the same area as the quad.
+// Used to upload (and draw) meshes of realistic size. Every cell is a draw of its own,
+// so the grid also gives a draw list of realistic length.
+MeshData generate_grid_mesh(uint32_t cells_per_side, JobSystem& job_system);
+
+
+// Creates the device-local buffers and uploads the mesh through a staging buffer
+// on the transfer queue. Logs the size of the upload and the bandwidth.
+// graphics_family and transfer_family are the families that use the buffers.
+// With an upload scheduler the data is only queued and streamed in over the next
+// frames instead (see Mesh::upload_ticket).
+void create_mesh(
+    Mesh& mesh,
+    const MeshData& mesh_data,
+    MemoryAllocator& allocator, VkDevice vk_logic_device,
+    uint32_t graphics_family, uint32_t transfer_family,
+    VkCommandPool vk_transfer_command_pool, VkQueue vk_transfer_queue,
+    JobSystem& job_system,
+    UploadScheduler* upload_scheduler = nullptr);
+
+void destroy_mesh(Mesh& mesh, MemoryAllocator& allocator, VkDevice vk_logic_device);
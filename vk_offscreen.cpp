@@ -0,0 +1,195 @@
+#include "vk_offscreen.hpp"
+#include "vk_buffer.hpp"
+
+#include <fstream>
+
+
+void create_offscreen_images(
+    std::vector<VkImage>& vk_offscreen_images,
+    std::vector<MemoryAllocation>& offscreen_allocations,
+    MemoryAllocator& allocator, VkDevice vk_logic_device,
+    uint32_t images_count, VkExtent2D extent,
+    VkFormat& vk_offscreen_image_format, VkExtent2D& vk_offscreen_extent) {
+
+    TRACE_SCOPE("create_offscreen_images");
+    std::cout << "Creating Vulkan Offscreen images (headless)... \n\n";
+
+    vk_offscreen_images.resize(images_count);
+    offscreen_allocations.resize(images_count);
+
+    for (uint32_t i = 0; i < images_count; i++) {
+
+        // Same properties a swapchain image would have, plus TRANSFER_SRC
+        // so that the result can be copied back to the host.
+        VkImageCreateInfo image_create_info{};
+        image_create_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        image_create_info.imageType = VK_IMAGE_TYPE_2D;
+        image_create_info.format = OFFSCREEN_IMAGE_FORMAT;
+        image_create_info.extent = { extent.width, extent.height, 1 };
+        image_create_info.mipLevels = 1;
+        image_create_info.arrayLayers = 1;
+        image_create_info.samples = VK_SAMPLE_COUNT_1_BIT;
+        image_create_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+        image_create_info.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+        image_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        image_create_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+        if (vkCreateImage(vk_logic_device, &image_create_info, nullptr, &vk_offscreen_images[i]) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create Vulkan Offscreen image! \n");
+        }
+
+        // Unlike swapchain images, we have to back the images with memory ourselves.
+        VkMemoryRequirements memory_requirements;
+        vkGetImageMemoryRequirements(vk_logic_device, vk_offscreen_images[i], &memory_requirements);
+
+        allocate_memory(
+            offscreen_allocations[i], allocator,
+            memory_requirements,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            AllocationKind::Optimal);
+
+        vkBindImageMemory(vk_logic_device, vk_offscreen_images[i], offscreen_allocations[i].memory, offscreen_allocations[i].offset);
+    }
+
+    vk_offscreen_image_format = OFFSCREEN_IMAGE_FORMAT;
+    vk_offscreen_extent = extent;
+
+    std::cout << "\t Offscreen images: " << images_count
+        << " (" << extent.width << "x" << extent.height << "). \n\n";
+
+    std::cout << "Vulkan Offscreen images created. \n\n";
+}
+
+
+void destroy_offscreen_images(
+    std::vector<VkImage>& vk_offscreen_images,
+    std::vector<MemoryAllocation>& offscreen_allocations,
+    MemoryAllocator& allocator, VkDevice vk_logic_device) {
+
+    for (auto image : vk_offscreen_images) {
+        vkDestroyImage(vk_logic_device, image, nullptr);
+    }
+    for (auto& allocation : offscreen_allocations) {
+        free_memory(allocation, allocator);
+    }
+
+    vk_offscreen_images.clear();
+    offscreen_allocations.clear();
+}
+
+
+void save_offscreen_image(
+    const std::string& file_name,
+    VkImage vk_image, VkExtent2D extent,
+    MemoryAllocator& allocator, VkDevice vk_logic_device,
+    VkCommandPool vk_command_pool, VkQueue vk_queue) {
+
+    TRACE_SCOPE("save_offscreen_image");
+    std::cout << "Saving offscreen image to " << file_name << "... \n\n";
+
+    VkDeviceSize image_size = static_cast<VkDeviceSize>(extent.width) * extent.height * 4;
+
+    // Host visible buffer the image is copied into.
+    VkBuffer readback_buffer;
+    MemoryAllocation readback_allocation;
+    create_buffer(
+        readback_buffer, readback_allocation,
+        allocator, vk_logic_device,
+        image_size,
+        VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+    // Record a one time command buffer doing the copy.
+    VkCommandBufferAllocateInfo command_buffer_allocate_info{};
+    command_buffer_allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    command_buffer_allocate_info.commandPool = vk_command_pool;
+    command_buffer_allocate_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    command_buffer_allocate_info.commandBufferCount = 1;
+
+    VkCommandBuffer command_buffer;
+    if (vkAllocateCommandBuffers(vk_logic_device, &command_buffer_allocate_info, &command_buffer) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate the readback command buffer! \n");
+    }
+
+    VkCommandBufferBeginInfo begin_info{};
+    begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkBeginCommandBuffer(command_buffer, &begin_info);
+
+    // Make the color attachment writes of the render pass visible to the copy.
+    VkImageMemoryBarrier image_barrier{};
+    image_barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    image_barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    image_barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    image_barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    image_barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    image_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    image_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    image_barrier.image = vk_image;
+    image_barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+    vkCmdPipelineBarrier(
+        command_buffer,
+        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0, 0, nullptr, 0, nullptr, 1, &image_barrier);
+
+    VkBufferImageCopy copy_region{};
+    copy_region.bufferOffset = 0;
+    copy_region.bufferRowLength = 0; // tightly packed
+    copy_region.bufferImageHeight = 0;
+    copy_region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+    copy_region.imageOffset = { 0, 0, 0 };
+    copy_region.imageExtent = { extent.width, extent.height, 1 };
+
+    vkCmdCopyImageToBuffer(command_buffer, vk_image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readback_buffer, 1, &copy_region);
+
+    // Make the copied data visible to the host.
+    VkBufferMemoryBarrier buffer_barrier{};
+    buffer_barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    buffer_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    buffer_barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    buffer_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    buffer_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    buffer_barrier.buffer = readback_buffer;
+    buffer_barrier.offset = 0;
+    buffer_barrier.size = VK_WHOLE_SIZE;
+
+    vkCmdPipelineBarrier(
+        command_buffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+        0, 0, nullptr, 1, &buffer_barrier, 0, nullptr);
+
+    vkEndCommandBuffer(command_buffer);
+
+    VkSubmitInfo submit_info{};
+    submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submit_info.commandBufferCount = 1;
+    submit_info.pCommandBuffers = &command_buffer;
+
+    if (vkQueueSubmit(vk_queue, 1, &submit_info, VK_NULL_HANDLE) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to submit the readback command buffer! \n");
+    }
+    vkQueueWaitIdle(vk_queue);
+
+    vkFreeCommandBuffers(vk_logic_device, vk_command_pool, 1, &command_buffer);
+
+    // Write the pixels as a binary PPM (RGB, the alpha channel is dropped).
+    // The allocator keeps host visible memory mapped.
+    const uint8_t* pixels = static_cast<const uint8_t*>(readback_allocation.mapped);
+
+    std::ofstream file(file_name, std::ios::binary);
+    if (!file.is_open()) {
+        destroy_buffer(readback_buffer, readback_allocation, allocator, vk_logic_device);
+        throw std::runtime_error("Failed to open file: " + file_name + " \n");
+    }
+
+    file << "P6\n" << extent.width << " " << extent.height << "\n255\n";
+    for (VkDeviceSize i = 0; i < image_size; i += 4) {
+        file.write(reinterpret_cast<const char*>(pixels + i), 3);
+    }
+    file.close();
+
+    destroy_buffer(readback_buffer, readback_allocation, allocator, vk_logic_device);
+
+    std::cout << "Offscreen image saved. \n\n";
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "my_utils.hpp"
+#include "vk_memory.hpp"
+
+
+// Format of the offscreen images. R8G8B8A8_UNORM is supported as color attachment
+// by every implementation (it is one of the mandatory formats).
+const VkFormat OFFSCREEN_IMAGE_FORMAT = VK_FORMAT_R8G8B8A8_UNORM;
+
+
+// Creates the images we render into when running headless. They take the place of the
+// swapchain images, so image views, render pass, pipeline and framebuffers are created
+// exactly the same way as with a window.
+void create_offscreen_images(
+    std::vector<VkImage>& vk_offscreen_images,
+    std::vector<MemoryAllocation>& offscreen_allocations,
+    MemoryAllocator& allocator, VkDevice vk_logic_device,
+    uint32_t images_count, VkExtent2D extent,
+    VkFormat& vk_offscreen_image_format, VkExtent2D& vk_offscreen_extent);
+
+void destroy_offscreen_images(
+    std::vector<VkImage>& vk_offscreen_images,
+    std::vector<MemoryAllocation>& offscreen_allocations,
+    MemoryAllocator& allocator, VkDevice vk_logic_device);
+
+// Copies an offscreen image back to the host and writes it as a binary PPM file.
+// The image must be in VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL (the final layout of the
+// render pass when running headless) and the device must be idle.
+void save_offscreen_image(
+    const std::string& file_name,
+    VkImage vk_image, VkExtent2D extent,
+    MemoryAllocator& allocator, VkDevice vk_logic_device,
+    VkCommandPool vk_command_pool, VkQueue vk_queue);
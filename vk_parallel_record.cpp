@@ -0,0 +1,152 @@
+#include "vk_parallel_record.hpp"
+#include "vk_core.hpp"
+#include "vk_graphics_pipeline.hpp"
+#include "vk_queue_family.hpp"
+
+
+static void record_slice(ParallelRecorder& recorder, uint32_t slice_index, const SecondaryRecordJob& job) {
+
+    TRACE_SCOPE("record_secondary");
+
+    RecordSlice& slice = recorder.slices[slice_index];
+
+    // Contiguous slices, so that executing the secondary command buffers in order
+    // draws in the same order as the draw list (or as draw_order).
+    uint32_t draws_count = static_cast<uint32_t>(job.mesh->draws.size());
+    uint32_t slices_count = static_cast<uint32_t>(recorder.slices.size());
+    uint32_t first_draw = static_cast<uint32_t>(static_cast<uint64_t>(draws_count) * slice_index / slices_count);
+    uint32_t last_draw = static_cast<uint32_t>(static_cast<uint64_t>(draws_count) * (slice_index + 1) / slices_count);
+
+    // Resetting the whole pool is cheaper than resetting its command buffers one by one.
+    vkResetCommandPool(recorder.device, slice.command_pools[job.frame_index], 0);
+
+    // A secondary command buffer executed inside a render pass must know
+    // which render pass, subpass and framebuffer it is going to be executed in.
+    VkCommandBufferInheritanceInfo inheritance_info{};
+    inheritance_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    inheritance_info.renderPass = job.render_pass;
+    inheritance_info.subpass = 0;
+    inheritance_info.framebuffer = job.framebuffer;
+
+    // Without a render pass to inherit, the command buffer is told the attachments
+    // of the vkCmdBeginRendering() it will be executed in.
+    VkCommandBufferInheritanceRenderingInfo inheritance_rendering_info{};
+    if (job.render_pass == VK_NULL_HANDLE) {
+        inheritance_rendering_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO;
+        inheritance_rendering_info.colorAttachmentCount = static_cast<uint32_t>(job.color_formats.size());
+        inheritance_rendering_info.pColorAttachmentFormats = job.color_formats.data();
+        inheritance_rendering_info.depthAttachmentFormat = job.depth_format;
+        if (has_stencil_component(job.depth_format)) {
+            inheritance_rendering_info.stencilAttachmentFormat = job.depth_format;
+        }
+        inheritance_rendering_info.rasterizationSamples = job.samples;
+        inheritance_info.pNext = &inheritance_rendering_info;
+    }
+
+    VkCommandBufferBeginInfo begin_info{};
+    begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    begin_info.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    begin_info.pInheritanceInfo = &inheritance_info;
+
+    VkCommandBuffer command_buffer = slice.command_buffers[job.frame_index];
+
+    if (vkBeginCommandBuffer(command_buffer, &begin_info) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to begin recording secondary command buffer! \n");
+    }
+
+    record_draws(
+        command_buffer,
+        job.graphics_pipeline, job.pipeline_layout,
+        job.frame_descriptor_set, job.frame_uniforms_offset,
+        job.extent,
+        *job.mesh, job.instances, job.draw_order,
+        first_draw, last_draw - first_draw);
+
+    if (vkEndCommandBuffer(command_buffer) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to record secondary command buffer! \n");
+    }
+}
+
+
+void create_parallel_recorder(
+    ParallelRecorder& recorder,
+    uint32_t slices_count,
+    VkSurfaceKHR vk_surface,
+    VkPhysicalDevice vk_phys_device, VkDevice vk_logic_device,
+    uint32_t frames_in_flight) {
+
+    TRACE_SCOPE("create_parallel_recorder");
+    std::cout << "Creating Parallel command recorder... \n\n";
+
+    QueueFamilyIndices queue_family_indices = find_queue_families(vk_surface, vk_phys_device);
+
+    recorder.device = vk_logic_device;
+    recorder.slices.resize(slices_count);
+
+    for (auto& slice : recorder.slices) {
+
+        slice.command_pools.resize(frames_in_flight);
+        slice.command_buffers.resize(frames_in_flight);
+
+        for (uint32_t i = 0; i < frames_in_flight; i++) {
+
+            // TRANSIENT: the command buffers are recorded again every time the pool is reset.
+            VkCommandPoolCreateInfo command_pool_create_info{};
+            command_pool_create_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+            command_pool_create_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+            command_pool_create_info.queueFamilyIndex = queue_family_indices.graphics_family.value();
+
+            if (vkCreateCommandPool(vk_logic_device, &command_pool_create_info, nullptr, &slice.command_pools[i]) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to create Vulkan Command pool of a record slice! \n");
+            }
+
+            VkCommandBufferAllocateInfo command_buffer_allocate_info{};
+            command_buffer_allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            command_buffer_allocate_info.commandPool = slice.command_pools[i];
+            command_buffer_allocate_info.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+            command_buffer_allocate_info.commandBufferCount = 1;
+
+            if (vkAllocateCommandBuffers(vk_logic_device, &command_buffer_allocate_info, &slice.command_buffers[i]) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to allocate Vulkan secondary Command buffer! \n");
+            }
+        }
+    }
+
+    std::cout << "\t Secondary command buffers per frame: " << slices_count << ". \n\n";
+
+    std::cout << "Parallel command recorder created. \n\n";
+}
+
+
+void destroy_parallel_recorder(ParallelRecorder& recorder) {
+
+    // Destroying a pool frees its command buffers too.
+    for (auto& slice : recorder.slices) {
+        for (auto command_pool : slice.command_pools) {
+            vkDestroyCommandPool(recorder.device, command_pool, nullptr);
+        }
+    }
+
+    recorder.slices.clear();
+}
+
+
+void record_secondary_command_buffers(
+    ParallelRecorder& recorder,
+    JobSystem& job_system,
+    const SecondaryRecordJob& job,
+    std::vector<VkCommandBuffer>& vk_secondary_command_buffers) {
+
+    JobCounter counter;
+    for (uint32_t i = 0; i < recorder.slices.size(); i++) {
+        run_job(job_system, [&recorder, i, job]() { record_slice(recorder, i, job); }, counter);
+    }
+
+    // The calling thread records slices too while it waits.
+    wait_for_counter(job_system, counter);
+
+    vk_secondary_command_buffers.clear();
+    for (const auto& slice : recorder.slices) {
+        vk_secondary_command_buffers.push_back(slice.command_buffers[job.frame_index]);
+    }
+}
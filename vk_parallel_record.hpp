@@ -0,0 +1,75 @@
+#pragma once
+
+#include "my_utils.hpp"
+#include "vk_mesh.hpp"
+#include "vk_instancing.hpp"
+#include "job_system.hpp"
+
+
+// Parallel command buffer recording.
+//
+// The draw list of the mesh is split in slices, every slice is recorded into a secondary
+// command buffer by a job of the job system, and the primary command buffer executes them
+// with vkCmdExecuteCommands() inside a render pass begun with
+// VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS (or, with dynamic rendering, a
+// vkCmdBeginRendering() with VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT).
+// Command pools are externally synchronized (only one thread may use a pool at a time),
+// so every slice has its own pools: only one job records a slice, whichever thread runs it.
+// One pool per frame in flight, because a pool can only be reset once the GPU is done
+// with every command buffer allocated from it.
+
+
+// What the jobs record this frame.
+struct SecondaryRecordJob {
+
+    VkPipeline graphics_pipeline;
+    VkPipelineLayout pipeline_layout;
+    VkDescriptorSet frame_descriptor_set;
+    uint32_t frame_uniforms_offset;
+    VkRenderPass render_pass; // VK_NULL_HANDLE with dynamic rendering
+    VkFramebuffer framebuffer;
+    std::vector<VkFormat> color_formats; // Dynamic rendering: the attachments inherited
+    VkFormat depth_format;               // VK_FORMAT_UNDEFINED = no depth attachment
+    VkSampleCountFlagBits samples;       // Of the attachments
+    VkExtent2D extent;
+    const Mesh* mesh;
+    const FrameInstances* instances; // nullptr = no instancing
+    const uint32_t* draw_order;      // nullptr = the order of the draw list
+    uint32_t frame_index;
+};
+
+
+struct RecordSlice {
+
+    // Indexed by frame in flight.
+    std::vector<VkCommandPool> command_pools;
+    std::vector<VkCommandBuffer> command_buffers;
+};
+
+
+struct ParallelRecorder {
+
+    VkDevice device = VK_NULL_HANDLE;
+    std::vector<RecordSlice> slices;
+};
+
+
+// Creates the command pools and secondary command buffers of slices_count slices.
+void create_parallel_recorder(
+    ParallelRecorder& recorder,
+    uint32_t slices_count,
+    VkSurfaceKHR vk_surface,
+    VkPhysicalDevice vk_phys_device, VkDevice vk_logic_device,
+    uint32_t frames_in_flight);
+
+// The command buffers must not be in use by the GPU anymore.
+void destroy_parallel_recorder(ParallelRecorder& recorder);
+
+// Records the draw list of job.mesh with one job per slice, waits for them (running
+// jobs meanwhile) and returns the secondary command buffers (in draw list order).
+// The fence of job.frame_index must have been waited for.
+void record_secondary_command_buffers(
+    ParallelRecorder& recorder,
+    JobSystem& job_system,
+    const SecondaryRecordJob& job,
+    std::vector<VkCommandBuffer>& vk_secondary_command_buffers);
@@ -0,0 +1,213 @@
+#include "vk_pipeline_cache.hpp"
+
+#include <fstream>
+#include <filesystem>
+#include <cstring> // memcpy | memcmp
+
+
+// The driver validates the cache header itself, but a file that got truncated or
+// corrupted on disk can still crash some drivers. So the Vulkan blob is wrapped in
+// our own small header with the size and a checksum of the data.
+struct PipelineCacheFileHeader {
+
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t data_size;
+    uint64_t data_hash;
+};
+
+const char PIPELINE_CACHE_FILE_MAGIC[8] = { 'V', 'K', 'D', 'E', 'M', 'O', 'P', 'C' };
+const uint32_t PIPELINE_CACHE_FILE_VERSION = 1;
+
+
+// FNV-1a, good enough to detect corruption (this is not about security).
+static uint64_t hash_cache_data(const char* data, size_t size) {
+
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= static_cast<uint8_t>(data[i]);
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+
+// Reads the cache file and unwraps the Vulkan blob. Returns an empty vector
+// if the file doesn't exist or is not a well formed cache file.
+static std::vector<char> load_pipeline_cache_file(const std::string& file_name) {
+
+    std::ifstream file(file_name, std::ios::ate | std::ios::binary);
+    if (!file.is_open()) {
+        std::cout << "\t No pipeline cache found (" << file_name << "). \n";
+        return {};
+    }
+
+    size_t file_size = (size_t)file.tellg();
+    if (file_size < sizeof(PipelineCacheFileHeader)) {
+        std::cout << "\t Pipeline cache file is truncated, discarding it. \n";
+        return {};
+    }
+
+    file.seekg(0);
+
+    PipelineCacheFileHeader header;
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+    if (memcmp(header.magic, PIPELINE_CACHE_FILE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != PIPELINE_CACHE_FILE_VERSION ||
+        header.data_size != file_size - sizeof(PipelineCacheFileHeader)) {
+
+        std::cout << "\t Pipeline cache file has an unknown format or a wrong size, discarding it. \n";
+        return {};
+    }
+
+    std::vector<char> cache_data(static_cast<size_t>(header.data_size));
+    file.read(cache_data.data(), cache_data.size());
+
+    if (!file || hash_cache_data(cache_data.data(), cache_data.size()) != header.data_hash) {
+        std::cout << "\t Pipeline cache file is corrupted, discarding it. \n";
+        return {};
+    }
+
+    return cache_data;
+}
+
+
+bool is_pipeline_cache_data_valid(const std::vector<char>& cache_data, VkPhysicalDevice vk_phys_device) {
+
+    // The layout of the header is fixed by the specification (VkPipelineCacheHeaderVersionOne),
+    // it is the same for every implementation.
+    VkPipelineCacheHeaderVersionOne header;
+    if (cache_data.size() < sizeof(header)) {
+        return false;
+    }
+    memcpy(&header, cache_data.data(), sizeof(header));
+
+    VkPhysicalDeviceProperties device_properties;
+    vkGetPhysicalDeviceProperties(vk_phys_device, &device_properties);
+
+    // The pipelineCacheUUID changes with every driver update, which
+    // invalidates all the previously compiled pipelines.
+    return header.headerSize >= sizeof(header) &&
+        header.headerSize <= cache_data.size() &&
+        header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+        header.vendorID == device_properties.vendorID &&
+        header.deviceID == device_properties.deviceID &&
+        memcmp(header.pipelineCacheUUID, device_properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+
+bool create_pipeline_cache(
+    VkPipelineCache& vk_pipeline_cache,
+    VkPhysicalDevice vk_phys_device, VkDevice vk_logic_device,
+    const std::string& file_name) {
+
+    TRACE_SCOPE("create_pipeline_cache");
+    std::cout << "Creating Vulkan Pipeline cache... \n\n";
+
+    std::vector<char> cache_data;
+    if (!file_name.empty()) {
+
+        cache_data = load_pipeline_cache_file(file_name);
+
+        if (!cache_data.empty() && !is_pipeline_cache_data_valid(cache_data, vk_phys_device)) {
+            std::cout << "\t Pipeline cache was created by a different device or driver, discarding it. \n";
+            cache_data.clear();
+        }
+    }
+
+    VkPipelineCacheCreateInfo pipeline_cache_create_info{};
+    pipeline_cache_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    pipeline_cache_create_info.initialDataSize = cache_data.size();
+    pipeline_cache_create_info.pInitialData = cache_data.empty() ? nullptr : cache_data.data();
+
+    if (vkCreatePipelineCache(vk_logic_device, &pipeline_cache_create_info, nullptr, &vk_pipeline_cache) != VK_SUCCESS) {
+
+        // The driver may still reject data that passed our checks.
+        // Never fail the startup because of the cache, just start cold.
+        std::cout << "\t Driver rejected the pipeline cache data, starting with an empty cache. \n";
+        cache_data.clear();
+        pipeline_cache_create_info.initialDataSize = 0;
+        pipeline_cache_create_info.pInitialData = nullptr;
+
+        if (vkCreatePipelineCache(vk_logic_device, &pipeline_cache_create_info, nullptr, &vk_pipeline_cache) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create Vulkan Pipeline cache! \n");
+        }
+    }
+
+    bool warm = !cache_data.empty();
+    if (warm) {
+        std::cout << "\t Pipeline cache loaded: " << cache_data.size() << " bytes. \n";
+    }
+
+    std::cout << "\n" << "Vulkan Pipeline cache created (" << (warm ? "warm" : "cold") << "). \n\n";
+
+    return warm;
+}
+
+
+void save_pipeline_cache(
+    VkPipelineCache vk_pipeline_cache,
+    VkDevice vk_logic_device,
+    const std::string& file_name) {
+
+    TRACE_SCOPE("save_pipeline_cache");
+    if (file_name.empty()) {
+        return;
+    }
+
+    std::cout << "Saving Vulkan Pipeline cache to " << file_name << "... \n\n";
+
+    size_t data_size = 0;
+    if (vkGetPipelineCacheData(vk_logic_device, vk_pipeline_cache, &data_size, nullptr) != VK_SUCCESS || data_size == 0) {
+        std::cout << "\t Pipeline cache is empty, nothing to save. \n\n";
+        return;
+    }
+
+    std::vector<char> cache_data(data_size);
+    if (vkGetPipelineCacheData(vk_logic_device, vk_pipeline_cache, &data_size, cache_data.data()) != VK_SUCCESS) {
+        std::cout << "\t Failed to get the pipeline cache data, not saving it. \n\n";
+        return;
+    }
+    cache_data.resize(data_size);
+
+    PipelineCacheFileHeader header{};
+    memcpy(header.magic, PIPELINE_CACHE_FILE_MAGIC, sizeof(header.magic));
+    header.version = PIPELINE_CACHE_FILE_VERSION;
+    header.data_size = cache_data.size();
+    header.data_hash = hash_cache_data(cache_data.data(), cache_data.size());
+
+    // Write-then-rename: the rename replaces the old file in a single step,
+    // so readers either see the old cache or the new one, never half of it.
+    const std::string temp_file_name = file_name + ".tmp";
+    {
+        std::ofstream file(temp_file_name, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            std::cout << "\t Failed to open " << temp_file_name << ", not saving the pipeline cache. \n\n";
+            return;
+        }
+
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(cache_data.data(), cache_data.size());
+        file.flush();
+
+        if (!file) {
+            std::cout << "\t Failed to write " << temp_file_name << ", not saving the pipeline cache. \n\n";
+            file.close();
+            std::error_code error;
+            std::filesystem::remove(temp_file_name, error);
+            return;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temp_file_name, file_name, error);
+    if (error) {
+        std::cout << "\t Failed to replace " << file_name << ": " << error.message() << ". \n\n";
+        std::filesystem::remove(temp_file_name, error);
+        return;
+    }
+
+    std::cout << "Vulkan Pipeline cache saved: " << cache_data.size() << " bytes. \n\n";
+}
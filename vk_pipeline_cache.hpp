@@ -0,0 +1,25 @@
+#pragma once
+
+#include "my_utils.hpp"
+
+
+// Creates the pipeline cache, seeded with the data saved by a previous run if the
+// file exists and was written by the same device and driver. Stale or corrupt files
+// are discarded and we start with an empty cache.
+// Returns true if the cache was seeded from disk (warm start).
+bool create_pipeline_cache(
+    VkPipelineCache& vk_pipeline_cache,
+    VkPhysicalDevice vk_phys_device, VkDevice vk_logic_device,
+    const std::string& file_name);
+
+// Writes the content of the pipeline cache to disk. The data is first written to a
+// temporary file which is then renamed over the old one, so a crash while saving
+// can never leave a truncated cache behind.
+void save_pipeline_cache(
+    VkPipelineCache vk_pipeline_cache,
+    VkDevice vk_logic_device,
+    const std::string& file_name);
+
+// Checks the header Vulkan puts in front of the cache data against the device.
+// A cache is only usable by the same vendor, device and driver (pipelineCacheUUID).
+bool is_pipeline_cache_data_valid(const std::vector<char>& cache_data, VkPhysicalDevice vk_phys_device);
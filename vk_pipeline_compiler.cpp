@@ -0,0 +1,279 @@
+#include "vk_pipeline_compiler.hpp"
+
+#include <chrono>
+
+
+static void compile_pipeline(PipelineCompiler& compiler, CompiledPipeline& compiled) {
+
+    TRACE_SCOPE("compile_pipeline");
+
+    using clock = std::chrono::steady_clock;
+    clock::time_point compile_start = clock::now();
+
+    // The job system would keep the exception for whoever waits on the counter, but
+    // nobody waits for a single pipeline: the error is kept with the pipeline instead.
+    try {
+        create_graphics_pipeline(
+            compiled.pipeline, compiled.layout,
+            compiler.device,
+            compiler.pipeline_cache,
+            compiled.desc,
+            *compiler.job_system);
+
+        compiled.compile_ms = std::chrono::duration<double, std::milli>(clock::now() - compile_start).count();
+        compiled.status.store(PipelineStatus::Ready, std::memory_order_release);
+    }
+    catch (const std::exception& ex) {
+
+        if (compiled.layout != VK_NULL_HANDLE) {
+            vkDestroyPipelineLayout(compiler.device, compiled.layout, nullptr);
+            compiled.layout = VK_NULL_HANDLE;
+        }
+
+        compiled.error = ex.what();
+        compiled.status.store(PipelineStatus::Failed, std::memory_order_release);
+    }
+}
+
+
+// Walks the probe sequence of the hash. Returns the handle of the matching description,
+// or NULL_PIPELINE_HANDLE at the first empty slot.
+static PipelineHandle probe_lookup_table(
+    const PipelineCompiler& compiler,
+    const PipelineLookupTable* table,
+    const GraphicsPipelineDesc& desc, uint64_t desc_hash) {
+
+    if (table == nullptr) {
+        return NULL_PIPELINE_HANDLE;
+    }
+
+    size_t mask = table->slots.size() - 1;
+
+    for (size_t i = desc_hash & mask; ; i = (i + 1) & mask) {
+
+        const PipelineLookupSlot& slot = table->slots[i];
+
+        if (slot.handle == NULL_PIPELINE_HANDLE) {
+            return NULL_PIPELINE_HANDLE;
+        }
+
+        // Equal hashes are compared in full: a collision must never hand out the wrong pipeline.
+        if (slot.hash == desc_hash &&
+            compiler.pipelines[slot.handle].load(std::memory_order_acquire)->desc == desc) {
+            return slot.handle;
+        }
+    }
+}
+
+
+static void insert_lookup_slot(PipelineLookupTable& table, uint64_t desc_hash, PipelineHandle handle) {
+
+    size_t mask = table.slots.size() - 1;
+    size_t i = desc_hash & mask;
+
+    while (table.slots[i].handle != NULL_PIPELINE_HANDLE) {
+        i = (i + 1) & mask;
+    }
+
+    table.slots[i].hash = desc_hash;
+    table.slots[i].handle = handle;
+}
+
+
+// Starts the compile job of a new pipeline. Called with the mutex held.
+static PipelineHandle submit_graphics_pipeline(PipelineCompiler& compiler, const GraphicsPipelineDesc& desc) {
+
+    uint32_t count = compiler.pipelines_count.load(std::memory_order_relaxed);
+    if (count == MAX_PIPELINES) {
+        throw std::runtime_error("Too many pipelines, the limit is " + std::to_string(MAX_PIPELINES) + "! \n");
+    }
+
+    PipelineHandle handle = count;
+
+    compiler.owned_pipelines.push_back(std::make_unique<CompiledPipeline>());
+    CompiledPipeline* compiled = compiler.owned_pipelines.back().get();
+    compiled->desc = desc;
+
+    compiler.pipelines[handle].store(compiled, std::memory_order_release);
+    compiler.pipelines_count.store(count + 1, std::memory_order_release);
+
+    run_job(*compiler.job_system, [&compiler, compiled]() {
+        compile_pipeline(compiler, *compiled);
+    }, compiler.compile_counter);
+
+    return handle;
+}
+
+
+void create_pipeline_compiler(
+    PipelineCompiler& compiler,
+    VkDevice vk_logic_device,
+    VkPipelineCache vk_pipeline_cache,
+    JobSystem& job_system) {
+
+    compiler.device = vk_logic_device;
+    compiler.pipeline_cache = vk_pipeline_cache;
+    compiler.job_system = &job_system;
+
+    compiler.pipelines = std::make_unique<std::atomic<CompiledPipeline*>[]>(MAX_PIPELINES);
+    for (uint32_t i = 0; i < MAX_PIPELINES; i++) {
+        compiler.pipelines[i].store(nullptr, std::memory_order_relaxed);
+    }
+    compiler.pipelines_count.store(0);
+    compiler.lookup_table.store(nullptr);
+    compiler.lookup_hits.store(0);
+    compiler.lookup_misses.store(0);
+}
+
+
+void destroy_pipeline_compiler(PipelineCompiler& compiler) {
+
+    wait_for_pipelines(compiler);
+
+    for (auto& compiled : compiler.owned_pipelines) {
+        if (compiled->pipeline != VK_NULL_HANDLE) {
+            vkDestroyPipeline(compiler.device, compiled->pipeline, nullptr);
+        }
+        if (compiled->layout != VK_NULL_HANDLE) {
+            vkDestroyPipelineLayout(compiler.device, compiled->layout, nullptr);
+        }
+    }
+
+    compiler.lookup_table.store(nullptr);
+    compiler.owned_tables.clear();
+    compiler.owned_pipelines.clear();
+    compiler.pipelines.reset();
+    compiler.pipelines_count.store(0);
+}
+
+
+PipelineHandle request_graphics_pipeline(
+    PipelineCompiler& compiler,
+    const GraphicsPipelineDesc& desc, uint64_t desc_hash) {
+
+    // Read path: no lock.
+    PipelineHandle handle = find_graphics_pipeline(compiler, desc, desc_hash);
+    if (handle != NULL_PIPELINE_HANDLE) {
+        compiler.lookup_hits.fetch_add(1, std::memory_order_relaxed);
+        return handle;
+    }
+
+    bool compile_now = false;
+    {
+        std::lock_guard<std::mutex> lock(compiler.mutex);
+
+        // Another thread may have added it since we looked.
+        const PipelineLookupTable* table = compiler.lookup_table.load(std::memory_order_acquire);
+        handle = probe_lookup_table(compiler, table, desc, desc_hash);
+        if (handle != NULL_PIPELINE_HANDLE) {
+            compiler.lookup_hits.fetch_add(1, std::memory_order_relaxed);
+            return handle;
+        }
+
+        compiler.lookup_misses.fetch_add(1, std::memory_order_relaxed);
+        handle = submit_graphics_pipeline(compiler, desc);
+
+        // Copy into a new table with room for the new entry, at most half full.
+        uint32_t count = compiler.pipelines_count.load(std::memory_order_relaxed);
+        size_t slots_count = 16;
+        while (slots_count < static_cast<size_t>(count) * 2) {
+            slots_count *= 2;
+        }
+
+        auto new_table = std::make_unique<PipelineLookupTable>();
+        new_table->slots.resize(slots_count);
+        if (table != nullptr) {
+            for (const auto& slot : table->slots) {
+                if (slot.handle != NULL_PIPELINE_HANDLE) {
+                    insert_lookup_slot(*new_table, slot.hash, slot.handle);
+                }
+            }
+        }
+        insert_lookup_slot(*new_table, desc_hash, handle);
+
+        // Release: the readers that see the new table see its slots and the new pipeline.
+        compiler.lookup_table.store(new_table.get(), std::memory_order_release);
+        compiler.owned_tables.push_back(std::move(new_table));
+
+        compile_now = compiler.job_system->workers.empty();
+    }
+
+    if (compile_now) {
+        wait_for_pipelines(compiler);
+    }
+
+    return handle;
+}
+
+
+PipelineHandle find_graphics_pipeline(
+    const PipelineCompiler& compiler,
+    const GraphicsPipelineDesc& desc, uint64_t desc_hash) {
+
+    const PipelineLookupTable* table = compiler.lookup_table.load(std::memory_order_acquire);
+    return probe_lookup_table(compiler, table, desc, desc_hash);
+}
+
+
+const CompiledPipeline& get_compiled_pipeline(const PipelineCompiler& compiler, PipelineHandle handle) {
+
+    return *compiler.pipelines[handle].load(std::memory_order_acquire);
+}
+
+
+PipelineStatus get_pipeline_status(const PipelineCompiler& compiler, PipelineHandle handle) {
+
+    return get_compiled_pipeline(compiler, handle).status.load(std::memory_order_acquire);
+}
+
+
+VkPipeline get_ready_pipeline(
+    const PipelineCompiler& compiler,
+    PipelineHandle handle,
+    PipelineHandle fallback_handle) {
+
+    PipelineStatus status = get_pipeline_status(compiler, handle);
+
+    if (status == PipelineStatus::Ready) {
+        return get_compiled_pipeline(compiler, handle).pipeline;
+    }
+
+    if (fallback_handle != NULL_PIPELINE_HANDLE &&
+        get_pipeline_status(compiler, fallback_handle) == PipelineStatus::Ready) {
+        return get_compiled_pipeline(compiler, fallback_handle).pipeline;
+    }
+
+    if (status == PipelineStatus::Failed) {
+        throw std::runtime_error("Failed to compile Vulkan Graphics Pipeline: " + get_compiled_pipeline(compiler, handle).error);
+    }
+
+    return VK_NULL_HANDLE;
+}
+
+
+void wait_for_pipelines(PipelineCompiler& compiler) {
+
+    TRACE_SCOPE("wait_for_pipelines");
+    wait_for_counter(*compiler.job_system, compiler.compile_counter);
+}
+
+
+void print_pipeline_stats(const PipelineCompiler& compiler) {
+
+    uint32_t count = compiler.pipelines_count.load();
+    uint32_t ready = 0;
+    double compile_ms = 0.0;
+
+    for (uint32_t i = 0; i < count; i++) {
+        const CompiledPipeline& compiled = get_compiled_pipeline(compiler, i);
+        if (compiled.status.load(std::memory_order_acquire) == PipelineStatus::Ready) {
+            ready++;
+            compile_ms += compiled.compile_ms;
+        }
+    }
+
+    std::cout << "Pipeline statistics: \n";
+    std::cout << "\t Pipelines: " << count << " (" << ready << " ready, " << compile_ms << " ms compiling). \n";
+    std::cout << "\t Lookups: " << compiler.lookup_hits.load() << " hits, "
+        << compiler.lookup_misses.load() << " misses. \n\n";
+}
@@ -0,0 +1,153 @@
+#pragma once
+
+#include "my_utils.hpp"
+#include "vk_graphics_pipeline.hpp"
+#include "job_system.hpp"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+
+// Asynchronous pipeline compilation.
+//
+// vkCreateGraphicsPipelines() is where the driver compiles the shaders to GPU code:
+// tens to hundreds of milliseconds per pipeline with a cold cache. Done in the middle
+// of init_vulkan() it delays the first frame by the compile time of every pipeline.
+//
+// Instead, pipelines are submitted to the compiler, which compiles each of them as a
+// job of the job system (so several pipelines compile in parallel) and hands back a
+// handle right away. Every frame the renderer asks for the pipeline of the handle:
+// until it is ready it gets the fallback pipeline (if that one is ready) or nothing,
+// and skips the draws that need it. The first frames are only cleared, but they are
+// presented long before the compilation is done.
+//
+// The pipeline cache is internally synchronized, the jobs can all use the same one.
+//
+// Pipelines are requested by description (see GraphicsPipelineDesc): requesting a
+// description that was already requested returns the same handle, nothing is compiled
+// twice. Lookups happen for every draw, from any thread, so they never take a lock:
+// they read an immutable hash table (open addressing, keyed by the hash of the
+// description). A miss takes the lock, builds a larger copy of the table with the new
+// pipeline and publishes it with an atomic pointer swap. Old tables are kept until the
+// compiler is destroyed, a reader may still be walking one of them. There are only as
+// many tables as misses, and misses are rare after startup.
+
+
+using PipelineHandle = uint32_t;
+
+const PipelineHandle NULL_PIPELINE_HANDLE = UINT32_MAX;
+
+// Handles index a fixed array, so that it never moves under the readers.
+const uint32_t MAX_PIPELINES = 4096;
+
+
+enum class PipelineStatus {
+
+    Pending,
+    Ready,
+    Failed
+};
+
+
+struct CompiledPipeline {
+
+    GraphicsPipelineDesc desc;
+
+    // Written by the job before it publishes Ready (release), so a thread that reads
+    // Ready (acquire) sees the pipeline and layout too.
+    std::atomic<PipelineStatus> status{ PipelineStatus::Pending };
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    VkPipelineLayout layout = VK_NULL_HANDLE;
+
+    double compile_ms = 0.0;
+    std::string error; // Failed only
+};
+
+
+struct PipelineLookupSlot {
+
+    uint64_t hash = 0;
+    PipelineHandle handle = NULL_PIPELINE_HANDLE; // NULL_PIPELINE_HANDLE: empty slot
+};
+
+
+// Never modified once published. Kept at most half full, so probes stay short.
+struct PipelineLookupTable {
+
+    std::vector<PipelineLookupSlot> slots; // Power of two
+};
+
+
+struct PipelineCompiler {
+
+    VkDevice device = VK_NULL_HANDLE;
+    VkPipelineCache pipeline_cache = VK_NULL_HANDLE;
+    JobSystem* job_system = nullptr;
+
+    // Indexed by handle, MAX_PIPELINES entries. A slot is written once, before its
+    // handle is published in the lookup table (release).
+    std::unique_ptr<std::atomic<CompiledPipeline*>[]> pipelines;
+    std::atomic<uint32_t> pipelines_count{ 0 };
+
+    std::atomic<const PipelineLookupTable*> lookup_table{ nullptr };
+
+    // Taken by misses only: owns the pipelines and every table published so far.
+    std::mutex mutex;
+    std::vector<std::unique_ptr<CompiledPipeline>> owned_pipelines;
+    std::vector<std::unique_ptr<PipelineLookupTable>> owned_tables;
+
+    std::atomic<uint64_t> lookup_hits{ 0 };
+    std::atomic<uint64_t> lookup_misses{ 0 };
+
+    // Every compile job, so that they can all be waited for.
+    JobCounter compile_counter;
+};
+
+
+void create_pipeline_compiler(
+    PipelineCompiler& compiler,
+    VkDevice vk_logic_device,
+    VkPipelineCache vk_pipeline_cache,
+    JobSystem& job_system);
+
+// Waits for the pipelines still compiling, then destroys all of them.
+// The GPU must be done with them.
+void destroy_pipeline_compiler(PipelineCompiler& compiler);
+
+// Returns the handle of the pipeline of this description. The first request of a
+// description starts compiling it in the background (a miss), the next ones return
+// the same handle (hits). desc_hash must be hash_pipeline_desc(desc), computed once
+// by the caller. Can be called from any thread.
+// Without worker threads nothing would run the compile job until someone waits for
+// it, so in that case a miss compiles the pipeline before returning.
+PipelineHandle request_graphics_pipeline(
+    PipelineCompiler& compiler,
+    const GraphicsPipelineDesc& desc, uint64_t desc_hash);
+
+inline PipelineHandle request_graphics_pipeline(PipelineCompiler& compiler, const GraphicsPipelineDesc& desc) {
+    return request_graphics_pipeline(compiler, desc, hash_pipeline_desc(desc));
+}
+
+// Lock-free lookup. NULL_PIPELINE_HANDLE if the description was never requested.
+PipelineHandle find_graphics_pipeline(
+    const PipelineCompiler& compiler,
+    const GraphicsPipelineDesc& desc, uint64_t desc_hash);
+
+const CompiledPipeline& get_compiled_pipeline(const PipelineCompiler& compiler, PipelineHandle handle);
+
+PipelineStatus get_pipeline_status(const PipelineCompiler& compiler, PipelineHandle handle);
+
+// The pipeline of the handle if it is ready, otherwise the pipeline of the fallback
+// handle if that one is ready, otherwise VK_NULL_HANDLE (skip the draws).
+// Throws if the pipeline failed to compile and there is no fallback to draw with.
+VkPipeline get_ready_pipeline(
+    const PipelineCompiler& compiler,
+    PipelineHandle handle,
+    PipelineHandle fallback_handle = NULL_PIPELINE_HANDLE);
+
+// Blocks until every submitted pipeline is compiled (running jobs meanwhile).
+void wait_for_pipelines(PipelineCompiler& compiler);
+
+// Pipelines compiled, lookup hits and misses.
+void print_pipeline_stats(const PipelineCompiler& compiler);
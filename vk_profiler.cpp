@@ -0,0 +1,337 @@
+#include "vk_profiler.hpp"
+#include "vk_queue_family.hpp"
+
+#include <algorithm> // std::sort
+#include <fstream>
+#include <cmath> // std::ceil
+#include <cstdio> // snprintf
+
+
+const char* profile_scope_to_string(ProfileScope scope) {
+
+    switch (scope) {
+    case ProfileScope::FenceWait:   return "fence_wait";
+    case ProfileScope::Acquire:     return "acquire";
+    case ProfileScope::Record:      return "record";
+    case ProfileScope::Descriptors: return "descriptors";
+    case ProfileScope::Culling:     return "culling";
+    case ProfileScope::Uploads:     return "uploads";
+    case ProfileScope::Submit:      return "submit";
+    case ProfileScope::Present:     return "present";
+    case ProfileScope::Gpu:         return "gpu";
+    default:                        return "unknown";
+    }
+}
+
+
+void Profiler::begin_frame(uint64_t frame_number) {
+
+    current_frame.frame_number = frame_number;
+    current_frame.scope_ms.fill(-1.0);
+}
+
+
+void Profiler::add_cpu_time(ProfileScope scope, double ms) {
+
+    double& scope_ms = current_frame.scope_ms[static_cast<size_t>(scope)];
+    scope_ms = (scope_ms < 0.0 ? 0.0 : scope_ms) + ms;
+}
+
+
+void Profiler::end_frame() {
+
+    // The ring buffer is indexed by frame number, so the GPU timings that
+    // arrive frames_in_flight frames later can find their frame.
+    if (history.empty()) {
+        history.resize(PROFILER_HISTORY_SIZE, FrameTimings{ UINT64_MAX, {} });
+    }
+    history[current_frame.frame_number % PROFILER_HISTORY_SIZE] = current_frame;
+    frames_count++;
+
+    clock::time_point now = clock::now();
+    if (std::chrono::duration<double, std::milli>(now - last_report).count() < PROFILER_REPORT_INTERVAL_MS) {
+        return;
+    }
+    last_report = now;
+
+    // Printed from inside the frame loop, so through the async logger.
+    char line[LOG_MESSAGE_SIZE];
+    int length = snprintf(line, sizeof(line), "\t Profiler p50/p95/p99 (ms)");
+
+    for (size_t i = 0; i < PROFILE_SCOPES_COUNT && length > 0 && length < static_cast<int>(sizeof(line)); i++) {
+
+        TimingPercentiles percentiles = compute_percentiles(static_cast<ProfileScope>(i));
+        if (percentiles.samples == 0) {
+            continue;
+        }
+
+        length += snprintf(line + length, sizeof(line) - length, " | %s: %.3f/%.3f/%.3f",
+            profile_scope_to_string(static_cast<ProfileScope>(i)),
+            percentiles.p50, percentiles.p95, percentiles.p99);
+    }
+
+    LOG_INFO("%s", line);
+}
+
+
+std::vector<double> Profiler::get_samples(ProfileScope scope) const {
+
+    std::vector<double> samples;
+    samples.reserve(history.size());
+    for (const auto& frame : history) {
+        if (frame.frame_number != UINT64_MAX && frame.scope_ms[static_cast<size_t>(scope)] >= 0.0) {
+            samples.push_back(frame.scope_ms[static_cast<size_t>(scope)]);
+        }
+    }
+    return samples;
+}
+
+
+TimingPercentiles Profiler::compute_percentiles(ProfileScope scope) const {
+
+    TimingPercentiles percentiles;
+
+    std::vector<double> samples = get_samples(scope);
+
+    if (samples.empty()) {
+        return percentiles;
+    }
+
+    std::sort(samples.begin(), samples.end());
+
+    // Nearest-rank percentile
+    auto percentile = [&samples](double p) {
+        size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * samples.size()));
+        return samples[std::min(std::max<size_t>(rank, 1), samples.size()) - 1];
+    };
+
+    double sum = 0.0;
+    for (double sample : samples) {
+        sum += sample;
+    }
+
+    percentiles.p50 = percentile(50.0);
+    percentiles.p95 = percentile(95.0);
+    percentiles.p99 = percentile(99.0);
+    percentiles.mean = sum / samples.size();
+    percentiles.samples = samples.size();
+
+    return percentiles;
+}
+
+
+void Profiler::print_summary() const {
+
+    std::cout << "Profiler summary (last " << std::min<uint64_t>(frames_count, PROFILER_HISTORY_SIZE) << " frames): \n";
+
+    for (size_t i = 0; i < PROFILE_SCOPES_COUNT; i++) {
+
+        TimingPercentiles percentiles = compute_percentiles(static_cast<ProfileScope>(i));
+        if (percentiles.samples == 0) {
+            continue;
+        }
+
+        std::cout << "\t " << profile_scope_to_string(static_cast<ProfileScope>(i))
+            << ": p50 " << percentiles.p50 << " ms"
+            << " | p95 " << percentiles.p95 << " ms"
+            << " | p99 " << percentiles.p99 << " ms"
+            << " | mean " << percentiles.mean << " ms. \n";
+    }
+
+    if (timestamp_query_pool == VK_NULL_HANDLE) {
+        std::cout << "\t GPU timestamps not supported by the graphics queue. \n";
+    }
+    std::cout << "\n";
+}
+
+
+void create_profiler(
+    Profiler& profiler,
+    VkSurfaceKHR vk_surface,
+    VkPhysicalDevice vk_phys_device, VkDevice vk_logic_device,
+    uint32_t frames_in_flight) {
+
+    TRACE_SCOPE("create_profiler");
+    std::cout << "Creating Profiler... \n\n";
+
+    profiler.pending_queries.assign(frames_in_flight, -1);
+    profiler.last_report = Profiler::clock::now();
+
+    // Timestamps are written by the graphics queue, so that family must support them.
+    QueueFamilyIndices queue_family_indices = find_queue_families(vk_surface, vk_phys_device);
+
+    uint32_t queue_family_count = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(vk_phys_device, &queue_family_count, nullptr);
+    std::vector<VkQueueFamilyProperties> queue_families(queue_family_count);
+    vkGetPhysicalDeviceQueueFamilyProperties(vk_phys_device, &queue_family_count, queue_families.data());
+
+    uint32_t timestamp_valid_bits = queue_families[queue_family_indices.graphics_family.value()].timestampValidBits;
+    if (timestamp_valid_bits == 0) {
+        std::cout << "\t Graphics queue doesn't support timestamps, GPU timings disabled. \n\n";
+        std::cout << "Profiler created (CPU only). \n\n";
+        return;
+    }
+
+    VkPhysicalDeviceProperties device_properties;
+    vkGetPhysicalDeviceProperties(vk_phys_device, &device_properties);
+
+    // Timestamps are in "ticks", timestampPeriod is the number of nanoseconds per tick.
+    // Only the lower timestampValidBits bits of a timestamp are meaningful.
+    profiler.timestamp_period_ns = device_properties.limits.timestampPeriod;
+    profiler.timestamp_mask = timestamp_valid_bits >= 64 ? ~0ULL : ((1ULL << timestamp_valid_bits) - 1);
+
+    // Two timestamps (begin, end) per frame in flight.
+    VkQueryPoolCreateInfo query_pool_create_info{};
+    query_pool_create_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    query_pool_create_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    query_pool_create_info.queryCount = frames_in_flight * 2;
+
+    if (vkCreateQueryPool(vk_logic_device, &query_pool_create_info, nullptr, &profiler.timestamp_query_pool) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create Vulkan Timestamp query pool! \n");
+    }
+
+    std::cout << "\t Timestamp period: " << profiler.timestamp_period_ns << " ns"
+        << " (" << timestamp_valid_bits << " valid bits). \n\n";
+
+    std::cout << "Profiler created. \n\n";
+}
+
+
+void destroy_profiler(Profiler& profiler, VkDevice vk_logic_device) {
+
+    if (profiler.timestamp_query_pool != VK_NULL_HANDLE) {
+        vkDestroyQueryPool(vk_logic_device, profiler.timestamp_query_pool, nullptr);
+        profiler.timestamp_query_pool = VK_NULL_HANDLE;
+    }
+}
+
+
+void collect_gpu_timings(Profiler& profiler, VkDevice vk_logic_device, uint32_t frame_index) {
+
+    if (profiler.timestamp_query_pool == VK_NULL_HANDLE || profiler.pending_queries[frame_index] < 0) {
+        return;
+    }
+
+    uint64_t frame_number = static_cast<uint64_t>(profiler.pending_queries[frame_index]);
+    profiler.pending_queries[frame_index] = -1;
+
+    // The fence of the frame has been waited for, so the results are available:
+    // no VK_QUERY_RESULT_WAIT_BIT, this never blocks.
+    uint64_t timestamps[2] = {};
+    if (vkGetQueryPoolResults(
+        vk_logic_device,
+        profiler.timestamp_query_pool,
+        first_timestamp_query(frame_index), 2,
+        sizeof(timestamps), timestamps, sizeof(uint64_t),
+        VK_QUERY_RESULT_64_BIT) != VK_SUCCESS) {
+
+        return;
+    }
+
+    uint64_t ticks = ((timestamps[1] & profiler.timestamp_mask) - (timestamps[0] & profiler.timestamp_mask)) & profiler.timestamp_mask;
+    double gpu_ms = ticks * profiler.timestamp_period_ns / 1e6;
+
+    // The frame may have already left the ring buffer if the history is shorter
+    // than the number of frames in flight (it never is, but better safe than sorry).
+    if (profiler.history.empty()) {
+        return;
+    }
+    FrameTimings& frame = profiler.history[frame_number % PROFILER_HISTORY_SIZE];
+    if (frame.frame_number == frame_number) {
+        frame.scope_ms[static_cast<size_t>(ProfileScope::Gpu)] = gpu_ms;
+    }
+}
+
+
+void mark_gpu_timings_pending(Profiler& profiler, uint32_t frame_index, uint64_t frame_number) {
+
+    if (profiler.timestamp_query_pool != VK_NULL_HANDLE) {
+        profiler.pending_queries[frame_index] = static_cast<int64_t>(frame_number);
+    }
+}
+
+
+void save_profiler_report(const Profiler& profiler, const std::string& file_name) {
+
+    std::cout << "Saving profiler report to " << file_name << "... \n\n";
+
+    std::ofstream file(file_name);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open file: " + file_name + " \n");
+    }
+
+    // Frames in order, oldest first.
+    std::vector<FrameTimings> frames;
+    for (const auto& frame : profiler.history) {
+        if (frame.frame_number != UINT64_MAX) {
+            frames.push_back(frame);
+        }
+    }
+    std::sort(frames.begin(), frames.end(), [](const FrameTimings& a, const FrameTimings& b) {
+        return a.frame_number < b.frame_number;
+    });
+
+    bool csv = file_name.size() >= 4 && file_name.compare(file_name.size() - 4, 4, ".csv") == 0;
+
+    if (csv) {
+
+        // One row per frame, empty cell = not measured.
+        file << "frame";
+        for (size_t i = 0; i < PROFILE_SCOPES_COUNT; i++) {
+            file << "," << profile_scope_to_string(static_cast<ProfileScope>(i)) << "_ms";
+        }
+        file << "\n";
+
+        for (const auto& frame : frames) {
+            file << frame.frame_number;
+            for (double ms : frame.scope_ms) {
+                file << ",";
+                if (ms >= 0.0) {
+                    file << ms;
+                }
+            }
+            file << "\n";
+        }
+    }
+    else {
+
+        file << "{\n  \"summary\": {";
+        bool first_scope = true;
+        for (size_t i = 0; i < PROFILE_SCOPES_COUNT; i++) {
+
+            TimingPercentiles percentiles = profiler.compute_percentiles(static_cast<ProfileScope>(i));
+            if (percentiles.samples == 0) {
+                continue;
+            }
+
+            file << (first_scope ? "\n" : ",\n");
+            first_scope = false;
+
+            file << "    \"" << profile_scope_to_string(static_cast<ProfileScope>(i)) << "\": { "
+                << "\"p50_ms\": " << percentiles.p50 << ", "
+                << "\"p95_ms\": " << percentiles.p95 << ", "
+                << "\"p99_ms\": " << percentiles.p99 << ", "
+                << "\"mean_ms\": " << percentiles.mean << ", "
+                << "\"samples\": " << percentiles.samples << " }";
+        }
+        file << "\n  },\n  \"frames\": [";
+
+        for (size_t f = 0; f < frames.size(); f++) {
+
+            file << (f == 0 ? "\n" : ",\n") << "    { \"frame\": " << frames[f].frame_number;
+            for (size_t i = 0; i < PROFILE_SCOPES_COUNT; i++) {
+                if (frames[f].scope_ms[i] >= 0.0) {
+                    file << ", \"" << profile_scope_to_string(static_cast<ProfileScope>(i)) << "_ms\": " << frames[f].scope_ms[i];
+                }
+            }
+            file << " }";
+        }
+        file << "\n  ]\n}\n";
+    }
+
+    if (!file) {
+        throw std::runtime_error("Failed to write file: " + file_name + " \n");
+    }
+
+    std::cout << "Profiler report saved (" << frames.size() << " frames). \n\n";
+}
@@ -0,0 +1,147 @@
+#pragma once
+
+#include "my_utils.hpp"
+
+#include <array>
+#include <chrono>
+
+
+// How many frames the profiler remembers. The percentiles are computed over
+// this window and the report written at exit contains these frames.
+const size_t PROFILER_HISTORY_SIZE = 1024;
+
+// How often the profiler line is printed.
+const double PROFILER_REPORT_INTERVAL_MS = 1000.0;
+
+
+// What gets timed every frame. All but Gpu are measured on the CPU.
+enum class ProfileScope {
+
+    FenceWait,   // Waiting for the GPU to release the frame in flight
+    Acquire,     // vkAcquireNextImageKHR()
+    Record,      // Recording the command buffer
+    Descriptors, // Resetting the frame descriptor allocator, allocating and writing the sets
+    Culling,     // Frustum culling on the CPU, or preparing the culling dispatch (see vk_culling.hpp)
+    Uploads,     // Copying and submitting the streamed uploads (see vk_upload_scheduler.hpp)
+    Submit,      // vkQueueSubmit()
+    Present,     // vkQueuePresentKHR()
+    Gpu,         // GPU time of the render pass (timestamp queries)
+
+    Count
+};
+
+const size_t PROFILE_SCOPES_COUNT = static_cast<size_t>(ProfileScope::Count);
+
+const char* profile_scope_to_string(ProfileScope scope);
+
+
+// Timings of a single frame, in milliseconds (negative = not measured).
+struct FrameTimings {
+
+    uint64_t frame_number;
+    std::array<double, PROFILE_SCOPES_COUNT> scope_ms;
+};
+
+
+struct TimingPercentiles {
+
+    double p50 = 0.0;
+    double p95 = 0.0;
+    double p99 = 0.0;
+    double mean = 0.0;
+    size_t samples = 0;
+};
+
+
+// Frame timing profiler.
+// The CPU side uses scoped timers (ProfileTimer) around the interesting calls.
+// The GPU side writes two timestamps around the render pass, in a query pool with
+// two queries per frame in flight. The results are read back once the fence of the
+// frame has been waited for, so reading them never stalls.
+// Every frame ends up in a ring buffer, the percentiles are computed over it.
+struct Profiler {
+
+    using clock = std::chrono::steady_clock;
+
+    VkQueryPool timestamp_query_pool = VK_NULL_HANDLE; // VK_NULL_HANDLE if timestamps are not supported
+    double timestamp_period_ns = 1.0;
+    uint64_t timestamp_mask = ~0ULL;
+
+    // Frame number whose timestamps are pending in each frame in flight slot (-1 = none).
+    std::vector<int64_t> pending_queries;
+
+    // Ring buffer of the last PROFILER_HISTORY_SIZE frames.
+    std::vector<FrameTimings> history;
+    uint64_t frames_count = 0;
+
+    FrameTimings current_frame{};
+    clock::time_point last_report;
+
+    // Starts the timings of a new frame.
+    void begin_frame(uint64_t frame_number);
+
+    // Adds time to a scope of the current frame.
+    void add_cpu_time(ProfileScope scope, double ms);
+
+    // Stores the current frame in the history and prints the periodic line.
+    void end_frame();
+
+    // The timings of a scope in the history, in frame order of the ring buffer (unsorted).
+    std::vector<double> get_samples(ProfileScope scope) const;
+
+    TimingPercentiles compute_percentiles(ProfileScope scope) const;
+
+    void print_summary() const;
+};
+
+
+// Times the enclosing scope and adds it to the current frame of the profiler.
+// The scope also shows up in the trace (see vk_trace.hpp), if tracing.
+struct ProfileTimer {
+
+    Profiler& profiler;
+    ProfileScope scope;
+    Profiler::clock::time_point start;
+
+    ProfileTimer(Profiler& target_profiler, ProfileScope timed_scope)
+        : profiler(target_profiler), scope(timed_scope), start(Profiler::clock::now()) {
+
+        trace_begin(profile_scope_to_string(scope));
+    }
+
+    ~ProfileTimer() {
+        profiler.add_cpu_time(
+            scope,
+            std::chrono::duration<double, std::milli>(Profiler::clock::now() - start).count());
+
+        trace_end(profile_scope_to_string(scope));
+    }
+};
+
+
+// Creates the timestamp query pool. If the graphics queue doesn't support
+// timestamps (timestampValidBits == 0) only the CPU timings are collected.
+void create_profiler(
+    Profiler& profiler,
+    VkSurfaceKHR vk_surface,
+    VkPhysicalDevice vk_phys_device, VkDevice vk_logic_device,
+    uint32_t frames_in_flight);
+
+void destroy_profiler(Profiler& profiler, VkDevice vk_logic_device);
+
+// Reads the GPU timestamps of the frame previously submitted with this frame in flight
+// slot. Must be called after its fence has been waited for.
+void collect_gpu_timings(Profiler& profiler, VkDevice vk_logic_device, uint32_t frame_index);
+
+// Marks the timestamps of this frame in flight slot as pending for frame_number.
+// Called when the command buffer recorded with first_timestamp_query() is submitted.
+void mark_gpu_timings_pending(Profiler& profiler, uint32_t frame_index, uint64_t frame_number);
+
+// Index of the first of the two timestamp queries of a frame in flight slot.
+inline uint32_t first_timestamp_query(uint32_t frame_index) {
+    return frame_index * 2;
+}
+
+// Writes the last PROFILER_HISTORY_SIZE frames and the percentiles to a file.
+// The format follows the extension: .csv (one row per frame) or JSON otherwise.
+void save_profiler_report(const Profiler& profiler, const std::string& file_name);
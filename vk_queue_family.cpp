@@ -20,27 +20,75 @@ QueueFamilyIndices find_queue_families(VkSurfaceKHR vk_surface, VkPhysicalDevice
     // So we need to find a queue family that supports presenting to the surface created.
     // It is possible that queue families supporting drawing commands and the ones supporting
     // presentation do not overlap.
-    int index = 0;
+    std::optional<uint32_t> dedicated_transfer_family;
+    std::optional<uint32_t> non_graphics_transfer_family;
+    std::optional<uint32_t> async_compute_family;
+
+    uint32_t index = 0;
     for (const auto& queue_family : queue_families) {
 
-        if (queue_family.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+        if ((queue_family.queueFlags & VK_QUEUE_GRAPHICS_BIT) && !family_indices.graphics_family.has_value()) {
             family_indices.graphics_family = index;
         }
 
-        VkBool32 present_queue_support = false;
-        vkGetPhysicalDeviceSurfaceSupportKHR(phys_device, index, vk_surface, &present_queue_support);
+        // A family with only the transfer bit is usually the DMA engine of the GPU.
+        if (queue_family.queueFlags & VK_QUEUE_TRANSFER_BIT) {
 
-        if (present_queue_support) {
-            family_indices.present_family = index;
+            bool no_graphics = (queue_family.queueFlags & VK_QUEUE_GRAPHICS_BIT) == 0;
+            bool no_compute = (queue_family.queueFlags & VK_QUEUE_COMPUTE_BIT) == 0;
+
+            if (no_graphics && no_compute && !dedicated_transfer_family.has_value()) {
+                dedicated_transfer_family = index;
+            }
+            if (no_graphics && !non_graphics_transfer_family.has_value()) {
+                non_graphics_transfer_family = index;
+            }
+        }
+
+        // A compute family without graphics runs on the async compute engines (if any).
+        if ((queue_family.queueFlags & VK_QUEUE_COMPUTE_BIT) &&
+            !(queue_family.queueFlags & VK_QUEUE_GRAPHICS_BIT) &&
+            !async_compute_family.has_value()) {
+
+            async_compute_family = index;
+        }
+
+        // Running headless nothing is ever presented, so the graphics family
+        // also stands in for the present family.
+        VkBool32 present_queue_support = false;
+        if (is_headless(vk_surface)) {
+            present_queue_support = (queue_family.queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0;
+        }
+        else {
+            vkGetPhysicalDeviceSurfaceSupportKHR(phys_device, index, vk_surface, &present_queue_support);
         }
 
-        if (family_indices.is_complete()) {
-            break;
+        // Prefer presenting from the graphics family, which avoids sharing
+        // the swapchain images between two families.
+        if (present_queue_support &&
+            (!family_indices.present_family.has_value() || family_indices.graphics_family == index)) {
+
+            family_indices.present_family = index;
         }
 
         index++;
     }
 
+    if (dedicated_transfer_family.has_value()) {
+        family_indices.transfer_family = dedicated_transfer_family;
+    }
+    else if (non_graphics_transfer_family.has_value()) {
+        family_indices.transfer_family = non_graphics_transfer_family;
+    }
+    else {
+        family_indices.transfer_family = family_indices.graphics_family;
+    }
+
+    // Otherwise compute runs on the graphics queue (in practice the graphics family
+    // always supports compute too).
+    family_indices.compute_family = async_compute_family.has_value() ?
+        async_compute_family : family_indices.graphics_family;
+
 #ifdef _DEBUG
     std::cout << "\t\t Available Vulkan Queue Families: " << queue_families_count << ".\n";
     std::cout << "\t\t Listing all queue families: \n";
@@ -9,6 +9,15 @@ struct QueueFamilyIndices {
     std::optional<uint32_t> graphics_family;
     std::optional<uint32_t> present_family;
 
+    // Family used for uploads. A dedicated transfer family (DMA engine) if the device
+    // has one, so that copies run in parallel with rendering, otherwise the graphics
+    // family (every graphics family supports transfers, even without the bit set).
+    std::optional<uint32_t> transfer_family;
+
+    // Family for async compute. A compute family without graphics if the device has
+    // one, so that compute work can overlap the graphics queue, otherwise the graphics family.
+    std::optional<uint32_t> compute_family;
+
     bool is_complete() {
         return graphics_family.has_value() && present_family.has_value();
     }
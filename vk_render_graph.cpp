@@ -0,0 +1,1252 @@
+#include "vk_render_graph.hpp"
+
+#include <algorithm> // std::sort | std::max
+
+
+RenderGraphAccessInfo get_render_graph_access_info(RenderGraphAccess access) {
+
+    switch (access) {
+    case RenderGraphAccess::ColorAttachment:
+        return { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+            VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, true };
+    case RenderGraphAccess::DepthAttachment:
+        // The depth test reads and writes in the early fragment tests (before the fragment
+        // shader runs), or in the late ones when the shader can discard or writes depth.
+        return { VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+            VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+            VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, true };
+    case RenderGraphAccess::FragmentShaderRead:
+        return { VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT,
+            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, false };
+    case RenderGraphAccess::ComputeShaderRead:
+        return { VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT,
+            VK_IMAGE_LAYOUT_GENERAL, false };
+    case RenderGraphAccess::ComputeShaderWrite:
+        return { VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+            VK_IMAGE_LAYOUT_GENERAL, true };
+    case RenderGraphAccess::IndirectRead:
+        return { VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT,
+            VK_IMAGE_LAYOUT_UNDEFINED, false };
+    case RenderGraphAccess::TransferRead:
+        return { VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+            VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, false };
+    case RenderGraphAccess::TransferWrite:
+        return { VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, true };
+    default:
+        throw std::runtime_error("Unknown render graph access! \n");
+    }
+}
+
+
+// The access flags that write memory: only writes have to be made available by a barrier.
+static const VkAccessFlags WRITE_ACCESS_MASK =
+    VK_ACCESS_SHADER_WRITE_BIT |
+    VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+    VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+    VK_ACCESS_TRANSFER_WRITE_BIT |
+    VK_ACCESS_HOST_WRITE_BIT |
+    VK_ACCESS_MEMORY_WRITE_BIT;
+
+
+static VkImageAspectFlags get_format_aspect(VkFormat format) {
+
+    switch (format) {
+    case VK_FORMAT_D16_UNORM:
+    case VK_FORMAT_X8_D24_UNORM_PACK32:
+    case VK_FORMAT_D32_SFLOAT:
+        return VK_IMAGE_ASPECT_DEPTH_BIT;
+    case VK_FORMAT_D16_UNORM_S8_UINT:
+    case VK_FORMAT_D24_UNORM_S8_UINT:
+    case VK_FORMAT_D32_SFLOAT_S8_UINT:
+        return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+    default:
+        return VK_IMAGE_ASPECT_COLOR_BIT;
+    }
+}
+
+
+// What a lazily allocated image can be used for: only as attachment.
+static const VkImageUsageFlags ATTACHMENT_USAGE_MASK =
+    VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+    VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT |
+    VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
+
+
+static VkImageUsageFlags get_access_image_usage(RenderGraphAccess access) {
+
+    switch (access) {
+    case RenderGraphAccess::ColorAttachment:    return VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    case RenderGraphAccess::DepthAttachment:    return VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+    case RenderGraphAccess::FragmentShaderRead: return VK_IMAGE_USAGE_SAMPLED_BIT;
+    case RenderGraphAccess::ComputeShaderRead:  return VK_IMAGE_USAGE_STORAGE_BIT;
+    case RenderGraphAccess::ComputeShaderWrite: return VK_IMAGE_USAGE_STORAGE_BIT;
+    case RenderGraphAccess::TransferRead:       return VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    case RenderGraphAccess::TransferWrite:      return VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    default:                                    return 0;
+    }
+}
+
+
+// Everything a pass does with one resource: a pass may declare several accesses to the
+// same resource (e.g. an attachment that is loaded), they are synchronized together.
+struct PassResourceUse {
+
+    RenderGraphResource resource;
+    RenderGraphAccessInfo info;
+    bool reads_contents; // Needs what earlier passes wrote
+};
+
+
+static std::vector<PassResourceUse> get_pass_resource_uses(const RenderGraph& graph, const RenderGraphPass& pass) {
+
+    std::vector<PassResourceUse> uses;
+
+    for (const auto& pass_access : pass.accesses) {
+
+        RenderGraphAccessInfo info = get_render_graph_access_info(pass_access.access);
+
+        // A compute write rewrites the resource, but a loaded attachment is read first.
+        bool reads_contents = !info.write;
+        if (pass_access.access == RenderGraphAccess::ColorAttachment) {
+            for (const auto& attachment : pass.color_attachments) {
+                if (attachment.resource == pass_access.resource && attachment.load_op == VK_ATTACHMENT_LOAD_OP_LOAD) {
+                    info.access |= VK_ACCESS_COLOR_ATTACHMENT_READ_BIT;
+                    reads_contents = true;
+                }
+            }
+        }
+        if (pass_access.access == RenderGraphAccess::DepthAttachment) {
+            reads_contents = pass.depth_attachment.load_op == VK_ATTACHMENT_LOAD_OP_LOAD;
+        }
+
+        auto use = std::find_if(uses.begin(), uses.end(),
+            [&](const PassResourceUse& other) { return other.resource == pass_access.resource; });
+
+        if (use == uses.end()) {
+            uses.push_back({ pass_access.resource, info, reads_contents });
+            continue;
+        }
+
+        if (graph.resources[pass_access.resource].is_image && use->info.layout != info.layout) {
+            throw std::runtime_error("Render graph pass " + pass.name + " uses "
+                + graph.resources[pass_access.resource].name + " in two different layouts! \n");
+        }
+        use->info.stages |= info.stages;
+        use->info.access |= info.access;
+        use->info.write = use->info.write || info.write;
+        use->reads_contents = use->reads_contents || reads_contents;
+    }
+
+    return uses;
+}
+
+
+RenderGraphResource add_imported_image(
+    RenderGraph& graph,
+    const std::string& name,
+    VkFormat format, VkImageLayout final_layout, VkPipelineStageFlags initial_stages) {
+
+    RenderGraphResourceNode resource;
+    resource.name = name;
+    resource.imported = true;
+    resource.output = true;
+    resource.format = format;
+    resource.final_layout = final_layout;
+    resource.initial_stages = initial_stages;
+
+    graph.resources.push_back(resource);
+    return static_cast<RenderGraphResource>(graph.resources.size() - 1);
+}
+
+
+RenderGraphResource add_transient_image(
+    RenderGraph& graph,
+    const std::string& name,
+    VkFormat format, VkSampleCountFlagBits samples) {
+
+    RenderGraphResourceNode resource;
+    resource.name = name;
+    resource.format = format;
+    resource.samples = samples;
+
+    graph.resources.push_back(resource);
+    return static_cast<RenderGraphResource>(graph.resources.size() - 1);
+}
+
+
+RenderGraphResource add_imported_buffer(RenderGraph& graph, const std::string& name) {
+
+    RenderGraphResourceNode resource;
+    resource.name = name;
+    resource.is_image = false;
+    resource.imported = true;
+
+    graph.resources.push_back(resource);
+    return static_cast<RenderGraphResource>(graph.resources.size() - 1);
+}
+
+
+void mark_render_graph_output(RenderGraph& graph, RenderGraphResource resource) {
+
+    graph.resources[resource].output = true;
+}
+
+
+RenderGraphPassIndex add_render_graph_pass(
+    RenderGraph& graph,
+    const std::string& name, RenderGraphPassType type,
+    std::function<void(VkCommandBuffer)> record) {
+
+    RenderGraphPass pass;
+    pass.name = name;
+    pass.type = type;
+    pass.record = std::move(record);
+
+    graph.passes.push_back(std::move(pass));
+    return static_cast<RenderGraphPassIndex>(graph.passes.size() - 1);
+}
+
+
+void add_pass_color_attachment(
+    RenderGraph& graph, RenderGraphPassIndex pass,
+    RenderGraphResource resource,
+    VkAttachmentLoadOp load_op, VkClearColorValue clear_color) {
+
+    if (graph.passes[pass].color_attachments.size() == MAX_RENDER_GRAPH_ATTACHMENTS) {
+        throw std::runtime_error("Render graph pass " + graph.passes[pass].name + " has too many attachments! \n");
+    }
+
+    RenderGraphAttachment attachment{};
+    attachment.resource = resource;
+    attachment.load_op = load_op;
+    attachment.clear_value.color = clear_color;
+
+    graph.passes[pass].color_attachments.push_back(attachment);
+    add_pass_access(graph, pass, resource, RenderGraphAccess::ColorAttachment);
+}
+
+
+void add_pass_depth_attachment(
+    RenderGraph& graph, RenderGraphPassIndex pass,
+    RenderGraphResource resource,
+    VkAttachmentLoadOp load_op, float clear_depth) {
+
+    if (graph.passes[pass].depth_attachment.resource != UINT32_MAX) {
+        throw std::runtime_error("Render graph pass " + graph.passes[pass].name + " already has a depth attachment! \n");
+    }
+
+    RenderGraphAttachment& attachment = graph.passes[pass].depth_attachment;
+    attachment.resource = resource;
+    attachment.load_op = load_op;
+    attachment.clear_value.depthStencil = { clear_depth, 0 };
+
+    add_pass_access(graph, pass, resource, RenderGraphAccess::DepthAttachment);
+}
+
+
+void add_pass_resolve_attachment(
+    RenderGraph& graph, RenderGraphPassIndex pass,
+    RenderGraphResource resource, RenderGraphResource resolve_resource) {
+
+    for (auto& attachment : graph.passes[pass].color_attachments) {
+        if (attachment.resource == resource) {
+
+            // The resolve is written in the COLOR_ATTACHMENT_OUTPUT stage,
+            // in COLOR_ATTACHMENT_OPTIMAL: the same access as the attachment itself.
+            attachment.resolve_resource = resolve_resource;
+            add_pass_access(graph, pass, resolve_resource, RenderGraphAccess::ColorAttachment);
+            return;
+        }
+    }
+
+    throw std::runtime_error("Render graph pass " + graph.passes[pass].name + " has no color attachment "
+        + graph.resources[resource].name + " to resolve! \n");
+}
+
+
+void add_pass_access(
+    RenderGraph& graph, RenderGraphPassIndex pass,
+    RenderGraphResource resource, RenderGraphAccess access) {
+
+    graph.passes[pass].accesses.push_back({ resource, access });
+}
+
+
+// Walks the passes backwards, from the outputs: a pass is live if it writes something that
+// is still needed after it, and then whatever it reads is needed before it.
+// A resource rewritten without being read is not needed before the rewrite anymore.
+static void cull_render_graph_passes(RenderGraph& graph) {
+
+    std::vector<bool> needed(graph.resources.size());
+    for (size_t i = 0; i < graph.resources.size(); i++) {
+        needed[i] = graph.resources[i].output;
+    }
+
+    graph.live_passes = 0;
+    for (size_t p = graph.passes.size(); p-- > 0;) {
+
+        RenderGraphPass& pass = graph.passes[p];
+        std::vector<PassResourceUse> uses = get_pass_resource_uses(graph, pass);
+
+        bool live = pass.side_effects;
+        for (const auto& use : uses) {
+            live = live || (use.info.write && needed[use.resource]);
+        }
+
+        pass.culled = !live;
+        if (!live) {
+            continue;
+        }
+        graph.live_passes++;
+
+        for (const auto& use : uses) {
+            if (use.info.write && !use.reads_contents) {
+                needed[use.resource] = false;
+            }
+        }
+        for (const auto& use : uses) {
+            if (use.reads_contents) {
+                needed[use.resource] = true;
+            }
+        }
+    }
+}
+
+
+// Whether the contents of the attachment written by pass must be stored: a later live pass
+// reads them before rewriting them, or they are an output of the graph.
+static bool is_attachment_stored(const RenderGraph& graph, RenderGraphPassIndex pass, RenderGraphResource resource) {
+
+    for (size_t p = pass + 1; p < graph.passes.size(); p++) {
+
+        if (graph.passes[p].culled) {
+            continue;
+        }
+        for (const auto& use : get_pass_resource_uses(graph, graph.passes[p])) {
+            if (use.resource != resource) {
+                continue;
+            }
+            if (use.reads_contents) {
+                return true;
+            }
+            if (use.info.write) {
+                return false;
+            }
+        }
+    }
+
+    return graph.resources[resource].output;
+}
+
+
+static void create_pass_render_pass(RenderGraph& graph, RenderGraphPassIndex pass_index, VkDevice vk_logic_device) {
+
+    RenderGraphPass& pass = graph.passes[pass_index];
+
+    std::vector<VkAttachmentDescription> attachments;
+    std::vector<VkAttachmentReference> color_references;
+
+    for (const auto& attachment : pass.color_attachments) {
+
+        const RenderGraphResourceNode& resource = graph.resources[attachment.resource];
+
+        // The barriers before the pass put the attachment in its layout, the render pass
+        // leaves it there: initial and final layouts are the same.
+        VkAttachmentDescription description{};
+        description.format = resource.format;
+        description.samples = resource.samples;
+        description.loadOp = attachment.load_op;
+        description.storeOp = attachment.store_op;
+        description.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        description.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        description.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        description.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+        VkAttachmentReference reference{};
+        reference.attachment = static_cast<uint32_t>(attachments.size());
+        reference.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+        attachments.push_back(description);
+        color_references.push_back(reference);
+    }
+
+    // The depth attachment comes after the color attachments (in the framebuffer too).
+    VkAttachmentReference depth_reference{};
+    if (pass.depth_attachment.resource != UINT32_MAX) {
+
+        const RenderGraphResourceNode& resource = graph.resources[pass.depth_attachment.resource];
+
+        VkAttachmentDescription description{};
+        description.format = resource.format;
+        description.samples = resource.samples;
+        description.loadOp = pass.depth_attachment.load_op;
+        description.storeOp = pass.depth_attachment.store_op;
+        description.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        description.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        description.initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+        description.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+        depth_reference.attachment = static_cast<uint32_t>(attachments.size());
+        depth_reference.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+        attachments.push_back(description);
+    }
+
+    VkSubpassDescription subpass{};
+    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.colorAttachmentCount = static_cast<uint32_t>(color_references.size());
+    subpass.pColorAttachments = color_references.data();
+    subpass.pDepthStencilAttachment = pass.depth_attachment.resource != UINT32_MAX ? &depth_reference : nullptr;
+
+    // Then the resolve attachments, one reference per color attachment (UNUSED = not resolved).
+    std::vector<VkAttachmentReference> resolve_references(color_references.size(), { VK_ATTACHMENT_UNUSED, VK_IMAGE_LAYOUT_UNDEFINED });
+    bool has_resolves = false;
+    for (size_t i = 0; i < pass.color_attachments.size(); i++) {
+
+        const RenderGraphAttachment& attachment = pass.color_attachments[i];
+        if (attachment.resolve_resource == UINT32_MAX) {
+            continue;
+        }
+
+        // Every sample is overwritten by the resolve: nothing to load.
+        VkAttachmentDescription description{};
+        description.format = graph.resources[attachment.resolve_resource].format;
+        description.samples = VK_SAMPLE_COUNT_1_BIT;
+        description.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        description.storeOp = attachment.resolve_store_op;
+        description.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        description.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        description.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        description.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+        resolve_references[i].attachment = static_cast<uint32_t>(attachments.size());
+        resolve_references[i].layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        has_resolves = true;
+
+        attachments.push_back(description);
+    }
+    subpass.pResolveAttachments = has_resolves ? resolve_references.data() : nullptr;
+
+    // No subpass dependencies: the barriers recorded before the pass already synchronize
+    // it with the previous passes (and with the acquire of the swapchain image).
+    VkRenderPassCreateInfo render_pass_create_info{};
+    render_pass_create_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    render_pass_create_info.attachmentCount = static_cast<uint32_t>(attachments.size());
+    render_pass_create_info.pAttachments = attachments.data();
+    render_pass_create_info.subpassCount = 1;
+    render_pass_create_info.pSubpasses = &subpass;
+
+    if (vkCreateRenderPass(vk_logic_device, &render_pass_create_info, nullptr, &pass.render_pass) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create the render pass of render graph pass " + pass.name + "! \n");
+    }
+}
+
+
+void compile_render_graph(RenderGraph& graph, VkDevice vk_logic_device) {
+
+    TRACE_SCOPE("compile_render_graph");
+    std::cout << "Compiling Render graph... \n\n";
+
+    cull_render_graph_passes(graph);
+
+    // Lifetimes (in pass order) and the usage of the transient images.
+    for (auto& resource : graph.resources) {
+        resource.first_pass = UINT32_MAX;
+        resource.last_pass = UINT32_MAX;
+        if (!resource.imported) {
+            resource.usage = 0;
+        }
+    }
+
+    for (uint32_t p = 0; p < graph.passes.size(); p++) {
+
+        if (graph.passes[p].culled) {
+            continue;
+        }
+        for (const auto& pass_access : graph.passes[p].accesses) {
+
+            RenderGraphResourceNode& resource = graph.resources[pass_access.resource];
+            if (resource.first_pass == UINT32_MAX) {
+                resource.first_pass = p;
+            }
+            resource.last_pass = p;
+            if (!resource.imported) {
+                resource.usage |= get_access_image_usage(pass_access.access);
+            }
+        }
+    }
+
+    for (uint32_t p = 0; p < graph.passes.size(); p++) {
+
+        RenderGraphPass& pass = graph.passes[p];
+        if (pass.type != RenderGraphPassType::Graphics || pass.culled) {
+            continue;
+        }
+
+        // A multisampled attachment that is resolved is usually not needed afterwards:
+        // only the resolved image is stored, the samples stay in tile memory.
+        for (auto& attachment : pass.color_attachments) {
+            attachment.store_op = is_attachment_stored(graph, p, attachment.resource) ?
+                VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+            if (attachment.resolve_resource != UINT32_MAX) {
+                attachment.resolve_store_op = is_attachment_stored(graph, p, attachment.resolve_resource) ?
+                    VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+            }
+        }
+        // A depth buffer only used by this pass is never written back to memory.
+        if (pass.depth_attachment.resource != UINT32_MAX) {
+            pass.depth_attachment.store_op = is_attachment_stored(graph, p, pass.depth_attachment.resource) ?
+                VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        }
+        if (!graph.dynamic_rendering) {
+            create_pass_render_pass(graph, p, vk_logic_device);
+        }
+    }
+
+    // Transient images whose contents never outlive the pass that uses them as attachment.
+    for (auto& resource : graph.resources) {
+
+        resource.lazy = !resource.imported && !resource.output &&
+            resource.first_pass != UINT32_MAX && resource.first_pass == resource.last_pass &&
+            (resource.usage & ~ATTACHMENT_USAGE_MASK) == 0;
+        if (resource.lazy) {
+            resource.usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+        }
+    }
+
+    graph.compiled = true;
+
+    for (const auto& pass : graph.passes) {
+        std::cout << "\t Pass " << pass.name << (pass.culled ? ": culled (nothing uses its outputs). \n" : ". \n");
+    }
+    std::cout << "\t Graphics passes begun with " << (graph.dynamic_rendering ? "vkCmdBeginRendering()" : "render passes") << ". \n\n";
+
+    std::cout << "Render graph compiled. \n\n";
+}
+
+
+// Synchronization state of a resource while walking the passes.
+struct ResourceSyncState {
+
+    VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    VkPipelineStageFlags write_stages = 0;   // Of the last write (or layout transition)
+    VkAccessFlags write_access = 0;          // Written by the last write, not yet available
+    VkPipelineStageFlags read_stages = 0;    // Reads since the last write (for write-after-read)
+    VkPipelineStageFlags visible_stages = 0; // Stages the last write is visible to already
+    VkAccessFlags visible_access = 0;
+};
+
+
+// Walks the live passes in order, adding the barriers every access needs to the batch
+// of its pass (when batches is not nullptr). states holds the state at the start of the
+// frame and is left with the state at the end.
+static void track_render_graph_accesses(
+    const RenderGraph& graph,
+    std::vector<ResourceSyncState>& states,
+    std::vector<RenderGraphBarrierBatch>* batches) {
+
+    for (uint32_t p = 0; p < graph.passes.size(); p++) {
+
+        if (graph.passes[p].culled) {
+            continue;
+        }
+
+        for (const auto& use : get_pass_resource_uses(graph, graph.passes[p])) {
+
+            ResourceSyncState& state = states[use.resource];
+            const RenderGraphAccessInfo& info = use.info;
+
+            bool is_image = graph.resources[use.resource].is_image;
+            bool layout_change = is_image && state.layout != info.layout;
+
+            // Writes and transitions wait for every earlier access, reads only for the last write.
+            bool needs_barrier;
+            VkPipelineStageFlags src_stages;
+            if (info.write || layout_change) {
+                src_stages = state.write_stages | state.read_stages;
+                needs_barrier = layout_change || src_stages != 0;
+            }
+            else {
+                src_stages = state.write_stages;
+                bool visible =
+                    (state.visible_stages & info.stages) == info.stages &&
+                    (state.visible_access & info.access) == info.access;
+                needs_barrier = state.write_stages != 0 && !visible;
+            }
+
+            if (needs_barrier && batches != nullptr) {
+
+                RenderGraphBarrierBatch& batch = (*batches)[p];
+                batch.src_stages |= src_stages;
+                batch.dst_stages |= info.stages;
+
+                RenderGraphBarrier barrier;
+                barrier.resource = use.resource;
+                barrier.src_access = state.write_access;
+                barrier.dst_access = info.access;
+                barrier.old_layout = is_image ? state.layout : VK_IMAGE_LAYOUT_UNDEFINED;
+                barrier.new_layout = is_image ? info.layout : VK_IMAGE_LAYOUT_UNDEFINED;
+                batch.barriers.push_back(barrier);
+            }
+
+            if (info.write) {
+                state.write_stages = info.stages;
+                state.write_access = info.access & WRITE_ACCESS_MASK;
+                state.read_stages = 0;
+                state.visible_stages = 0;
+                state.visible_access = 0;
+            }
+            else if (layout_change) {
+                // The transition is a write the barrier already made visible to this access.
+                state.write_stages = info.stages;
+                state.write_access = 0;
+                state.read_stages = info.stages;
+                state.visible_stages = info.stages;
+                state.visible_access = info.access;
+            }
+            else {
+                state.read_stages |= info.stages;
+                if (needs_barrier) {
+                    state.visible_stages |= info.stages;
+                    state.visible_access |= info.access;
+                }
+            }
+
+            if (is_image) {
+                state.layout = info.layout;
+            }
+        }
+    }
+}
+
+
+static void compute_render_graph_barriers(RenderGraph& graph) {
+
+    // At the start of the frame imported images wait for their initial stages, everything
+    // else starts with nothing to wait for.
+    std::vector<ResourceSyncState> initial_states(graph.resources.size());
+    for (size_t i = 0; i < graph.resources.size(); i++) {
+        if (graph.resources[i].imported && graph.resources[i].is_image) {
+            initial_states[i].write_stages = graph.resources[i].initial_stages;
+        }
+    }
+
+    // A transient image must wait for whatever used its memory before: the image before
+    // it in the same slot, or for the first image of the slot the last one of the previous
+    // frame (frames in flight share the transient images). Their accesses at the end of the
+    // frame don't depend on where the frame starts, a first walk gives them.
+    std::vector<ResourceSyncState> end_states = initial_states;
+    track_render_graph_accesses(graph, end_states, nullptr);
+
+    for (size_t i = 0; i < graph.resources.size(); i++) {
+
+        RenderGraphResource predecessor = graph.resources[i].alias_predecessor;
+        if (graph.resources[i].imported || predecessor == UINT32_MAX) {
+            continue;
+        }
+        initial_states[i].write_stages = end_states[predecessor].write_stages | end_states[predecessor].read_stages;
+        initial_states[i].write_access = end_states[predecessor].write_access;
+    }
+
+    std::vector<RenderGraphBarrierBatch> batches(graph.passes.size());
+    std::vector<ResourceSyncState> states = initial_states;
+    track_render_graph_accesses(graph, states, &batches);
+
+    for (size_t p = 0; p < graph.passes.size(); p++) {
+        graph.passes[p].barriers = batches[p];
+    }
+
+    // The imported images end the frame in their final layout.
+    graph.final_barriers = RenderGraphBarrierBatch{};
+    for (size_t i = 0; i < graph.resources.size(); i++) {
+
+        const RenderGraphResourceNode& resource = graph.resources[i];
+        if (!resource.imported || !resource.is_image || resource.final_layout == states[i].layout) {
+            continue;
+        }
+
+        graph.final_barriers.src_stages |= states[i].write_stages | states[i].read_stages;
+        graph.final_barriers.dst_stages |= VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+
+        RenderGraphBarrier barrier;
+        barrier.resource = static_cast<RenderGraphResource>(i);
+        barrier.src_access = states[i].write_access;
+        barrier.dst_access = 0;
+        barrier.old_layout = states[i].layout;
+        barrier.new_layout = resource.final_layout;
+        graph.final_barriers.barriers.push_back(barrier);
+    }
+}
+
+
+// A memory slot shared by transient images whose lifetimes don't overlap.
+struct AliasSlot {
+
+    VkMemoryRequirements requirements;
+    bool lazy; // Only lazy images (see RenderGraphResourceNode::lazy)
+    std::vector<RenderGraphResource> images;
+};
+
+
+void create_render_graph_resources(
+    RenderGraph& graph,
+    MemoryAllocator& allocator, VkDevice vk_logic_device,
+    VkExtent2D extent) {
+
+    TRACE_SCOPE("create_render_graph_resources");
+
+    if (!graph.compiled) {
+        throw std::runtime_error("The render graph must be compiled before creating its resources! \n");
+    }
+
+    graph.extent = extent;
+    graph.transient_bytes = 0;
+    graph.aliased_bytes = 0;
+    graph.lazy_bytes = 0;
+
+    // Images of the live transient resources, and their memory requirements.
+    std::vector<RenderGraphResource> transients;
+    std::vector<VkMemoryRequirements> requirements(graph.resources.size());
+
+    for (uint32_t i = 0; i < graph.resources.size(); i++) {
+
+        RenderGraphResourceNode& resource = graph.resources[i];
+        resource.alias_slot = UINT32_MAX;
+        resource.alias_predecessor = UINT32_MAX;
+
+        if (resource.imported || resource.first_pass == UINT32_MAX) {
+            continue;
+        }
+
+        VkImageCreateInfo image_create_info{};
+        image_create_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        image_create_info.imageType = VK_IMAGE_TYPE_2D;
+        image_create_info.format = resource.format;
+        image_create_info.extent = { extent.width, extent.height, 1 };
+        image_create_info.mipLevels = 1;
+        image_create_info.arrayLayers = 1;
+        image_create_info.samples = resource.samples;
+        image_create_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+        image_create_info.usage = resource.usage;
+        image_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        image_create_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+        if (vkCreateImage(vk_logic_device, &image_create_info, nullptr, &resource.image) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create render graph image " + resource.name + "! \n");
+        }
+        vkGetImageMemoryRequirements(vk_logic_device, resource.image, &requirements[i]);
+
+        graph.owned.images.push_back(resource.image);
+        graph.transient_bytes += requirements[i].size;
+        transients.push_back(i);
+    }
+
+    // Largest first, each image goes to the first slot it fits in: a compatible memory type
+    // and no image of the slot alive at the same time. A slot is as large as its largest image.
+    std::sort(transients.begin(), transients.end(), [&](RenderGraphResource a, RenderGraphResource b) {
+        return requirements[a].size > requirements[b].size;
+    });
+
+    std::vector<AliasSlot> slots;
+    for (RenderGraphResource image : transients) {
+
+        const RenderGraphResourceNode& resource = graph.resources[image];
+
+        AliasSlot* fitting_slot = nullptr;
+        for (auto& slot : slots) {
+
+            if ((slot.requirements.memoryTypeBits & requirements[image].memoryTypeBits) == 0 ||
+                slot.lazy != resource.lazy) {
+                continue;
+            }
+            bool overlaps = false;
+            for (RenderGraphResource other : slot.images) {
+                overlaps = overlaps ||
+                    (resource.first_pass <= graph.resources[other].last_pass &&
+                     graph.resources[other].first_pass <= resource.last_pass);
+            }
+            if (!overlaps) {
+                fitting_slot = &slot;
+                break;
+            }
+        }
+
+        if (fitting_slot == nullptr) {
+            slots.push_back({ requirements[image], resource.lazy, {} });
+            fitting_slot = &slots.back();
+        }
+
+        fitting_slot->requirements.size = std::max(fitting_slot->requirements.size, requirements[image].size);
+        fitting_slot->requirements.alignment = std::max(fitting_slot->requirements.alignment, requirements[image].alignment);
+        fitting_slot->requirements.memoryTypeBits &= requirements[image].memoryTypeBits;
+        fitting_slot->images.push_back(image);
+    }
+
+    for (uint32_t s = 0; s < slots.size(); s++) {
+
+        AliasSlot& slot = slots[s];
+
+        // Desktop GPUs have no lazily allocated memory, the lazy images get regular memory there.
+        VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+        if (slot.lazy && has_memory_type(allocator, slot.requirements.memoryTypeBits, properties | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT)) {
+            properties |= VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+            graph.lazy_bytes += slot.requirements.size;
+        }
+
+        MemoryAllocation allocation;
+        allocate_memory(allocation, allocator, slot.requirements, properties, AllocationKind::Optimal);
+        graph.owned.allocations.push_back(allocation);
+        graph.aliased_bytes += slot.requirements.size;
+
+        // In the order they use the slot during the frame.
+        std::sort(slot.images.begin(), slot.images.end(), [&](RenderGraphResource a, RenderGraphResource b) {
+            return graph.resources[a].first_pass < graph.resources[b].first_pass;
+        });
+
+        for (size_t i = 0; i < slot.images.size(); i++) {
+
+            RenderGraphResourceNode& resource = graph.resources[slot.images[i]];
+            resource.alias_slot = s;
+            resource.alias_predecessor = slot.images[i > 0 ? i - 1 : slot.images.size() - 1];
+
+            vkBindImageMemory(vk_logic_device, resource.image, allocation.memory, allocation.offset);
+
+            VkImageViewCreateInfo image_view_create_info{};
+            image_view_create_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+            image_view_create_info.image = resource.image;
+            image_view_create_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+            image_view_create_info.format = resource.format;
+            image_view_create_info.subresourceRange.aspectMask = get_format_aspect(resource.format);
+            image_view_create_info.subresourceRange.baseMipLevel = 0;
+            image_view_create_info.subresourceRange.levelCount = 1;
+            image_view_create_info.subresourceRange.baseArrayLayer = 0;
+            image_view_create_info.subresourceRange.layerCount = 1;
+
+            if (vkCreateImageView(vk_logic_device, &image_view_create_info, nullptr, &resource.view) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to create the view of render graph image " + resource.name + "! \n");
+            }
+            graph.owned.views.push_back(resource.view);
+        }
+    }
+
+    graph.alias_slots = static_cast<uint32_t>(slots.size());
+
+    compute_render_graph_barriers(graph);
+}
+
+
+RenderGraphResources retire_render_graph_resources(RenderGraph& graph) {
+
+    RenderGraphResources retired = std::move(graph.owned);
+    graph.owned = RenderGraphResources{};
+
+    for (auto& resource : graph.resources) {
+        if (!resource.imported) {
+            resource.image = VK_NULL_HANDLE;
+            resource.view = VK_NULL_HANDLE;
+        }
+    }
+
+    return retired;
+}
+
+
+void destroy_render_graph_resources(RenderGraphResources& resources, MemoryAllocator& allocator, VkDevice vk_logic_device) {
+
+    for (const auto& framebuffer : resources.framebuffers) {
+        vkDestroyFramebuffer(vk_logic_device, framebuffer.framebuffer, nullptr);
+    }
+    for (auto view : resources.views) {
+        vkDestroyImageView(vk_logic_device, view, nullptr);
+    }
+    for (auto image : resources.images) {
+        vkDestroyImage(vk_logic_device, image, nullptr);
+    }
+    for (auto& allocation : resources.allocations) {
+        free_memory(allocation, allocator);
+    }
+
+    resources = RenderGraphResources{};
+}
+
+
+void destroy_render_graph(RenderGraph& graph, MemoryAllocator& allocator, VkDevice vk_logic_device) {
+
+    RenderGraphResources resources = retire_render_graph_resources(graph);
+    destroy_render_graph_resources(resources, allocator, vk_logic_device);
+
+    for (auto& pass : graph.passes) {
+        if (pass.render_pass != VK_NULL_HANDLE) {
+            vkDestroyRenderPass(vk_logic_device, pass.render_pass, nullptr);
+            pass.render_pass = VK_NULL_HANDLE;
+        }
+    }
+
+    graph.compiled = false;
+}
+
+
+void bind_render_graph_image(RenderGraph& graph, RenderGraphResource resource, VkImage vk_image, VkImageView vk_image_view) {
+
+    graph.resources[resource].image = vk_image;
+    graph.resources[resource].view = vk_image_view;
+}
+
+
+void bind_render_graph_buffer(
+    RenderGraph& graph, RenderGraphResource resource,
+    VkBuffer vk_buffer, VkDeviceSize offset, VkDeviceSize size) {
+
+    graph.resources[resource].buffer = vk_buffer;
+    graph.resources[resource].buffer_offset = offset;
+    graph.resources[resource].buffer_size = size;
+}
+
+
+VkRenderPass get_pass_render_pass(const RenderGraph& graph, RenderGraphPassIndex pass) {
+
+    return graph.passes[pass].render_pass;
+}
+
+
+std::vector<VkFormat> get_pass_color_formats(const RenderGraph& graph, RenderGraphPassIndex pass) {
+
+    std::vector<VkFormat> formats;
+    for (const auto& attachment : graph.passes[pass].color_attachments) {
+        formats.push_back(graph.resources[attachment.resource].format);
+    }
+    return formats;
+}
+
+
+VkFormat get_pass_depth_format(const RenderGraph& graph, RenderGraphPassIndex pass) {
+
+    RenderGraphResource depth = graph.passes[pass].depth_attachment.resource;
+    return depth != UINT32_MAX ? graph.resources[depth].format : VK_FORMAT_UNDEFINED;
+}
+
+
+VkSampleCountFlagBits get_pass_samples(const RenderGraph& graph, RenderGraphPassIndex pass) {
+
+    const RenderGraphPass& graph_pass = graph.passes[pass];
+    if (!graph_pass.color_attachments.empty()) {
+        return graph.resources[graph_pass.color_attachments[0].resource].samples;
+    }
+    if (graph_pass.depth_attachment.resource != UINT32_MAX) {
+        return graph.resources[graph_pass.depth_attachment.resource].samples;
+    }
+    return VK_SAMPLE_COUNT_1_BIT;
+}
+
+
+// The attachments of a graphics pass in framebuffer order: the color attachments, the depth
+// one, then the resolve attachments (in the order of the color attachments they resolve).
+static uint32_t get_pass_attachments_count(const RenderGraphPass& pass) {
+
+    uint32_t count = static_cast<uint32_t>(pass.color_attachments.size()) + (pass.depth_attachment.resource != UINT32_MAX ? 1 : 0);
+    for (const auto& attachment : pass.color_attachments) {
+        count += attachment.resolve_resource != UINT32_MAX ? 1 : 0;
+    }
+    return count;
+}
+
+static VkImageView get_pass_attachment_view(const RenderGraph& graph, const RenderGraphPass& pass, uint32_t attachment) {
+
+    if (attachment < pass.color_attachments.size()) {
+        return graph.resources[pass.color_attachments[attachment].resource].view;
+    }
+    attachment -= static_cast<uint32_t>(pass.color_attachments.size());
+
+    if (pass.depth_attachment.resource != UINT32_MAX) {
+        if (attachment == 0) {
+            return graph.resources[pass.depth_attachment.resource].view;
+        }
+        attachment--;
+    }
+
+    for (const auto& color_attachment : pass.color_attachments) {
+        if (color_attachment.resolve_resource == UINT32_MAX) {
+            continue;
+        }
+        if (attachment == 0) {
+            return graph.resources[color_attachment.resolve_resource].view;
+        }
+        attachment--;
+    }
+    return VK_NULL_HANDLE;
+}
+
+
+VkFramebuffer get_pass_framebuffer(RenderGraph& graph, RenderGraphPassIndex pass_index, VkDevice vk_logic_device) {
+
+    const RenderGraphPass& pass = graph.passes[pass_index];
+    if (graph.dynamic_rendering) {
+        return VK_NULL_HANDLE;
+    }
+
+    uint32_t attachments_count = get_pass_attachments_count(pass);
+
+    // A handful of entries (one per swapchain image): a linear search is enough.
+    for (const auto& framebuffer : graph.owned.framebuffers) {
+
+        bool same_views = framebuffer.pass == pass_index;
+        for (uint32_t i = 0; same_views && i < attachments_count; i++) {
+            same_views = framebuffer.views[i] == get_pass_attachment_view(graph, pass, i);
+        }
+        if (same_views) {
+            return framebuffer.framebuffer;
+        }
+    }
+
+    std::vector<VkImageView> views;
+    for (uint32_t i = 0; i < attachments_count; i++) {
+        views.push_back(get_pass_attachment_view(graph, pass, i));
+    }
+
+    for (auto view : views) {
+        if (view == VK_NULL_HANDLE) {
+            throw std::runtime_error("Render graph pass " + pass.name + " has an attachment with no image bound! \n");
+        }
+    }
+
+    VkFramebufferCreateInfo framebuffer_create_info{};
+    framebuffer_create_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    framebuffer_create_info.renderPass = pass.render_pass;
+    framebuffer_create_info.attachmentCount = static_cast<uint32_t>(views.size());
+    framebuffer_create_info.pAttachments = views.data();
+    framebuffer_create_info.width = graph.extent.width;
+    framebuffer_create_info.height = graph.extent.height;
+    framebuffer_create_info.layers = 1;
+
+    RenderGraphFramebuffer framebuffer;
+    framebuffer.pass = pass_index;
+    framebuffer.views = views;
+    if (vkCreateFramebuffer(vk_logic_device, &framebuffer_create_info, nullptr, &framebuffer.framebuffer) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create the framebuffer of render graph pass " + pass.name + "! \n");
+    }
+
+    graph.owned.framebuffers.push_back(framebuffer);
+    return framebuffer.framebuffer;
+}
+
+
+static void record_barrier_batch(const RenderGraph& graph, const RenderGraphBarrierBatch& batch, VkCommandBuffer vk_command_buffer) {
+
+    if (batch.barriers.empty()) {
+        return;
+    }
+
+    // A handful of barriers at most: on the stack, nothing to allocate every frame.
+    const size_t MAX_BATCH_BARRIERS = 32;
+    VkImageMemoryBarrier image_barriers[MAX_BATCH_BARRIERS];
+    VkBufferMemoryBarrier buffer_barriers[MAX_BATCH_BARRIERS];
+    uint32_t image_barriers_count = 0;
+    uint32_t buffer_barriers_count = 0;
+
+    if (batch.barriers.size() > MAX_BATCH_BARRIERS) {
+        throw std::runtime_error("Too many barriers before a render graph pass! \n");
+    }
+
+    for (const auto& barrier : batch.barriers) {
+
+        const RenderGraphResourceNode& resource = graph.resources[barrier.resource];
+
+        if (resource.is_image) {
+
+            VkImageMemoryBarrier& image_barrier = image_barriers[image_barriers_count++];
+            image_barrier = VkImageMemoryBarrier{};
+            image_barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            image_barrier.srcAccessMask = barrier.src_access;
+            image_barrier.dstAccessMask = barrier.dst_access;
+            image_barrier.oldLayout = barrier.old_layout;
+            image_barrier.newLayout = barrier.new_layout;
+            image_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            image_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            image_barrier.image = resource.image;
+            image_barrier.subresourceRange.aspectMask = get_format_aspect(resource.format);
+            image_barrier.subresourceRange.baseMipLevel = 0;
+            image_barrier.subresourceRange.levelCount = 1;
+            image_barrier.subresourceRange.baseArrayLayer = 0;
+            image_barrier.subresourceRange.layerCount = 1;
+        }
+        else {
+
+            VkBufferMemoryBarrier& buffer_barrier = buffer_barriers[buffer_barriers_count++];
+            buffer_barrier = VkBufferMemoryBarrier{};
+            buffer_barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+            buffer_barrier.srcAccessMask = barrier.src_access;
+            buffer_barrier.dstAccessMask = barrier.dst_access;
+            buffer_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            buffer_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            buffer_barrier.buffer = resource.buffer;
+            buffer_barrier.offset = resource.buffer_offset;
+            buffer_barrier.size = resource.buffer_size;
+        }
+    }
+
+    // Nothing to wait for is the top of the pipe, nothing waiting is the bottom.
+    VkPipelineStageFlags src_stages = batch.src_stages;
+    VkPipelineStageFlags dst_stages = batch.dst_stages;
+    if (src_stages == 0) {
+        src_stages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+    }
+    if (dst_stages == 0) {
+        dst_stages = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+    }
+
+    vkCmdPipelineBarrier(
+        vk_command_buffer,
+        src_stages, dst_stages,
+        0,
+        0, nullptr,
+        buffer_barriers_count, buffer_barriers,
+        image_barriers_count, image_barriers);
+}
+
+
+// The dynamic rendering equivalent of vkCmdBeginRenderPass(): the attachments, their load
+// and store ops and the render area are given when recording, the layout is the one the
+// barriers put the attachments in. Nothing to create up front or after a resize.
+static void begin_pass_rendering(const RenderGraph& graph, const RenderGraphPass& pass, VkCommandBuffer vk_command_buffer) {
+
+    VkRenderingAttachmentInfo color_attachments[MAX_RENDER_GRAPH_ATTACHMENTS]{};
+    uint32_t color_attachments_count = 0;
+    for (const auto& attachment : pass.color_attachments) {
+
+        const RenderGraphResourceNode& resource = graph.resources[attachment.resource];
+        if (resource.view == VK_NULL_HANDLE) {
+            throw std::runtime_error("Render graph pass " + pass.name + " has an attachment with no image bound! \n");
+        }
+
+        VkRenderingAttachmentInfo& info = color_attachments[color_attachments_count++];
+        info.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+        info.imageView = resource.view;
+        info.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        info.resolveMode = VK_RESOLVE_MODE_NONE;
+        info.loadOp = attachment.load_op;
+        info.storeOp = attachment.store_op;
+        info.clearValue = attachment.clear_value;
+
+        // The average of the samples, what a render pass resolve does for float and normalized formats.
+        if (attachment.resolve_resource != UINT32_MAX) {
+
+            const RenderGraphResourceNode& resolve = graph.resources[attachment.resolve_resource];
+            if (resolve.view == VK_NULL_HANDLE) {
+                throw std::runtime_error("Render graph pass " + pass.name + " has a resolve attachment with no image bound! \n");
+            }
+            info.resolveMode = VK_RESOLVE_MODE_AVERAGE_BIT;
+            info.resolveImageView = resolve.view;
+            info.resolveImageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        }
+    }
+
+    // A depth/stencil format is given as both, depth-only formats only as depth attachment.
+    VkRenderingAttachmentInfo depth_attachment{};
+    bool has_depth = pass.depth_attachment.resource != UINT32_MAX;
+    bool has_stencil = false;
+    if (has_depth) {
+
+        const RenderGraphResourceNode& resource = graph.resources[pass.depth_attachment.resource];
+        has_stencil = (get_format_aspect(resource.format) & VK_IMAGE_ASPECT_STENCIL_BIT) != 0;
+
+        depth_attachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+        depth_attachment.imageView = resource.view;
+        depth_attachment.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+        depth_attachment.resolveMode = VK_RESOLVE_MODE_NONE;
+        depth_attachment.loadOp = pass.depth_attachment.load_op;
+        depth_attachment.storeOp = pass.depth_attachment.store_op;
+        depth_attachment.clearValue = pass.depth_attachment.clear_value;
+    }
+
+    VkRenderingInfo rendering_info{};
+    rendering_info.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+    rendering_info.flags = pass.contents == VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS ?
+        VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT : 0;
+    rendering_info.renderArea.offset = { 0, 0 };
+    rendering_info.renderArea.extent = graph.extent;
+    rendering_info.layerCount = 1;
+    rendering_info.colorAttachmentCount = color_attachments_count;
+    rendering_info.pColorAttachments = color_attachments;
+    rendering_info.pDepthAttachment = has_depth ? &depth_attachment : nullptr;
+    rendering_info.pStencilAttachment = has_stencil ? &depth_attachment : nullptr;
+
+    vkCmdBeginRendering(vk_command_buffer, &rendering_info);
+}
+
+
+void execute_render_graph(RenderGraph& graph, VkCommandBuffer vk_command_buffer, VkDevice vk_logic_device) {
+
+    for (uint32_t p = 0; p < graph.passes.size(); p++) {
+
+        RenderGraphPass& pass = graph.passes[p];
+        if (pass.culled) {
+            continue;
+        }
+
+        record_barrier_batch(graph, pass.barriers, vk_command_buffer);
+
+        if (pass.type != RenderGraphPassType::Graphics) {
+            pass.record(vk_command_buffer);
+            continue;
+        }
+
+        if (graph.dynamic_rendering) {
+            begin_pass_rendering(graph, pass, vk_command_buffer);
+            pass.record(vk_command_buffer);
+            vkCmdEndRendering(vk_command_buffer);
+            continue;
+        }
+
+        // One clear value per attachment, used by the attachments that are cleared.
+        VkClearValue clear_values[MAX_RENDER_GRAPH_ATTACHMENTS + 1];
+        uint32_t clear_values_count = 0;
+        for (const auto& attachment : pass.color_attachments) {
+            clear_values[clear_values_count++] = attachment.clear_value;
+        }
+        if (pass.depth_attachment.resource != UINT32_MAX) {
+            clear_values[clear_values_count++] = pass.depth_attachment.clear_value;
+        }
+
+        VkRenderPassBeginInfo render_pass_begin_info{};
+        render_pass_begin_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+        render_pass_begin_info.renderPass = pass.render_pass;
+        render_pass_begin_info.framebuffer = get_pass_framebuffer(graph, p, vk_logic_device);
+        render_pass_begin_info.renderArea.offset = { 0, 0 };
+        render_pass_begin_info.renderArea.extent = graph.extent;
+        render_pass_begin_info.clearValueCount = clear_values_count;
+        render_pass_begin_info.pClearValues = clear_values;
+
+        vkCmdBeginRenderPass(vk_command_buffer, &render_pass_begin_info, pass.contents);
+        pass.record(vk_command_buffer);
+        vkCmdEndRenderPass(vk_command_buffer);
+    }
+
+    record_barrier_batch(graph, graph.final_barriers, vk_command_buffer);
+}
+
+
+void print_render_graph(const RenderGraph& graph) {
+
+    uint32_t barrier_calls = graph.final_barriers.barriers.empty() ? 0 : 1;
+    size_t barriers_count = graph.final_barriers.barriers.size();
+    for (const auto& pass : graph.passes) {
+        if (!pass.culled && !pass.barriers.barriers.empty()) {
+            barrier_calls++;
+            barriers_count += pass.barriers.barriers.size();
+        }
+    }
+
+    uint32_t transient_images = 0;
+    for (const auto& resource : graph.resources) {
+        if (!resource.imported && resource.first_pass != UINT32_MAX) {
+            transient_images++;
+        }
+    }
+
+    std::cout << "Render graph: " << graph.live_passes << " of " << graph.passes.size() << " pass(es) recorded, "
+        << barriers_count << " barrier(s) in " << barrier_calls << " vkCmdPipelineBarrier() per frame. \n";
+    std::cout << "\t Transient images: " << transient_images << " in " << graph.alias_slots << " memory slot(s), "
+        << graph.aliased_bytes / 1024 << " KB (" << graph.transient_bytes / 1024 << " KB without aliasing). \n";
+    std::cout << "\t Lazily allocated: " << graph.lazy_bytes / 1024 << " KB. \n\n";
+}
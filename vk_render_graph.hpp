@@ -0,0 +1,326 @@
+#pragma once
+
+#include "my_utils.hpp"
+#include "vk_memory.hpp"
+
+#include <functional>
+
+
+// Frame render graph.
+//
+// The frame is described as a list of passes (graphics, compute or transfer) and the
+// resources (images and buffers) every pass reads and writes. From that description the
+// graph works out what used to be written by hand for every new pass:
+//
+// - Barriers: the state of every resource (layout, last writer, readers since) is tracked
+//   from pass to pass, and a barrier is added only where there is a hazard (read after
+//   write, write after read or write) or a layout transition. All the barriers needed
+//   before a pass are merged into a single vkCmdPipelineBarrier(), one more call after
+//   the last pass moves the imported images to their final layout (e.g. PRESENT_SRC).
+//
+// - Pass culling: a pass is only recorded if something needs what it writes: an output of
+//   the graph (the swapchain image) or a resource read by a later pass that is recorded.
+//   Passes with side effects can be kept regardless.
+//
+// - Transient images: images that only live during the frame (depth, intermediate targets)
+//   are created by the graph. Transient images whose lifetimes (from the first to the last
+//   pass that uses them) don't overlap share the same memory.
+//
+// Graphics passes get their VkRenderPass from the graph, built from the attachments of the
+// pass. The attachments stay in the layout the barriers put them in (the render pass does
+// no transition), and their contents are only stored if a later pass or the output needs them.
+// With dynamic_rendering the passes are begun with vkCmdBeginRendering() instead, from the
+// same attachments, load and store ops: no render pass or framebuffer object at all.
+//
+// Multisampled color attachments are resolved at the end of their pass into a single sampled
+// image (add_pass_resolve_attachment()). A transient image only used as attachment by a single
+// pass never has its contents in memory: it gets TRANSIENT_ATTACHMENT usage and lazily
+// allocated memory where the device has it (tile based GPUs keep it in tile memory, and the
+// memory is never actually committed). Multisampled color and depth buffers are the usual case.
+//
+// The graph is declared and compiled once (compile_render_graph()), its transient images
+// follow the extent (create_render_graph_resources()), and every frame the imported
+// resources are bound and the passes recorded (execute_render_graph()). The barriers are
+// computed once as well, every frame runs the same passes.
+
+
+// Most color attachments of a graphics pass, plus one depth attachment
+// (clear values are kept on the stack).
+const uint32_t MAX_RENDER_GRAPH_ATTACHMENTS = 8;
+
+
+// Index of a resource of the graph.
+typedef uint32_t RenderGraphResource;
+
+// Index of a pass of the graph.
+typedef uint32_t RenderGraphPassIndex;
+
+
+enum class RenderGraphPassType {
+
+    Graphics, // Recorded inside a render pass made of its attachments
+    Compute,
+    Transfer
+};
+
+
+// How a pass uses a resource. Each one maps to pipeline stages, access flags and,
+// for images, the layout the image must be in (see get_render_graph_access_info()).
+enum class RenderGraphAccess {
+
+    ColorAttachment,    // Written as color attachment (declared with add_pass_color_attachment())
+    DepthAttachment,    // Tested and written as depth attachment (add_pass_depth_attachment())
+    FragmentShaderRead, // Sampled by the fragment shader
+    ComputeShaderRead,
+    ComputeShaderWrite, // Read-modify-write from a compute shader (storage buffers/images, atomics)
+    IndirectRead,       // Indirect draw commands and counts
+    TransferRead,
+    TransferWrite
+};
+
+struct RenderGraphAccessInfo {
+
+    VkPipelineStageFlags stages;
+    VkAccessFlags access;
+    VkImageLayout layout; // Images only
+    bool write;
+};
+
+RenderGraphAccessInfo get_render_graph_access_info(RenderGraphAccess access);
+
+
+struct RenderGraphResourceNode {
+
+    std::string name;
+    bool is_image = true;
+    bool imported = false; // Owned by someone else and bound every frame
+    bool output = false;   // Needed after the graph: keeps the passes that write it
+
+    // Images
+    VkFormat format = VK_FORMAT_UNDEFINED;
+    VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+    VkImageUsageFlags usage = 0;     // Transient images, from the accesses
+    VkImageLayout final_layout = VK_IMAGE_LAYOUT_UNDEFINED; // Imported images, after the last pass
+    VkPipelineStageFlags initial_stages = 0; // Imported, what the first barrier waits for
+    bool lazy = false; // Compiled, transient images: only an attachment of one pass (see above)
+
+    // Bound every frame for imported resources, created by the graph for transient images.
+    VkImage image = VK_NULL_HANDLE;
+    VkImageView view = VK_NULL_HANDLE;
+    VkBuffer buffer = VK_NULL_HANDLE;
+    VkDeviceSize buffer_offset = 0;
+    VkDeviceSize buffer_size = VK_WHOLE_SIZE;
+
+    // Compiled: the live passes that use the resource (UINT32_MAX = none).
+    uint32_t first_pass = UINT32_MAX;
+    uint32_t last_pass = UINT32_MAX;
+
+    // Transient images: the memory slot they are bound to, and the image that used the
+    // slot before them (the last one of the slot for the first one, from the previous frame).
+    uint32_t alias_slot = UINT32_MAX;
+    RenderGraphResource alias_predecessor = UINT32_MAX;
+};
+
+
+struct RenderGraphPassAccess {
+
+    RenderGraphResource resource;
+    RenderGraphAccess access;
+};
+
+struct RenderGraphAttachment {
+
+    RenderGraphResource resource = UINT32_MAX; // UINT32_MAX = none
+    VkAttachmentLoadOp load_op = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    VkClearValue clear_value = {};
+    VkAttachmentStoreOp store_op = VK_ATTACHMENT_STORE_OP_DONT_CARE; // Compiled
+
+    // Color attachments: the single sampled image the attachment is resolved into (UINT32_MAX = none).
+    RenderGraphResource resolve_resource = UINT32_MAX;
+    VkAttachmentStoreOp resolve_store_op = VK_ATTACHMENT_STORE_OP_DONT_CARE; // Compiled
+};
+
+
+// A barrier of a batch. Stages are merged for the whole batch.
+struct RenderGraphBarrier {
+
+    RenderGraphResource resource;
+    VkAccessFlags src_access;
+    VkAccessFlags dst_access;
+    VkImageLayout old_layout; // Images only
+    VkImageLayout new_layout;
+};
+
+// The barriers recorded with one vkCmdPipelineBarrier().
+struct RenderGraphBarrierBatch {
+
+    VkPipelineStageFlags src_stages = 0;
+    VkPipelineStageFlags dst_stages = 0;
+    std::vector<RenderGraphBarrier> barriers;
+};
+
+
+struct RenderGraphPass {
+
+    std::string name;
+    RenderGraphPassType type = RenderGraphPassType::Graphics;
+    std::vector<RenderGraphPassAccess> accesses;
+    std::vector<RenderGraphAttachment> color_attachments; // Graphics passes, in attachment order
+    RenderGraphAttachment depth_attachment; // resource UINT32_MAX = none
+    bool side_effects = false; // Never culled
+
+    std::function<void(VkCommandBuffer)> record;
+
+    // Can change every frame: SECONDARY_COMMAND_BUFFERS if the pass executes secondary
+    // command buffers (see vk_parallel_record.hpp). With dynamic rendering this becomes
+    // VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT.
+    VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE;
+
+    // Compiled
+    bool culled = false;
+    VkRenderPass render_pass = VK_NULL_HANDLE; // VK_NULL_HANDLE with dynamic rendering
+    RenderGraphBarrierBatch barriers; // Recorded before the pass
+};
+
+
+struct RenderGraphFramebuffer {
+
+    RenderGraphPassIndex pass;
+    std::vector<VkImageView> views;
+    VkFramebuffer framebuffer;
+};
+
+// What depends on the extent and the imported images. Split from the graph so that it
+// can be retired on a swapchain recreation while the frames in flight still use it.
+struct RenderGraphResources {
+
+    std::vector<VkImage> images;
+    std::vector<VkImageView> views;
+    std::vector<MemoryAllocation> allocations; // One per memory slot
+    std::vector<RenderGraphFramebuffer> framebuffers;
+};
+
+
+struct RenderGraph {
+
+    std::vector<RenderGraphResourceNode> resources;
+    std::vector<RenderGraphPass> passes;
+
+    VkExtent2D extent = { 0, 0 }; // Of every transient image and render pass
+    bool compiled = false;
+
+    // Set before compile_render_graph(). Needs the dynamicRendering feature (Vulkan 1.3).
+    bool dynamic_rendering = false;
+
+    RenderGraphBarrierBatch final_barriers; // Recorded after the last pass
+    RenderGraphResources owned;
+
+    // Stats
+    uint32_t live_passes = 0;
+    uint32_t alias_slots = 0;
+    VkDeviceSize transient_bytes = 0; // Without aliasing
+    VkDeviceSize aliased_bytes = 0;   // With aliasing (what is actually allocated)
+    VkDeviceSize lazy_bytes = 0;      // Of aliased_bytes, in lazily allocated memory
+};
+
+
+// Declaration. Passes run in the order they are added.
+
+// An image owned outside of the graph (e.g. a swapchain image), bound every frame with
+// bind_render_graph_image(). Its contents are discarded at the start of the frame, the first
+// barrier waits for initial_stages (the stage the acquire semaphore is waited on), and it is
+// left in final_layout after the last pass. Imported images are outputs of the graph.
+RenderGraphResource add_imported_image(
+    RenderGraph& graph,
+    const std::string& name,
+    VkFormat format, VkImageLayout final_layout, VkPipelineStageFlags initial_stages);
+
+// An image created by the graph, with the extent of the graph. Its contents don't outlive the frame.
+RenderGraphResource add_transient_image(
+    RenderGraph& graph,
+    const std::string& name,
+    VkFormat format, VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT);
+
+// A buffer (or a range of it) bound every frame with bind_render_graph_buffer().
+// Only the accesses of this frame are synchronized: a range reused by a later frame
+// must be protected by the fence of the frame, like every other per-frame resource.
+RenderGraphResource add_imported_buffer(RenderGraph& graph, const std::string& name);
+
+void mark_render_graph_output(RenderGraph& graph, RenderGraphResource resource);
+
+RenderGraphPassIndex add_render_graph_pass(
+    RenderGraph& graph,
+    const std::string& name, RenderGraphPassType type,
+    std::function<void(VkCommandBuffer)> record);
+
+void add_pass_color_attachment(
+    RenderGraph& graph, RenderGraphPassIndex pass,
+    RenderGraphResource resource,
+    VkAttachmentLoadOp load_op, VkClearColorValue clear_color = {});
+
+// At most one per pass. Cleared to clear_depth (1.0 = far) unless loaded.
+void add_pass_depth_attachment(
+    RenderGraph& graph, RenderGraphPassIndex pass,
+    RenderGraphResource resource,
+    VkAttachmentLoadOp load_op, float clear_depth = 1.0f);
+
+// Resolves the (multisampled) color attachment resource of the pass into resolve_resource
+// (single sampled, same format) at the end of the pass. The pass writes resolve_resource.
+void add_pass_resolve_attachment(
+    RenderGraph& graph, RenderGraphPassIndex pass,
+    RenderGraphResource resource, RenderGraphResource resolve_resource);
+
+void add_pass_access(
+    RenderGraph& graph, RenderGraphPassIndex pass,
+    RenderGraphResource resource, RenderGraphAccess access);
+
+
+// Culls the passes and creates the render passes. Once, after the declaration.
+void compile_render_graph(RenderGraph& graph, VkDevice vk_logic_device);
+
+// Creates the transient images (aliasing their memory) and computes the barriers.
+// Again after every resize, once the previous resources have been retired.
+void create_render_graph_resources(
+    RenderGraph& graph,
+    MemoryAllocator& allocator, VkDevice vk_logic_device,
+    VkExtent2D extent);
+
+// Hands the resources over to the caller, to be destroyed once no frame uses them anymore.
+RenderGraphResources retire_render_graph_resources(RenderGraph& graph);
+
+void destroy_render_graph_resources(RenderGraphResources& resources, MemoryAllocator& allocator, VkDevice vk_logic_device);
+
+// Destroys the render passes and the resources. The device must be idle.
+void destroy_render_graph(RenderGraph& graph, MemoryAllocator& allocator, VkDevice vk_logic_device);
+
+
+// Every frame, before executing the graph.
+void bind_render_graph_image(RenderGraph& graph, RenderGraphResource resource, VkImage vk_image, VkImageView vk_image_view);
+
+void bind_render_graph_buffer(
+    RenderGraph& graph, RenderGraphResource resource,
+    VkBuffer vk_buffer, VkDeviceSize offset, VkDeviceSize size);
+
+// The render pass of a graphics pass, to create the pipelines drawn in it.
+// VK_NULL_HANDLE with dynamic rendering: the pipelines take the formats below instead.
+VkRenderPass get_pass_render_pass(const RenderGraph& graph, RenderGraphPassIndex pass);
+
+// The formats of the color attachments of a graphics pass, in attachment order.
+std::vector<VkFormat> get_pass_color_formats(const RenderGraph& graph, RenderGraphPassIndex pass);
+
+// VK_FORMAT_UNDEFINED if the pass has no depth attachment.
+VkFormat get_pass_depth_format(const RenderGraph& graph, RenderGraphPassIndex pass);
+
+// The sample count of the attachments of a graphics pass (all of them have the same),
+// the rasterizationSamples of the pipelines drawn in it.
+VkSampleCountFlagBits get_pass_samples(const RenderGraph& graph, RenderGraphPassIndex pass);
+
+// The framebuffer of a graphics pass for the images bound this frame (created the first
+// time these images are used together). Secondary command buffers need it up front.
+// VK_NULL_HANDLE with dynamic rendering.
+VkFramebuffer get_pass_framebuffer(RenderGraph& graph, RenderGraphPassIndex pass, VkDevice vk_logic_device);
+
+// Records the barriers and the live passes into the command buffer.
+void execute_render_graph(RenderGraph& graph, VkCommandBuffer vk_command_buffer, VkDevice vk_logic_device);
+
+void print_render_graph(const RenderGraph& graph);
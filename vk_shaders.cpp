@@ -0,0 +1,612 @@
+#include "vk_shaders.hpp"
+
+#include <algorithm> // std::sort | std::max
+#include <cstring> // memcpy | strcmp
+
+#ifdef VKDEMO_EMBED_SHADERS
+#include "embedded_shaders.hpp"
+#endif
+
+
+// The few parts of the SPIR-V specification the reflection reads.
+const uint32_t SPIRV_MAGIC = 0x07230203;
+const size_t SPIRV_HEADER_WORDS = 5;
+
+enum SpirvOp : uint32_t {
+
+    SpvOpEntryPoint = 15,
+    SpvOpTypeInt = 21,
+    SpvOpTypeFloat = 22,
+    SpvOpTypeVector = 23,
+    SpvOpTypeMatrix = 24,
+    SpvOpTypeImage = 25,
+    SpvOpTypeSampler = 26,
+    SpvOpTypeSampledImage = 27,
+    SpvOpTypeArray = 28,
+    SpvOpTypeRuntimeArray = 29,
+    SpvOpTypeStruct = 30,
+    SpvOpTypePointer = 32,
+    SpvOpConstant = 43,
+    SpvOpSpecConstantTrue = 48,
+    SpvOpSpecConstantFalse = 49,
+    SpvOpSpecConstant = 50,
+    SpvOpSpecConstantComposite = 51,
+    SpvOpSpecConstantOp = 52,
+    SpvOpVariable = 59,
+    SpvOpDecorate = 71,
+    SpvOpMemberDecorate = 72
+};
+
+enum SpirvDecoration : uint32_t {
+
+    SpvDecorationBlock = 2,
+    SpvDecorationBufferBlock = 3,
+    SpvDecorationArrayStride = 6,
+    SpvDecorationMatrixStride = 7,
+    SpvDecorationBuiltIn = 11,
+    SpvDecorationLocation = 30,
+    SpvDecorationBinding = 33,
+    SpvDecorationDescriptorSet = 34,
+    SpvDecorationOffset = 35
+};
+
+enum SpirvStorageClass : uint32_t {
+
+    SpvStorageClassUniformConstant = 0,
+    SpvStorageClassInput = 1,
+    SpvStorageClassUniform = 2,
+    SpvStorageClassPushConstant = 9,
+    SpvStorageClassStorageBuffer = 12
+};
+
+// OpTypeImage dimensions that are not plain images.
+const uint32_t SPIRV_DIM_BUFFER = 5;
+const uint32_t SPIRV_DIM_SUBPASS_DATA = 6;
+
+
+ShaderBytecode load_shader(const std::string& file_name) {
+
+#ifdef VKDEMO_EMBED_SHADERS
+    for (const auto& shader : EMBEDDED_SHADERS) {
+        if (strcmp(shader.name, file_name.c_str()) == 0) {
+            return ShaderBytecode(shader.code, shader.code + shader.words_count);
+        }
+    }
+#endif
+
+    std::vector<char> bytes = read_file(file_name);
+    if (bytes.size() % sizeof(uint32_t) != 0) {
+        throw std::runtime_error("Shader " + file_name + " is not SPIR-V (its size is not a multiple of 4 bytes)! \n");
+    }
+
+    ShaderBytecode bytecode(bytes.size() / sizeof(uint32_t));
+    memcpy(bytecode.data(), bytes.data(), bytes.size());
+    return bytecode;
+}
+
+
+// What the reflection keeps of every id: the declarations are read in one pass, the
+// variables are resolved afterwards (decorations may come before what they decorate).
+struct SpirvId {
+
+    uint32_t opcode = 0;
+    std::vector<uint32_t> operands; // Of the declaration, after the result id
+
+    // Decorations
+    uint32_t location = UINT32_MAX;
+    uint32_t binding = UINT32_MAX;
+    uint32_t set = UINT32_MAX;
+    uint32_t array_stride = 0;
+    bool block = false;
+    bool buffer_block = false;
+    bool builtin = false;
+
+    // Struct members
+    std::vector<uint32_t> member_offsets;
+    std::vector<uint32_t> member_matrix_strides;
+};
+
+
+struct SpirvModule {
+
+    std::vector<SpirvId> ids;
+    std::vector<uint32_t> variables;
+    VkShaderStageFlagBits stage = VK_SHADER_STAGE_ALL;
+};
+
+
+static VkShaderStageFlagBits get_execution_model_stage(uint32_t execution_model, const std::string& shader_name) {
+
+    switch (execution_model) {
+    case 0: return VK_SHADER_STAGE_VERTEX_BIT;
+    case 1: return VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT;
+    case 2: return VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT;
+    case 3: return VK_SHADER_STAGE_GEOMETRY_BIT;
+    case 4: return VK_SHADER_STAGE_FRAGMENT_BIT;
+    case 5: return VK_SHADER_STAGE_COMPUTE_BIT;
+    default:
+        throw std::runtime_error("Shader " + shader_name + " has an unsupported execution model! \n");
+    }
+}
+
+
+// Operands (after the opcode word) the reflection reads from the instructions it parses:
+// a shorter instruction is malformed.
+static uint32_t get_min_operands_count(uint32_t opcode) {
+
+    switch (opcode) {
+    case SpvOpEntryPoint:       return 3; // Execution model, entry point, name
+    case SpvOpTypeInt:          return 3; // Result, width, signedness
+    case SpvOpTypeFloat:        return 2; // Result, width
+    case SpvOpTypeVector:       return 3; // Result, component type, count
+    case SpvOpTypeMatrix:       return 3; // Result, column type, count
+    case SpvOpTypeImage:        return 8; // Result, sampled type, dim, depth, arrayed, ms, sampled, format
+    case SpvOpTypeSampler:      return 1;
+    case SpvOpTypeSampledImage: return 2; // Result, image type
+    case SpvOpTypeArray:        return 3; // Result, element type, length
+    case SpvOpTypeRuntimeArray: return 2; // Result, element type
+    case SpvOpTypeStruct:       return 1; // Result, member types...
+    case SpvOpTypePointer:      return 3; // Result, storage class, type
+    case SpvOpConstant:         return 3; // Result type, result, value
+    case SpvOpSpecConstantTrue:
+    case SpvOpSpecConstantFalse:
+    case SpvOpSpecConstant:
+    case SpvOpSpecConstantComposite:
+    case SpvOpSpecConstantOp:   return 2; // Result type, result...
+    case SpvOpVariable:         return 3; // Result type, result, storage class
+    case SpvOpDecorate:         return 2; // Target, decoration, values...
+    case SpvOpMemberDecorate:   return 3; // Struct, member, decoration, values...
+    default:                    return 0;
+    }
+}
+
+
+static SpirvModule parse_spirv(const ShaderBytecode& bytecode, const std::string& shader_name) {
+
+    if (bytecode.size() < SPIRV_HEADER_WORDS || bytecode[0] != SPIRV_MAGIC) {
+        throw std::runtime_error("Shader " + shader_name + " is not SPIR-V! \n");
+    }
+
+    // The bound: every id is smaller. Every id is declared by an instruction of its own,
+    // so a bound larger than the module is corrupted (and not worth allocating).
+    if (bytecode[3] > bytecode.size()) {
+        throw std::runtime_error("Shader " + shader_name + " has an id bound larger than the module! \n");
+    }
+
+    SpirvModule module;
+    module.ids.resize(bytecode[3]);
+
+    auto get_id = [&](uint32_t id) -> SpirvId& {
+        if (id >= module.ids.size()) {
+            throw std::runtime_error("Shader " + shader_name + " has an id out of bounds! \n");
+        }
+        return module.ids[id];
+    };
+
+    size_t word = SPIRV_HEADER_WORDS;
+    while (word < bytecode.size()) {
+
+        uint32_t opcode = bytecode[word] & 0xFFFF;
+        uint32_t words_count = bytecode[word] >> 16;
+        if (words_count == 0 || word + words_count > bytecode.size()) {
+            throw std::runtime_error("Shader " + shader_name + " has a truncated instruction! \n");
+        }
+        const uint32_t* operands = &bytecode[word + 1];
+        uint32_t operands_count = words_count - 1;
+        if (operands_count < get_min_operands_count(opcode)) {
+            throw std::runtime_error("Shader " + shader_name + " has a malformed instruction (opcode "
+                + std::to_string(opcode) + ")! \n");
+        }
+
+        // The value of a decoration, after the operands every decoration has.
+        auto get_decoration_value = [&](uint32_t index) -> uint32_t {
+            if (index >= operands_count) {
+                throw std::runtime_error("Shader " + shader_name + " has a decoration without its value! \n");
+            }
+            return operands[index];
+        };
+
+        switch (opcode) {
+
+        case SpvOpEntryPoint:
+            if (module.stage != VK_SHADER_STAGE_ALL) {
+                throw std::runtime_error("Shader " + shader_name + " has more than one entry point! \n");
+            }
+            module.stage = get_execution_model_stage(operands[0], shader_name);
+            break;
+
+        // Result id first.
+        case SpvOpTypeInt:
+        case SpvOpTypeFloat:
+        case SpvOpTypeVector:
+        case SpvOpTypeMatrix:
+        case SpvOpTypeImage:
+        case SpvOpTypeSampler:
+        case SpvOpTypeSampledImage:
+        case SpvOpTypeArray:
+        case SpvOpTypeRuntimeArray:
+        case SpvOpTypeStruct:
+        case SpvOpTypePointer: {
+            SpirvId& id = get_id(operands[0]);
+            id.opcode = opcode;
+            id.operands.assign(operands + 1, operands + operands_count);
+            break;
+        }
+
+        // Result type, then result id.
+        case SpvOpConstant:
+        case SpvOpVariable: {
+            SpirvId& id = get_id(operands[1]);
+            id.opcode = opcode;
+            id.operands.assign(operands, operands + operands_count);
+            id.operands.erase(id.operands.begin() + 1);
+            if (opcode == SpvOpVariable) {
+                module.variables.push_back(operands[1]);
+            }
+            break;
+        }
+
+        // Only kept to tell them apart from the constants: the reflection doesn't
+        // evaluate specialization constants.
+        case SpvOpSpecConstantTrue:
+        case SpvOpSpecConstantFalse:
+        case SpvOpSpecConstant:
+        case SpvOpSpecConstantComposite:
+        case SpvOpSpecConstantOp:
+            get_id(operands[1]).opcode = opcode;
+            break;
+
+        case SpvOpDecorate: {
+            SpirvId& id = get_id(operands[0]);
+            switch (operands[1]) {
+            case SpvDecorationBlock:         id.block = true; break;
+            case SpvDecorationBufferBlock:   id.buffer_block = true; break;
+            case SpvDecorationArrayStride:   id.array_stride = get_decoration_value(2); break;
+            case SpvDecorationBuiltIn:       id.builtin = true; break;
+            case SpvDecorationLocation:      id.location = get_decoration_value(2); break;
+            case SpvDecorationBinding:       id.binding = get_decoration_value(2); break;
+            case SpvDecorationDescriptorSet: id.set = get_decoration_value(2); break;
+            default: break;
+            }
+            break;
+        }
+
+        case SpvOpMemberDecorate: {
+            SpirvId& id = get_id(operands[0]);
+            uint32_t member = operands[1];
+            if (operands[2] == SpvDecorationOffset || operands[2] == SpvDecorationMatrixStride) {
+                // Like the bound, a struct can't have more members than the module has words.
+                if (member >= bytecode.size()) {
+                    throw std::runtime_error("Shader " + shader_name + " decorates a struct member out of bounds! \n");
+                }
+                if (id.member_offsets.size() <= member) {
+                    id.member_offsets.resize(member + 1, 0);
+                    id.member_matrix_strides.resize(member + 1, 0);
+                }
+                uint32_t value = get_decoration_value(3);
+                (operands[2] == SpvDecorationOffset ? id.member_offsets : id.member_matrix_strides)[member] = value;
+            }
+            break;
+        }
+
+        default:
+            break;
+        }
+
+        word += words_count;
+    }
+
+    if (module.stage == VK_SHADER_STAGE_ALL) {
+        throw std::runtime_error("Shader " + shader_name + " has no entry point! \n");
+    }
+
+    return module;
+}
+
+
+// An id an instruction refers to. The operands of its declaration were checked by
+// parse_spirv(), the ids they refer to are checked when they are read.
+static const SpirvId& get_declaration(const SpirvModule& module, uint32_t id, const std::string& shader_name) {
+
+    if (id >= module.ids.size() || module.ids[id].opcode == 0) {
+        throw std::runtime_error("Shader " + shader_name + " refers to an undeclared id! \n");
+    }
+    return module.ids[id];
+}
+
+
+static uint32_t get_array_length(const SpirvModule& module, const SpirvId& array_type, const std::string& shader_name) {
+
+    const SpirvId& length = get_declaration(module, array_type.operands[1], shader_name);
+    if (length.opcode != SpvOpConstant) {
+        throw std::runtime_error("Shader " + shader_name
+            + " has an array sized by a specialization constant, which is not supported! \n");
+    }
+    return length.operands[1]; // OpConstant: type, value
+}
+
+
+// Size in bytes of a type inside a block (the explicit layout decorations of the block).
+static uint32_t get_type_size(
+    const SpirvModule& module,
+    uint32_t type_id, uint32_t matrix_stride,
+    const std::string& shader_name) {
+
+    const SpirvId& type = get_declaration(module, type_id, shader_name);
+
+    switch (type.opcode) {
+    case SpvOpTypeInt:
+    case SpvOpTypeFloat:
+        return type.operands[0] / 8;
+    case SpvOpTypeVector:
+        return type.operands[1] * get_type_size(module, type.operands[0], 0, shader_name);
+    case SpvOpTypeMatrix:
+        return type.operands[1] * matrix_stride;
+    case SpvOpTypeArray:
+        return get_array_length(module, type, shader_name) * type.array_stride;
+    case SpvOpTypeStruct: {
+        // Up to the end of the last member (the members are in offset order).
+        uint32_t size = 0;
+        for (size_t i = 0; i < type.operands.size() && i < type.member_offsets.size(); i++) {
+            size = std::max(size, type.member_offsets[i] +
+                get_type_size(module, type.operands[i], type.member_matrix_strides[i], shader_name));
+        }
+        return size;
+    }
+    default:
+        return 0; // Runtime arrays have no size
+    }
+}
+
+
+// The 32 bit format of a scalar or vector type.
+static VkFormat get_vertex_input_format(const SpirvModule& module, uint32_t type_id, const std::string& shader_name) {
+
+    const SpirvId& type = get_declaration(module, type_id, shader_name);
+
+    uint32_t components = 1;
+    const SpirvId* scalar = &type;
+    if (type.opcode == SpvOpTypeVector) {
+        components = type.operands[1];
+        scalar = &get_declaration(module, type.operands[0], shader_name);
+    }
+
+    bool is_scalar = scalar->opcode == SpvOpTypeFloat || scalar->opcode == SpvOpTypeInt;
+    if (is_scalar && scalar->operands[0] == 32 && components >= 1 && components <= 4) {
+
+        static const VkFormat float_formats[] = {
+            VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT };
+        static const VkFormat sint_formats[] = {
+            VK_FORMAT_R32_SINT, VK_FORMAT_R32G32_SINT, VK_FORMAT_R32G32B32_SINT, VK_FORMAT_R32G32B32A32_SINT };
+        static const VkFormat uint_formats[] = {
+            VK_FORMAT_R32_UINT, VK_FORMAT_R32G32_UINT, VK_FORMAT_R32G32B32_UINT, VK_FORMAT_R32G32B32A32_UINT };
+
+        if (scalar->opcode == SpvOpTypeFloat) {
+            return float_formats[components - 1];
+        }
+        if (scalar->opcode == SpvOpTypeInt) {
+            // OpTypeInt: width, signedness
+            return scalar->operands[1] != 0 ? sint_formats[components - 1] : uint_formats[components - 1];
+        }
+    }
+
+    throw std::runtime_error("Shader " + shader_name + " has a vertex input of an unsupported type! \n");
+}
+
+
+static VkDescriptorType get_descriptor_type(
+    const SpirvModule& module,
+    uint32_t storage_class, uint32_t type_id,
+    const std::string& shader_name) {
+
+    const SpirvId& type = get_declaration(module, type_id, shader_name);
+
+    if (storage_class == SpvStorageClassStorageBuffer) {
+        return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    }
+    // Before SPIR-V 1.3 storage buffers are Uniform blocks decorated BufferBlock.
+    if (storage_class == SpvStorageClassUniform) {
+        return type.buffer_block ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    }
+
+    switch (type.opcode) {
+    case SpvOpTypeSampler:
+        return VK_DESCRIPTOR_TYPE_SAMPLER;
+    case SpvOpTypeSampledImage:
+        return VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    case SpvOpTypeImage: {
+        // OpTypeImage: sampled type, dim, depth, arrayed, multisampled, sampled (1 = sampled, 2 = storage), format
+        uint32_t dim = type.operands[1];
+        bool storage = type.operands[5] == 2;
+        if (dim == SPIRV_DIM_SUBPASS_DATA) {
+            return VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+        }
+        if (dim == SPIRV_DIM_BUFFER) {
+            return storage ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+        }
+        return storage ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+    }
+    default:
+        throw std::runtime_error("Shader " + shader_name + " has a descriptor of an unsupported type! \n");
+    }
+}
+
+
+ShaderReflection reflect_shader(const ShaderBytecode& bytecode, const std::string& shader_name) {
+
+    SpirvModule module = parse_spirv(bytecode, shader_name);
+
+    ShaderReflection reflection;
+    reflection.stage = module.stage;
+
+    for (uint32_t variable_id : module.variables) {
+
+        const SpirvId& variable = module.ids[variable_id];
+        const SpirvId& pointer = get_declaration(module, variable.operands[0], shader_name); // OpTypePointer: storage class, type
+        if (pointer.opcode != SpvOpTypePointer) {
+            throw std::runtime_error("Shader " + shader_name + " has a variable whose type is not a pointer! \n");
+        }
+        uint32_t storage_class = variable.operands[1];
+        uint32_t type_id = pointer.operands[1];
+
+        if (storage_class == SpvStorageClassInput) {
+
+            // Built-ins (gl_VertexIndex...) are not read from the vertex buffers.
+            if (module.stage != VK_SHADER_STAGE_VERTEX_BIT || variable.builtin ||
+                get_declaration(module, type_id, shader_name).builtin) {
+                continue;
+            }
+            if (variable.location == UINT32_MAX) {
+                throw std::runtime_error("Shader " + shader_name + " has a vertex input without location! \n");
+            }
+
+            // A matrix input takes one location per column.
+            const SpirvId& type = get_declaration(module, type_id, shader_name);
+            if (type.opcode == SpvOpTypeMatrix) {
+                VkFormat column_format = get_vertex_input_format(module, type.operands[0], shader_name);
+                for (uint32_t column = 0; column < type.operands[1]; column++) {
+                    reflection.vertex_inputs.push_back({ variable.location + column, column_format });
+                }
+            }
+            else {
+                reflection.vertex_inputs.push_back({ variable.location, get_vertex_input_format(module, type_id, shader_name) });
+            }
+        }
+        else if (storage_class == SpvStorageClassPushConstant) {
+
+            reflection.push_constants_size = get_type_size(module, type_id, 0, shader_name);
+        }
+        else if (storage_class == SpvStorageClassUniformConstant ||
+                 storage_class == SpvStorageClassUniform ||
+                 storage_class == SpvStorageClassStorageBuffer) {
+
+            // Arrays of descriptors: one binding with descriptorCount elements.
+            uint32_t count = 1;
+            const SpirvId* type = &get_declaration(module, type_id, shader_name);
+            if (type->opcode == SpvOpTypeRuntimeArray) {
+                throw std::runtime_error("Shader " + shader_name + " has a runtime descriptor array, which is not supported! \n");
+            }
+            if (type->opcode == SpvOpTypeArray) {
+                count = get_array_length(module, *type, shader_name);
+                type_id = type->operands[0];
+            }
+
+            ShaderDescriptorBinding descriptor;
+            descriptor.set = variable.set != UINT32_MAX ? variable.set : 0;
+            descriptor.binding.binding = variable.binding != UINT32_MAX ? variable.binding : 0;
+            descriptor.binding.type = get_descriptor_type(module, storage_class, type_id, shader_name);
+            descriptor.binding.count = count;
+            descriptor.binding.stages = module.stage;
+            if (storage_class != SpvStorageClassUniformConstant) {
+                descriptor.block_size = get_type_size(module, type_id, 0, shader_name);
+            }
+            reflection.descriptor_bindings.push_back(descriptor);
+        }
+    }
+
+    std::sort(reflection.vertex_inputs.begin(), reflection.vertex_inputs.end(),
+        [](const ShaderVertexInput& a, const ShaderVertexInput& b) { return a.location < b.location; });
+
+    std::sort(reflection.descriptor_bindings.begin(), reflection.descriptor_bindings.end(),
+        [](const ShaderDescriptorBinding& a, const ShaderDescriptorBinding& b) {
+            return a.set != b.set ? a.set < b.set : a.binding.binding < b.binding.binding;
+        });
+
+    return reflection;
+}
+
+
+DescriptorSetLayoutDesc get_reflected_set_layout(
+    const std::vector<const ShaderReflection*>& stages,
+    uint32_t set, bool dynamic_uniform_buffers) {
+
+    DescriptorSetLayoutDesc desc;
+
+    for (const ShaderReflection* stage : stages) {
+        for (const auto& descriptor : stage->descriptor_bindings) {
+
+            if (descriptor.set != set) {
+                continue;
+            }
+
+            DescriptorBinding binding = descriptor.binding;
+            if (dynamic_uniform_buffers && binding.type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER) {
+                binding.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+            }
+
+            auto existing = std::find_if(desc.bindings.begin(), desc.bindings.end(),
+                [&](const DescriptorBinding& other) { return other.binding == binding.binding; });
+
+            if (existing == desc.bindings.end()) {
+                desc.bindings.push_back(binding);
+                continue;
+            }
+
+            if (existing->type != binding.type) {
+                throw std::runtime_error("Binding " + std::to_string(binding.binding) + " of set " + std::to_string(set)
+                    + " has different descriptor types in two stages! \n");
+            }
+            existing->stages |= binding.stages;
+            existing->count = std::max(existing->count, binding.count);
+        }
+    }
+
+    return desc;
+}
+
+
+void check_vertex_layout(const ShaderReflection& vertex_shader, const VertexLayout& layout, const std::string& shader_name) {
+
+    for (const auto& input : vertex_shader.vertex_inputs) {
+
+        bool found = false;
+        for (const auto& binding : layout.bindings) {
+            for (const auto& attribute : binding.attributes) {
+                found = found || attribute.location == input.location;
+            }
+        }
+
+        if (!found) {
+            throw std::runtime_error("The vertex layout has no attribute for input location "
+                + std::to_string(input.location) + " of shader " + shader_name + "! \n");
+        }
+    }
+}
+
+
+static uint32_t get_vertex_format_size(VkFormat format) {
+
+    switch (format) {
+    case VK_FORMAT_R32_SFLOAT:
+    case VK_FORMAT_R32_SINT:
+    case VK_FORMAT_R32_UINT:
+        return 4;
+    case VK_FORMAT_R32G32_SFLOAT:
+    case VK_FORMAT_R32G32_SINT:
+    case VK_FORMAT_R32G32_UINT:
+        return 8;
+    case VK_FORMAT_R32G32B32_SFLOAT:
+    case VK_FORMAT_R32G32B32_SINT:
+    case VK_FORMAT_R32G32B32_UINT:
+        return 12;
+    default:
+        return 16;
+    }
+}
+
+
+VertexLayout derive_vertex_layout(const ShaderReflection& vertex_shader) {
+
+    VertexBindingLayout binding;
+    binding.stride = 0;
+    binding.input_rate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+    for (const auto& input : vertex_shader.vertex_inputs) {
+        binding.attributes.push_back({ input.location, input.format, binding.stride });
+        binding.stride += get_vertex_format_size(input.format);
+    }
+
+    VertexLayout layout;
+    layout.bindings.push_back(binding);
+    return layout;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "my_utils.hpp"
+#include "vk_mesh.hpp"
+#include "vk_descriptors.hpp"
+
+
+// SPIR-V shaders.
+//
+// The GLSL sources are compiled to SPIR-V by compile_shaders.py (the build step, run by the
+// Visual Studio project before every build, or by hand on the other platforms). The demo
+// loads the shaders by the name of their .spv file:
+//
+// - Built with VKDEMO_EMBED_SHADERS, from embedded_shaders.hpp (compile_shaders.py --embed):
+//   the bytecode is a constexpr array inside the binary, startup reads no file and the
+//   binary runs from any working directory. The Release configurations embed the shaders.
+//
+// - Otherwise, from the .spv files in the working directory: a shader can be recompiled
+//   and picked up without rebuilding the demo.
+//
+// Reflection reads back from the bytecode what the pipelines need to know about the shader
+// interface: the vertex inputs (checked against the vertex layout of the pipeline, or turned
+// into one) and the descriptor bindings (turned into the descriptor set layouts), so the two
+// sides can't silently drift apart when a shader changes.
+
+
+// SPIR-V is a stream of 32 bit words.
+typedef std::vector<uint32_t> ShaderBytecode;
+
+// The embedded shader of that name if the shaders are embedded, the file otherwise.
+ShaderBytecode load_shader(const std::string& file_name);
+
+
+struct ShaderVertexInput {
+
+    uint32_t location;
+    VkFormat format; // The 32 bit format of the GLSL type (vec3 = R32G32B32_SFLOAT)
+};
+
+struct ShaderDescriptorBinding {
+
+    uint32_t set;
+    DescriptorBinding binding; // stages is the stage of the shader
+    uint32_t block_size = 0;   // Uniform and storage buffers: size of the block (without its runtime array)
+};
+
+struct ShaderReflection {
+
+    VkShaderStageFlagBits stage;
+    std::vector<ShaderVertexInput> vertex_inputs;             // Vertex shaders, by location (a matrix takes one per column)
+    std::vector<ShaderDescriptorBinding> descriptor_bindings; // By set, then binding
+    uint32_t push_constants_size = 0;                         // 0 = no push constants
+};
+
+// Parses the declarations of the shader (the entry point must be the only one).
+// Throws if the bytecode is not valid SPIR-V or uses something not supported here
+// (runtime descriptor arrays, arrays sized by specialization constants).
+ShaderReflection reflect_shader(const ShaderBytecode& bytecode, const std::string& shader_name);
+
+// The layout of set number set, from the bindings of every stage of a pipeline (the stages
+// using the same binding are merged). With dynamic_uniform_buffers the uniform buffers
+// become UNIFORM_BUFFER_DYNAMIC: the shader reads them the same way, the choice is the CPU's.
+DescriptorSetLayoutDesc get_reflected_set_layout(
+    const std::vector<const ShaderReflection*>& stages,
+    uint32_t set, bool dynamic_uniform_buffers);
+
+// Throws if an input of the vertex shader has no attribute in the layout. The formats can
+// differ (e.g. a vec4 read from R8G8B8A8_UNORM), unused attributes are allowed.
+void check_vertex_layout(const ShaderReflection& vertex_shader, const VertexLayout& layout, const std::string& shader_name);
+
+// A single per-vertex binding with the inputs of the shader tightly packed in location
+// order, for vertices that are a plain struct of the input types.
+VertexLayout derive_vertex_layout(const ShaderReflection& vertex_shader);
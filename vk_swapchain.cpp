@@ -1,36 +1,31 @@
 #include "vk_swapchain.hpp"
 #include "vk_queue_family.hpp"
-#include <algorithm> // std::clamp
+#include <algorithm> // std::clamp | std::find | std::max
 
 
 void create_vulkan_swapchain(
     VkSwapchainKHR& vk_swapchain,
     GLFWwindow* window, VkSurfaceKHR vk_surface,
     VkPhysicalDevice vk_phys_device, VkDevice vk_logic_device,
-    std::vector<VkImage> vk_swapchain_images, VkFormat& vk_swapchain_image_format, VkExtent2D vk_swapchain_extent) {
+    PresentProfile present_profile, uint32_t requested_images_count,
+    std::vector<VkImage>& vk_swapchain_images, VkFormat& vk_swapchain_image_format, VkExtent2D& vk_swapchain_extent,
+    VkPresentModeKHR& vk_present_mode,
+    VkSwapchainKHR vk_old_swapchain) {
 
+    TRACE_SCOPE("create_vulkan_swapchain");
     std::cout << "Creating Vulkan Swapchain... \n\n";
 
     SwapchainSupportDetails swapchain_support = query_swapchain_support(vk_surface, vk_phys_device);
 
     // Setting up swapchain properties
     VkSurfaceFormatKHR surface_format = choose_swapchain_surface_format(swapchain_support.formats);
-    VkPresentModeKHR present_mode = choose_swapchain_present_mode(swapchain_support.present_modes);
+    VkPresentModeKHR present_mode = choose_swapchain_present_mode(swapchain_support.present_modes, present_profile);
     VkExtent2D swap_extent = choose_swapchain_extent(window, swapchain_support.capabilities);
 
     // Decide how many minimum images we want to have in the swapchain.
-    // Sticking to the minimum means that sometimes it may occur that we have to wait
-    // on the driver to complete internal operations before we can acquire
-    // another image to render to. It is therefore recommended to request
-    // at least one more image than the minimum.
-    uint32_t images_in_swapchain_count = swapchain_support.capabilities.minImageCount + 1;
-
-    // Make sure to not exceed the maximum number of images 
-    if (swapchain_support.capabilities.maxImageCount > 0 &&
-        images_in_swapchain_count > swapchain_support.capabilities.maxImageCount) {
-
-        images_in_swapchain_count = swapchain_support.capabilities.maxImageCount;
-    }
+    uint32_t images_in_swapchain_count = choose_swapchain_images_count(
+        swapchain_support.capabilities,
+        present_profile, requested_images_count);
 
     // Fill the Swapchain struct
     VkSwapchainCreateInfoKHR swapchain_create_info{};
@@ -89,9 +84,10 @@ void create_vulkan_swapchain(
 
     // Swapchain can become invalid or unoptimized ar runtime, 
     // for example when the window is resized. In that case the swapchain
-    // must be recreated from scratch and a copy of the old one must be specified.
-    // For now we will assume to create only one swapchain.
-    swapchain_create_info.oldSwapchain = VK_NULL_HANDLE;
+    // must be recreated and the old one must be specified, so that the
+    // implementation can reuse its resources (and images that are already
+    // being presented can finish presenting).
+    swapchain_create_info.oldSwapchain = vk_old_swapchain;
 
     if (vkCreateSwapchainKHR(
         vk_logic_device,
@@ -113,11 +109,56 @@ void create_vulkan_swapchain(
     // Written just because will need it in the future.
     vk_swapchain_image_format = surface_format.format;
     vk_swapchain_extent = swap_extent;
+    vk_present_mode = present_mode;
+
+    std::cout << "\t Swapchain extent: " << swap_extent.width << "x" << swap_extent.height
+        << " (" << images_in_swapchain_count << " images). \n";
+    std::cout << "\t Present mode: " << present_mode_to_string(present_mode)
+        << " (" << present_profile_to_string(present_profile) << " profile). \n\n";
 
     std::cout << "Vulkan Swapchain created. \n\n";
 }
 
 
+void destroy_retired_swapchain(RetiredSwapchain& retired_swapchain, MemoryAllocator& allocator, VkDevice vk_logic_device) {
+
+    // Same order as in cleanup: framebuffers (with the graph resources), image views,
+    // then the swapchain owning the images.
+    destroy_render_graph_resources(retired_swapchain.graph_resources, allocator, vk_logic_device);
+    for (auto img_view : retired_swapchain.image_views) {
+        vkDestroyImageView(vk_logic_device, img_view, nullptr);
+    }
+    vkDestroySwapchainKHR(vk_logic_device, retired_swapchain.swapchain, nullptr);
+    destroy_render_finished_semaphores(retired_swapchain.render_finished_semaphores, vk_logic_device);
+
+    retired_swapchain.image_views.clear();
+    retired_swapchain.swapchain = VK_NULL_HANDLE;
+}
+
+
+void create_render_finished_semaphores(std::vector<VkSemaphore>& semaphores, size_t images_count, VkDevice vk_logic_device) {
+
+    VkSemaphoreCreateInfo semaphore_create_info{};
+    semaphore_create_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+    semaphores.resize(images_count, VK_NULL_HANDLE);
+    for (auto& semaphore : semaphores) {
+        if (vkCreateSemaphore(vk_logic_device, &semaphore_create_info, nullptr, &semaphore) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create Vulkan Render finished semaphore! \n");
+        }
+    }
+}
+
+
+void destroy_render_finished_semaphores(std::vector<VkSemaphore>& semaphores, VkDevice vk_logic_device) {
+
+    for (auto semaphore : semaphores) {
+        vkDestroySemaphore(vk_logic_device, semaphore, nullptr);
+    }
+    semaphores.clear();
+}
+
+
 VkSurfaceFormatKHR choose_swapchain_surface_format(const std::vector<VkSurfaceFormatKHR>& available_formats) {
 
     // We are choosing the best possible swapchain surface format.
@@ -143,29 +184,92 @@ VkSurfaceFormatKHR choose_swapchain_surface_format(const std::vector<VkSurfaceFo
 }
 
 
-VkPresentModeKHR choose_swapchain_present_mode(const std::vector<VkPresentModeKHR>& available_present_modes) {
-
-    // Since we are on a computer and not a mobile device, 
-    // the best present mode is probably VK_PRESENT_MODE_MAILBOX_KHR.
-    // Even though it may be possible that it's not available.
-    // The only present mode guaranteed to be available is
-    // VK_PRESENT_MODE_FIFO_KHR, so we need to query even for
-    // present modes.
+VkPresentModeKHR choose_swapchain_present_mode(
+    const std::vector<VkPresentModeKHR>& available_present_modes,
+    PresentProfile present_profile) {
+
+    // The present modes, from the lowest latency to the lowest power usage:
+    // IMMEDIATE:    images are shown right away, may cause tearing. Never waits.
+    // MAILBOX:      the newest image replaces the queued one at the next vblank, no tearing.
+    //               Renders as fast as possible, but frames that are never shown waste power.
+    // FIFO_RELAXED: like FIFO, but a late image is shown right away (tearing) instead of
+    //               waiting one more vblank.
+    // FIFO:         a queue emptied at every vblank (vsync). Capped at the refresh rate.
+    // The only present mode guaranteed to be available is VK_PRESENT_MODE_FIFO_KHR,
+    // so every profile falls back to it.
+    std::vector<VkPresentModeKHR> preferred_modes;
+
+    switch (present_profile) {
+    case PresentProfile::LowLatency:
+        preferred_modes = { VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_MAILBOX_KHR };
+        break;
+    case PresentProfile::MaxThroughput:
+        preferred_modes = { VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR };
+        break;
+    case PresentProfile::PowerSaving:
+        preferred_modes = { VK_PRESENT_MODE_FIFO_RELAXED_KHR };
+        break;
+    }
 
-    for (const auto& available_present_mode : available_present_modes) {
+    for (auto preferred_mode : preferred_modes) {
 
-        if (available_present_mode == VK_PRESENT_MODE_MAILBOX_KHR) {
+        if (std::find(available_present_modes.begin(), available_present_modes.end(), preferred_mode) !=
+            available_present_modes.end()) {
 
-            return available_present_mode;
+            return preferred_mode;
         }
     }
 
-    // As we said, if VK_PRESENT_MODE_MAILBOX_KHR is not present
-    // just return the guaranteed one.
     return VK_PRESENT_MODE_FIFO_KHR;
 }
 
 
+uint32_t choose_swapchain_images_count(
+    const VkSurfaceCapabilitiesKHR& capabilities,
+    PresentProfile present_profile, uint32_t requested_images_count) {
+
+    // Sticking to the minimum means that sometimes it may occur that we have to wait
+    // on the driver to complete internal operations before we can acquire
+    // another image to render to. That is what we want when saving power (the
+    // frame rate is capped anyway) or latency (fewer images queued in front of the
+    // one we are rendering). For throughput we request one more than the minimum.
+    uint32_t images_count = capabilities.minImageCount;
+    if (present_profile == PresentProfile::MaxThroughput) {
+        images_count++;
+    }
+
+    if (requested_images_count > 0) {
+        images_count = std::max(requested_images_count, capabilities.minImageCount);
+    }
+
+    // Make sure to not exceed the maximum number of images (0 means no maximum).
+    if (capabilities.maxImageCount > 0 && images_count > capabilities.maxImageCount) {
+        images_count = capabilities.maxImageCount;
+    }
+
+    if (requested_images_count > 0 && images_count != requested_images_count) {
+        std::cout << "\t Requested " << requested_images_count << " swapchain images, the surface supports "
+            << capabilities.minImageCount << " to "
+            << (capabilities.maxImageCount > 0 ? std::to_string(capabilities.maxImageCount) : "unlimited")
+            << ": using " << images_count << ". \n";
+    }
+
+    return images_count;
+}
+
+
+const char* present_mode_to_string(VkPresentModeKHR present_mode) {
+
+    switch (present_mode) {
+    case VK_PRESENT_MODE_IMMEDIATE_KHR:    return "IMMEDIATE";
+    case VK_PRESENT_MODE_MAILBOX_KHR:      return "MAILBOX";
+    case VK_PRESENT_MODE_FIFO_KHR:         return "FIFO";
+    case VK_PRESENT_MODE_FIFO_RELAXED_KHR: return "FIFO_RELAXED";
+    default:                               return "OTHER";
+    }
+}
+
+
 VkExtent2D choose_swapchain_extent(GLFWwindow* window, const VkSurfaceCapabilitiesKHR& capabilities) {
 
     // The swap extent is the resolution of the swapchain images
@@ -214,9 +318,10 @@ VkExtent2D choose_swapchain_extent(GLFWwindow* window, const VkSurfaceCapabiliti
 void create_swapchain_image_views(
     std::vector<VkImageView>& vk_swapchain_image_views,
     VkDevice vk_logic_device,
-    std::vector<VkImage> vk_swapchain_images,
+    const std::vector<VkImage>& vk_swapchain_images,
     VkFormat& vk_swapchain_image_format) {
 
+    TRACE_SCOPE("create_swapchain_image_views");
     std::cout << "Creating Vulkan Image views for Vulkan Swapchain images... \n";
 
     // Resize to fit all the image views we will create
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "my_utils.hpp"
+#include "app_config.hpp" // PresentProfile
+#include "vk_render_graph.hpp" // RenderGraphResources
 
 
 // Just checking if a swapchain is available is not sufficient, it may not be
@@ -14,22 +16,65 @@ struct SwapchainSupportDetails {
 };
 
 
+// Objects left over by a swapchain recreation. They may still be used by frames
+// that are in flight, so they are destroyed later, once those frames are done.
+struct RetiredSwapchain {
+
+    VkSwapchainKHR swapchain;
+    std::vector<VkImageView> image_views;
+    RenderGraphResources graph_resources; // Framebuffers and transient images of the old extent
+    std::vector<VkSemaphore> render_finished_semaphores; // A present may still wait on them
+
+    // Number of frames submitted when the swapchain was retired.
+    // Only the frames before this one can reference the objects above.
+    uint64_t retired_at_frame;
+};
+
+
+// The present mode and the number of images are chosen by the present profile,
+// requested_images_count (if not 0) overrides the number of images of the profile.
+// vk_old_swapchain is the swapchain being replaced (or VK_NULL_HANDLE the first time).
+// Passing it lets the implementation reuse its resources, and retires it:
+// no more images can be acquired from it, but it still has to be destroyed.
 void create_vulkan_swapchain(
     VkSwapchainKHR& vk_swapchain,
     GLFWwindow* window, VkSurfaceKHR vk_surface,
     VkPhysicalDevice vk_phys_device, VkDevice vk_logic_device,
-    std::vector<VkImage> vk_swapchain_images, VkFormat& vk_swapchain_image_format, VkExtent2D vk_swapchain_extent);
+    PresentProfile present_profile, uint32_t requested_images_count,
+    std::vector<VkImage>& vk_swapchain_images, VkFormat& vk_swapchain_image_format, VkExtent2D& vk_swapchain_extent,
+    VkPresentModeKHR& vk_present_mode,
+    VkSwapchainKHR vk_old_swapchain = VK_NULL_HANDLE);
+
+void destroy_retired_swapchain(RetiredSwapchain& retired_swapchain, MemoryAllocator& allocator, VkDevice vk_logic_device);
+
+
+// One render finished semaphore per swapchain image, signaled by the submit that renders
+// into the image and waited on by its present. They can't belong to the frames in flight:
+// no fence tells when a present has finished waiting, so with more images than frames in
+// flight a frame could signal a semaphore that an earlier present still holds. An image
+// is only acquired again once its previous present is done, and so is its semaphore.
+void create_render_finished_semaphores(std::vector<VkSemaphore>& semaphores, size_t images_count, VkDevice vk_logic_device);
+
+void destroy_render_finished_semaphores(std::vector<VkSemaphore>& semaphores, VkDevice vk_logic_device);
 
 VkSurfaceFormatKHR choose_swapchain_surface_format(const std::vector<VkSurfaceFormatKHR>& available_formats);
 
-VkPresentModeKHR choose_swapchain_present_mode(const std::vector<VkPresentModeKHR>& available_present_modes);
+VkPresentModeKHR choose_swapchain_present_mode(
+    const std::vector<VkPresentModeKHR>& available_present_modes,
+    PresentProfile present_profile);
+
+uint32_t choose_swapchain_images_count(
+    const VkSurfaceCapabilitiesKHR& capabilities,
+    PresentProfile present_profile, uint32_t requested_images_count);
+
+const char* present_mode_to_string(VkPresentModeKHR present_mode);
 
 VkExtent2D choose_swapchain_extent(GLFWwindow* window, const VkSurfaceCapabilitiesKHR& capabilities);
 
 void create_swapchain_image_views(
     std::vector<VkImageView>& vk_swapchain_image_views,
     VkDevice vk_logic_device,
-    std::vector<VkImage> vk_swapchain_images,
+    const std::vector<VkImage>& vk_swapchain_images,
     VkFormat& vk_swapchain_image_format);
 
 SwapchainSupportDetails query_swapchain_support(VkSurfaceKHR vk_surface, VkPhysicalDevice phys_device);
\ No newline at end of file
@@ -0,0 +1,193 @@
+#include "vk_trace.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+
+namespace {
+
+    using trace_clock = std::chrono::steady_clock;
+
+    struct TraceEvent {
+
+        const char* name;
+        int64_t timestamp_ns; // Since start_tracing()
+        char phase;           // 'B' (begin) or 'E' (end)
+    };
+
+    struct ThreadTraceBuffer {
+
+        uint32_t thread_id;
+        const char* thread_name = nullptr;
+
+        std::unique_ptr<TraceEvent[]> events;
+
+        // Only the owning thread writes the events, it publishes them by increasing
+        // the count (release). save_trace() reads the count (acquire) and then the events.
+        std::atomic<size_t> count{ 0 };
+        std::atomic<uint64_t> dropped{ 0 };
+    };
+
+    std::atomic<bool> tracing_enabled{ false };
+    trace_clock::time_point trace_start;
+
+    // The registry owns the buffers, so they outlive the threads that recorded them.
+    std::mutex registry_mutex;
+    std::vector<std::unique_ptr<ThreadTraceBuffer>> registry;
+
+    thread_local ThreadTraceBuffer* thread_buffer = nullptr;
+
+
+    ThreadTraceBuffer* get_thread_buffer() {
+
+        if (thread_buffer == nullptr) {
+
+            auto buffer = std::make_unique<ThreadTraceBuffer>();
+            buffer->events = std::make_unique<TraceEvent[]>(TRACE_EVENTS_PER_THREAD);
+
+            std::lock_guard<std::mutex> lock(registry_mutex);
+            buffer->thread_id = static_cast<uint32_t>(registry.size()) + 1;
+            thread_buffer = buffer.get();
+            registry.push_back(std::move(buffer));
+        }
+
+        return thread_buffer;
+    }
+
+
+    void record_event(const char* name, char phase) {
+
+        if (!tracing_enabled.load(std::memory_order_relaxed)) {
+            return;
+        }
+
+        int64_t timestamp_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(trace_clock::now() - trace_start).count();
+
+        ThreadTraceBuffer* buffer = get_thread_buffer();
+        size_t index = buffer->count.load(std::memory_order_relaxed);
+
+        if (index >= TRACE_EVENTS_PER_THREAD) {
+            buffer->dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        buffer->events[index] = { name, timestamp_ns, phase };
+        buffer->count.store(index + 1, std::memory_order_release);
+    }
+
+
+    void write_json_string(std::ofstream& file, const char* text) {
+
+        file << '"';
+        for (const char* c = text; *c != '\0'; c++) {
+            if (*c == '"' || *c == '\\') {
+                file << '\\';
+            }
+            file << *c;
+        }
+        file << '"';
+    }
+}
+
+
+void start_tracing() {
+
+    trace_start = trace_clock::now();
+    tracing_enabled.store(true, std::memory_order_release);
+}
+
+
+bool is_tracing_enabled() {
+
+    return tracing_enabled.load(std::memory_order_relaxed);
+}
+
+
+void trace_begin(const char* name) {
+
+    record_event(name, 'B');
+}
+
+
+void trace_end(const char* name) {
+
+    record_event(name, 'E');
+}
+
+
+void set_trace_thread_name(const char* name) {
+
+    if (!is_tracing_enabled()) {
+        return;
+    }
+    get_thread_buffer()->thread_name = name;
+}
+
+
+void save_trace(const std::string& file_name) {
+
+    std::cout << "Saving trace to " << file_name << "... \n\n";
+
+    std::ofstream file(file_name);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open file: " + file_name + " \n");
+    }
+
+    std::lock_guard<std::mutex> lock(registry_mutex);
+
+    size_t events_count = 0;
+    uint64_t dropped_count = 0;
+    bool first_event = true;
+
+    // Timestamps are in microseconds in the Chrome Trace Event format.
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+    for (const auto& buffer : registry) {
+
+        if (buffer->thread_name != nullptr) {
+            file << (first_event ? "\n" : ",\n");
+            first_event = false;
+
+            file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->thread_id
+                << ",\"args\":{\"name\":";
+            write_json_string(file, buffer->thread_name);
+            file << "}}";
+        }
+
+        size_t count = buffer->count.load(std::memory_order_acquire);
+        for (size_t i = 0; i < count; i++) {
+
+            const TraceEvent& event = buffer->events[i];
+
+            file << (first_event ? "\n" : ",\n");
+            first_event = false;
+
+            file << "{\"name\":";
+            write_json_string(file, event.name);
+            file << ",\"ph\":\"" << event.phase << "\""
+                << ",\"ts\":" << (event.timestamp_ns / 1000) << "." << (event.timestamp_ns % 1000 / 100)
+                << ",\"pid\":1,\"tid\":" << buffer->thread_id << "}";
+        }
+
+        events_count += count;
+        dropped_count += buffer->dropped.load(std::memory_order_relaxed);
+    }
+
+    file << "\n]}\n";
+
+    if (!file) {
+        throw std::runtime_error("Failed to write file: " + file_name + " \n");
+    }
+
+    std::cout << "\t Events: " << events_count << " from " << registry.size() << " thread(s). \n";
+    if (dropped_count > 0) {
+        std::cout << "\t Dropped events (buffer full): " << dropped_count << ". \n";
+    }
+    std::cout << "\n" << "Trace saved. \n\n";
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+
+// Lightweight tracing in the Chrome Trace Event format, the JSON written by
+// save_trace() can be loaded in about://tracing or https://ui.perfetto.dev.
+//
+// Every thread records its begin/end events into its own buffer, so recording
+// takes no lock: the only synchronization is the atomic event counter of the
+// buffer. A mutex is taken once per thread, the first time it records an event,
+// to register the buffer. Event names must be string literals (only the pointer is
+// stored). When tracing was never started every call returns right away.
+
+
+// Events a single thread can record. Once full, the following events are dropped
+// (and counted), the buffer is never reallocated while other threads may read it.
+const size_t TRACE_EVENTS_PER_THREAD = 1 << 18;
+
+
+// Starts recording. Events recorded before this call are ignored.
+void start_tracing();
+
+bool is_tracing_enabled();
+
+void trace_begin(const char* name);
+
+void trace_end(const char* name);
+
+// Name shown for the calling thread in the trace viewer.
+void set_trace_thread_name(const char* name);
+
+// Writes all the recorded events. Must be called when no other thread is recording.
+void save_trace(const std::string& file_name);
+
+
+// Records a begin event now and the matching end event at the end of the scope.
+struct TraceScope {
+
+    const char* name;
+
+    explicit TraceScope(const char* scope_name) : name(scope_name) {
+        trace_begin(name);
+    }
+
+    ~TraceScope() {
+        trace_end(name);
+    }
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+
+// TRACE_SCOPE("name") traces the enclosing scope.
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(trace_scope_, __LINE__)(name)
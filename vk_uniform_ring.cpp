@@ -0,0 +1,69 @@
+#include "vk_uniform_ring.hpp"
+#include "vk_buffer.hpp"
+
+#include <algorithm> // std::max
+
+
+void create_uniform_ring(
+    UniformRing& ring,
+    MemoryAllocator& allocator,
+    VkPhysicalDevice vk_phys_device, VkDevice vk_logic_device,
+    VkDeviceSize frame_size, uint32_t frames_in_flight) {
+
+    TRACE_SCOPE("create_uniform_ring");
+    std::cout << "Creating the Uniform ring buffer... \n\n";
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(vk_phys_device, &properties);
+    VkDeviceSize alignment = std::max<VkDeviceSize>(properties.limits.minUniformBufferOffsetAlignment, 1);
+
+    // Every region starts aligned too, so the offsets stay aligned across regions.
+    frame_size = (frame_size + alignment - 1) & ~(alignment - 1);
+
+    // Coherent: the writes through the mapped pointer need no flush.
+    // The CPU only ever writes this memory, sequentially, so write-combined memory is fine.
+    create_buffer(
+        ring.buffer, ring.allocation,
+        allocator, vk_logic_device,
+        frame_size * frames_in_flight,
+        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+    init_uniform_ring(ring, ring.allocation.mapped, frame_size, alignment, frames_in_flight);
+
+    std::cout << "\t Size: " << frame_size / 1024 << " KB x " << frames_in_flight << " frame(s) in flight. \n";
+    std::cout << "\t Block alignment: " << alignment << " bytes. \n\n";
+}
+
+
+void destroy_uniform_ring(UniformRing& ring, MemoryAllocator& allocator, VkDevice vk_logic_device) {
+
+    destroy_buffer(ring.buffer, ring.allocation, allocator, vk_logic_device);
+    ring.mapped = nullptr;
+}
+
+
+void init_uniform_ring(
+    UniformRing& ring,
+    void* mapped, VkDeviceSize frame_size, VkDeviceSize alignment, uint32_t frames_count) {
+
+    if ((alignment & (alignment - 1)) != 0) {
+        throw std::runtime_error("Uniform ring alignment must be a power of two! \n");
+    }
+
+    ring.mapped = static_cast<uint8_t*>(mapped);
+    ring.frame_size = frame_size;
+    ring.alignment = alignment;
+    ring.frames_count = frames_count;
+    ring.frame_index = 0;
+    ring.head = 0;
+    ring.peak_bytes = 0;
+}
+
+
+void begin_uniform_ring_frame(UniformRing& ring, uint32_t frame_index) {
+
+    ring.peak_bytes = std::max(ring.peak_bytes, ring.head);
+    ring.frame_index = frame_index % ring.frames_count;
+    ring.head = 0;
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "my_utils.hpp"
+#include "vk_memory.hpp"
+
+#include <cstring> // memcpy
+#include <stdexcept>
+
+
+// Ring buffer for the transient uniform data of every frame (per-frame constants,
+// per-object transforms, material parameters...).
+//
+// A single host visible buffer, persistently mapped, split in one region per frame in
+// flight. Writing a block of constants is a pointer bump in the region of the current
+// frame plus a memcpy: no buffer is created and no descriptor is updated. The shaders
+// read the block through a VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC descriptor, and the
+// offset of the block is passed as a dynamic offset to vkCmdBindDescriptorSets().
+//
+// Every block starts at a multiple of minUniformBufferOffsetAlignment, which dynamic
+// offsets must respect (from 16 to 256 bytes, depending on the GPU).
+//
+// The region of a frame is only written again frames_in_flight frames later, after
+// waiting for the fence of that frame: the GPU is done reading it by then.
+
+
+// Size of the region of every frame in flight.
+const VkDeviceSize UNIFORM_RING_FRAME_SIZE = 4ull * 1024 * 1024;
+
+
+struct UniformRing {
+
+    VkBuffer buffer = VK_NULL_HANDLE;
+    MemoryAllocation allocation;
+
+    uint8_t* mapped = nullptr;  // Start of the buffer
+    VkDeviceSize frame_size = 0;
+    VkDeviceSize alignment = 1; // minUniformBufferOffsetAlignment
+    uint32_t frames_count = 0;
+
+    uint32_t frame_index = 0;
+    VkDeviceSize head = 0;      // Next free byte in the region of the current frame
+
+    VkDeviceSize peak_bytes = 0; // Most bytes used by a frame so far
+};
+
+
+struct UniformBlock {
+
+    void* data;      // Where to write the block
+    uint32_t offset; // Dynamic offset of the block in the buffer
+};
+
+
+// Creates the buffer (frame_size bytes per frame in flight) and maps it.
+void create_uniform_ring(
+    UniformRing& ring,
+    MemoryAllocator& allocator,
+    VkPhysicalDevice vk_phys_device, VkDevice vk_logic_device,
+    VkDeviceSize frame_size, uint32_t frames_in_flight);
+
+void destroy_uniform_ring(UniformRing& ring, MemoryAllocator& allocator, VkDevice vk_logic_device);
+
+// Sets up the ring over memory that is already mapped, frames_count * frame_size bytes.
+// No Vulkan involved, the benchmarks use it on plain host memory.
+void init_uniform_ring(
+    UniformRing& ring,
+    void* mapped, VkDeviceSize frame_size, VkDeviceSize alignment, uint32_t frames_count);
+
+// Starts writing into the region of this frame in flight. Its fence must have been waited for.
+void begin_uniform_ring_frame(UniformRing& ring, uint32_t frame_index);
+
+// Reserves size bytes in the region of the current frame.
+// Throws if the region is full (UNIFORM_RING_FRAME_SIZE is too small).
+inline UniformBlock allocate_uniform_block(UniformRing& ring, VkDeviceSize size) {
+
+    // alignment is a power of two (required by the spec)
+    VkDeviceSize start = (ring.head + ring.alignment - 1) & ~(ring.alignment - 1);
+
+    if (start + size > ring.frame_size) {
+        throw std::runtime_error("Uniform ring buffer full, increase UNIFORM_RING_FRAME_SIZE! \n");
+    }
+
+    ring.head = start + size;
+
+    VkDeviceSize offset = static_cast<VkDeviceSize>(ring.frame_index) * ring.frame_size + start;
+    return { ring.mapped + offset, static_cast<uint32_t>(offset) };
+}
+
+// Copies the block into the ring and returns its dynamic offset.
+template <typename T>
+uint32_t push_uniform_block(UniformRing& ring, const T& block) {
+
+    UniformBlock reserved = allocate_uniform_block(ring, sizeof(T));
+    memcpy(reserved.data, &block, sizeof(T));
+    return reserved.offset;
+}
@@ -0,0 +1,253 @@
+#include "vk_upload_scheduler.hpp"
+#include "vk_buffer.hpp"
+
+#include <algorithm> // std::min | std::max
+#include <cstring> // memcpy
+
+
+void create_upload_scheduler(
+    UploadScheduler& scheduler,
+    MemoryAllocator& allocator, VkDevice vk_logic_device,
+    uint32_t transfer_family, VkQueue vk_transfer_queue,
+    VkDeviceSize bytes_per_frame) {
+
+    TRACE_SCOPE("create_upload_scheduler");
+    std::cout << "Creating Upload scheduler... \n\n";
+
+    scheduler.transfer_queue = vk_transfer_queue;
+    scheduler.bytes_per_frame = bytes_per_frame;
+
+    // The command buffers of the batches are recorded again every time their slot is reused.
+    VkCommandPoolCreateInfo command_pool_create_info{};
+    command_pool_create_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    command_pool_create_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    command_pool_create_info.queueFamilyIndex = transfer_family;
+
+    if (vkCreateCommandPool(vk_logic_device, &command_pool_create_info, nullptr, &scheduler.command_pool) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create the Upload scheduler command pool! \n");
+    }
+
+    VkCommandBufferAllocateInfo command_buffer_allocate_info{};
+    command_buffer_allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    command_buffer_allocate_info.commandPool = scheduler.command_pool;
+    command_buffer_allocate_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    command_buffer_allocate_info.commandBufferCount = 1;
+
+    VkFenceCreateInfo fence_create_info{};
+    fence_create_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+    for (auto& batch : scheduler.batches) {
+
+        if (vkAllocateCommandBuffers(vk_logic_device, &command_buffer_allocate_info, &batch.command_buffer) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to allocate the Upload scheduler command buffers! \n");
+        }
+        if (vkCreateFence(vk_logic_device, &fence_create_info, nullptr, &batch.fence) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create the Upload scheduler fences! \n");
+        }
+    }
+
+    // A timeline semaphore is a single semaphore for every batch: batch N signals value N,
+    // and waiting for value N also covers the batches before it.
+    VkSemaphoreTypeCreateInfo semaphore_type_info{};
+    semaphore_type_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    semaphore_type_info.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    semaphore_type_info.initialValue = 0;
+
+    VkSemaphoreCreateInfo semaphore_create_info{};
+    semaphore_create_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphore_create_info.pNext = &semaphore_type_info;
+
+    if (vkCreateSemaphore(vk_logic_device, &semaphore_create_info, nullptr, &scheduler.timeline_semaphore) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create the Upload scheduler timeline semaphore! \n");
+    }
+
+    // Host visible and coherent: the CPU writes the staging slots through the mapped pointer.
+    create_buffer(
+        scheduler.staging_buffer, scheduler.staging_allocation,
+        allocator, vk_logic_device,
+        bytes_per_frame * UPLOAD_STAGING_SLOTS,
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+    std::cout << "\t Budget: " << bytes_per_frame / 1024 << " KB per frame, "
+        << UPLOAD_STAGING_SLOTS << " staging slots. \n\n";
+
+    std::cout << "Upload scheduler created. \n\n";
+}
+
+
+void destroy_upload_scheduler(UploadScheduler& scheduler, MemoryAllocator& allocator, VkDevice vk_logic_device) {
+
+    destroy_buffer(scheduler.staging_buffer, scheduler.staging_allocation, allocator, vk_logic_device);
+
+    vkDestroySemaphore(vk_logic_device, scheduler.timeline_semaphore, nullptr);
+    scheduler.timeline_semaphore = VK_NULL_HANDLE;
+
+    for (auto& batch : scheduler.batches) {
+        vkDestroyFence(vk_logic_device, batch.fence, nullptr);
+        batch = UploadBatch{};
+    }
+
+    // Frees the command buffers too.
+    vkDestroyCommandPool(vk_logic_device, scheduler.command_pool, nullptr);
+    scheduler.command_pool = VK_NULL_HANDLE;
+
+    scheduler.pending.clear();
+}
+
+
+UploadTicket schedule_buffer_upload(
+    UploadScheduler& scheduler,
+    const void* data, VkDeviceSize size,
+    VkBuffer dst_buffer, VkDeviceSize dst_offset) {
+
+    // vkCmdCopyBuffer() doesn't allow a region of size 0.
+    if (size == 0) {
+        throw std::runtime_error("Cannot schedule an upload of 0 bytes! \n");
+    }
+
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+
+    PendingUpload upload;
+    upload.ticket = ++scheduler.last_ticket;
+    upload.data.assign(bytes, bytes + size);
+    upload.dst_buffer = dst_buffer;
+    upload.dst_offset = dst_offset;
+    scheduler.pending.push_back(std::move(upload));
+
+    VkDeviceSize pending_bytes = 0;
+    for (const auto& pending : scheduler.pending) {
+        pending_bytes += pending.data.size() - pending.uploaded;
+    }
+    scheduler.peak_pending_bytes = std::max(scheduler.peak_pending_bytes, pending_bytes);
+
+    return scheduler.last_ticket;
+}
+
+
+void process_uploads(UploadScheduler& scheduler, VkDevice vk_logic_device) {
+
+    TRACE_SCOPE("process_uploads");
+
+    // Batches complete in submission order on the queue, but checking each of them
+    // costs nothing and doesn't rely on it.
+    for (auto& batch : scheduler.batches) {
+
+        if (batch.in_flight && vkGetFenceStatus(vk_logic_device, batch.fence) == VK_SUCCESS) {
+            batch.in_flight = false;
+        }
+    }
+
+    if (scheduler.pending.empty()) {
+        return;
+    }
+
+    // The GPU is still copying from every slot: try again next frame rather than wait.
+    UploadBatch& batch = scheduler.batches[scheduler.next_batch];
+    if (batch.in_flight) {
+        scheduler.busy_frames++;
+        return;
+    }
+
+    VkDeviceSize slot_offset = scheduler.next_batch * scheduler.bytes_per_frame;
+    uint8_t* slot = static_cast<uint8_t*>(scheduler.staging_allocation.mapped) + slot_offset;
+
+    vkResetCommandBuffer(batch.command_buffer, 0);
+
+    VkCommandBufferBeginInfo begin_info{};
+    begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkBeginCommandBuffer(batch.command_buffer, &begin_info);
+
+    // Packs the pending uploads into the slot, in order, until the budget is spent.
+    // The upload that doesn't fit goes on in the next batch, from where this one stopped.
+    batch.last_ticket = 0;
+    VkDeviceSize used = 0;
+    while (!scheduler.pending.empty() && used < scheduler.bytes_per_frame) {
+
+        PendingUpload& upload = scheduler.pending.front();
+
+        VkDeviceSize remaining = upload.data.size() - upload.uploaded;
+        VkDeviceSize chunk = std::min(remaining, scheduler.bytes_per_frame - used);
+
+        memcpy(slot + used, upload.data.data() + upload.uploaded, static_cast<size_t>(chunk));
+
+        VkBufferCopy copy_region{};
+        copy_region.srcOffset = slot_offset + used;
+        copy_region.dstOffset = upload.dst_offset + upload.uploaded;
+        copy_region.size = chunk;
+        vkCmdCopyBuffer(batch.command_buffer, scheduler.staging_buffer, upload.dst_buffer, 1, &copy_region);
+
+        used += chunk;
+        upload.uploaded += chunk;
+
+        if (upload.uploaded == upload.data.size()) {
+            batch.last_ticket = upload.ticket;
+            scheduler.pending.pop_front();
+        }
+    }
+
+    vkEndCommandBuffer(batch.command_buffer);
+
+    VkSubmitInfo submit_info{};
+    submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submit_info.commandBufferCount = 1;
+    submit_info.pCommandBuffers = &batch.command_buffer;
+
+    uint64_t signal_value = scheduler.timeline_value + 1;
+    VkTimelineSemaphoreSubmitInfo timeline_submit_info{};
+    timeline_submit_info.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timeline_submit_info.signalSemaphoreValueCount = 1;
+    timeline_submit_info.pSignalSemaphoreValues = &signal_value;
+
+    submit_info.pNext = &timeline_submit_info;
+    submit_info.signalSemaphoreCount = 1;
+    submit_info.pSignalSemaphores = &scheduler.timeline_semaphore;
+
+    // The fence tells when the slot can be written again.
+    vkResetFences(vk_logic_device, 1, &batch.fence);
+    if (vkQueueSubmit(scheduler.transfer_queue, 1, &submit_info, batch.fence) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to submit the upload batch! \n");
+    }
+
+    batch.in_flight = true;
+    scheduler.timeline_value = signal_value;
+    if (batch.last_ticket != 0) {
+        scheduler.submitted_ticket = batch.last_ticket;
+    }
+
+    scheduler.next_batch = (scheduler.next_batch + 1) % UPLOAD_STAGING_SLOTS;
+    scheduler.total_bytes += used;
+    scheduler.total_batches++;
+}
+
+
+bool is_upload_ready(const UploadScheduler& scheduler, UploadTicket ticket) {
+
+    // The graphics queue waits for the copy on the GPU, the CPU only has to know
+    // that it was submitted.
+    return ticket <= scheduler.submitted_ticket;
+}
+
+
+uint64_t get_upload_wait_value(const UploadScheduler& scheduler) {
+
+    // A semaphore wait only orders the commands of its own submit, so every graphics
+    // submit waits, not just the first one after an upload. Waiting for a value that
+    // is already signaled costs next to nothing.
+    return scheduler.timeline_value;
+}
+
+
+void print_upload_stats(const UploadScheduler& scheduler) {
+
+    if (scheduler.command_pool == VK_NULL_HANDLE) {
+        return;
+    }
+
+    std::cout << "Upload scheduler: " << scheduler.total_bytes / 1024 << " KB in "
+        << scheduler.total_batches << " batch(es) of at most " << scheduler.bytes_per_frame / 1024 << " KB, "
+        << scheduler.busy_frames << " frame(s) with every staging slot busy, peak "
+        << scheduler.peak_pending_bytes / 1024 << " KB pending, "
+        << scheduler.pending.size() << " upload(s) left. \n\n";
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "my_utils.hpp"
+#include "vk_memory.hpp"
+
+#include <deque>
+
+
+// Streams data into device-local buffers on the transfer queue, a little every frame.
+//
+// upload_buffers_with_staging() (see vk_buffer.hpp) copies everything at once and waits
+// for the copy: fine at startup, but an asset streamed in while rendering would stall
+// the frame. The scheduler instead queues the uploads and, once per frame, copies at most
+// bytes_per_frame of them into a staging slot and submits them on the transfer queue.
+// Nothing ever waits on the CPU: when every staging slot is still in use by the GPU the
+// frame simply uploads nothing.
+//
+// The staging buffer is split in UPLOAD_STAGING_SLOTS slots of bytes_per_frame bytes, each
+// with its command buffer and fence. A slot is used again once its fence is signaled.
+// An upload larger than bytes_per_frame is split across several frames.
+//
+// Synchronisation with the graphics queue: every batch signals the next value of a timeline
+// semaphore, and the graphics submit waits for the last value (see get_upload_wait_value()).
+// An upload can be used as soon as it has been submitted. The scheduler needs the
+// timelineSemaphore feature (Vulkan 1.2): the fence of a batch only tells the host that the
+// copy is done, it doesn't make the writes visible to the commands of another queue.
+// The destination buffers are shared CONCURRENT between the transfer and graphics families
+// (see create_buffer()), so no queue family ownership transfer is needed.
+
+
+// Staging slots, so transfers of that many frames can be in flight at once.
+const uint32_t UPLOAD_STAGING_SLOTS = 3;
+
+
+// Identifies an upload. Uploads complete in the order they are scheduled,
+// 0 is an upload that is always complete.
+typedef uint64_t UploadTicket;
+
+
+struct PendingUpload {
+
+    UploadTicket ticket;
+    std::vector<uint8_t> data; // Owned: the caller can free its copy right away
+    VkBuffer dst_buffer;
+    VkDeviceSize dst_offset;
+    VkDeviceSize uploaded = 0; // Bytes already copied by earlier batches
+};
+
+struct UploadBatch {
+
+    VkCommandBuffer command_buffer = VK_NULL_HANDLE;
+    VkFence fence = VK_NULL_HANDLE;
+    bool in_flight = false;
+    UploadTicket last_ticket = 0; // Last upload completed by this batch (0 = none)
+};
+
+
+struct UploadScheduler {
+
+    VkQueue transfer_queue = VK_NULL_HANDLE;
+    VkCommandPool command_pool = VK_NULL_HANDLE;
+
+    VkSemaphore timeline_semaphore = VK_NULL_HANDLE;
+    uint64_t timeline_value = 0; // Last value signaled by a submitted batch
+
+    VkBuffer staging_buffer = VK_NULL_HANDLE;
+    MemoryAllocation staging_allocation;
+    VkDeviceSize bytes_per_frame = 0; // Size of a staging slot
+
+    UploadBatch batches[UPLOAD_STAGING_SLOTS];
+    uint32_t next_batch = 0;
+
+    std::deque<PendingUpload> pending;
+    UploadTicket last_ticket = 0;      // Last ticket handed out
+    UploadTicket submitted_ticket = 0; // Every upload up to this one is submitted
+
+    // Whole run
+    uint64_t total_bytes = 0;
+    uint64_t total_batches = 0;
+    uint64_t busy_frames = 0; // Frames with pending uploads but no free staging slot
+    VkDeviceSize peak_pending_bytes = 0;
+};
+
+
+// bytes_per_frame caps what is copied (and submitted) every frame.
+// The device must have the timelineSemaphore feature enabled.
+void create_upload_scheduler(
+    UploadScheduler& scheduler,
+    MemoryAllocator& allocator, VkDevice vk_logic_device,
+    uint32_t transfer_family, VkQueue vk_transfer_queue,
+    VkDeviceSize bytes_per_frame);
+
+// The device must be idle. Pending uploads are dropped.
+void destroy_upload_scheduler(UploadScheduler& scheduler, MemoryAllocator& allocator, VkDevice vk_logic_device);
+
+// Queues a copy of size bytes of data into dst_buffer at dst_offset. The data is copied,
+// the buffer must have been created with TRANSFER_DST and be usable by the transfer family.
+// Throws if size is 0.
+UploadTicket schedule_buffer_upload(
+    UploadScheduler& scheduler,
+    const void* data, VkDeviceSize size,
+    VkBuffer dst_buffer, VkDeviceSize dst_offset);
+
+// Once per frame: recycles the batches the GPU is done with, then copies up to
+// bytes_per_frame of the pending uploads and submits them. Never waits.
+void process_uploads(UploadScheduler& scheduler, VkDevice vk_logic_device);
+
+// Whether the graphics queue can use what the upload wrote (as long as its submit waits
+// for get_upload_wait_value()).
+bool is_upload_ready(const UploadScheduler& scheduler, UploadTicket ticket);
+
+// The value of scheduler.timeline_semaphore the graphics submit must wait for before
+// reading uploaded data. 0 = nothing to wait for.
+uint64_t get_upload_wait_value(const UploadScheduler& scheduler);
+
+void print_upload_stats(const UploadScheduler& scheduler);